@@ -20,6 +20,7 @@
 #include "sim/netStringTable.h"
 
 #include "console/stringStack.h"
+#include "platform/metrics.h"
 
 using namespace Compiler;
 
@@ -198,11 +199,17 @@ void CodeBlock::getFunctionArgs(char buffer[1024], U32 ip)
    }
 }
 
+static Metric sScriptExec("script.exec", Metric::Timer);
+static U32 sExecDepth = 0;
+
 const char *CodeBlock::exec(U32 ip, const char *functionName, Namespace *thisNamespace, U32 argc, const char **argv, bool noCalls, StringTableEntry packageName, S32 setFrame)
 {
    static char traceBuffer[1024];
    U32 i;
 
+   // Only the outermost call is timed; nested calls are part of it.
+   U64 execStart = sExecDepth++ ? 0 : Platform::getRealMicroseconds();
+
    incRefCount();
    F64 *curFloatTable;
    char *curStringTable;
@@ -1199,6 +1206,9 @@ execFinished:
    }
 
    decRefCount();
+
+   if(!--sExecDepth)
+      sScriptExec.addTime(U32(Platform::getRealMicroseconds() - execStart));
    return STR.getStringValue();
 }
 
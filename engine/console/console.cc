@@ -5,7 +5,11 @@
 
 #include "platform/platform.h"
 #include "platform/platformThread.h"
+#include "platform/platformMutex.h"
+#include "platform/platformSemaphore.h"
+#include "platform/platformIntrinsics.h"
 #include "console/console.h"
+#include "console/consoleLogRing.h"
 #include "console/consoleInternal.h"
 #include "console/consoleObject.h"
 #include "core/fileStream.h"
@@ -156,10 +160,10 @@ namespace Con
 {
 
 static Vector<ConsumerCallback> gConsumers(__FILE__, __LINE__);
-static DataChunker consoleLogChunker;
 static Vector<ConsoleLogEntry> consoleLog(__FILE__, __LINE__);
 static bool consoleLogLocked;
 static bool logBufferEnabled=true;
+static S32 logBufferSize = 4096;
 static S32 printLevel = 10;
 static FileStream consoleLogFile;
 static const char *defLogFileName = "console.log";
@@ -179,6 +183,39 @@ static U32 completionBaseLen;
 static S32 gMainThreadID = -1;
 #endif
 
+/// @name Threaded logging
+///
+/// Lines bound for console.log are queued on gLogFileRing and appended to the
+/// file in batches by a writer thread (inline in single threaded builds).
+/// Lines printed off the main thread are also queued on gDeferredLogRing, and
+/// only reach the consumers and the history when the main thread calls
+/// dispatchQueuedLog().
+/// @{
+static ConsoleLogRing *gLogFileRing;
+static ConsoleLogRing *gDeferredLogRing;
+static void *gLogFileMutex;            ///< Guards consoleLogFile, newLogFile and mode changes.
+static volatile U32 gLogLinesQueued;
+static volatile U32 gLogLinesWritten;
+
+#ifdef TORQUE_MULTITHREAD
+static Thread *gLogWriterThread;
+static void *gLogWriterSemaphore;
+static volatile U32 gLogWriterQuit;
+#endif
+
+enum
+{
+   LogFileRingSize     = 1024,
+   DeferredLogRingSize = 256,
+   LogBatchSize        = 64 * 1024,
+};
+
+static void writeQueuedLog();
+#ifdef TORQUE_MULTITHREAD
+static void logWriterMain(S32);
+#endif
+/// @}
+
 /// Current script file name and root, these are registered as
 /// console variables.
 /// @{
@@ -194,7 +231,8 @@ ConsoleFunction( cls, void, 1, 1, "Clear the screen.")
 {
    if(consoleLogLocked)
       return;
-   consoleLogChunker.freeBlocks();
+   for(U32 i = 0; i < consoleLog.size(); i++)
+      dFree((void *)consoleLog[i].mString);
    consoleLog.setSize(0);
 };
 
@@ -226,6 +264,19 @@ void init()
    gMainThreadID = Thread::getCurrentThreadId();
 #endif
 
+   // Log queues and the file writer.
+   gLogFileRing     = new ConsoleLogRing(LogFileRingSize);
+   gDeferredLogRing = new ConsoleLogRing(DeferredLogRingSize);
+   gLogFileMutex    = Mutex::createMutex();
+   gLogLinesQueued  = 0;
+   gLogLinesWritten = 0;
+
+#ifdef TORQUE_MULTITHREAD
+   gLogWriterQuit      = 0;
+   gLogWriterSemaphore = Semaphore::createSemaphore(0);
+   gLogWriterThread    = new Thread((ThreadRunFunction)logWriterMain, 0, true);
+#endif
+
    // Initialize subsystems.
    Namespace::init();
    ConsoleConstructor::setup();
@@ -237,6 +288,7 @@ void init()
    // Variables
    setVariable("Con::prompt", "% ");
    addVariable("Con::logBufferEnabled", TypeBool, &logBufferEnabled);
+   addVariable("Con::logBufferSize", TypeS32, &logBufferSize);
    addVariable("Con::printLevel", TypeS32, &printLevel);
    addVariable("Con::warnUndefinedVariables", TypeBool, &gWarnUndefinedScriptVariables);
 
@@ -256,9 +308,33 @@ void init()
 void shutdown()
 {
    AssertFatal(active == true, "Con::shutdown should only be called once.");
+   // Get everything that was printed out to its destinations.
+   dispatchQueuedLog();
+   flushLog();
+
    active = false;
 
+#ifdef TORQUE_MULTITHREAD
+   dAtomicWrite(gLogWriterQuit, 1);
+   Semaphore::releaseSemaphore(gLogWriterSemaphore);
+   gLogWriterThread->join();
+   delete gLogWriterThread;
+   gLogWriterThread = NULL;
+   Semaphore::destroySemaphore(gLogWriterSemaphore);
+#endif
+
    consoleLogFile.close();
+   consoleLogMode = 0;
+
+   delete gLogFileRing;
+   delete gDeferredLogRing;
+   gLogFileRing = gDeferredLogRing = NULL;
+   Mutex::destroyMutex(gLogFileMutex);
+
+   for(U32 i = 0; i < consoleLog.size(); i++)
+      dFree((void *)consoleLog[i].mString);
+   consoleLog.clear();
+
    Namespace::shutdown();
 }
 
@@ -404,116 +480,254 @@ U32 tabComplete(char* inputBuffer, U32 cursorPos, U32 maxResultLength, bool forw
 }
 
 //------------------------------------------------------------------------------
-static void log(const char *string)
-{
-   // Bail if we ain't logging.
-   if (!consoleLogMode) 
-   {
-      return;
-   }
 
-   // In mode 1, we open, append, close on each log write.
+/// Make sure the log file is open and positioned for appending.  Called with
+/// gLogFileMutex held.
+static bool openLogForWrite()
+{
+   // In mode 1, we open, append, close on each batch of writes.
    if ((consoleLogMode & 0x3) == 1) 
    {
       consoleLogFile.open(defLogFileName, FileStream::ReadWrite);
    }
 
    // Write to the log if its status is hunky-dory.
-   if ((consoleLogFile.getStatus() == Stream::Ok) || (consoleLogFile.getStatus() == Stream::EOS)) 
+   if ((consoleLogFile.getStatus() != Stream::Ok) && (consoleLogFile.getStatus() != Stream::EOS)) 
+      return false;
+
+   consoleLogFile.setPosition(consoleLogFile.getStreamSize());
+   // If this is the first write...
+   if (newLogFile) 
    {
-      consoleLogFile.setPosition(consoleLogFile.getStreamSize());
-      // If this is the first write...
-      if (newLogFile) 
+      // Make a header.
+      Platform::LocalTime lt;
+      Platform::getLocalTime(lt);
+      char buffer[128];
+      dSprintf(buffer, sizeof(buffer), "//-------------------------- %d/%d/%d -- %02d:%02d:%02d -----\r\n",
+            lt.month + 1,
+            lt.monthday,
+            lt.year + 1900,
+            lt.hour,
+            lt.min,
+            lt.sec);
+      consoleLogFile.write(dStrlen(buffer), buffer);
+      newLogFile = false;
+   }
+   return true;
+}
+
+/// Drain gLogFileRing into the log file, one write per LogBatchSize bytes.
+/// Runs on the writer thread, or inline in single threaded builds.
+static void writeQueuedLog()
+{
+   static char batch[LogBatchSize];
+   char line[4096];
+   ConsoleLogEntry::Level level;
+   ConsoleLogEntry::Type type;
+
+   MutexHandle mutex;
+   mutex.lock(gLogFileMutex);
+
+   bool logging = consoleLogMode != 0;
+   bool opened = false;
+   U32 used = 0, lines = 0;
+
+   while (gLogFileRing->pop(level, type, line, sizeof(line)))
+   {
+      lines++;
+
+      // Logging was turned off after this was queued.
+      if (!logging)
+         continue;
+
+      U32 len = dStrlen(line);
+      if (used + len + 2 > LogBatchSize)
       {
-         // Make a header.
-         Platform::LocalTime lt;
-         Platform::getLocalTime(lt);
-         char buffer[128];
-         dSprintf(buffer, sizeof(buffer), "//-------------------------- %d/%d/%d -- %02d:%02d:%02d -----\r\n",
-               lt.month + 1,
-               lt.monthday,
-               lt.year + 1900,
-               lt.hour,
-               lt.min,
-               lt.sec);
-         consoleLogFile.write(dStrlen(buffer), buffer);
-         newLogFile = false;
-         if (consoleLogMode & 0x4) 
-         {
-            // Dump anything that has been printed to the console so far.
-            consoleLogMode -= 0x4;
-            U32 size, line;
-            ConsoleLogEntry *log;
-            getLockLog(log, size);
-            for (line = 0; line < size; line++) 
-            {
-               consoleLogFile.write(dStrlen(log[line].mString), log[line].mString);
-               consoleLogFile.write(2, "\r\n");
-            }
-            unlockLog();
-         }
+         if (opened || (opened = openLogForWrite()) == true)
+            consoleLogFile.write(used, batch);
+         used = 0;
       }
-      // Now write what we came here to write.
-      consoleLogFile.write(dStrlen(string), string);
-      consoleLogFile.write(2, "\r\n");
+      dMemcpy(batch + used, line, len);
+      used += len;
+      batch[used++] = '\r';
+      batch[used++] = '\n';
    }
 
-   if ((consoleLogMode & 0x3) == 1) 
-   {
+   if (used && (opened || (opened = openLogForWrite()) == true))
+      consoleLogFile.write(used, batch);
+
+   if (opened && (consoleLogMode & 0x3) == 1) 
       consoleLogFile.close();
+
+   dFetchAndAdd(gLogLinesWritten, lines);
+}
+
+#ifdef TORQUE_MULTITHREAD
+static void logWriterMain(S32)
+{
+   for (;;)
+   {
+      Semaphore::acquireSemaphore(gLogWriterSemaphore);
+      writeQueuedLog();
+      if (dAtomicRead(gLogWriterQuit))
+         return;
+   }
+}
+#endif
+
+static void log(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, const char *string)
+{
+   // Bail if we ain't logging.
+   if (!consoleLogMode || !gLogFileRing) 
+   {
+      return;
+   }
+
+   gLogFileRing->push(level, type, string, true);
+   dFetchAndAdd(gLogLinesQueued, 1);
+
+#ifdef TORQUE_MULTITHREAD
+   Semaphore::releaseSemaphore(gLogWriterSemaphore);
+#else
+   writeQueuedLog();
+#endif
+}
+
+void flushLog()
+{
+   if (!gLogFileRing)
+      return;
+
+#ifdef TORQUE_MULTITHREAD
+   U32 target = dAtomicRead(gLogLinesQueued);
+   Semaphore::releaseSemaphore(gLogWriterSemaphore);
+   while (S32(dAtomicRead(gLogLinesWritten) - target) < 0)
+      Platform::sleep(1);
+#else
+   writeQueuedLog();
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+static void appendToHistory(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, const char *string)
+{
+   if(!logBufferEnabled || consoleLogLocked)
+      return;
+
+   // Keep the history bounded.  Trim an extra eighth when we hit the limit
+   // so the shuffle down isn't paid on every line.
+   if(logBufferSize > 0 && consoleLog.size() >= logBufferSize)
+   {
+      U32 trim = getMin(U32(consoleLog.size() - logBufferSize + 1 + logBufferSize / 8), U32(consoleLog.size()));
+      for(U32 i = 0; i < trim; i++)
+         dFree((void *)consoleLog[i].mString);
+      dMemmove(consoleLog.address(), consoleLog.address() + trim, (consoleLog.size() - trim) * sizeof(ConsoleLogEntry));
+      consoleLog.setSize(consoleLog.size() - trim);
+   }
+
+   ConsoleLogEntry entry;
+   entry.mLevel  = level;
+   entry.mType   = type;
+   entry.mString = dStrdup(string);
+   consoleLog.push_back(entry);
+}
+
+/// Split a formatted print into lines for the log file and/or the history.
+static void splitLines(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, char *buffer, bool toFile, bool toHistory)
+{
+   char *pos = buffer;
+   while(*pos)
+   {
+      if(*pos == '\t')
+         *pos = '^';
+      pos++;
+   }
+   pos = buffer;
+
+   for(;;)
+   {
+      char *eofPos = dStrchr(pos, '\n');
+      if(eofPos)
+         *eofPos = 0;
+
+      if(toFile)
+         log(level, type, pos);
+      if(toHistory)
+         appendToHistory(level, type, pos);
+      if(!eofPos)
+         break;
+      pos = eofPos + 1;
    }
 }
 
+void dispatchQueuedLog()
+{
+   static bool dispatching = false;
+   if(!gDeferredLogRing || dispatching)
+      return;
+   dispatching = true;
+
+   char buffer[4096];
+   ConsoleLogEntry::Level level;
+   ConsoleLogEntry::Type type;
+   while(gDeferredLogRing->pop(level, type, buffer, sizeof(buffer)))
+   {
+      for(U32 i = 0; i < gConsumers.size(); i++)
+         gConsumers[i](level, buffer);
+
+      // Already went to the log file when it was printed.
+      if(logBufferEnabled)
+         splitLines(level, type, buffer, false, true);
+   }
+
+   dispatching = false;
+
+   U32 dropped = gDeferredLogRing->takeDropped();
+   if(dropped)
+      warnf("Con - %d lines printed from other threads were dropped, the main thread wasn't keeping up.", dropped);
+}
+
 //------------------------------------------------------------------------------
 
 static void _printf(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, const char* fmt, va_list argptr)
 {
+   // Before init (and after shutdown) there is nobody else to hand off to.
+   bool mainThread = !active || isMainThread();
+
    char buffer[4096];
    U32 offset = 0;
-   if(gEvalState.traceOn && gEvalState.stack.size())
+   if(mainThread)
    {
-      offset = gEvalState.stack.size() * 3;
-      for(U32 i = 0; i < offset; i++)
-         buffer[i] = ' ';
+      // Lines other threads printed go out first.
+      dispatchQueuedLog();
+
+      if(gEvalState.traceOn && gEvalState.stack.size())
+      {
+         offset = gEvalState.stack.size() * 3;
+         for(U32 i = 0; i < offset; i++)
+            buffer[i] = ' ';
+      }
    }
    _vsprintf_p(buffer + offset, sizeof(buffer) - offset, fmt, argptr);
    //dVsprintf(buffer + offset, sizeof(buffer) - offset, fmt, argptr);
 
+   if(!mainThread)
+   {
+      // The consumers and the history belong to the main thread; the log file
+      // gets the line now so it keeps its place relative to other threads.
+      if(gDeferredLogRing)
+         gDeferredLogRing->push(level, type, buffer, false);
+      if(consoleLogMode)
+         splitLines(level, type, buffer, true, false);
+      return;
+   }
+
    for(U32 i = 0; i < gConsumers.size(); i++)
       gConsumers[i](level, buffer);
 
    if(logBufferEnabled || consoleLogMode)
-   {
-      char *pos = buffer;
-      while(*pos)
-      {
-         if(*pos == '\t')
-            *pos = '^';
-         pos++;
-      }
-      pos = buffer;
-
-      for(;;)
-      {
-         char *eofPos = dStrchr(pos, '\n');
-         if(eofPos)
-            *eofPos = 0;
-
-         log(pos);
-         if(logBufferEnabled && !consoleLogLocked)
-         {
-            ConsoleLogEntry entry;
-            entry.mLevel  = level;
-            entry.mType   = type;
-            entry.mString = (const char *)consoleLogChunker.alloc(dStrlen(pos) + 1);
-            dStrcpy(const_cast<char*>(entry.mString), pos);
-            consoleLog.push_back(entry);
-         }
-         if(!eofPos)
-            break;
-         pos = eofPos + 1;
-      }
-   }
+      splitLines(level, type, buffer, true, true);
 }
 
 //------------------------------------------------------------------------------
@@ -990,6 +1204,12 @@ bool isMethod(const char *cn, const char *fn) {
 
 void setLogMode(S32 newMode)
 {
+   // Anything already queued was printed under the old mode.
+   flushLog();
+
+   MutexHandle mutex;
+   mutex.lock(gLogFileMutex);
+
    if ((newMode & 0x3) != (consoleLogMode & 0x3)) {
       if (newMode && !consoleLogMode) {
          // Enabling logging when it was previously disabled.
@@ -1005,6 +1225,16 @@ void setLogMode(S32 newMode)
       }
       consoleLogMode = newMode;
    }
+
+   mutex.unlock();
+
+   if ((consoleLogMode & 0x4) && newLogFile) 
+   {
+      // Dump anything that has been printed to the console so far.
+      consoleLogMode -= 0x4;
+      for (U32 line = 0; line < consoleLog.size(); line++) 
+         log(consoleLog[line].mLevel, consoleLog[line].mType, consoleLog[line].mString);
+   }
 }
 
 Namespace *lookupNamespace(const char *ns)
@@ -566,6 +566,14 @@ namespace Con
    void unlockLog(void);
    void setLogMode(S32 mode);
 
+   /// Block until every line queued so far has been written to the log file.
+   void flushLog();
+
+   /// Hand lines printed from other threads to the consumers and the log
+   /// history.  Must be called from the main thread; printing from the main
+   /// thread does this too.
+   void dispatchQueuedLog();
+
    /// @}
 
    /// @name Dynamic Type System
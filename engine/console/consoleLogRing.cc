@@ -0,0 +1,124 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "platform/platformIntrinsics.h"
+#include "console/consoleLogRing.h"
+
+//------------------------------------------------------------------------------
+
+ConsoleLogRing::ConsoleLogRing(U32 capacity)
+{
+   U32 size = 2;
+   while(size < capacity)
+      size <<= 1;
+
+   mSlots = new Slot[size];
+   mMask  = size - 1;
+   for(U32 i = 0; i < size; i++)
+   {
+      mSlots[i].sequence = i;
+      mSlots[i].overflow = NULL;
+   }
+
+   mHead    = 0;
+   mTail    = 0;
+   mDropped = 0;
+}
+
+ConsoleLogRing::~ConsoleLogRing()
+{
+   for(U32 i = 0; i <= mMask; i++)
+      dFree(mSlots[i].overflow);
+   delete [] mSlots;
+}
+
+//------------------------------------------------------------------------------
+
+bool ConsoleLogRing::push(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, const char *line, bool block)
+{
+   Slot *slot;
+   U32 pos = dAtomicRead(mHead);
+   for(;;)
+   {
+      slot = &mSlots[pos & mMask];
+      S32 diff = S32(dAtomicRead(slot->sequence) - pos);
+
+      if(diff == 0)
+      {
+         // Free slot, try to claim it.
+         if(dCompareAndSwap(mHead, pos, pos + 1))
+            break;
+         pos = dAtomicRead(mHead);
+      }
+      else if(diff < 0)
+      {
+         // Full: the consumer hasn't released this slot from the last lap.
+         if(!block)
+         {
+            dFetchAndAdd(mDropped, 1);
+            return false;
+         }
+         Platform::sleep(1);
+         pos = dAtomicRead(mHead);
+      }
+      else
+      {
+         // Someone else got there first.
+         pos = dAtomicRead(mHead);
+      }
+   }
+
+   U32 length = dStrlen(line);
+   slot->level  = level;
+   slot->type   = type;
+   slot->length = getMin(length, U32(U16_MAX));
+
+   if(slot->length < InlineLength)
+      dMemcpy(slot->text, line, slot->length + 1);
+   else
+   {
+      slot->overflow = (char *)dMalloc(slot->length + 1);
+      dMemcpy(slot->overflow, line, slot->length);
+      slot->overflow[slot->length] = 0;
+   }
+
+   // Publish.
+   dAtomicWrite(slot->sequence, pos + 1);
+   return true;
+}
+
+bool ConsoleLogRing::pop(ConsoleLogEntry::Level &level, ConsoleLogEntry::Type &type, char *buffer, U32 bufferSize)
+{
+   Slot *slot = &mSlots[mTail & mMask];
+   if(dAtomicRead(slot->sequence) != mTail + 1)
+      return false;
+
+   level = ConsoleLogEntry::Level(slot->level);
+   type  = ConsoleLogEntry::Type(slot->type);
+
+   U32 length = getMin(U32(slot->length), bufferSize - 1);
+   dMemcpy(buffer, slot->overflow ? slot->overflow : slot->text, length);
+   buffer[length] = 0;
+
+   if(slot->overflow)
+   {
+      dFree(slot->overflow);
+      slot->overflow = NULL;
+   }
+
+   // Hand the slot back to the producers for the next lap.
+   dAtomicWrite(slot->sequence, mTail + mMask + 1);
+   mTail++;
+   return true;
+}
+
+U32 ConsoleLogRing::takeDropped()
+{
+   U32 dropped = dAtomicRead(mDropped);
+   if(dropped)
+      dFetchAndAdd(mDropped, U32(-S32(dropped)));
+   return dropped;
+}
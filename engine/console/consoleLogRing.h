@@ -0,0 +1,66 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _CONSOLELOGRING_H_
+#define _CONSOLELOGRING_H_
+
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _CONSOLE_H_
+#include "console/console.h"
+#endif
+
+/// Bounded queue of console lines that any number of threads can push to
+/// without locking, drained by a single consumer thread.
+///
+/// Each slot carries a sequence number: a producer claims a slot by advancing
+/// the head with a compare-and-swap, fills it in, then publishes it by
+/// bumping the slot's sequence, which is what the consumer waits for. Lines
+/// that don't fit inline spill into a heap block owned by the slot.
+class ConsoleLogRing
+{
+   enum
+   {
+      InlineLength = 120,   ///< Characters stored in the slot itself.
+   };
+
+   struct Slot
+   {
+      volatile U32 sequence;
+      U8           level;
+      U8           type;
+      U16          length;
+      char        *overflow;
+      char         text[InlineLength];
+   };
+
+   Slot *mSlots;
+   U32   mMask;
+
+   volatile U32 mHead;        ///< Next position to claim (producers).
+   U32          mTail;        ///< Next position to read (consumer only).
+   volatile U32 mDropped;     ///< Lines lost to a full ring in non-blocking pushes.
+
+  public:
+   /// @param capacity Number of slots, rounded up to a power of two.
+   ConsoleLogRing(U32 capacity);
+   ~ConsoleLogRing();
+
+   /// Queue a line.  If the ring is full a blocking push sleeps until the
+   /// consumer makes room, otherwise the line is dropped and counted.
+   /// @return false if the line was dropped.
+   bool push(ConsoleLogEntry::Level level, ConsoleLogEntry::Type type, const char *line, bool block);
+
+   /// Take the oldest line, copying it (truncated if need be) into buffer.
+   /// Only ever call this from the one consumer thread.
+   /// @return false if the ring is empty.
+   bool pop(ConsoleLogEntry::Level &level, ConsoleLogEntry::Type &type, char *buffer, U32 bufferSize);
+
+   /// Return and reset the number of dropped lines.
+   U32 takeDropped();
+};
+
+#endif // _CONSOLELOGRING_H_
@@ -1405,6 +1405,9 @@ namespace Sim
    U32  getEventTimeLeft(U32 eventId);
    U32  getTimeSinceStart(U32 eventId);
    U32  getScheduleDuration(U32 eventId);
+
+   /// Sim time until the first queued event is due, or U32_MAX if none are.
+   U32  getTimeToNextEvent();
 }
 
 //----------------------------------------------------------------------------
@@ -105,6 +105,10 @@ U32 postEvent(SimObject *destObject, SimEvent* event,U32 time)
 
    Mutex::unlockMutex(gEventQueueMutex);
 
+   // The main loop may be waiting for something to do.
+   if(!Con::isMainThread())
+      Platform::wakeMainLoop();
+
    return seqCount;
 }
 
@@ -188,6 +192,18 @@ U32 getEventTimeLeft(U32 eventSequence)
    return 0;   
 }
 
+U32 getTimeToNextEvent()
+{
+   Mutex::lockMutex(gEventQueueMutex);
+
+   U32 t = U32_MAX;
+   if(gEventQueue)
+      t = gEventQueue->time > gCurrentTime ? gEventQueue->time - gCurrentTime : 0;
+
+   Mutex::unlockMutex(gEventQueueMutex);
+   return t;
+}
+
 U32 getScheduleDuration(U32 eventSequence)
 {
    for(SimEvent *walk = gEventQueue; walk; walk = walk->nextEvent)
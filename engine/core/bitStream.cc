@@ -343,6 +343,45 @@ S32 BitStream::readSignedInt(S32 bitCount)
       return readInt(bitCount - 1);
 }
 
+enum
+{
+   SmallDeltaBits = 8,
+};
+
+void BitStream::writeDeltaInts(const S32 *values, const S32 *baseline, U32 count, U32 bitCount)
+{
+   AssertFatal(bitCount <= 30, "BitStream::writeDeltaInts - values too big.");
+   for(U32 i = 0; i < count; i++)
+   {
+      S32 delta = values[i] - baseline[i];
+      if(writeFlag(delta == 0))
+         continue;
+
+      // Zigzag, so small changes either way are small numbers, less one
+      // since zero is taken care of.
+      U32 bits = ((U32(delta) << 1) ^ U32(delta >> 31)) - 1;
+      if(writeFlag(bits < (1 << SmallDeltaBits)))
+         writeInt(S32(bits), SmallDeltaBits);
+      else
+         writeInt(S32(bits), bitCount + 1);
+   }
+}
+
+void BitStream::readDeltaInts(S32 *values, const S32 *baseline, U32 count, U32 bitCount)
+{
+   for(U32 i = 0; i < count; i++)
+   {
+      if(readFlag())
+      {
+         values[i] = baseline[i];
+         continue;
+      }
+
+      U32 bits = U32(readInt(readFlag() ? SmallDeltaBits : bitCount + 1)) + 1;
+      values[i] = baseline[i] + (S32(bits >> 1) ^ -S32(bits & 1));
+   }
+}
+
 void BitStream::writeNormalVector(const Point3F& vec, S32 bitCount)
 {
    F32 phi   = mAtan(vec.x, vec.y) / M_PI;
@@ -112,6 +112,18 @@ public:
    void writeRangedU32(U32 value, U32 rangeStart, U32 rangeEnd);
    U32  readRangedU32(U32 rangeStart, U32 rangeEnd);
 
+   /// Write a value of up to maxBits bits that is usually much smaller, such
+   /// as a ghost index. Values that fit in half the bits take a flag and
+   /// half the bits, the rest a flag and maxBits.
+   void writeVariableU32(U32 value, U32 maxBits);
+   U32  readVariableU32(U32 maxBits);
+
+   /// Write count values of up to bitCount bits (signed, at most 30) as
+   /// differences from a baseline the reader also has. An unchanged value
+   /// costs a bit, a small change ten, anything else bitCount + 3.
+   void writeDeltaInts(const S32 *values, const S32 *baseline, U32 count, U32 bitCount);
+   void readDeltaInts(S32 *values, const S32 *baseline, U32 count, U32 bitCount);
+
    // read and write floats... floats are 0 to 1 inclusive, signed floats are -1 to 1 inclusive
 
    F32  readFloat(S32 bitCount);
@@ -274,4 +286,20 @@ inline U32 BitStream::readRangedU32(U32 rangeStart, U32 rangeEnd)
    return val + rangeStart;
 }
 
+inline void BitStream::writeVariableU32(U32 value, U32 maxBits)
+{
+   U32 smallBits = (maxBits + 1) >> 1;
+   if(writeFlag(value < (1 << smallBits)))
+      writeInt(S32(value), S32(smallBits));
+   else
+      writeInt(S32(value), S32(maxBits));
+}
+
+inline U32 BitStream::readVariableU32(U32 maxBits)
+{
+   if(readFlag())
+      return U32(readInt(S32((maxBits + 1) >> 1)));
+   return U32(readInt(S32(maxBits)));
+}
+
 #endif //_BITSTREAM_H_
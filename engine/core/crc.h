@@ -8,6 +8,9 @@
 
 #define INITIAL_CRC_VALUE 0xffffffff
 
+/// Size of the segments calculateCRCStream() reads from the stream.
+#define CRCStreamBufferSize (64 * 1024)
+
 class Stream;
 
 U32 calculateCRC(const void * buffer, S32 len, U32 crcVal = INITIAL_CRC_VALUE);
@@ -224,10 +224,12 @@ void ConnectionProtocol::processRawPacket(BitStream *pstream)
    }
    keepAlive(); // notification that the connection is ok
 
-   if(mLastSeqRecvd != pkSequenceNumber && pkPacketType == DataPacket)
-      handlePacket(pstream);
-
+   // handlePacket() can count on mLastSeqRecvd being this packet.
+   bool newPacket = mLastSeqRecvd != pkSequenceNumber;
    mLastSeqRecvd = pkSequenceNumber;
+
+   if(newPacket && pkPacketType == DataPacket)
+      handlePacket(pstream);
 }
 
 bool ConnectionProtocol::windowFull()
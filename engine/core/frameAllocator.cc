@@ -4,18 +4,127 @@
 //-----------------------------------------------------------------------------
 
 #include "core/frameAllocator.h"
+#include "platform/platformMutex.h"
 #include "console/console.h"
 
-U8*   FrameAllocator::smBuffer = NULL;
-U32   FrameAllocator::smWaterMark = 0;
-U32   FrameAllocator::smHighWaterMark = 0;
+FrameAllocator::Arena  FrameAllocator::smMainArena;
+FrameAllocator::Arena* FrameAllocator::smThreadArenas = NULL;
+ThreadStorage          FrameAllocator::smArena;
+void*                  FrameAllocator::smMutex = NULL;
+U32                    FrameAllocator::smThreadFrameSize = 0;
 
-#if defined(TORQUE_DEBUG)
+//-----------------------------------------------------------------------------
+
+static void initArena(FrameAllocator::Arena* arena, const U32 size)
+{
+   arena->buffer        = new U8[size];
+   arena->waterMark     = 0;
+   arena->highWaterMark = size;
+   arena->maxWaterMark  = 0;
+   arena->allocCount    = 0;
+   arena->threadId      = Thread::getCurrentThreadId();
+   arena->next          = NULL;
+}
+
+void FrameAllocator::init(const U32 frameSize, const U32 threadFrameSize)
+{
+   AssertFatal(smMainArena.buffer == NULL, "Error, already initialized");
+
+   initArena(&smMainArena, frameSize);
+   smThreadFrameSize = threadFrameSize;
+   smMutex = Mutex::createMutex();
+
+   smArena.set(&smMainArena);
+}
+
+void FrameAllocator::destroy()
+{
+   AssertFatal(smMainArena.buffer != NULL, "Error, not initialized");
+
+   // Any thread that didn't clean up after itself.
+   while(smThreadArenas)
+   {
+      Arena* next = smThreadArenas->next;
+      delete [] smThreadArenas->buffer;
+      delete smThreadArenas;
+      smThreadArenas = next;
+   }
+
+   delete [] smMainArena.buffer;
+   smMainArena.buffer = NULL;
+   smMainArena.waterMark = 0;
+   smMainArena.highWaterMark = 0;
+
+   smArena.set(NULL);
+   Mutex::destroyMutex(smMutex);
+   smMutex = NULL;
+}
+
+FrameAllocator::Arena* FrameAllocator::createThreadArena()
+{
+   AssertFatal(smMutex != NULL, "FrameAllocator - used before init()!");
+
+   Arena* arena = new Arena;
+   initArena(arena, smThreadFrameSize);
+
+   Mutex::lockMutex(smMutex);
+   arena->next = smThreadArenas;
+   smThreadArenas = arena;
+   Mutex::unlockMutex(smMutex);
+
+   smArena.set(arena);
+   return arena;
+}
+
+void FrameAllocator::releaseThreadArena()
+{
+   Arena* arena = (Arena*)smArena.get();
+   if(!arena || arena == &smMainArena)
+      return;
+
+   AssertFatal(arena->waterMark == 0, "FrameAllocator::releaseThreadArena - memory still in use!");
+
+   Mutex::lockMutex(smMutex);
+   for(Arena** walk = &smThreadArenas; *walk; walk = &(*walk)->next)
+   {
+      if(*walk == arena)
+      {
+         *walk = arena->next;
+         break;
+      }
+   }
+   Mutex::unlockMutex(smMutex);
+
+   smArena.set(NULL);
+   delete [] arena->buffer;
+   delete arena;
+}
+
+//-----------------------------------------------------------------------------
+
+static void printArena(const char* name, const FrameAllocator::Arena* arena)
+{
+   Con::printf("  %-8s thread %-10u %7d / %7d bytes in use, %7d max, %d allocs", name, arena->threadId,
+      arena->waterMark, arena->highWaterMark, arena->maxWaterMark, arena->allocCount);
+}
+
+void FrameAllocator::dumpStats()
+{
+   Con::printf("Frame allocators:");
+   if(smMainArena.buffer)
+      printArena("main", &smMainArena);
+
+   if(!smMutex)
+      return;
+
+   Mutex::lockMutex(smMutex);
+   for(Arena* walk = smThreadArenas; walk; walk = walk->next)
+      printArena("worker", walk);
+   Mutex::unlockMutex(smMutex);
+}
 
 ConsoleFunction(getMaxFrameAllocation, S32, 1,1, "getMaxFrameAllocation();")
 {
    argc, argv;
-   return sgMaxFrameAllocation;
+   return FrameAllocator::getArena()->maxWaterMark;
 }
-
-#endif
@@ -10,6 +10,10 @@
 #include "platform/platform.h"
 #endif
 
+#ifndef _PLATFORMTHREAD_H_
+#include "platform/platformThread.h"
+#endif
+
 /// Temporary memory pool for per-frame allocations.
 ///
 /// In the course of rendering a frame, it is often necessary to allocate
@@ -26,66 +30,90 @@
 ///   // Free frameAllocator memory
 ///   FrameAllocator::setWaterMark(waterMark);
 /// @endcode
+///
+/// Every thread has its own arena, so the calls above are safe from worker
+/// threads too. The thread that calls init() gets the frameSize buffer; any
+/// other thread gets a buffer of threadFrameSize the first time it allocates.
+/// A thread that is about to exit should call releaseThreadArena(), anything
+/// left over is freed by destroy().
 class FrameAllocator
 {
-   static U8*   smBuffer;
-   static U32   smHighWaterMark;
-   static U32   smWaterMark;
+  public:
+   /// One thread's buffer.
+   struct Arena
+   {
+      U8*    buffer;
+      U32    waterMark;
+      U32    highWaterMark;     ///< Size of the buffer.
+      U32    maxWaterMark;      ///< Most ever in use at once.
+      U32    allocCount;        ///< Allocations since init.
+      U32    threadId;
+      Arena* next;
+   };
+
+  private:
+   static Arena         smMainArena;
+   static Arena*        smThreadArenas;   ///< Arenas made for other threads.
+   static ThreadStorage smArena;          ///< This thread's arena.
+   static void*         smMutex;          ///< Guards smThreadArenas.
+   static U32           smThreadFrameSize;
+
+   static Arena* createThreadArena();
 
   public:
-   inline static void init(const U32 frameSize);
-   inline static void destroy();
+   static void init(const U32 frameSize, const U32 threadFrameSize = 256 << 10);
+   static void destroy();
+
+   /// Free the calling thread's arena, if it isn't the main one.
+   static void releaseThreadArena();
+
+   /// The calling thread's arena. Looking it up costs a thread storage
+   /// access, so code making many allocations can fetch it once and use
+   /// the overloads taking an Arena.
+   inline static Arena* getArena();
 
    inline static void* alloc(const U32 allocSize);
+   inline static void* alloc(Arena* arena, const U32 allocSize);
 
    inline static void setWaterMark(const U32);
+   inline static void setWaterMark(Arena* arena, const U32);
    inline static U32  getWaterMark();
    inline static U32  getHighWaterMark();
-};
 
-#if defined(TORQUE_DEBUG)
-static S32 sgMaxFrameAllocation = 0;
-#endif
+   /// Print the usage of every thread's arena to the console.
+   static void dumpStats();
+};
 
-void FrameAllocator::init(const U32 frameSize)
+FrameAllocator::Arena* FrameAllocator::getArena()
 {
-   AssertFatal(smBuffer == NULL, "Error, already initialized");
-   smBuffer = new U8[frameSize];
-   smWaterMark = 0;
-   smHighWaterMark = frameSize;
+   Arena* arena = (Arena*)smArena.get();
+   return arena ? arena : createThreadArena();
 }
 
-void FrameAllocator::destroy()
+void* FrameAllocator::alloc(const U32 allocSize)
 {
-   AssertFatal(smBuffer != NULL, "Error, not initialized");
-
-   delete [] smBuffer;
-   smBuffer = NULL;
-   smWaterMark = 0;
-   smHighWaterMark = 0;
+   return alloc(getArena(), allocSize);
 }
 
-
-void* FrameAllocator::alloc(const U32 allocSize)
+void* FrameAllocator::alloc(Arena* arena, const U32 allocSize)
 {
    U32 _allocSize = allocSize;
 #if defined(FRAMEALLOCATOR_DEBUG_GUARD)
    _allocSize+=4;
 #endif
-   AssertFatal(smBuffer != NULL, "Error, no buffer!");
-   AssertFatal(smWaterMark + _allocSize <= smHighWaterMark, "Error alloc too large, increase frame size!");
+   AssertFatal(arena->buffer != NULL, "Error, no buffer!");
+   AssertFatal(arena->waterMark + _allocSize <= arena->highWaterMark, "Error alloc too large, increase frame size!");
 
-   U8* p = &smBuffer[smWaterMark];
-   smWaterMark += _allocSize;
+   U8* p = &arena->buffer[arena->waterMark];
+   arena->waterMark += _allocSize;
+   arena->allocCount++;
 
-#if defined(TORQUE_DEBUG)
-   if (smWaterMark > sgMaxFrameAllocation)
-      sgMaxFrameAllocation = smWaterMark;
-#endif
+   if (arena->waterMark > arena->maxWaterMark)
+      arena->maxWaterMark = arena->waterMark;
 
 #if defined(FRAMEALLOCATOR_DEBUG_GUARD)
-   U32 *flag = (U32*) &smBuffer[smWaterMark-4];
-   *flag = 0xdeadbeef ^ smWaterMark;
+   U32 *flag = (U32*) &arena->buffer[arena->waterMark-4];
+   *flag = 0xdeadbeef ^ arena->waterMark;
 #endif
    return p;
 }
@@ -93,26 +121,31 @@ void* FrameAllocator::alloc(const U32 allocSize)
 
 void FrameAllocator::setWaterMark(const U32 waterMark)
 {
-   AssertFatal(waterMark < smHighWaterMark, "Error, invalid waterMark");
+   setWaterMark(getArena(), waterMark);
+}
+
+void FrameAllocator::setWaterMark(Arena* arena, const U32 waterMark)
+{
+   AssertFatal(waterMark < arena->highWaterMark, "Error, invalid waterMark");
 
 #if defined(FRAMEALLOCATOR_DEBUG_GUARD)
-   if(smWaterMark >= 4 )
+   if(arena->waterMark >= 4 )
    {
-      U32 *flag = (U32*) &smBuffer[smWaterMark-4];
-      AssertFatal( *flag == 0xdeadbeef ^ smWaterMark, "FrameAllocator guard overwritten!");
+      U32 *flag = (U32*) &arena->buffer[arena->waterMark-4];
+      AssertFatal( *flag == 0xdeadbeef ^ arena->waterMark, "FrameAllocator guard overwritten!");
    }
 #endif
-   smWaterMark = waterMark;
+   arena->waterMark = waterMark;
 }
 
 U32 FrameAllocator::getWaterMark()
 {
-   return smWaterMark;
+   return getArena()->waterMark;
 }
 
 U32 FrameAllocator::getHighWaterMark()
 {
-   return smHighWaterMark;
+   return getArena()->highWaterMark;
 }
 
 /// Helper class to deal with FrameAllocator usage.
@@ -132,22 +165,24 @@ U32 FrameAllocator::getHighWaterMark()
 /// don't have to remember to reset the FrameAllocator on every posssible branch.
 class FrameAllocatorMarker
 {
+   FrameAllocator::Arena* mArena;
    U32 mMarker;
 
 public:
    FrameAllocatorMarker()
    {
-      mMarker = FrameAllocator::getWaterMark();
+      mArena = FrameAllocator::getArena();
+      mMarker = mArena->waterMark;
    }
 
    ~FrameAllocatorMarker()
    {
-      FrameAllocator::setWaterMark(mMarker);
+      FrameAllocator::setWaterMark(mArena, mMarker);
    }
 
    void* alloc(const U32 allocSize) const
    {
-      return FrameAllocator::alloc(allocSize);
+      return FrameAllocator::alloc(mArena, allocSize);
    }
 };
 
@@ -181,6 +216,7 @@ template<class T>
 class FrameTemp
 {
 protected:
+   FrameAllocator::Arena *mArena;
    U32 mWaterMark;
    T *mMemory;
 
@@ -203,14 +239,15 @@ public:
    FrameTemp( const U32 count = 1 )
    {
       AssertFatal( count > 0, "Allocating a FrameTemp with less than one instance" );
-      mWaterMark = FrameAllocator::getWaterMark();
-      mMemory = static_cast<T *>( FrameAllocator::alloc( sizeof( T ) * count ) );
+      mArena = FrameAllocator::getArena();
+      mWaterMark = mArena->waterMark;
+      mMemory = static_cast<T *>( FrameAllocator::alloc( mArena, sizeof( T ) * count ) );
    }
 
    /// Destructor restores the watermark
    ~FrameTemp()
    {
-      FrameAllocator::setWaterMark( mWaterMark );
+      FrameAllocator::setWaterMark( mArena, mWaterMark );
    }
 
    /// NOTE: This will return the memory, NOT perform a ones-complement
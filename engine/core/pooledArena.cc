@@ -0,0 +1,212 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "platform/platformMutex.h"
+#include "core/pooledArena.h"
+#include "core/frameAllocator.h"
+#include "console/console.h"
+
+PooledArena *PooledArena::smList = NULL;
+
+//-----------------------------------------------------------------------------
+
+PooledArena::PooledArena(const char *name, U32 chunkSize, bool threadSafe)
+{
+   mName        = name;
+   mChunkSize   = chunkSize;
+   mMutex       = threadSafe ? Mutex::createMutex() : NULL;
+
+   mCurrent     = NULL;
+   mFree        = NULL;
+   dMemset(mRecycled, 0, sizeof(mRecycled));
+
+   mAllocCount  = 0;
+   mBytesInUse  = 0;
+   mPeakBytes   = 0;
+   mChunkAllocs = 0;
+   mReserved    = 0;
+
+   mNext  = smList;
+   smList = this;
+}
+
+PooledArena::~PooledArena()
+{
+   freeAll();
+
+   for(PooledArena **walk = &smList; *walk; walk = &(*walk)->mNext)
+   {
+      if(*walk == this)
+      {
+         *walk = mNext;
+         break;
+      }
+   }
+
+   if(mMutex)
+      Mutex::destroyMutex(mMutex);
+}
+
+//-----------------------------------------------------------------------------
+
+void *PooledArena::alloc(U32 size)
+{
+   size = (size + Alignment - 1) & ~(Alignment - 1);
+
+   if(mMutex)
+      Mutex::lockMutex(mMutex);
+
+   void *ret;
+   if(size && size <= MaxRecycledSize && mRecycled[size / Alignment - 1])
+   {
+      ret = mRecycled[size / Alignment - 1];
+      mRecycled[size / Alignment - 1] = *(void **)ret;
+   }
+   else if(mCurrent && mCurrent->used + size <= mCurrent->size)
+   {
+      ret = (U8 *)mCurrent + getHeaderSize() + mCurrent->used;
+      mCurrent->used += size;
+   }
+   else
+      ret = allocChunk(size);
+
+   mAllocCount++;
+   mBytesInUse += size;
+   if(mBytesInUse > mPeakBytes)
+      mPeakBytes = mBytesInUse;
+
+   if(mMutex)
+      Mutex::unlockMutex(mMutex);
+
+   return ret;
+}
+
+void *PooledArena::allocChunk(U32 size)
+{
+   // Reuse a kept chunk if one is big enough.
+   Chunk *chunk = NULL;
+   for(Chunk **walk = &mFree; *walk; walk = &(*walk)->next)
+   {
+      if((*walk)->size >= size)
+      {
+         chunk = *walk;
+         *walk = chunk->next;
+         break;
+      }
+   }
+
+   if(!chunk)
+   {
+      U32 chunkSize = getMax(size, mChunkSize);
+      chunk = (Chunk *)dMalloc(getHeaderSize() + chunkSize);
+      chunk->size = chunkSize;
+      mChunkAllocs++;
+      mReserved += chunkSize;
+   }
+
+   chunk->used = size;
+
+   // An oversized request fills its chunk, so keep allocating from the
+   // current one if it still has room.
+   if(mCurrent && chunk->size - size < mCurrent->size - mCurrent->used)
+   {
+      chunk->next = mCurrent->next;
+      mCurrent->next = chunk;
+   }
+   else
+   {
+      chunk->next = mCurrent;
+      mCurrent = chunk;
+   }
+
+   return (U8 *)chunk + getHeaderSize();
+}
+
+void PooledArena::free(void *ptr, U32 size)
+{
+   if(!ptr)
+      return;
+
+   size = (size + Alignment - 1) & ~(Alignment - 1);
+   if(!size || size > MaxRecycledSize)
+      return;
+
+   if(mMutex)
+      Mutex::lockMutex(mMutex);
+
+   *(void **)ptr = mRecycled[size / Alignment - 1];
+   mRecycled[size / Alignment - 1] = ptr;
+   mBytesInUse -= size;
+
+   if(mMutex)
+      Mutex::unlockMutex(mMutex);
+}
+
+char *PooledArena::dupString(const char *str)
+{
+   U32 length = dStrlen(str) + 1;
+   char *ret = (char *)alloc(length);
+   dMemcpy(ret, str, length);
+   return ret;
+}
+
+//-----------------------------------------------------------------------------
+
+void PooledArena::reset()
+{
+   // Everything in use goes on the free list.
+   while(mCurrent)
+   {
+      Chunk *next = mCurrent->next;
+      mCurrent->next = mFree;
+      mFree = mCurrent;
+      mCurrent = next;
+   }
+   dMemset(mRecycled, 0, sizeof(mRecycled));
+
+   mAllocCount = 0;
+   mBytesInUse = 0;
+}
+
+void PooledArena::releaseChunks(Chunk *list)
+{
+   while(list)
+   {
+      Chunk *next = list->next;
+      mReserved -= list->size;
+      dFree(list);
+      list = next;
+   }
+}
+
+void PooledArena::freeAll()
+{
+   releaseChunks(mCurrent);
+   releaseChunks(mFree);
+   mCurrent = NULL;
+   mFree    = NULL;
+   dMemset(mRecycled, 0, sizeof(mRecycled));
+
+   mAllocCount = 0;
+   mBytesInUse = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void PooledArena::dumpStats()
+{
+   Con::printf("Pooled arenas:");
+   for(PooledArena *walk = smList; walk; walk = walk->mNext)
+      Con::printf("  %-24s %8d bytes in use, %8d peak, %8d reserved, %d allocs, %d chunk allocs", walk->mName,
+         walk->mBytesInUse, walk->mPeakBytes, walk->mReserved, walk->mAllocCount, walk->mChunkAllocs);
+}
+
+ConsoleFunction(dumpArenas, void, 1, 1, "() - Print the usage of the frame allocators and pooled arenas.")
+{
+   argc, argv;
+   FrameAllocator::dumpStats();
+   PooledArena::dumpStats();
+}
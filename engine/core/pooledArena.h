@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _POOLEDARENA_H_
+#define _POOLEDARENA_H_
+
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+
+/// A bump allocator for work that is thrown away in one go, which keeps its
+/// memory between uses.
+///
+/// Memory comes out of chunks of chunkSize bytes (bigger requests get a chunk
+/// to themselves). reset() frees everything allocated at once, but holds on
+/// to the chunks, so once an arena has seen its largest workload it stops
+/// asking the system for memory at all. The chunk allocation count in the
+/// stats is the number to watch: in a steady state it should stop growing.
+///
+/// @code
+/// static PooledArena sPacketArena("net.packets");
+///
+/// U8 *buffer = (U8 *)sPacketArena.alloc(size);
+/// Point3F *points = sPacketArena.alloc<Point3F>(count);
+/// ...
+/// sPacketArena.reset();   // every pointer above is gone
+/// @endcode
+///
+/// Small blocks with lifetimes of their own can be handed back with free()
+/// instead. They go on a free list for their size and the next alloc() of
+/// that size gets them, so a steady churn of records stops allocating too.
+///
+/// Unless constructed with threadSafe false, an arena may be allocated from
+/// by several threads at once. reset() and freeAll() are the owner's call,
+/// when nobody else is using it. Arenas should be created on the main thread.
+class PooledArena
+{
+public:
+   enum
+   {
+      DefaultChunkSize = 64 << 10,
+      Alignment        = 8,
+      MaxRecycledSize  = 256,     ///< Largest block free() keeps.
+   };
+
+private:
+   struct Chunk
+   {
+      Chunk *next;
+      U32    size;
+      U32    used;
+   };
+
+   const char  *mName;
+   U32          mChunkSize;
+   void        *mMutex;         ///< NULL unless thread safe.
+
+   Chunk       *mCurrent;       ///< Being allocated from, then the rest in use.
+   Chunk       *mFree;          ///< Kept from before the last reset().
+   void        *mRecycled[MaxRecycledSize / Alignment];   ///< free()'d blocks by size.
+
+   U32          mAllocCount;    ///< Allocations since the last reset().
+   U32          mBytesInUse;
+   U32          mPeakBytes;
+   U32          mChunkAllocs;   ///< Times we went to the system for memory.
+   U32          mReserved;      ///< Bytes held in chunks.
+
+   PooledArena *mNext;
+   static PooledArena *smList;
+
+   static U32 getHeaderSize() { return (sizeof(Chunk) + Alignment - 1) & ~(Alignment - 1); }
+
+   void *allocChunk(U32 size);
+   void  releaseChunks(Chunk *list);
+
+public:
+   PooledArena(const char *name, U32 chunkSize = DefaultChunkSize, bool threadSafe = true);
+   ~PooledArena();
+
+   /// Get size bytes, aligned to Alignment.
+   void *alloc(U32 size);
+
+   /// Get space for count T's. No constructors are run.
+   template<class T> T *alloc(U32 count)
+   {
+      return reinterpret_cast<T *>(alloc(sizeof(T) * count));
+   }
+
+   /// Copy a string into the arena.
+   char *dupString(const char *str);
+
+   /// Give back a block alloc() returned, with the size it was asked for.
+   /// Blocks over MaxRecycledSize stay used until reset().
+   void free(void *ptr, U32 size);
+
+   /// Free everything allocated, keeping the memory for next time. This
+   /// includes blocks given back with free().
+   void reset();
+
+   /// Free everything and give the memory back to the system.
+   void freeAll();
+
+   /// @name Statistics
+   /// @{
+
+   const char *getName() const        { return mName; }
+   U32         getAllocCount() const  { return mAllocCount; }
+   U32         getBytesInUse() const  { return mBytesInUse; }
+   U32         getPeakBytes() const   { return mPeakBytes; }
+   U32         getChunkAllocs() const { return mChunkAllocs; }
+   U32         getReserved() const    { return mReserved; }
+
+   /// @}
+
+   /// Print the statistics of every arena to the console.
+   static void dumpStats();
+};
+
+#endif // _POOLEDARENA_H_
@@ -13,6 +13,7 @@
 #include "core/zipHeaders.h"
 #include "core/resizeStream.h"
 #include "core/frameAllocator.h"
+#include "platform/threadPool.h"
 
 #include "core/resManager.h"
 #include "core/findMatch.h"
@@ -178,6 +179,9 @@ void ResManager::create ()
    ResourceManager = new ResManager;
 
    Con::addVariable("Pref::ResourceManager::excludedDirectories", TypeString, &smExcludedDirectories);
+   Con::addVariable("Pref::ResourceManager::zipMapBudget", TypeS32, &ZipVolumeCache::smMappedBudgetMB);
+   Con::addVariable("Pref::ResourceManager::inflateCacheBudget", TypeS32, &ZipInflateCache::smBudgetMB);
+   Con::addVariable("Pref::ResourceManager::zipIndexFile", TypeString, &ZipIndex::smIndexFile);
 }
 
 
@@ -282,139 +286,234 @@ static void getPaths (const char *fullPath, StringTableEntry & path,
 
 //------------------------------------------------------------------------------
 
-bool ResManager::scanZip (ResourceObject * zipObject)
+void ResManager::addZipEntries (ResourceObject * zipObject,
+   const Vector < ZipAggregate::FileEntry > &entries)
 {
-  // now open the volume and add all its resources to the dictionary
-   ZipAggregate zipAggregate;
-   if (zipAggregate.
-        openAggregate (buildPath (zipObject->zipPath, zipObject->zipName)) ==
-        false)
+   for (U32 i = 0; i < entries.size (); i++)
    {
-      Con::errorf ("Error opening zip (%s/%s), need to handle this better...",
-         zipObject->zipPath, zipObject->zipName);
-      return false;
-   }
-   ZipAggregate::iterator itr;
-   for (itr = zipAggregate.begin (); itr != zipAggregate.end (); itr++)
-   {
-      const ZipAggregate::FileEntry & rEntry = * itr;
+      const ZipAggregate::FileEntry & rEntry = entries[i];
       ResourceObject * ro =
          createZipResource (rEntry.pPath, rEntry.pFileName,
             zipObject->zipPath,
             zipObject->zipName);
 
       ro->flags = ResourceObject::VolumeBlock;
+      if ((rEntry.flags & ZipAggregate::FileEntry::Compressed) && rEntry.fileSize)
+         ro->flags |= ResourceObject::Deflated;
       ro->fileSize = rEntry.fileSize;
       ro->compressedFileSize = rEntry.compressedFileSize;
       ro->fileOffset = rEntry.fileOffset;
+      ro->zipCrc = rEntry.crc32;
 
       dictionary.pushBehind (ro, ResourceObject::File);
    }
-   zipAggregate.closeAggregate ();
-
-   return true;
 }
 
 //------------------------------------------------------------------------------
-
-void ResManager::searchPath (const char *path)
+// Mod path scanning.
+//
+// Dumping the mod directories and reading the central directory of every zip
+// found in them is pure file system work, so it is spread over the thread
+// pool. Zips are opened on the calling thread, the pool only reads them.
+// Only the merge into the dictionary happens on the calling thread, in
+// the order the paths were given, so files override each other exactly as
+// they would with a serial scan.
+
+namespace {
+
+struct ZipScan : public ThreadPool::WorkItem
 {
-   AssertFatal (path != NULL, "No path to dump?");
+   char             zipFile[1024];
+   StringTableEntry zipPath;
+   StringTableEntry zipName;
+   U32              fileSize;
+   FileTime         modifyTime;
+   bool             indexed;      ///< Directory came from the zip index.
+   bool             ok;
 
-   Vector < Platform::FileInfo > fileInfoVec;
-   Platform::dumpPath (path, fileInfoVec);
+   FileStream      *stream;       ///< Opened by the main thread.
 
-   for (U32 i = 0; i < fileInfoVec.size (); i++)
+   Vector < ZipAggregate::FileEntry > entries;
+
+   void execute()
    {
-      Platform::FileInfo & rInfo = fileInfoVec[i];
+      ZipAggregate zipAggregate;
+      ok = zipAggregate.openAggregate (zipFile, stream);
+      delete stream;
+      stream = NULL;
+      if (!ok)
+         return;
+
+      entries.reserve (zipAggregate.numEntries ());
+      for (ZipAggregate::iterator itr = zipAggregate.begin (); itr != zipAggregate.end (); itr++)
+         entries.push_back (*itr);
+      zipAggregate.closeAggregate ();
+   }
+};
 
-      // Create a resource for this file...
-      //
-      ResourceObject *ro = createResource (rInfo.pFullPath, rInfo.pFileName);
-      dictionary.pushBehind (ro, ResourceObject::File);
+struct ModPathScan : public ThreadPool::WorkItem
+{
+   const char *path;
+   ZipScan    *modZip;            ///< <path>.zip, if there is one.
 
-      ro->flags = ResourceObject::File;
-      ro->fileOffset = 0;
-      ro->fileSize = rInfo.fileSize;
-      ro->compressedFileSize = rInfo.fileSize;
+   Vector < Platform::FileInfo > files;
+   Vector < ZipScan * >          zips;   ///< Parallel to files, NULL for non-zips.
 
-      // see if it's a zip
-      const char *extension = dStrrchr (ro->name, '.');
-      if (extension && !dStricmp (extension, ".zip"))
-      {
-         // Copy the path and files names to the zips resource object
-         ro->zipName = rInfo.pFileName;
-         ro->zipPath = rInfo.pFullPath;
-         scanZip(ro);
-      }
+   void execute()
+   {
+      Platform::dumpPath (path, files);
    }
-}
+};
 
+}
 
-//------------------------------------------------------------------------------
+static ZipScan *queueZipScan (ZipIndex &index, StringTableEntry zipPath,
+   StringTableEntry zipName, ThreadPool::WorkGroup *group)
+{
+   ZipScan *scan = new ZipScan;
+   scan->zipPath = zipPath;
+   scan->zipName = zipName;
+   dStrncpy (scan->zipFile, buildPath (zipPath, zipName), sizeof (scan->zipFile) - 1);
+   scan->zipFile[sizeof (scan->zipFile) - 1] = 0;
+
+   // stat it here, an unchanged archive doesn't need to be opened at all
+   S32 size = Platform::getFileSize (scan->zipFile);
+   scan->fileSize = size > 0 ? U32(size) : 0;
+   dMemset (&scan->modifyTime, 0, sizeof (FileTime));
+   scan->indexed = Platform::getFileTimes (scan->zipFile, NULL, &scan->modifyTime) &&
+      index.lookup (StringTable->insert (scan->zipFile), scan->fileSize, scan->modifyTime, scan->entries);
+   scan->ok = scan->indexed;
+   scan->stream = NULL;
+   if (scan->indexed)
+      return scan;
+
+   // The platform File::open implementations keep the path in static
+   // buffers, so only the directory is read on the pool.
+   scan->stream = new FileStream;
+   if (!scan->stream->open (scan->zipFile, FileStream::Read))
+   {
+      delete scan->stream;
+      scan->stream = NULL;
+      return scan;
+   }
+   ThreadPool::GLOBAL ().queueWorkItem (scan, group);
+   return scan;
+}
 
-bool ResManager::setModZip(const char* path)
+void ResManager::scanModPaths (const Vector < const char *> &paths)
 {
-   // Get the path and add .zip to the end of the dir
-   const char* ext =  ".zip";
-   char* modPath = new char[dStrlen(path) + dStrlen(ext) + 1]; // make enough room.
-   dStrcpy(modPath, path);
-   dStrcat(modPath, ext);
-
-   // Now we have to go through the root and look for our zipped up mod
-   // this is unfortunately necessary because there is no means to get
-   // a individual files properties -- we can only do it in one
-   // big dump
-   Vector < Platform::FileInfo > pathInfo;
-   Platform::dumpPath (Platform::getWorkingDirectory(), pathInfo);
-   for(U32 i = 0; i < pathInfo.size(); i++)
+   ThreadPool &pool = ThreadPool::GLOBAL ();
+
+   // getWorkingDirectory() caches on first use, make sure that isn't racing.
+   // dumpPath() on x86UNIX caches the pref dir the same way, but loading the
+   // scripts that got us here has already done that.
+   Platform::getWorkingDirectory ();
+
+   // dump every mod directory
+   Vector < ModPathScan * > dirScans;
+   ThreadPool::WorkGroup dirGroup;
+   for (U32 i = 0; i < paths.size (); i++)
    {
-      Platform::FileInfo &file = pathInfo[i];
+      ModPathScan *scan = new ModPathScan;
+      scan->path = paths[i];
+      scan->modZip = NULL;
+      dirScans.push_back (scan);
+      pool.queueWorkItem (scan, &dirGroup);
+   }
+   pool.waitForGroup (&dirGroup);
 
-      if(!dStricmp(file.pFileName, modPath))
+   // then read every zip that isn't in the index
+   mZipIndex.load ();
+
+   ThreadPool::WorkGroup zipGroup;
+   for (U32 i = 0; i < dirScans.size (); i++)
+   {
+      ModPathScan *dir = dirScans[i];
+
+      char modZip[1024];
+      dSprintf (modZip, sizeof (modZip), "%s.zip", dir->path);
+      if (Platform::isFile (modZip))
       {
-         // Setup the resource to the zip file itself
-         ResourceObject *zip = createResource(NULL, file.pFileName);
-         dictionary.pushBehind(zip, ResourceObject::File);
-         zip->flags = ResourceObject::File;
-         zip->fileOffset = 0;
-         zip->fileSize = file.fileSize;
-         zip->compressedFileSize = file.fileSize;
-         zip->zipName = file.pFileName;
-         zip->zipPath = NULL;
-
-         // Setup the resource for the zip contents
-         // ..now open the volume and add all its resources to the dictionary
-         ZipAggregate zipAggregate;
-         if (zipAggregate.openAggregate(zip->zipName) == false)
-         {
-            delete [] modPath;
-            return false;
-         }
+         StringTableEntry zipPath, zipName;
+         getPaths (modZip, zipPath, zipName);
+         dir->modZip = queueZipScan (mZipIndex, zipPath, zipName, &zipGroup);
+      }
 
-         ZipAggregate::iterator itr;
-         for (itr = zipAggregate.begin (); itr != zipAggregate.end (); itr++)
-         {
-            const ZipAggregate::FileEntry &rEntry = *itr;
+      dir->zips.setSize (dir->files.size ());
+      for (U32 j = 0; j < dir->files.size (); j++)
+      {
+         Platform::FileInfo & rInfo = dir->files[j];
+         const char *extension = dStrrchr (rInfo.pFileName, '.');
+         if (extension && !dStricmp (extension, ".zip"))
+            dir->zips[j] = queueZipScan (mZipIndex, rInfo.pFullPath, rInfo.pFileName, &zipGroup);
+         else
+            dir->zips[j] = NULL;
+      }
+   }
+   pool.waitForGroup (&zipGroup);
 
-            ResourceObject *ro = createZipResource(rEntry.pPath, rEntry.pFileName, zip->zipPath, zip->zipName);
+   // merge, in path order
+   Vector < ZipScan * > zipScans;
+   for (U32 i = 0; i < dirScans.size (); i++)
+   {
+      ModPathScan *dir = dirScans[i];
 
-            ro->flags = ResourceObject::VolumeBlock;
-            ro->fileSize = rEntry.fileSize;
-            ro->compressedFileSize = rEntry.compressedFileSize;
-            ro->fileOffset = rEntry.fileOffset;
-            dictionary.pushBehind (ro, ResourceObject::File);
-         }
-         zipAggregate.closeAggregate ();
+      // Load zip first so that local files override
+      if (ZipScan *zip = dir->modZip)
+      {
+         ResourceObject *ro = createResource (zip->zipPath, zip->zipName);
+         dictionary.pushBehind (ro, ResourceObject::File);
+         ro->flags = ResourceObject::File;
+         ro->fileOffset = 0;
+         ro->fileSize = zip->fileSize;
+         ro->compressedFileSize = zip->fileSize;
+         ro->zipName = zip->zipName;
+         ro->zipPath = zip->zipPath;
+
+         if (zip->ok)
+            addZipEntries (ro, zip->entries);
+         zipScans.push_back (zip);
+      }
 
-         // Break from the loop since we got our one file
-         delete [] modPath;
-         return true;
+      for (U32 j = 0; j < dir->files.size (); j++)
+      {
+         Platform::FileInfo & rInfo = dir->files[j];
+
+         // Create a resource for this file...
+         //
+         ResourceObject *ro = createResource (rInfo.pFullPath, rInfo.pFileName);
+         dictionary.pushBehind (ro, ResourceObject::File);
+
+         ro->flags = ResourceObject::File;
+         ro->fileOffset = 0;
+         ro->fileSize = rInfo.fileSize;
+         ro->compressedFileSize = rInfo.fileSize;
+
+         ZipScan *zip = dir->zips[j];
+         if (!zip)
+            continue;
+
+         // Copy the path and files names to the zips resource object
+         ro->zipName = rInfo.pFileName;
+         ro->zipPath = rInfo.pFullPath;
+         if (zip->ok)
+            addZipEntries (ro, zip->entries);
+         else
+            Con::errorf ("Error opening zip (%s/%s), need to handle this better...",
+               ro->zipPath, ro->zipName);
+         zipScans.push_back (zip);
       }
+
+      delete dir;
    }
 
-   delete [] modPath;
-   return false;
+   for (U32 i = 0; i < zipScans.size (); i++)
+   {
+      ZipScan *zip = zipScans[i];
+      if (zip->ok && !zip->indexed)
+         mZipIndex.store (StringTable->insert (zip->zipFile), zip->fileSize, zip->modifyTime, zip->entries);
+      delete zip;
+   }
 }
 
 //------------------------------------------------------------------------------
@@ -443,6 +542,9 @@ void ResManager::setModPaths (U32 numPaths, const char **paths)
          pwalk = pwalk->nextResource)
       pwalk->flags = ResourceObject::Added;
 
+   // archives may have changed on disk since they were mapped
+   mZipVolumes.flush();
+
    U32 pathLen = 0;
 
    // Set up exclusions.
@@ -456,7 +558,10 @@ void ResManager::setModPaths (U32 numPaths, const char **paths)
    {
       if (!Platform::isSubDirectory (Platform::getWorkingDirectory (), paths[i]) || Platform::isExcludedDirectory(paths[i]))
       {
-         if (!setModZip(paths[i]))
+         // not a directory, but it may be a zipped up mod
+         char modZip[1024];
+         dSprintf (modZip, sizeof (modZip), "%s.zip", paths[i]);
+         if (!Platform::isFile (modZip))
          {
             Con::errorf ("setModPaths: invalid mod path directory name: '%s'", paths[i]);
             continue;
@@ -464,14 +569,12 @@ void ResManager::setModPaths (U32 numPaths, const char **paths)
       }
       pathLen += (dStrlen (paths[i]) + 1);
 
-      // Load zip first so that local files override
-      setModZip(paths[i]);
-      searchPath (paths[i]);
-
       // Copy this path to the validPaths list
       validPaths.push_back(paths[i]);
    }
 
+   scanModPaths (validPaths);
+
    Platform::clearExcludedDirectories();
 
    if (!pathLen)
@@ -502,6 +605,8 @@ void ResManager::setModPaths (U32 numPaths, const char **paths)
       else
          rwalk = rwalk->nextResource;
    }
+
+   mZipIndex.save ();
 }
 
 ConsoleFunction( setModPaths, void, 2, 2, "(string paths)"
@@ -885,6 +990,21 @@ Stream * ResManager::openStream (ResourceObject * obj)
    // if zip file
    if (obj->flags & ResourceObject::VolumeBlock)
    {
+      StringTableEntry zipFile = StringTable->insert (buildPath (obj->zipPath, obj->zipName));
+
+      // already inflated? stored members never are, so don't count them
+      if (obj->flags & ResourceObject::Deflated)
+      {
+         Stream *cachedStream = mInflateCache.openStream (zipFile, obj->fileOffset, obj->zipCrc);
+         if (cachedStream)
+            return cachedStream;
+      }
+
+      // serve it out of the mapped archive if we can
+      Stream *volumeStream = mZipVolumes.openStream (obj, zipFile);
+      if (volumeStream)
+         return cacheInflatedStream (obj, zipFile, volumeStream);
+
       diskStream = new FileStream;
       diskStream->open (buildPath (obj->zipPath, obj->zipName),
          FileStream::Read);
@@ -917,7 +1037,7 @@ Stream * ResManager::openStream (ResourceObject * obj)
             ZipSubRStream *zipStream = new ZipSubRStream;
             zipStream->attachStream (diskStream);
             zipStream->setUncompressedSize (obj->fileSize);
-            return zipStream;
+            return cacheInflatedStream (obj, zipFile, zipStream);
          }
          else
          {
@@ -935,6 +1055,27 @@ Stream * ResManager::openStream (ResourceObject * obj)
 
 //------------------------------------------------------------------------------
 
+Stream * ResManager::cacheInflatedStream (ResourceObject * obj, StringTableEntry zipFile, Stream * stream)
+{
+   // only deflated members are worth keeping around
+   if (!dynamic_cast<ZipSubRStream*>(stream))
+      return stream;
+
+   Stream *cached = mInflateCache.insert (zipFile, obj->fileOffset, obj->zipCrc, stream);
+   if (!cached)
+   {
+      // too big for the cache, stream it as usual
+      if (stream->getPosition () != 0)
+         stream->setPosition (0);
+      return stream;
+   }
+
+   closeStream (stream);
+   return cached;
+}
+
+//------------------------------------------------------------------------------
+
 void ResManager::closeStream (Stream * stream)
 {
    // Try to cast the stream to a FilterStream
@@ -1024,12 +1165,15 @@ ResourceObject* ResManager::find(const char* fileName)
 				dictionary.pushBehind(newObj, ResourceObject::VolumeBlock);
 
 				newObj->flags      = ResourceObject::Flags::VolumeBlock;
+				if ((rEntry.flags & ZipAggregate::FileEntry::Compressed) && rEntry.fileSize)
+					newObj->flags |= ResourceObject::Deflated;
 				newObj->fileOffset = rEntry.fileOffset;
 
 				newObj->zipName            = StringTable->insert(tmpFile);
 				newObj->zipPath            = StringTable->insert(tmpPath);
 				newObj->fileSize           = rEntry.fileSize;
 				newObj->compressedFileSize = rEntry.compressedFileSize;
+				newObj->zipCrc             = rEntry.crc32;
 
 				if (!dStricmp(rEntry.pPath, path) && !dStricmp(rEntry.pFileName, file))
 				{
@@ -1116,6 +1260,16 @@ ConsoleFunction( purgeResources, void, 1, 1, "Purge resources from the resource
    ResourceManager->purge();
 }
 
+ConsoleFunction( dumpInflateCacheStats, void, 1, 1, "Print hit/miss statistics for the inflated zip member cache.")
+{
+   ResourceManager->getInflateCache().dumpStats();
+}
+
+ConsoleFunction( flushInflateCache, void, 1, 1, "Free every unused entry in the inflated zip member cache.")
+{
+   ResourceManager->getInflateCache().flush();
+}
+
 //------------------------------------------------------------------------------
 
 void ResManager::purge (ResourceObject * obj)
@@ -1265,6 +1419,7 @@ ResourceObject * ResManager::createResource (StringTableEntry path, StringTableE
    newRO->zipPath = NULL;
    newRO->zipName = NULL;
    newRO->crc = InvalidCRC;
+   newRO->zipCrc = 0;
 
    return newRO;
 }
@@ -1296,6 +1451,7 @@ ResourceObject * ResManager::createZipResource (StringTableEntry path, StringTab
    newRO->zipPath = zipPath;
    newRO->zipName = zipName;
    newRO->crc = InvalidCRC;
+   newRO->zipCrc = 0;
 
    return newRO;
 }
@@ -1335,6 +1491,9 @@ bool ResManager::openFileForWrite (FileStream & stream, const char *fileName, U3
 
    if (!Platform::createPath (fileName))   // create directory tree
       return false;
+
+   // a mapped archive can't be rewritten (on Win32), let go of it first
+   mZipVolumes.flush (fileName);
    if (!stream.open (fileName, (FileStream::AccessMode) accessMode))
       return false;
 
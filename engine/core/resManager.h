@@ -28,6 +28,15 @@
 #ifndef _ZIPHEADERS_H_
 #include "core/zipHeaders.h"
 #endif
+#ifndef _ZIPVOLUME_H_
+#include "core/zipVolume.h"
+#endif
+#ifndef _ZIPINFLATECACHE_H_
+#include "core/zipInflateCache.h"
+#endif
+#ifndef _ZIPINDEX_H_
+#include "core/zipIndex.h"
+#endif
 #ifndef _CRC_H_
 #include "core/crc.h"
 #endif
@@ -131,6 +140,7 @@ public:
       VolumeBlock   = BIT(0),
       File          = BIT(1),
       Added         = BIT(2),
+      Deflated      = BIT(3),   ///< VolumeBlock that has to be inflated.
    };
    S32 flags;  ///< Set from Flags.
 
@@ -148,6 +158,7 @@ public:
    S32 fileOffset;            ///< Offset of data in zip file.
    S32 fileSize;              ///< Size on disk of resource block.
    S32 compressedFileSize;    ///< Actual size of resource data.
+   U32 zipCrc;                ///< CRC of the uncompressed data from the zip directory.
    /// @}
 
    ResourceInstance *mInstance;  ///< Pointer to actual object instance. If the object is not loaded,
@@ -340,12 +351,21 @@ private:
 
    ResDictionary dictionary;
 
+   /// Mapped zip archives that VolumeBlock streams are served from.
+   ZipVolumeCache mZipVolumes;
+
+   /// Inflated copies of recently used deflated zip members.
+   ZipInflateCache mInflateCache;
+
+   /// Cached zip central directories, see $Pref::ResourceManager::zipIndexFile.
+   ZipIndex mZipIndex;
+
    bool echoFileNames;
 
    bool isIgnoredSubdirectoryName(const char *name) const;
 
-   /// Scan a zip file for resources.
-   bool scanZip(ResourceObject *zipObject);
+   /// Add the members of a scanned zip file to the dictionary.
+   void addZipEntries(ResourceObject *zipObject, const Vector<ZipAggregate::FileEntry> &entries);
 
    /// Create a ResourceObject from the given file.
    ResourceObject* createResource(StringTableEntry path, StringTableEntry file);
@@ -353,8 +373,14 @@ private:
    /// Create a ResourceObject from the given file in a zip file.
    ResourceObject* createZipResource(StringTableEntry path, StringTableEntry file, StringTableEntry zipPath, StringTableEntry zipFle);
 
-   void searchPath(const char *pathStart);
-   bool setModZip(const char* path);
+   /// Swap a freshly opened deflated member stream for one over its cached,
+   /// inflated copy.  Returns the stream that should be handed out.
+   Stream* cacheInflatedStream(ResourceObject *obj, StringTableEntry zipFile, Stream *stream);
+
+   /// Dump the mod directories and parse every zip found in them (plus the
+   /// <mod>.zip next to each) on the thread pool, then add the results to the
+   /// dictionary in mod path order.
+   void scanModPaths(const Vector<const char*> &paths);
 
    struct RegisteredExtension
    {
@@ -452,6 +478,8 @@ public:
    /// Opens a file for writing!
    bool openFileForWrite(FileStream &fs, const char *fileName, U32 accessMode = 1, bool alwaysWritable = false);
 
+   ZipInflateCache& getInflateCache() { return mInflateCache; }
+
 #ifdef TORQUE_DEBUG
    void dumpLoadedResources();                        ///< Dumps all loaded resources to the console.
 #endif
@@ -5,6 +5,7 @@
 
 #include "platform/platform.h"
 #include "core/stringTable.h"
+#include "platform/platformMutex.h"
 
 _StringTable *StringTable = NULL;
 const U32 _StringTable::csm_stInitSize = 29;
@@ -69,12 +70,20 @@ _StringTable::_StringTable()
 
    numBuckets = csm_stInitSize;
    itemCount = 0;
+
+#ifdef TORQUE_MULTITHREAD
+   mMutex = Mutex::createMutex();
+#endif
 }
 
 //--------------------------------------
 _StringTable::~_StringTable()
 {
    dFree(buckets);
+
+#ifdef TORQUE_MULTITHREAD
+   Mutex::destroyMutex(mMutex);
+#endif
 }
 
 
@@ -98,6 +107,11 @@ void _StringTable::destroy()
 //--------------------------------------
 StringTableEntry _StringTable::insert(const char* val, const bool  caseSens)
 {
+#ifdef TORQUE_MULTITHREAD
+	MutexHandle mutex;
+	mutex.lock(mMutex);
+#endif
+
 	Node** walk, * temp;
 	U32 key = hashString(val);
 	walk = &buckets[key % numBuckets];
@@ -141,6 +155,11 @@ StringTableEntry _StringTable::insertn(const char* src, S32 len, const bool  cas
 //--------------------------------------
 StringTableEntry _StringTable::lookup(const char* val, const bool  caseSens)
 {
+#ifdef TORQUE_MULTITHREAD
+   MutexHandle mutex;
+   mutex.lock(mMutex);
+#endif
+
    Node **walk, *temp;
    U32 key = hashString(val);
    walk = &buckets[key % numBuckets];
@@ -157,6 +176,11 @@ StringTableEntry _StringTable::lookup(const char* val, const bool  caseSens)
 //--------------------------------------
 StringTableEntry _StringTable::lookupn(const char* val, S32 len, const bool  caseSens)
 {
+#ifdef TORQUE_MULTITHREAD
+   MutexHandle mutex;
+   mutex.lock(mMutex);
+#endif
+
    Node **walk, *temp;
    U32 key = hashStringn(val, len);
    walk = &buckets[key % numBuckets];
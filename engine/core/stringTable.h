@@ -74,6 +74,12 @@ private:
    U32         itemCount;
    DataChunker mempool;
 
+#ifdef TORQUE_MULTITHREAD
+   /// Guards the table so worker threads (resource scanning, font baking)
+   /// can intern strings alongside the main thread.
+   void       *mMutex;
+#endif
+
   protected:
    static const U32 csm_stInitSize;
 
@@ -40,23 +40,33 @@ ZipAggregate::openAggregate(const char* in_pFileName)
 
    AssertFatal(in_pFileName != NULL, "No filename to open!");
 
+   FileStream* pStream = new FileStream;
+   bool success = pStream->open(in_pFileName, FileStream::Read) &&
+                  openAggregate(in_pFileName, pStream);
+
+   delete pStream;
+   return success;
+}
+
+bool
+ZipAggregate::openAggregate(const char* in_pFileName, Stream* io_pStream)
+{
+   closeAggregate();
+
+   AssertFatal(in_pFileName != NULL, "No filename to open!");
+
    m_pZipFileName = new char[dStrlen(in_pFileName) + 1];
    dStrcpy(m_pZipFileName, in_pFileName);
 
-   FileStream* pStream = new FileStream;
-   if (pStream->open(m_pZipFileName, FileStream::Read) == false ||
-       createZipDirectory(pStream)   == false) {
+   if (createZipDirectory(io_pStream) == false) {
       // Failure, abort the open...
       //
-      delete pStream;
-
       delete [] m_pZipFileName;
       m_pZipFileName = NULL;
       return false;
    }
 
    // Finished!  Open for business
-   delete pStream;
    return true;
 }
 
@@ -257,6 +267,7 @@ ZipAggregate::enterZipDirRecord(const ZipDirFileHeader& in_rHeader)
    rEntry.fileSize           = in_rHeader.m_header.uncompressedSize;
    rEntry.compressedFileSize = in_rHeader.m_header.compressedSize;
    rEntry.fileOffset         = in_rHeader.m_header.relativeOffsetOfLocalHeader;
+   rEntry.crc32              = in_rHeader.m_header.crc32;
 
 	// Tell ResourceManager the appropriate file compressions used on the file
 	if(in_rHeader.m_header.compressionMethod == ZipDirFileHeader::Deflated)
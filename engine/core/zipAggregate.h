@@ -31,6 +31,7 @@ class ZipAggregate
       U32 fileOffset;
       U32 fileSize;
       U32 compressedFileSize;
+      U32 crc32;
       U32 flags;
    };
 
@@ -51,6 +52,7 @@ class ZipAggregate
    // Opening/Manipulation interface...
   public:
    bool openAggregate(const char* in_pFileName);
+   bool openAggregate(const char* in_pFileName, Stream* io_pStream);  ///< Reads the directory from an open stream.
    void closeAggregate();
    bool refreshAggregate();
 
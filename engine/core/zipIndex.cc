@@ -0,0 +1,207 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "core/stringTable.h"
+#include "core/fileStream.h"
+#include "core/zipIndex.h"
+#include "core/resManager.h"
+#include "console/console.h"
+
+char *ZipIndex::smIndexFile = "";
+
+//------------------------------------------------------------------------------
+
+ZipIndex::ZipIndex()
+{
+   mLoadedFrom = NULL;
+   mDirty      = false;
+}
+
+ZipIndex::~ZipIndex()
+{
+   clear();
+}
+
+void ZipIndex::clear()
+{
+   for (U32 i = 0; i < mArchives.size(); i++)
+      delete mArchives[i];
+   mArchives.clear();
+}
+
+S32 ZipIndex::findArchive(StringTableEntry zipPath)
+{
+   for (U32 i = 0; i < mArchives.size(); i++)
+      if (mArchives[i]->zipPath == zipPath)
+         return i;
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+
+void ZipIndex::load()
+{
+   StringTableEntry indexFile = StringTable->insert(smIndexFile ? smIndexFile : "");
+   if (indexFile == mLoadedFrom)
+   {
+      // a new scan, archives have to be looked up again to be kept
+      for (U32 i = 0; i < mArchives.size(); i++)
+         mArchives[i]->used = false;
+      return;
+   }
+
+   clear();
+   mLoadedFrom = indexFile;
+   mDirty      = false;
+
+   if (!indexFile[0])
+      return;
+
+   FileStream stream;
+   if (!stream.open(indexFile, FileStream::Read))
+      return;
+
+   U32 magic, version, numArchives;
+   stream.read(&magic);
+   stream.read(&version);
+   stream.read(&numArchives);
+   if (magic != FileMagic || version != FileVersion)
+      return;
+
+   char buf[1024];
+   for (U32 i = 0; i < numArchives && stream.getStatus() == Stream::Ok; i++)
+   {
+      Archive *archive = new Archive;
+      archive->used = false;
+
+      stream.readLongString(sizeof(buf) - 1, buf);
+      archive->zipPath = StringTable->insert(buf);
+      stream.read(&archive->size);
+      stream.read(sizeof(FileTime), &archive->modifyTime);
+
+      U32 numEntries = 0;
+      stream.read(&numEntries);
+      archive->entries.setSize(numEntries);
+      for (U32 j = 0; j < numEntries; j++)
+      {
+         ZipAggregate::FileEntry &entry = archive->entries[j];
+         stream.readLongString(sizeof(buf) - 1, buf);
+         entry.pPath = StringTable->insert(buf);
+         stream.readLongString(sizeof(buf) - 1, buf);
+         entry.pFileName = StringTable->insert(buf);
+         stream.read(&entry.fileOffset);
+         stream.read(&entry.fileSize);
+         stream.read(&entry.compressedFileSize);
+         stream.read(&entry.crc32);
+         stream.read(&entry.flags);
+      }
+
+      mArchives.push_back(archive);
+   }
+
+   // a truncated index is worse than none
+   if (stream.getStatus() != Stream::Ok && stream.getStatus() != Stream::EOS)
+   {
+      Con::warnf("ZipIndex: ignoring damaged index '%s'.", indexFile);
+      clear();
+   }
+}
+
+void ZipIndex::save()
+{
+   if (!mLoadedFrom || !mLoadedFrom[0])
+      return;
+
+   // forget archives that have gone away
+   for (S32 i = mArchives.size() - 1; i >= 0; i--)
+   {
+      if (!mArchives[i]->used)
+      {
+         delete mArchives[i];
+         mArchives.erase(i);
+         mDirty = true;
+      }
+   }
+
+   if (!mDirty)
+      return;
+
+   FileStream stream;
+   if (!ResourceManager->openFileForWrite(stream, mLoadedFrom))
+   {
+      Con::warnf("ZipIndex: unable to write '%s'.", mLoadedFrom);
+      return;
+   }
+
+   stream.write(U32(FileMagic));
+   stream.write(U32(FileVersion));
+   stream.write(U32(mArchives.size()));
+   for (U32 i = 0; i < mArchives.size(); i++)
+   {
+      const Archive *archive = mArchives[i];
+      stream.writeLongString(1023, archive->zipPath);
+      stream.write(archive->size);
+      stream.write(sizeof(FileTime), &archive->modifyTime);
+
+      stream.write(U32(archive->entries.size()));
+      for (U32 j = 0; j < archive->entries.size(); j++)
+      {
+         const ZipAggregate::FileEntry &entry = archive->entries[j];
+         stream.writeLongString(1023, entry.pPath);
+         stream.writeLongString(1023, entry.pFileName);
+         stream.write(entry.fileOffset);
+         stream.write(entry.fileSize);
+         stream.write(entry.compressedFileSize);
+         stream.write(entry.crc32);
+         stream.write(entry.flags);
+      }
+   }
+   stream.close();
+
+   mDirty = false;
+}
+
+//------------------------------------------------------------------------------
+
+bool ZipIndex::lookup(StringTableEntry zipPath, const U32 size, const FileTime &modifyTime,
+                      Vector<ZipAggregate::FileEntry> &entries)
+{
+   S32 index = findArchive(zipPath);
+   if (index == -1)
+      return false;
+
+   Archive *archive = mArchives[index];
+   if (archive->size != size || dMemcmp(&archive->modifyTime, &modifyTime, sizeof(FileTime)))
+      return false;
+
+   archive->used = true;
+   entries = archive->entries;
+   return true;
+}
+
+void ZipIndex::store(StringTableEntry zipPath, const U32 size, const FileTime &modifyTime,
+                     const Vector<ZipAggregate::FileEntry> &entries)
+{
+   if (!mLoadedFrom || !mLoadedFrom[0])
+      return;
+
+   S32 index = findArchive(zipPath);
+   Archive *archive;
+   if (index == -1)
+   {
+      archive = new Archive;
+      archive->zipPath = zipPath;
+      mArchives.push_back(archive);
+   }
+   else
+      archive = mArchives[index];
+
+   archive->size       = size;
+   archive->modifyTime = modifyTime;
+   archive->used       = true;
+   archive->entries    = entries;
+   mDirty = true;
+}
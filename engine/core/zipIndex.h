@@ -0,0 +1,77 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _ZIPINDEX_H_
+#define _ZIPINDEX_H_
+
+//Includes
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _TVECTOR_H_
+#include "core/tVector.h"
+#endif
+#ifndef _ZIPAGGREGATE_H_
+#include "core/zipAggregate.h"
+#endif
+
+/// Persisted copy of the central directories of the zips found by the
+/// resource manager, so unchanged archives don't have to be opened and
+/// parsed every time the mod paths are set.
+///
+/// Archives are keyed by their full path, size and modification time; any
+/// change to one of those makes the entry stale and the archive is parsed
+/// again. The index lives in the file named by
+/// $Pref::ResourceManager::zipIndexFile and is disabled if that is empty.
+class ZipIndex
+{
+   struct Archive
+   {
+      StringTableEntry             zipPath;
+      U32                          size;
+      FileTime                     modifyTime;
+      bool                         used;      ///< Seen during the current scan.
+      Vector<ZipAggregate::FileEntry> entries;
+   };
+
+   Vector<Archive*> mArchives;
+   StringTableEntry mLoadedFrom;
+   bool             mDirty;
+
+   enum
+   {
+      FileMagic   = 0x5849505a,  // 'ZPIX'
+      FileVersion = 1,
+   };
+
+   S32  findArchive(StringTableEntry zipPath);
+   void clear();
+
+  public:
+   static char *smIndexFile;
+
+   ZipIndex();
+   ~ZipIndex();
+
+   /// Load the index named by the pref, if it isn't loaded already, and
+   /// start a new scan. Every archive counts as unused until it is looked
+   /// up or stored again.
+   void load();
+
+   /// Write the index back out if anything changed, dropping archives that
+   /// weren't looked up since the last load.
+   void save();
+
+   /// Fill 'entries' with the cached directory of an archive. Returns false
+   /// if the archive isn't in the index or has changed.
+   bool lookup(StringTableEntry zipPath, const U32 size, const FileTime &modifyTime,
+               Vector<ZipAggregate::FileEntry> &entries);
+
+   /// Record a freshly parsed directory.
+   void store(StringTableEntry zipPath, const U32 size, const FileTime &modifyTime,
+              const Vector<ZipAggregate::FileEntry> &entries);
+};
+
+#endif //_ZIPINDEX_H_
@@ -0,0 +1,211 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "core/zipInflateCache.h"
+#include "core/resManager.h"
+#include "console/console.h"
+
+S32 ZipInflateCache::smBudgetMB = 32;
+
+//------------------------------------------------------------------------------
+
+ZipInflateCacheStream::ZipInflateCacheStream(ZipInflateCache *cache, S32 index, void *data, const U32 size)
+ : Parent(size, data, true, false),
+   mCache(cache),
+   mIndex(index)
+{
+   cache->mEntries[index].refCount++;
+}
+
+ZipInflateCacheStream::~ZipInflateCacheStream()
+{
+   mCache->release(mIndex);
+}
+
+//------------------------------------------------------------------------------
+
+ZipInflateCache::ZipInflateCache()
+{
+   for (U32 i = 0; i < HashTableSize; i++)
+      mHashTable[i] = -1;
+
+   mCachedBytes = 0;
+   mUseSequence = 0;
+
+   mHits       = 0;
+   mMisses     = 0;
+   mEvictions  = 0;
+   mBytesSaved = 0;
+}
+
+ZipInflateCache::~ZipInflateCache()
+{
+   for (U32 i = 0; i < mEntries.size(); i++)
+   {
+      AssertWarn(mEntries[i].refCount == 0, "ZipInflateCache: entry still has open streams.");
+      delete [] mEntries[i].data;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+U32 ZipInflateCache::hash(StringTableEntry zipPath, const U32 offset, const U32 crc)
+{
+   U32 key = U32(dsize_t(zipPath) >> 2) ^ (offset * 2654435761U) ^ crc;
+   return (key ^ (key >> 16)) % HashTableSize;
+}
+
+S32 ZipInflateCache::findEntry(StringTableEntry zipPath, const U32 offset, const U32 crc)
+{
+   for (S32 i = mHashTable[hash(zipPath, offset, crc)]; i != -1; i = mEntries[i].nextInBucket)
+   {
+      const Entry &e = mEntries[i];
+      if (e.zipPath == zipPath && e.offset == offset && e.crc == crc)
+         return i;
+   }
+   return -1;
+}
+
+void ZipInflateCache::freeEntry(const U32 index)
+{
+   Entry &e = mEntries[index];
+   AssertFatal(e.data && e.refCount == 0, "ZipInflateCache::freeEntry: entry is in use.");
+
+   // unlink from its bucket
+   S32 *link = &mHashTable[hash(e.zipPath, e.offset, e.crc)];
+   while (*link != S32(index))
+      link = &mEntries[*link].nextInBucket;
+   *link = e.nextInBucket;
+
+   mCachedBytes -= e.size;
+   delete [] e.data;
+   e.data = NULL;
+   e.zipPath = NULL;
+   e.nextInBucket = -1;
+}
+
+bool ZipInflateCache::makeRoom(const U32 bytesNeeded)
+{
+   U32 budget = U32(getMax(smBudgetMB, 0)) << 20;
+   if (bytesNeeded > budget / 4)
+      return false;
+
+   while (mCachedBytes + bytesNeeded > budget)
+   {
+      S32 victim = -1;
+      for (U32 i = 0; i < mEntries.size(); i++)
+      {
+         const Entry &e = mEntries[i];
+         if (!e.data || e.refCount)
+            continue;
+         if (victim == -1 || e.lastUse < mEntries[victim].lastUse)
+            victim = i;
+      }
+
+      // everything left is open
+      if (victim == -1)
+         return false;
+
+      freeEntry(victim);
+      mEvictions++;
+   }
+   return true;
+}
+
+void ZipInflateCache::release(const S32 index)
+{
+   AssertFatal(mEntries[index].refCount > 0, "ZipInflateCache::release: entry is not referenced.");
+   mEntries[index].refCount--;
+}
+
+//------------------------------------------------------------------------------
+
+Stream* ZipInflateCache::openStream(StringTableEntry zipPath, const U32 offset, const U32 crc)
+{
+   S32 index = findEntry(zipPath, offset, crc);
+   if (index == -1)
+   {
+      mMisses++;
+      return NULL;
+   }
+
+   Entry &e = mEntries[index];
+   e.lastUse = ++mUseSequence;
+
+   mHits++;
+   mBytesSaved += e.size;
+   return new ZipInflateCacheStream(this, index, e.data, e.size);
+}
+
+Stream* ZipInflateCache::insert(StringTableEntry zipPath, const U32 offset, const U32 crc, Stream *inflater)
+{
+   U32 size = inflater->getStreamSize();
+   if (size == 0 || !makeRoom(size))
+      return NULL;
+
+   U8 *data = new U8[size];
+   if (!inflater->read(size, data))
+   {
+      delete [] data;
+      return NULL;
+   }
+
+   // reuse a free slot if there is one
+   S32 index = -1;
+   for (U32 i = 0; i < mEntries.size(); i++)
+   {
+      if (!mEntries[i].data)
+      {
+         index = i;
+         break;
+      }
+   }
+   if (index == -1)
+   {
+      mEntries.increment();
+      index = mEntries.size() - 1;
+   }
+
+   Entry &e = mEntries[index];
+   e.zipPath  = zipPath;
+   e.offset   = offset;
+   e.crc      = crc;
+   e.data     = data;
+   e.size     = size;
+   e.refCount = 0;
+   e.lastUse  = ++mUseSequence;
+
+   U32 bucket = hash(zipPath, offset, crc);
+   e.nextInBucket = mHashTable[bucket];
+   mHashTable[bucket] = index;
+
+   mCachedBytes += size;
+   return new ZipInflateCacheStream(this, index, data, size);
+}
+
+void ZipInflateCache::flush()
+{
+   for (U32 i = 0; i < mEntries.size(); i++)
+      if (mEntries[i].data && !mEntries[i].refCount)
+         freeEntry(i);
+}
+
+//------------------------------------------------------------------------------
+
+void ZipInflateCache::dumpStats()
+{
+   U32 count = 0;
+   for (U32 i = 0; i < mEntries.size(); i++)
+      if (mEntries[i].data)
+         count++;
+
+   U32 lookups = mHits + mMisses;
+   Con::printf("Zip inflate cache:");
+   Con::printf("   entries:   %d (%d KB of %d KB budget)", count, mCachedBytes >> 10, getMax(smBudgetMB, 0) << 10);
+   Con::printf("   hits:      %d / %d (%.1f%%)", mHits, lookups, lookups ? 100.0f * mHits / lookups : 0.0f);
+   Con::printf("   evictions: %d", mEvictions);
+   Con::printf("   saved:     %d KB of inflation", mBytesSaved >> 10);
+}
@@ -0,0 +1,103 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _ZIPINFLATECACHE_H_
+#define _ZIPINFLATECACHE_H_
+
+//Includes
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _TVECTOR_H_
+#include "core/tVector.h"
+#endif
+#ifndef _MEMSTREAM_H_
+#include "core/memstream.h"
+#endif
+
+class ZipInflateCache;
+
+/// Read-only stream over a cached, already inflated zip member.  Holds a
+/// reference on the blob so it can't be evicted while the stream is open.
+class ZipInflateCacheStream : public MemStream
+{
+   typedef MemStream Parent;
+
+   ZipInflateCache *mCache;
+   S32              mIndex;
+
+  public:
+   ZipInflateCacheStream(ZipInflateCache *cache, S32 index, void *data, const U32 size);
+   ~ZipInflateCacheStream();
+};
+
+/// LRU cache of inflated zip members.
+///
+/// Deflated members (shapes, interiors, scripts, textures that were purged...)
+/// are otherwise re-inflated through a ZipSubRStream every time they are
+/// opened. The cache holds the inflated bytes, keyed by archive, local header
+/// offset and CRC, within a memory budget of
+/// $Pref::ResourceManager::inflateCacheBudget MB.
+///
+/// Members larger than a quarter of the budget are never cached so one big
+/// file can't flush everything else.
+class ZipInflateCache
+{
+   friend class ZipInflateCacheStream;
+
+   struct Entry
+   {
+      StringTableEntry zipPath;
+      U32              offset;
+      U32              crc;
+      U8              *data;      ///< NULL if the slot is free.
+      U32              size;
+      S32              refCount;
+      U32              lastUse;
+      S32              nextInBucket;
+   };
+
+   enum { HashTableSize = 512 };
+
+   Vector<Entry> mEntries;
+   S32           mHashTable[HashTableSize];   ///< Index of the first entry in each bucket, or -1.
+   U32           mCachedBytes;
+   U32           mUseSequence;
+
+   /// @name Statistics
+   /// @{
+   U32 mHits;
+   U32 mMisses;
+   U32 mEvictions;
+   U32 mBytesSaved;     ///< Inflated bytes served from the cache.
+   /// @}
+
+   static U32 hash(StringTableEntry zipPath, const U32 offset, const U32 crc);
+   S32  findEntry(StringTableEntry zipPath, const U32 offset, const U32 crc);
+   void freeEntry(const U32 index);
+   bool makeRoom(const U32 bytesNeeded);
+   void release(const S32 index);
+
+  public:
+   static S32 smBudgetMB;
+
+   ZipInflateCache();
+   ~ZipInflateCache();
+
+   /// Returns a stream over the cached copy of a member, or NULL on a miss.
+   Stream* openStream(StringTableEntry zipPath, const U32 offset, const U32 crc);
+
+   /// Inflate all of 'inflater' into the cache and return a stream over the
+   /// cached copy. Returns NULL (leaving 'inflater' untouched) if the member
+   /// doesn't fit in the budget. The caller still owns 'inflater'.
+   Stream* insert(StringTableEntry zipPath, const U32 offset, const U32 crc, Stream *inflater);
+
+   /// Free every unreferenced entry.
+   void flush();
+
+   void dumpStats();
+};
+
+#endif //_ZIPINFLATECACHE_H_
@@ -23,7 +23,10 @@ ZipSubRStream::ZipSubRStream()
    m_EOS(false),
 
    m_pZipStream(NULL),
-   m_originalSlavePosition(0)
+   m_pInputBuffer(NULL),
+   m_originalSlavePosition(0),
+   m_pDirectInput(NULL),
+   m_directInputSize(0)
 {
    //
 }
@@ -48,16 +51,26 @@ bool ZipSubRStream::attachStream(Stream* io_pSlaveStream)
 
    // Initialize zipStream state...
    m_pZipStream   = new z_stream_s;
-   m_pInputBuffer = new U8[csm_inputBufferSize];
 
    m_pZipStream->zalloc = Z_NULL;
    m_pZipStream->zfree  = Z_NULL;
    m_pZipStream->opaque = Z_NULL;
 
-   U32 buffSize = fillBuffer(csm_inputBufferSize);
+   if (m_pDirectInput != NULL)
+   {
+      // All of the input is already in memory, hand it to zlib in one go.
+      m_pInputBuffer = NULL;
+      m_pZipStream->next_in  = (Bytef*)m_pDirectInput;
+      m_pZipStream->avail_in = m_directInputSize;
+   }
+   else
+   {
+      m_pInputBuffer = new U8[csm_inputBufferSize];
+      U32 buffSize = fillBuffer(csm_inputBufferSize);
 
-   m_pZipStream->next_in  = m_pInputBuffer;
-   m_pZipStream->avail_in = buffSize;
+      m_pZipStream->next_in  = m_pInputBuffer;
+      m_pZipStream->avail_in = buffSize;
+   }
    m_pZipStream->total_in = 0;
    inflateInit2(m_pZipStream, -MAX_WBITS);
 
@@ -84,6 +97,8 @@ void ZipSubRStream::detachStream()
    m_uncompressedSize = 0;
    m_currentPosition  = 0;
    m_EOS              = false;
+   m_pDirectInput     = NULL;
+   m_directInputSize  = 0;
    setStatus(Closed);
 }
 
@@ -101,6 +116,15 @@ void ZipSubRStream::setUncompressedSize(const U32 in_uncSize)
    m_uncompressedSize = in_uncSize;
 }
 
+//--------------------------------------
+void ZipSubRStream::setDirectInput(const void* in_pCompressed, const U32 in_compressedSize)
+{
+   AssertFatal(m_pStream == NULL, "Direct input must be set before attaching");
+
+   m_pDirectInput    = (const U8*)in_pCompressed;
+   m_directInputSize = in_compressedSize;
+}
+
 //--------------------------------------
 bool ZipSubRStream::_read(const U32 in_numBytes, void *out_pBuffer)
 {
@@ -202,8 +226,12 @@ bool ZipSubRStream::setPosition(const U32 in_newPosition)
       Stream* pStream = getStream();
       U32 resetPosition = m_originalSlavePosition;
       U32 uncompressedSize = m_uncompressedSize;
+      const U8* directInput = m_pDirectInput;
+      U32 directInputSize = m_directInputSize;
       detachStream();
       pStream->setPosition(resetPosition);
+      if (directInput != NULL)
+         setDirectInput(directInput, directInputSize);
       attachStream(pStream);
       setUncompressedSize(uncompressedSize);
       return true;
@@ -219,8 +247,12 @@ bool ZipSubRStream::setPosition(const U32 in_newPosition)
          Stream* pStream = getStream();
          U32 resetPosition = m_originalSlavePosition;
          U32 uncompressedSize = m_uncompressedSize;
+         const U8* directInput = m_pDirectInput;
+         U32 directInputSize = m_directInputSize;
          detachStream();
          pStream->setPosition(resetPosition);
+         if (directInput != NULL)
+            setDirectInput(directInput, directInputSize);
          attachStream(pStream);
          setUncompressedSize(uncompressedSize);
       }
@@ -271,6 +303,10 @@ U32 ZipSubRStream::fillBuffer(const U32 in_attemptSize)
    AssertFatal(m_pStream->getStatus() != Stream::Closed,
                "Fill from a closed stream?");
 
+   // direct input was handed over in full when we attached
+   if (m_pDirectInput != NULL)
+      return 0;
+
    U32 streamSize = m_pStream->getStreamSize();
    U32 currPos    = m_pStream->getPosition();
 
@@ -29,6 +29,9 @@ class ZipSubRStream : public FilterStream
 
    U32          m_originalSlavePosition;
 
+   const U8*    m_pDirectInput;
+   U32          m_directInputSize;
+
    U32 fillBuffer(const U32 in_attemptSize);
 
   public:
@@ -43,6 +46,12 @@ class ZipSubRStream : public FilterStream
 
    void setUncompressedSize(const U32);
 
+   /// Inflate straight out of an in-memory copy of the compressed data (e.g.
+   /// a mapped zip volume) instead of copying it through the input buffer.
+   /// Must be called before attachStream(); the slave stream is then only
+   /// used for ownership and is never read.
+   void setDirectInput(const void* in_pCompressed, const U32 in_compressedSize);
+
    // Mandatory overrides.  By default, these are simply passed to
    //  whatever is returned from getStream();
   protected:
@@ -0,0 +1,201 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "core/stringTable.h"
+#include "core/zipVolume.h"
+#include "core/zipHeaders.h"
+#include "core/zipSubStream.h"
+#include "core/resManager.h"
+#include "console/console.h"
+#include "math/mMathFn.h"
+
+S32 ZipVolumeCache::smMappedBudgetMB = 256;
+
+//------------------------------------------------------------------------------
+
+ZipVolumeStream::ZipVolumeStream(ZipVolumeCache *cache, ZipVolume *volume, const U32 offset, const U32 size)
+ : Parent(size, (void *)(volume->base + offset), true, false),
+   mCache(cache),
+   mVolume(volume)
+{
+   volume->refCount++;
+}
+
+ZipVolumeStream::~ZipVolumeStream()
+{
+   mCache->release(mVolume);
+}
+
+//------------------------------------------------------------------------------
+
+ZipVolumeCache::ZipVolumeCache()
+{
+   mMappedBytes  = 0;
+   mOpenSequence = 0;
+}
+
+ZipVolumeCache::~ZipVolumeCache()
+{
+   for (U32 i = 0; i < mVolumes.size(); i++)
+   {
+      AssertWarn(mVolumes[i]->refCount == 0, "ZipVolumeCache: volume still has open streams.");
+      Platform::unmapFile(mVolumes[i]->base, mVolumes[i]->size, mVolumes[i]->handle);
+      delete mVolumes[i];
+   }
+   mVolumes.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void ZipVolumeCache::unmap(U32 index)
+{
+   ZipVolume *volume = mVolumes[index];
+   AssertFatal(volume->refCount == 0, "ZipVolumeCache::unmap: volume is still referenced.");
+
+   Platform::unmapFile(volume->base, volume->size, volume->handle);
+   mMappedBytes -= volume->size;
+   delete volume;
+   mVolumes.erase_fast(index);
+}
+
+void ZipVolumeCache::evict(const U32 bytesNeeded)
+{
+   // Kept under 2GB so the budget and the sum below can't wrap.
+   U32 budget = U32(mClamp(smMappedBudgetMB, 0, 2047)) << 20;
+
+   while (mMappedBytes + bytesNeeded > budget)
+   {
+      // find the least recently used volume with no open streams
+      S32 victim = -1;
+      for (U32 i = 0; i < mVolumes.size(); i++)
+      {
+         if (mVolumes[i]->refCount)
+            continue;
+         if (victim == -1 || mVolumes[i]->lastUse < mVolumes[victim]->lastUse)
+            victim = i;
+      }
+
+      if (victim == -1)
+         break;
+      unmap(victim);
+   }
+}
+
+ZipVolume* ZipVolumeCache::acquire(const char *zipPath)
+{
+   StringTableEntry path = StringTable->insert(zipPath);
+
+   for (U32 i = 0; i < mVolumes.size(); i++)
+   {
+      if (mVolumes[i]->path == path)
+      {
+         mVolumes[i]->lastUse = ++mOpenSequence;
+         return mVolumes[i];
+      }
+   }
+
+   // make room, then map it
+   S32 fileSize = Platform::getFileSize(zipPath);
+   evict(fileSize > 0 ? U32(fileSize) : 0);
+
+   U32 size;
+   void *handle;
+   const void *base = Platform::mapFile(zipPath, size, handle);
+   if (!base)
+   {
+      // could be out of address space, drop everything we can and retry once
+      flush();
+      base = Platform::mapFile(zipPath, size, handle);
+      if (!base)
+         return NULL;
+   }
+
+   ZipVolume *volume = new ZipVolume;
+   volume->path     = path;
+   volume->base     = (const U8 *)base;
+   volume->size     = size;
+   volume->handle   = handle;
+   volume->refCount = 0;
+   volume->lastUse  = ++mOpenSequence;
+
+   mVolumes.push_back(volume);
+   mMappedBytes += size;
+   return volume;
+}
+
+void ZipVolumeCache::release(ZipVolume *volume)
+{
+   AssertFatal(volume->refCount > 0, "ZipVolumeCache::release: volume is not referenced.");
+   volume->refCount--;
+}
+
+void ZipVolumeCache::flush(const char *zipPath)
+{
+   StringTableEntry path = zipPath ? StringTable->insert(zipPath) : NULL;
+
+   for (S32 i = mVolumes.size() - 1; i >= 0; i--)
+   {
+      if (mVolumes[i]->refCount)
+         continue;
+      if (path && mVolumes[i]->path != path)
+         continue;
+      unmap(i);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+Stream* ZipVolumeCache::openStream(ResourceObject *obj, const char *zipPath)
+{
+   // empty members can't be represented by a MemStream; let the caller
+   // take the FileStream path
+   if (obj->fileSize == 0 || obj->compressedFileSize == 0)
+      return NULL;
+
+   ZipVolume *volume = acquire(zipPath);
+   if (!volume)
+      return NULL;
+
+   U32 headerOffset = U32(obj->fileOffset);
+   if (headerOffset >= volume->size)
+      return NULL;
+
+   // parse the local header straight out of the mapping
+   ZipLocalFileHeader zlfHeader;
+   U32 dataOffset;
+   {
+      ZipVolumeStream headerStream(this, volume, headerOffset, volume->size - headerOffset);
+      if (zlfHeader.readFromStream(headerStream) == false)
+         return NULL;
+      dataOffset = headerOffset + headerStream.getPosition();
+   }
+
+   if (zlfHeader.m_header.compressionMethod == ZipLocalFileHeader::Stored)
+   {
+      if (dataOffset + U32(obj->fileSize) > volume->size)
+         return NULL;
+
+      // zero copy
+      return new ZipVolumeStream(this, volume, dataOffset, obj->fileSize);
+   }
+
+   if (zlfHeader.m_header.compressionMethod == ZipLocalFileHeader::Deflated)
+   {
+      if (dataOffset + U32(obj->compressedFileSize) > volume->size)
+         return NULL;
+
+      ZipVolumeStream *compressed = new ZipVolumeStream(this, volume, dataOffset, obj->compressedFileSize);
+
+      ZipSubRStream *zipStream = new ZipSubRStream;
+      zipStream->setDirectInput(volume->base + dataOffset, obj->compressedFileSize);
+      zipStream->attachStream(compressed);
+      zipStream->setUncompressedSize(obj->fileSize);
+      return zipStream;
+   }
+
+   // let the caller report the bad compression method
+   return NULL;
+}
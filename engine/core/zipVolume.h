@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _ZIPVOLUME_H_
+#define _ZIPVOLUME_H_
+
+//Includes
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _TVECTOR_H_
+#include "core/tVector.h"
+#endif
+#ifndef _MEMSTREAM_H_
+#include "core/memstream.h"
+#endif
+
+class ResourceObject;
+class ZipVolumeCache;
+
+/// A zip archive mapped into memory, shared by every stream opened on one of
+/// its members.
+struct ZipVolume
+{
+   StringTableEntry path;     ///< Full path of the zip file.
+   const U8        *base;     ///< Start of the mapping.
+   U32              size;     ///< Size of the mapping.
+   void            *handle;   ///< Platform handle for Platform::unmapFile().
+   S32              refCount; ///< Number of open streams on this volume.
+   U32              lastUse;  ///< Sequence number of the last open, for LRU eviction.
+};
+
+/// Read-only stream over a range of a mapped zip volume.
+///
+/// Holds a reference on the volume for its lifetime so the mapping can't go
+/// away underneath it; deleting the stream (ResManager::closeStream) drops it.
+class ZipVolumeStream : public MemStream
+{
+   typedef MemStream Parent;
+
+   ZipVolumeCache *mCache;
+   ZipVolume      *mVolume;
+
+  public:
+   ZipVolumeStream(ZipVolumeCache *cache, ZipVolume *volume, const U32 offset, const U32 size);
+   ~ZipVolumeStream();
+};
+
+/// Keeps the zip archives used by the resource manager mapped once, instead
+/// of re-opening the archive, seeking and re-reading through a FileStream
+/// for every member that is loaded.
+///
+/// Stored members are served as zero-copy memory streams over the mapping,
+/// deflated members are inflated directly out of the mapping by a
+/// ZipSubRStream.
+///
+/// Unreferenced volumes stay mapped until the total mapped size goes over
+/// $Pref::ResourceManager::zipMapBudget (in MB), at which point the least
+/// recently used ones are unmapped. If a volume can't be mapped at all
+/// openStream() returns NULL and the caller falls back to a FileStream.
+class ZipVolumeCache
+{
+   Vector<ZipVolume*> mVolumes;
+   U32                mMappedBytes;
+   U32                mOpenSequence;
+
+   ZipVolume* acquire(const char *zipPath);
+   void       unmap(U32 index);
+   void       evict(const U32 bytesNeeded);
+
+  public:
+   static S32 smMappedBudgetMB;
+
+   ZipVolumeCache();
+   ~ZipVolumeCache();
+
+   /// Open a read stream on a VolumeBlock resource, or NULL if the archive
+   /// could not be mapped or the member could not be located in it.
+   Stream* openStream(ResourceObject *obj, const char *zipPath);
+
+   /// Drop a reference taken by openStream().
+   void release(ZipVolume *volume);
+
+   /// Unmap every volume that has no open streams, or just the given one.
+   ///
+   /// Done before an archive is rewritten (a mapped file can't be replaced on
+   /// Win32) and when the mod paths are rescanned.
+   void flush(const char *zipPath = NULL);
+
+   U32 getMappedBytes() const { return mMappedBytes; }
+   U32 getVolumeCount() const { return mVolumes.size(); }
+};
+
+#endif //_ZIPVOLUME_H_
@@ -170,6 +170,72 @@ void DynamicTexture::setUpdateRect( const RectI &newRect )
 
 //------------------------------------------------------------------------------
 
+bool DynamicTexture::updateRegion( const RectI &screenRect )
+{
+   if( !mHasUpdateRect || mTextureHandle == NULL || !mTextureHandle->isValid() )
+      return false;
+
+   // Flip to GL's lower-left origin, same as setUpdateRect
+   S32 glY = Platform::getWindowSize().y - screenRect.point.y - screenRect.extent.y;
+
+   glReadBuffer( GL_BACK );
+   glBindTexture( GL_TEXTURE_2D, mTextureHandle->getGLName() );
+   glCopyTexSubImage2D( GL_TEXTURE_2D, 0,
+                        screenRect.point.x - mUpdateRect.point.x, glY - mUpdateRect.point.y,
+                        screenRect.point.x, glY,
+                        screenRect.extent.x, screenRect.extent.y );
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool DynamicTexture::restoreRegion( const RectI &screenRect )
+{
+   if( !mHasUpdateRect || mTextureHandle == NULL || !mTextureHandle->isValid() )
+      return false;
+
+   TextureObject *obj = mTextureHandle->object;
+   F32 invTexWidth  = 1.0f / obj->texWidth;
+   F32 invTexHeight = 1.0f / obj->texHeight;
+
+   // The rows were grabbed bottom-up, so the top of the rect is the high t
+   S32 glY = Platform::getWindowSize().y - screenRect.point.y - screenRect.extent.y;
+   F32 texLeft   = (screenRect.point.x - mUpdateRect.point.x) * invTexWidth;
+   F32 texRight  = (screenRect.point.x + screenRect.extent.x - mUpdateRect.point.x) * invTexWidth;
+   F32 texBottom = (glY - mUpdateRect.point.y) * invTexHeight;
+   F32 texTop    = (glY + screenRect.extent.y - mUpdateRect.point.y) * invTexHeight;
+
+   F32 left   = F32(screenRect.point.x);
+   F32 right  = F32(screenRect.point.x + screenRect.extent.x);
+   F32 top    = F32(screenRect.point.y);
+   F32 bottom = F32(screenRect.point.y + screenRect.extent.y);
+
+   // The alpha in the color-buffer is whatever the Gui left there, so
+   // these pixels have to replace what is on screen rather than blend.
+   glDisable( GL_LIGHTING );
+   glDisable( GL_BLEND );
+   glEnable( GL_TEXTURE_2D );
+   glBindTexture( GL_TEXTURE_2D, mTextureHandle->getGLName() );
+   glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+
+   glBegin( GL_TRIANGLE_FAN );
+      glTexCoord2f( texLeft,  texTop );
+      glVertex2f( left,  top );
+      glTexCoord2f( texRight, texTop );
+      glVertex2f( right, top );
+      glTexCoord2f( texRight, texBottom );
+      glVertex2f( right, bottom );
+      glTexCoord2f( texLeft,  texBottom );
+      glVertex2f( left,  bottom );
+   glEnd();
+
+   glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+   glDisable( GL_TEXTURE_2D );
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
 void DynamicTexture::renderGuiControl( GuiControl *ctrl /* = NULL */, bool rttMode /* = false  */ )
 {
    if( ctrl == NULL )
@@ -120,6 +120,20 @@ public:
    /// @param   newUpdatePoint   The new rect, in screen coordinates, to use for the update rect
    void setUpdateRect( const RectI &newRect );
 
+   /// Grabs part of the update rect from the color-buffer into the matching
+   /// part of the texture, leaving the rest of the texture as it was.
+   ///
+   /// @param   screenRect   Rect to grab, in screen coordinates
+   /// @returns False if there is no texture to grab into
+   bool updateRegion( const RectI &screenRect );
+
+   /// Draws part of the texture back over the screen at the place it was
+   /// grabbed from, without blending.
+   ///
+   /// @param   screenRect   Rect to draw, in screen coordinates
+   /// @returns False if there is no texture to draw from
+   bool restoreRegion( const RectI &screenRect );
+
    /// @defgroup dyntex_rtt Render To Texture Simulation
    /// Render To Texture is really great because it allows you to draw to offscreen
    /// buffers and not muck around with copying pixels etc. Unfortunatly there is
@@ -21,7 +21,8 @@
 #include "ctype.h"  // Needed for isupper and tolower
 
 S32 GFont::smSheetIdCount = 0;
-const U32 GFont::csm_fileVersion = 3;
+const U32 GFont::csm_fileVersion = 4;
+void *GFont::smRasterMutex = NULL;
 
 ConsoleFunction(populateFontCacheString, void, 4, 4, "(faceName, size, string) - "
                 "Populate the font cache for the specified font with characters from the specified string.")
@@ -83,6 +84,37 @@ ConsoleFunction(populateFontCacheRange, void, 5, 5, "(faceName, size, rangeStart
    // All done!
 }
 
+ConsoleFunction(prewarmFontCacheRange, void, 5, 5, "(faceName, size, rangeStart, rangeEnd) - "
+                "Like populateFontCacheRange, but the characters are rasterized in the background "
+                "and added to the font as they are needed. Prewarmed ranges are saved with the "
+                "font cache, so they are only ever rasterized once.")
+{
+   Resource<GFont> f = GFont::create(argv[1], dAtoi(argv[2]), Con::getVariable("$GUI::fontCacheDirectory"));
+
+   if(f.isNull())
+   {
+      Con::errorf("prewarmFontCacheRange - could not load font '%s %d'!", argv[1], dAtoi(argv[2]));
+      return;
+   }
+
+   U32 rangeStart = dAtoi(argv[3]);
+   U32 rangeEnd   = dAtoi(argv[4]);
+
+   if(rangeStart > rangeEnd)
+   {
+      Con::errorf("prewarmFontCacheRange - range start is after end!");
+      return;
+   }
+
+   if(!f->hasPlatformFont())
+   {
+      Con::errorf("prewarmFontCacheRange - font '%s %d' has no platform font! Cannot generate more characters.", argv[1], dAtoi(argv[2]));
+      return;
+   }
+
+   f->prewarmRange(rangeStart, rangeEnd);
+}
+
 ConsoleFunction(dumpFontCacheStatus, void, 1, 1, "() - Return a full description "
                 "of all cached fonts, along with info on the codepoints each contains.")
 {
@@ -131,6 +163,8 @@ ConsoleFunction(writeFontCache, void, 1, 1, "() - force all cached fonts to"
       }
 
       // Ok, dump info!
+      font->finishPrewarm();
+
       FileStream stream;
       if(ResourceManager->openFileForWrite(stream, curMatch)) 
       {
@@ -293,6 +327,8 @@ ConsoleFunction(duplicateCachedFont, void, 4, 4, "(oldFontName, oldFontSize, new
    }
 
    // Ok, dump info!
+   font->finishPrewarm();
+
    FileStream stream;
    if(ResourceManager->openFileForWrite(stream, newFontFile)) 
    {
@@ -357,9 +393,9 @@ ResourceInstance* constructFont(Stream& stream)
    return ret;
 }
 
-void GFont::getFontCacheFilename(const char *faceName, U32 size, U32 buffLen, char *outBuff)
+void GFont::getFontCacheFilename(const char *faceName, U32 size, U32 buffLen, char *outBuff, U32 charset /* = TGE_ANSI_CHARSET */)
 {
-   dSprintf(outBuff, buffLen, "%s/%s %d (%s).uft", Con::getVariable("$GUI::fontCacheDirectory"), faceName, size, getCharSetName(0));
+   dSprintf(outBuff, buffLen, "%s/%s %d (%s).uft", Con::getVariable("$GUI::fontCacheDirectory"), faceName, size, getCharSetName(charset));
 }
 
 Resource<GFont> GFont::create(const char *faceName, U32 size, const char *cacheDirectory, U32 charset /* = TGE_ANSI_CHARSET */)
@@ -414,10 +450,17 @@ GFont::GFont()
    mNeedSave = false;
    
    mMutex = Mutex::createMutex();
+
+   // fonts are only ever created on the main thread, so this can't race
+   if(!smRasterMutex)
+      smRasterMutex = Mutex::createMutex();
 }
 
 GFont::~GFont()
 {
+   // the GL context may be gone by now, just fill in the bitmaps for saving
+   finishPrewarm(false);
+
    if(mNeedSave)
    {
       FileStream stream;
@@ -463,6 +506,8 @@ void GFont::dumpInfo()
       Con::printf("      - Codepoints range from 0x%x to 0x%x.", mapBegin, mapEnd);
    else
       Con::printf("      - No mapped codepoints.", mapBegin, mapEnd);
+   for(U32 i=0; i<mPrewarmedRanges.size(); i+=2)
+      Con::printf("      - Prewarmed 0x%x to 0x%x.", mPrewarmedRanges[i], mPrewarmedRanges[i+1]);
    Con::printf("      - Platform font is %s.", (mPlatformFont ? "present" : "not present") );
 }
 
@@ -473,10 +518,19 @@ bool GFont::loadCharInfo(const UTF16 ch)
     if(mRemapTable[ch] != -1)
         return true;    // Not really an error
 
+    // It may already have been rasterized in the background.
+    commitPrewarmed();
+    if(mRemapTable[ch] != -1)
+        return true;
+
     if(mPlatformFont && mPlatformFont->isValidChar(ch))
     {
-        Mutex::lockMutex(mMutex); // the CharInfo returned by mPlatformFont is static data, must protect from changes.
-        PlatformFont::CharInfo &ci = mPlatformFont->getCharInfo(ch);
+        // the CharInfo returned by mPlatformFont is static data, must protect from changes.
+        Mutex::lockMutex(smRasterMutex);
+        PlatformFont::CharInfo ci = mPlatformFont->getCharInfo(ch);
+        Mutex::unlockMutex(smRasterMutex);
+
+        Mutex::lockMutex(mMutex);
         if(ci.bitmapData)
             addBitmap(ci);
 
@@ -492,63 +546,45 @@ bool GFont::loadCharInfo(const UTF16 ch)
     return false;
 }
 
-void GFont::addBitmap(PlatformFont::CharInfo &charInfo)
+void GFont::addBitmap(PlatformFont::CharInfo &charInfo, bool refresh)
 {
-   U32 nextCurX = U32(mCurX + charInfo.width ); /*7) & ~0x3;*/
-   U32 nextCurY = U32(mCurY + mPlatformFont->getFontHeight()); // + 7) & ~0x3;
-
-   // These are here for postmortem debugging.
-   bool routeA = false, routeB = false;
+   S32 width  = charInfo.width + GlyphGutter;
+   S32 height = charInfo.height + GlyphGutter;
 
-   if(mCurSheet == -1 || nextCurY >= TextureSheetSize)
+   if(width > TextureSheetSize || height > TextureSheetSize)
    {
-      routeA = true;
-      addSheet();
-
-      // Recalc our nexts.
-      nextCurX = U32(mCurX + charInfo.width); // + 7) & ~0x3;
-      nextCurY = U32(mCurY + mPlatformFont->getFontHeight()); // + 7) & ~0x3;
-   }
-
-   if( nextCurX >= TextureSheetSize)
-   {
-      routeB = true;
-      mCurX = 0;
-      mCurY = nextCurY;
-
-      // Recalc our nexts.
-      nextCurX = U32(mCurX + charInfo.width); // + 7) & ~0x3;
-      nextCurY = U32(mCurY + mPlatformFont->getFontHeight()); // + 7) & ~0x3;
+      Con::warnf("GFont::addBitmap - %dx%d glyph doesn't fit on a sheet of '%s %d', it won't be drawn.",
+         charInfo.width, charInfo.height, mFaceName, mSize);
+      charInfo.bitmapIndex = -1;
+      return;
    }
 
-   // Check the Y once more - sometimes we advance to a new row and run off
-   // the end.
-   if(nextCurY >= TextureSheetSize)
+   S32 x, y;
+   U32 index;
+   if(mCurSheet == -1 || !findGlyphSpot(width, height, x, y, index))
    {
-      routeA = true;
       addSheet();
-
-      // Recalc our nexts.
-      nextCurX = U32(mCurX + charInfo.width); // + 7) & ~0x3;
-      nextCurY = U32(mCurY + mPlatformFont->getFontHeight()); // + 7) & ~0x3;
+      findGlyphSpot(width, height, x, y, index);
    }
+   addSkylineLevel(index, x, y, width, height);
 
-    charInfo.bitmapIndex = mCurSheet;
-    charInfo.xOffset = mCurX;
-    charInfo.yOffset = mCurY;
+   charInfo.bitmapIndex = mCurSheet;
+   charInfo.xOffset = x;
+   charInfo.yOffset = y;
 
-   mCurX = nextCurX;
+   // Only kept up to date for the benefit of the cache file.
+   mCurX = x + width;
+   mCurY = y;
 
-   S32 x, y;
    GBitmap *bmp = mTextureSheets[mCurSheet].getBitmap();
 
    AssertFatal(bmp->getFormat() == GBitmap::Alpha, "GFont::addBitmap - cannot added characters to non-greyscale textures!");
 
    for(y = 0;y < charInfo.height;y++)
-      for(x = 0;x < charInfo.width;x++)
-         *bmp->getAddress(x + charInfo.xOffset, y + charInfo.yOffset) = charInfo.bitmapData[y * charInfo.width + x];
+      dMemcpy(bmp->getAddress(charInfo.xOffset, y + charInfo.yOffset), &charInfo.bitmapData[y * charInfo.width], charInfo.width);
 
-   mTextureSheets[mCurSheet].refresh();
+   if(refresh)
+      mTextureSheets[mCurSheet].refresh();
 }
 
 void GFont::addSheet()
@@ -572,6 +608,270 @@ void GFont::addSheet()
     mCurX = 0;
     mCurY = 0;
     mCurSheet = mTextureSheets.size() - 1;
+
+    mSkyline.setSize(1);
+    mSkyline[0].x = 0;
+    mSkyline[0].y = 0;
+    mSkyline[0].width = TextureSheetSize;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Glyph packing
+//
+// Glyphs are packed into the current sheet with a bottom-left skyline: the
+// sheet's free space is tracked as the outline of everything placed so far,
+// and each glyph goes wherever its top would end up lowest. Unlike plain
+// rows this lets short glyphs (punctuation, lowercase) tuck in next to tall
+// ones instead of wasting a full line height each.
+
+S32 GFont::fitSkyline(U32 index, S32 width, S32 height) const
+{
+   // The skyline always spans the whole sheet, so if the glyph fits
+   // horizontally we can't walk off the end of it.
+   S32 x = mSkyline[index].x;
+   if(x + width > TextureSheetSize)
+      return -1;
+
+   S32 y = 0;
+   S32 widthLeft = width;
+   while(widthLeft > 0)
+   {
+      y = getMax(y, mSkyline[index].y);
+      if(y + height > TextureSheetSize)
+         return -1;
+      widthLeft -= mSkyline[index].width;
+      index++;
+   }
+   return y;
+}
+
+bool GFont::findGlyphSpot(S32 width, S32 height, S32 &outX, S32 &outY, U32 &outIndex) const
+{
+   S32 bestBottom = S32_MAX;
+   S32 bestWidth  = S32_MAX;
+   bool found = false;
+
+   for(U32 i = 0; i < mSkyline.size(); i++)
+   {
+      S32 y = fitSkyline(i, width, height);
+      if(y < 0)
+         continue;
+
+      if(y + height < bestBottom || (y + height == bestBottom && mSkyline[i].width < bestWidth))
+      {
+         bestBottom = y + height;
+         bestWidth  = mSkyline[i].width;
+         outX       = mSkyline[i].x;
+         outY       = y;
+         outIndex   = i;
+         found      = true;
+      }
+   }
+   return found;
+}
+
+void GFont::addSkylineLevel(U32 index, S32 x, S32 y, S32 width, S32 height)
+{
+   mSkyline.insert(index);
+   mSkyline[index].x     = x;
+   mSkyline[index].y     = y + height;
+   mSkyline[index].width = width;
+
+   // Cut away whatever the new segment now covers.
+   for(U32 i = index + 1; i < mSkyline.size(); )
+   {
+      S32 prevEnd = mSkyline[i - 1].x + mSkyline[i - 1].width;
+      if(mSkyline[i].x >= prevEnd)
+         break;
+
+      S32 shrink = prevEnd - mSkyline[i].x;
+      mSkyline[i].x     += shrink;
+      mSkyline[i].width -= shrink;
+      if(mSkyline[i].width > 0)
+         break;
+      mSkyline.erase(i);
+   }
+
+   // Merge neighbours at the same height.
+   for(U32 i = 0; i + 1 < mSkyline.size(); )
+   {
+      if(mSkyline[i].y == mSkyline[i + 1].y)
+      {
+         mSkyline[i].width += mSkyline[i + 1].width;
+         mSkyline.erase(i + 1);
+      }
+      else
+         i++;
+   }
+}
+
+void GFont::rebuildSkyline()
+{
+   mSkyline.clear();
+   if(mCurSheet < 0 || mCurSheet >= mTextureSheets.size())
+   {
+      // Nothing to append to, the next glyph starts a fresh sheet.
+      mCurSheet = -1;
+      return;
+   }
+
+   // The outline of the current sheet is the lowest free row in each column.
+   S32 columns[TextureSheetSize];
+   dMemset(columns, 0, sizeof(columns));
+
+   for(U32 i = 0; i < mCharInfoList.size(); i++)
+   {
+      const PlatformFont::CharInfo &ci = mCharInfoList[i];
+      if(ci.bitmapIndex != mCurSheet || !ci.width || !ci.height)
+         continue;
+
+      S32 bottom = getMin(S32(ci.yOffset + ci.height + GlyphGutter), S32(TextureSheetSize));
+      S32 right  = getMin(S32(ci.xOffset + ci.width + GlyphGutter), S32(TextureSheetSize));
+      for(S32 x = ci.xOffset; x < right; x++)
+         columns[x] = getMax(columns[x], bottom);
+   }
+
+   for(S32 x = 0; x < TextureSheetSize; x++)
+   {
+      if(mSkyline.size() && mSkyline.last().y == columns[x])
+      {
+         mSkyline.last().width++;
+         continue;
+      }
+      mSkyline.increment();
+      mSkyline.last().x     = x;
+      mSkyline.last().y     = columns[x];
+      mSkyline.last().width = 1;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Prewarming
+
+class GFont::PrewarmItem : public ThreadPool::WorkItem
+{
+   GFont *mFont;
+   U32    mRangeStart;
+   U32    mRangeEnd;
+
+   Vector<PrewarmedGlyph> mGlyphs;
+
+   enum { BatchSize = 64 };
+
+   void handOver(bool finished)
+   {
+      Mutex::lockMutex(mFont->mMutex);
+      for(U32 i = 0; i < mGlyphs.size(); i++)
+         mFont->mPrewarmReady.push_back(mGlyphs[i]);
+      if(finished)
+      {
+         mFont->mPrewarmReadyRanges.push_back(mRangeStart);
+         mFont->mPrewarmReadyRanges.push_back(mRangeEnd);
+      }
+      Mutex::unlockMutex(mFont->mMutex);
+
+      mGlyphs.clear();
+   }
+
+public:
+   PrewarmItem(GFont *font, U32 rangeStart, U32 rangeEnd)
+      : ThreadPool::WorkItem(true), mFont(font), mRangeStart(rangeStart), mRangeEnd(rangeEnd) {}
+
+   void execute()
+   {
+      PlatformFont *platFont = mFont->mPlatformFont;
+
+      for(U32 i = mRangeStart; i < mRangeEnd; i++)
+      {
+         // A stale read of the remap table only costs a duplicate, which
+         // commitPrewarmed() throws away.
+         UTF16 ch = i;
+         if(!ch || mFont->mRemapTable[ch] != -1 || !platFont->isValidChar(ch))
+            continue;
+
+         mGlyphs.increment();
+         mGlyphs.last().ch = ch;
+
+         Mutex::lockMutex(smRasterMutex);
+         mGlyphs.last().info = platFont->getCharInfo(ch);
+         Mutex::unlockMutex(smRasterMutex);
+
+         // Hand glyphs over in batches so early ones are usable right away.
+         if(mGlyphs.size() >= BatchSize)
+            handOver(false);
+      }
+
+      handOver(true);
+   }
+};
+
+bool GFont::isRangePrewarmed(U32 rangeStart, U32 rangeEnd) const
+{
+   for(U32 i = 0; i < mPrewarmedRanges.size(); i += 2)
+      if(mPrewarmedRanges[i] <= rangeStart && mPrewarmedRanges[i + 1] >= rangeEnd)
+         return true;
+   return false;
+}
+
+void GFont::prewarmRange(U32 rangeStart, U32 rangeEnd)
+{
+   rangeEnd = getMin(rangeEnd, U32(0x10000));
+   if(!mPlatformFont || rangeStart >= rangeEnd || isRangePrewarmed(rangeStart, rangeEnd))
+      return;
+
+   ThreadPool::GLOBAL().queueWorkItem(new PrewarmItem(this, rangeStart, rangeEnd), &mPrewarmGroup);
+}
+
+void GFont::commitPrewarmed(bool refreshTextures)
+{
+   Mutex::lockMutex(mMutex);
+
+   if(mPrewarmReady.empty() && mPrewarmReadyRanges.empty())
+   {
+      Mutex::unlockMutex(mMutex);
+      return;
+   }
+
+   // Pack everything first, then upload each touched sheet once.
+   S32 firstSheet = getMax(mCurSheet, S32(0));
+
+   for(U32 i = 0; i < mPrewarmReady.size(); i++)
+   {
+      PrewarmedGlyph &glyph = mPrewarmReady[i];
+      if(mRemapTable[glyph.ch] != -1)
+      {
+         SAFE_DELETE_ARRAY(glyph.info.bitmapData);
+         continue;
+      }
+
+      if(glyph.info.bitmapData)
+         addBitmap(glyph.info, false);
+
+      mCharInfoList.push_back(glyph.info);
+      mRemapTable[glyph.ch] = mCharInfoList.size() - 1;
+   }
+
+   for(U32 i = 0; i < mPrewarmReadyRanges.size(); i++)
+      mPrewarmedRanges.push_back(mPrewarmReadyRanges[i]);
+
+   mPrewarmReady.clear();
+   mPrewarmReadyRanges.clear();
+   mNeedSave = true;
+
+   if(refreshTextures)
+      for(S32 i = firstSheet; i < mTextureSheets.size(); i++)
+         mTextureSheets[i].refresh();
+
+   Mutex::unlockMutex(mMutex);
+}
+
+void GFont::finishPrewarm(bool refreshTextures)
+{
+   // Nothing can be outstanding once the pool is gone, it drains on shutdown.
+   if(ThreadPool::hasGlobal())
+      ThreadPool::GLOBAL().waitForGroup(&mPrewarmGroup);
+
+   commitPrewarmed(refreshTextures);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -834,7 +1134,7 @@ bool GFont::read(Stream& io_rStream)
     // Handle versioning
     U32 version;
     io_rStream.read(&version);
-    if(version != csm_fileVersion)
+    if(version != csm_fileVersion && version != 3)
         return false;
 
     char buf[256];
@@ -918,6 +1218,19 @@ bool GFont::read(Stream& io_rStream)
       for(i = minGlyph; i <= maxGlyph; i++)
          mRemapTable[i] = convertBEndianToHost(mRemapTable[i]);
    }
+
+   // Ranges that were prewarmed into this cache (version 4 and up).
+   if(version >= 4)
+   {
+      U32 numRanges = 0;
+      io_rStream.read(&numRanges);
+      mPrewarmedRanges.setSize(numRanges * 2);
+      for(i = 0; i < numRanges * 2; i++)
+         io_rStream.read(&mPrewarmedRanges[i]);
+   }
+
+   // Pick up packing where the cache left off.
+   rebuildSkyline();
    
    return (io_rStream.getStatus() == Stream::Ok);
 }
@@ -999,6 +1312,10 @@ bool GFont::write(Stream& stream)
       for(i = minGlyph; i <= maxGlyph; i++)
          mRemapTable[i] = convertBEndianToHost(mRemapTable[i]);
    }
+
+   stream.write(U32(mPrewarmedRanges.size() / 2));
+   for(i = 0; i < mPrewarmedRanges.size(); i++)
+      stream.write(mPrewarmedRanges[i]);
    
    return (stream.getStatus() == Stream::Ok);
 }
@@ -1215,4 +1532,8 @@ void GFont::importStrip(const char *fileName, U32 padding, U32 kerning)
    // Ok, all done! Just refresh some textures and we're set.
    for(S32 i=0; i<sheetSizes.size(); i++)
       mTextureSheets[i].refresh();
+
+   // Any characters added later go after the imported ones.
+   mCurSheet = mTextureSheets.size() - 1;
+   rebuildSkyline();
 }
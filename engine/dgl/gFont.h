@@ -26,6 +26,10 @@
 #include "core/resManager.h"
 #endif
 
+#ifndef _THREADPOOL_H_
+#include "platform/threadPool.h"
+#endif
+
 #include "dgl/gTexManager.h"
 
 extern ResourceInstance* constructFont(Stream& stream);
@@ -46,6 +50,7 @@ public:
    {
       TabWidthInSpaces = 3,
       TextureSheetSize = 256,
+      GlyphGutter      = 1,    ///< Empty pixels kept right of and below each glyph.
    };
 
 
@@ -58,6 +63,34 @@ private:
    S32 mCurY;
    S32 mCurSheet;
 
+   /// One horizontal segment of the skyline of the current sheet: the
+   /// lowest free row over [x, x + width).
+   struct SkylineNode
+   {
+      S32 x;
+      S32 y;
+      S32 width;
+   };
+   Vector<SkylineNode> mSkyline;
+
+   /// @name Prewarming
+   /// Glyphs rasterized by prewarmRange() on the thread pool wait in
+   /// mPrewarmReady (guarded by mMutex) until the main thread packs them.
+   /// @{
+   struct PrewarmedGlyph
+   {
+      UTF16                  ch;
+      PlatformFont::CharInfo info;
+   };
+   class PrewarmItem;
+   friend class PrewarmItem;
+
+   Vector<PrewarmedGlyph> mPrewarmReady;
+   Vector<U32>            mPrewarmReadyRanges;   ///< Finished [start, end) pairs not yet committed.
+   Vector<U32>            mPrewarmedRanges;      ///< Committed [start, end) pairs, saved with the cache.
+   ThreadPool::WorkGroup  mPrewarmGroup;
+   /// @}
+
    bool mNeedSave;
    StringTableEntry mGFTFile;
    StringTableEntry mFaceName;
@@ -79,12 +112,26 @@ public:
 
 protected:
     bool loadCharInfo(const UTF16 ch);
-    void addBitmap(PlatformFont::CharInfo &charInfo);
+    void addBitmap(PlatformFont::CharInfo &charInfo, bool refresh = true);
     void addSheet(void);
     void assignSheet(S32 sheetNum, GBitmap *bmp);
 
+    /// @name Skyline packing
+    /// @{
+    S32  fitSkyline(U32 index, S32 width, S32 height) const;
+    bool findGlyphSpot(S32 width, S32 height, S32 &outX, S32 &outY, U32 &outIndex) const;
+    void addSkylineLevel(U32 index, S32 x, S32 y, S32 width, S32 height);
+    void rebuildSkyline();
+    /// @}
+
+    bool isRangePrewarmed(U32 rangeStart, U32 rangeEnd) const;
+
     void *mMutex;
 
+    /// Serializes every call into the platform fonts, which rasterize into
+    /// shared static buffers.
+    static void *smRasterMutex;
+
 public:
    static Resource<GFont> create(const char *faceName, U32 size, const char *cacheDirectory, U32 charset = TGE_ANSI_CHARSET);
 
@@ -93,6 +140,17 @@ public:
        return mTextureSheets[index];
    }
 
+   /// Rasterize the valid characters in [rangeStart, rangeEnd) on the thread
+   /// pool. They are added to the sheets the next time a missing character is
+   /// looked up (or by commitPrewarmed()) and saved with the font cache.
+   void prewarmRange(U32 rangeStart, U32 rangeEnd);
+
+   /// Pack every glyph the thread pool has finished into the texture sheets.
+   void commitPrewarmed(bool refreshTextures = true);
+
+   /// Block until all outstanding prewarming is done, then commit it.
+   void finishPrewarm(bool refreshTextures = true);
+
    /// While this is const to the outside world, it calls loadCharInfo() to load char info as it is used
    const PlatformFont::CharInfo& getCharInfo(const UTF16 in_charIndex) const;
    
@@ -148,7 +206,7 @@ public:
    }
 
    /// Get the filename for a cached font.
-   static void getFontCacheFilename(const char *faceName, U32 faceSize, U32 buffLen, char *outBuff);
+   static void getFontCacheFilename(const char *faceName, U32 faceSize, U32 buffLen, char *outBuff, U32 charset = TGE_ANSI_CHARSET);
 
    bool read(Stream& io_rStream);
    bool write(Stream& io_rStream);
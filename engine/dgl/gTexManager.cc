@@ -18,6 +18,7 @@
 #include "util/safeDelete.h"
 #include "game/net/TCPBinaryDownload.h"
 #include "game/net/ThreadedDownloading.h"
+#include "platform/metrics.h"
 
 //------------------------------------------------------------------------------
 
@@ -707,12 +708,29 @@ static void getSourceDestByteFormat(GBitmap *pBitmap, U32 *sourceFormat, U32 *de
 }
 
 
+static Metric sTextureUploads("texture.uploads", Metric::Counter);
+static Metric sTextureUploadBytes("texture.uploadBytes", Metric::Counter);
+static Metric sTextureUpload("texture.upload", Metric::Timer);
+
+/// Count the mips [firstMip, endMip) of a bitmap as uploaded.
+static void noteTextureUpload(const GBitmap *pDL, U32 firstMip, U32 endMip)
+{
+   U32 bytes = 0;
+   for (U32 i = firstMip; i < endMip; i++)
+      bytes += pDL->getWidth(i) * pDL->getHeight(i) * pDL->bytesPerPixel;
+
+   sTextureUploads.add();
+   sTextureUploadBytes.add(bytes);
+}
+
 //--------------------------------------
 void TextureManager::refresh(TextureObject *to)
 {
    if (!(gDGLRender || sgResurrect))
       return;
 
+   MetricScope uploadScope(sTextureUpload);
+
    U32 sourceFormat, destFormat, byteFormat;
    GBitmap *pBitmap = to->bitmap;
 
@@ -742,6 +760,7 @@ void TextureManager::refresh(TextureObject *to)
                       pDL->getPalette()->getColors());
    }
 
+   noteTextureUpload(pDL, 0, maxDownloadMip);
    if (sgDisableSubImage)
    {
       for (U32 i = 0; i < maxDownloadMip; i++)
@@ -832,6 +851,8 @@ void TextureManager::refresh(TextureObject *to, GBitmap* bmp)
 {
    if (!(gDGLRender || sgResurrect)) return;
 
+   MetricScope uploadScope(sTextureUpload);
+
    U32 sourceFormat, destFormat, byteFormat;
    GBitmap* pBitmap = bmp;
 
@@ -861,6 +882,7 @@ void TextureManager::refresh(TextureObject *to, GBitmap* bmp)
                       pDL->getPalette()->getColors());
    }
 
+   noteTextureUpload(pDL, 0, maxDownloadMip);
    if (sgDisableSubImage)
    {
       for (U32 i = 0; i < maxDownloadMip; i++)
@@ -957,6 +979,8 @@ bool TextureManager::createGLName(GBitmap*          pBitmap,
    if (!(gDGLRender || sgResurrect))
       return 0;
 
+   MetricScope uploadScope(sTextureUpload);
+
    glGenTextures(1, &to->texGLName);
    glBindTexture(GL_TEXTURE_2D, to->texGLName);
 
@@ -984,6 +1008,7 @@ bool TextureManager::createGLName(GBitmap*          pBitmap,
                       pDL->getPalette()->getColors());
    }
 
+   noteTextureUpload(pDL, firstMip, maxDownloadMip);
    for (U32 i = firstMip; i < maxDownloadMip; i++)
    {
       glTexImage2D(GL_TEXTURE_2D,
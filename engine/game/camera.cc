@@ -352,7 +352,7 @@ void Camera::writePacketData(GameConnection *connection, BitStream *bstream)
       if(writeMode == OrbitObjectMode)
       {
          bstream->writeFlag(mObservingClientObject);
-         bstream->writeInt(gIndex, NetConnection::GhostIdBitSize);
+         connection->writeGhostIndex(bstream, gIndex);
       }
       if (writeMode == OrbitPointMode)
          bstream->writeCompressedPoint(writePos);
@@ -379,7 +379,7 @@ void Camera::readPacketData(GameConnection *connection, BitStream *bstream)
       if(mode == OrbitObjectMode)
       {
          mObservingClientObject = bstream->readFlag();
-         S32 gIndex = bstream->readInt(NetConnection::GhostIdBitSize);
+         S32 gIndex = connection->readGhostIndex(bstream);
          obj = static_cast<GameBase*>(connection->resolveGhost(gIndex));
       }
       if (mode == OrbitPointMode)
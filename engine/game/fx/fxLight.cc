@@ -1564,7 +1564,7 @@ U32 fxLight::packUpdate(NetConnection * con, U32 mask, BitStream * stream)
 			// Get the GhostID of the object.
 			S32 GhostID = con->getGhostIndex(Obj);
 			// Send it to the client.
-            stream->writeRangedU32(U32(GhostID), 0, NetConnection::MaxGhostCount);
+            con->writeGhostIndex(stream, GhostID, true);
 		}
 		// Invalidate Attachment.
 		//mAttachValid = false;
@@ -1606,7 +1606,7 @@ void fxLight::unpackUpdate(NetConnection * con, BitStream * stream)
 		if (mAttached)
 		{
 			// Get the ObjectID.
-			S32 ObjectID = stream->readRangedU32(0, NetConnection::MaxGhostCount);
+			S32 ObjectID = con->readGhostIndex(stream, true);
 			// Resolve it.
 			NetObject* pObject = con->resolveGhost(ObjectID);
 			if (pObject != NULL)
@@ -781,7 +781,7 @@ U32 fxShapeReplicator::packUpdate(NetConnection * con, U32 mask, BitStream * str
 		   stream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 		   for(U32 i=0; i<maxcount; i++)
 		   {
-			   stream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+			   con->writeGhostIndex(stream, lightIds[i]);
 		   }
 	   }
 	   else
@@ -791,7 +791,7 @@ U32 fxShapeReplicator::packUpdate(NetConnection * con, U32 mask, BitStream * str
 		   stream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 		   for(U32 i=0; i<maxcount; i++)
 		   {
-			   stream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+			   con->writeGhostIndex(stream, lightIds[i]);
 		   }
 	   }
    }
@@ -855,7 +855,7 @@ void fxShapeReplicator::unpackUpdate(NetConnection * con, BitStream * stream)
 	   lightIds.clear();
 	   for(U32 i=0; i<count; i++)
 	   {
-		   S32 id = stream->readInt(NetConnection::GhostIdBitSize);
+		   S32 id = con->readGhostIndex(stream);
 		   lightIds.push_back(id);
 	   }
    }
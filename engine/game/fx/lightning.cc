@@ -126,7 +126,7 @@ void LightningStrikeEvent::pack(NetConnection* con, BitStream* stream)
       return;
    }
    stream->writeFlag(true);
-   stream->writeRangedU32(U32(id), 0, NetConnection::MaxGhostCount);
+   con->writeGhostIndex(stream, id, true);
    stream->writeFloat(mStart.x, PositionalBits);
    stream->writeFloat(mStart.y, PositionalBits);
 
@@ -138,7 +138,7 @@ void LightningStrikeEvent::pack(NetConnection* con, BitStream* stream)
       else
       {
          stream->writeFlag(true);
-         stream->writeRangedU32(U32(ghostIndex), 0, NetConnection::MaxGhostCount);
+         con->writeGhostIndex(stream, ghostIndex, true);
       }
    }
    else
@@ -149,7 +149,7 @@ void LightningStrikeEvent::unpack(NetConnection* con, BitStream* stream)
 {
    if(!stream->readFlag())
       return;
-   S32 mClientId = stream->readRangedU32(0, NetConnection::MaxGhostCount);
+   S32 mClientId = con->readGhostIndex(stream, true);
    mLightning = NULL;
    NetObject* pObject = con->resolveGhost(mClientId);
    if (pObject)
@@ -161,7 +161,7 @@ void LightningStrikeEvent::unpack(NetConnection* con, BitStream* stream)
    if( stream->readFlag() )
    {
       // target id
-      S32 mTargetID    = stream->readRangedU32(0, NetConnection::MaxGhostCount);
+      S32 mTargetID    = con->readGhostIndex(stream, true);
 
       NetObject* pObject = con->resolveGhost(mTargetID);
       if( pObject != NULL )
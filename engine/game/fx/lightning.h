@@ -175,6 +175,7 @@ class Lightning : public GameBase
 
    // Time management
    void processTick(const Move *move);
+   bool isProcessTickThreadSafe() const { return isClientObject(); }  ///< Only the server strikes.
    void interpolateTick(F32 delta);
    void advanceTime(F32 dt);
 
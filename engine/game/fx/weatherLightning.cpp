@@ -78,7 +78,7 @@ void WeatherLightningStrikeEvent::pack(NetConnection* con, BitStream* stream)
    }
    
    stream->writeFlag(true);
-   stream->writeRangedU32(U32(ghostIndex), 0, NetConnection::MaxGhostCount);
+   con->writeGhostIndex(stream, ghostIndex, true);
    stream->writeFloat(mStart.x, PositionalBits);
    stream->writeFloat(mStart.y, PositionalBits);
 }
@@ -87,7 +87,7 @@ void WeatherLightningStrikeEvent::unpack(NetConnection* con, BitStream* stream)
 {
    if(!stream->readFlag())
       return;
-   S32 ghostIndex = stream->readRangedU32(0, NetConnection::MaxGhostCount);
+   S32 ghostIndex = con->readGhostIndex(stream, true);
    mLightning = NULL;
    NetObject* pObject = con->resolveGhost(ghostIndex);
    if(pObject)
@@ -515,4 +515,5 @@ void GameBase::consoleInit()
 #ifdef TORQUE_DEBUG
    Con::addVariable("GameBase::boundingBox", TypeBool, &gShowBoundingBox);
 #endif
+   Con::addVariable("pref::ProcessList::ParallelTick", TypeBool, &ProcessList::smParallelTick);
 }
@@ -281,6 +281,18 @@ class GameBase : public SceneObject
    /// @param  move   Move event corresponding to this tick, or NULL.
    virtual void processTick(const Move *move);
 
+   /// True if processTick(NULL) may run on a worker thread, alongside other
+   /// objects' ticks.
+   ///
+   /// That means it only changes the object itself, and only reads data
+   /// nothing else changes during a tick. It must not move the object in
+   /// the container, set mask bits, delete anything, or use the console,
+   /// the sim or the network. Objects processing after another one, and
+   /// objects a client controls, are always ticked on the main thread.
+   ///
+   /// @see ProcessList::smParallelTick
+   virtual bool isProcessTickThreadSafe() const { return false; }
+
    /// Interpolates between tick events.  This takes place on the CLIENT ONLY.
    ///
    /// @param   delta   Time since last call to interpolate
@@ -364,18 +376,30 @@ class ProcessList
    SimTime mLastDelta;
    bool mIsServer;
    bool mDirty;
+   bool mParallelOrder;             ///< smParallelTick as of the last orderList().
    static bool mDebugControlSync;
 
+   enum { ParallelTickBatchSize = 64 };
+   Vector<GameBase*> mParallelRun;   ///< Objects at the front of this tick.
+
    void orderList();
-   void advanceObjects();
+   bool isParallelTickObject(GameBase *obj);
 
 public:
+   /// Tick the objects at the front of the list whose processTick() is
+   /// thread safe across the thread pool. Off by default.
+   static bool smParallelTick;
+
    SimTime getLastTime() { return mLastTime; }
    ProcessList(bool isServer);
    void markDirty()  { mDirty = true; }
    bool isDirty()  { return mDirty; }
    void addObject(GameBase* obj) {
       obj->plLinkBefore(&head);
+
+      // Belongs with the others at the front.
+      if (smParallelTick && obj->isProcessTickThreadSafe())
+         mDirty = true;
    }
    F32 getLastInterpDelta() { return mLastDelta / F32(TickMs); }
 
@@ -389,6 +413,9 @@ public:
    bool advanceServerTime(SimTime timeDelta);
    bool advanceClientTime(SimTime timeDelta);
 
+   /// Tick every object once.
+   void advanceObjects();
+
    /// @}
 };
 
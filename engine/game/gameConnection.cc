@@ -24,7 +24,7 @@
 
 #define ControlRequestTime 5000
 
-const U32 GameConnection::CurrentProtocolVersion = 21;
+const U32 GameConnection::CurrentProtocolVersion = 24;
 const U32 GameConnection::MinRequiredProtocolVersion = 9;
 
 //----------------------------------------------------------------------------
@@ -193,6 +193,9 @@ void GameConnection::writeConnectAccept(BitStream *stream)
 {
    Parent::writeConnectAccept(stream);
    stream->write(getProtocolVersion());
+
+   if(getProtocolVersion() >= GhostIdBitSizeVersion)
+      writeGhostIdBitSizeAccept(stream);
 }
 
 bool GameConnection::readConnectAccept(BitStream *stream, const char **errorString)
@@ -207,6 +210,10 @@ bool GameConnection::readConnectAccept(BitStream *stream, const char **errorStri
       *errorString = "CHR_PROTOCOL"; // this should never happen unless someone is faking us out.
       return false;
    }
+   setProtocolVersion(protocolVersion);
+
+   if(protocolVersion >= GhostIdBitSizeVersion)
+      return readGhostIdBitSizeAccept(stream, errorString);
    return true;
 }
 
@@ -221,6 +228,9 @@ void GameConnection::writeConnectRequest(BitStream *stream)
    stream->write(mConnectArgc);
    for(U32 i = 0; i < mConnectArgc; i++)
       stream->writeString(mConnectArgv[i]);
+
+   // Last, so servers from before it don't read that far.
+   writeGhostIdBitSizeRequest(stream);
 }
 
 bool GameConnection::readConnectRequest(BitStream *stream, const char **errorString)
@@ -278,6 +288,10 @@ bool GameConnection::readConnectRequest(BitStream *stream, const char **errorStr
       mConnectArgv[i] = dStrdup(argString);
       connectArgv[i + 3] = mConnectArgv[i];
    }
+
+   if(getProtocolVersion() >= GhostIdBitSizeVersion && !readGhostIdBitSizeRequest(stream, errorString))
+      return false;
+
    connectArgv[0] = "onConnectRequest";
    char buffer[256];
    Net::addressToString(getNetAddress(), buffer);
@@ -787,7 +801,7 @@ void GameConnection::readPacket(BitStream *bstream)
             if(mControlObject.isNull())
                callScript = true;
 
-            S32 gIndex = bstream->readInt(NetConnection::GhostIdBitSize);
+            S32 gIndex = readGhostIndex(bstream);
             ShapeBase* obj = static_cast<ShapeBase*>(resolveGhost(gIndex));
             if (mControlObject != obj)
                setControlObject(obj);
@@ -809,7 +823,7 @@ void GameConnection::readPacket(BitStream *bstream)
 
       if (bstream->readFlag())
       {
-            S32 gIndex = bstream->readInt(NetConnection::GhostIdBitSize);
+            S32 gIndex = readGhostIndex(bstream);
             ShapeBase* obj = static_cast<ShapeBase*>(resolveGhost(gIndex));
             setCameraObject(obj);
             obj->readPacketData(this, bstream);
@@ -962,7 +976,7 @@ void GameConnection::writePacket(BitStream *bstream, PacketNotify *note)
 #ifdef TORQUE_DEBUG_NET
             Con::printf("packetDataChecksum disagree!");
 #endif
-            bstream->writeInt(gIndex, NetConnection::GhostIdBitSize);
+            writeGhostIndex(bstream, gIndex);
             mControlObject->writePacketData(this, bstream);
          }
          else
@@ -984,7 +998,7 @@ void GameConnection::writePacket(BitStream *bstream, PacketNotify *note)
          gIndex = getGhostIndex(mCameraObject);
          if (bstream->writeFlag(gIndex != -1))
          {
-            bstream->writeInt(gIndex, NetConnection::GhostIdBitSize);
+            writeGhostIndex(bstream, gIndex);
             mCameraObject->writePacketData(this, bstream);
          }
       }
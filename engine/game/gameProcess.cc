@@ -9,6 +9,8 @@
 #include "game/shapeBase.h"
 #include "platform/profiler.h"
 #include "console/consoleTypes.h"
+#include "platform/threadPool.h"
+#include "math/mRandom.h"
 
 //----------------------------------------------------------------------------
 
@@ -16,10 +18,12 @@ ProcessList gClientProcessList(false);
 ProcessList gServerProcessList(true);
 
 bool ProcessList::mDebugControlSync = false;
+bool ProcessList::smParallelTick = false;
 
 ProcessList::ProcessList(bool isServer)
 {
    mDirty = false;
+   mParallelOrder = false;
    mCurrentTag = 0;
    mLastTick = 0;
    mLastTime = 0;
@@ -63,7 +67,27 @@ void ProcessList::orderList()
       else
          ptr->plLinkBefore(&head);
    }
+
+   // With the pref on, pull the objects that can tick on their own to the
+   // front, keeping their order, so advanceObjects() can do them in one
+   // run. Nothing has to tick before them, so no dependency is broken.
+   mParallelOrder = smParallelTick;
    mDirty = false;
+   if (!smParallelTick)
+      return;
+
+   GameBase* front = &head;
+   GameBase* next;
+   for (GameBase* ptr = head.mProcessLink.next; ptr != &head; ptr = next) {
+      next = ptr->mProcessLink.next;
+      if (!ptr->isProcessTickThreadSafe() || bool(ptr->mAfterObject))
+         continue;
+      if (ptr->mProcessLink.prev != front) {
+         ptr->plUnlink();
+         ptr->plLinkAfter(front);
+      }
+      front = ptr;
+   }
 }
 
 
@@ -203,16 +227,72 @@ bool ProcessList::advanceClientTime(SimTime timeDelta)
 
 //----------------------------------------------------------------------------
 
+/// Ticks part of the parallel run on the thread pool.
+class ProcessTickItem : public ThreadPool::WorkItem
+{
+   GameBase **mObjects;
+   U32 mCount;
+public:
+   ProcessTickItem(GameBase **objects, U32 count) : WorkItem(true), mObjects(objects), mCount(count) {}
+   void execute()
+   {
+      for (U32 i = 0; i < mCount; i++)
+         mObjects[i]->processTick(0);
+   }
+};
+
+bool ProcessList::isParallelTickObject(GameBase* obj)
+{
+   if (!obj->isProcessTickThreadSafe() || bool(obj->mAfterObject))
+      return false;
+
+   // Controlled objects take their moves on the main thread.
+   GameConnection* con = obj->getControllingClient();
+   return !con || con->getControlObject() != obj;
+}
+
 void ProcessList::advanceObjects()
 {
    PROFILE_START(AdvanceObjects);
 
+   if (mDirty || mParallelOrder != smParallelTick) orderList();
+
    // A little link list shuffling is done here to avoid problems
    // with objects being deleted from within the process method.
    GameBase list;
    GameBase* obj;
    list.plLinkBefore(head.mProcessLink.next);
    head.plUnlink();
+
+   // The objects at the front don't touch each other or anything else, so
+   // tick them first, all at once. With the pref off everything ticks in
+   // list order below, as it always did.
+   mParallelRun.clear();
+   while (smParallelTick && (obj = list.mProcessLink.next) != &list && isParallelTickObject(obj)) {
+      obj->plUnlink();
+      obj->plLinkBefore(&head);
+      if (obj->mProcessTick)
+         mParallelRun.push_back(obj);
+   }
+
+#ifdef TORQUE_MULTITHREAD
+   if (smParallelTick && mParallelRun.size() > ParallelTickBatchSize)
+   {
+      PROFILE_START(AdvanceObjectsParallel);
+      ThreadPool::WorkGroup group;
+      for (U32 i = 0; i < mParallelRun.size(); i += ParallelTickBatchSize)
+         ThreadPool::GLOBAL().queueWorkItem(new ProcessTickItem(mParallelRun.address() + i,
+            getMin(U32(ParallelTickBatchSize), mParallelRun.size() - i)), &group);
+      ThreadPool::GLOBAL().waitForGroup(&group);
+      PROFILE_END();
+   }
+   else
+#endif
+   {
+      for (U32 i = 0; i < mParallelRun.size(); i++)
+         mParallelRun[i]->processTick(0);
+   }
+
    while ((obj = list.mProcessLink.next) != &list) {
       obj->plUnlink();
       obj->plLinkBefore(&head);
@@ -243,3 +323,93 @@ void ProcessList::advanceObjects()
    }
    PROFILE_END();
 }
+
+//----------------------------------------------------------------------------
+
+/// A ball on a spring, for checking parallel ticks. The ones that aren't
+/// thread safe are pulled towards another ball as well, and process after
+/// it so the order they see it in doesn't depend on the pref.
+class TickTestObject : public GameBase
+{
+public:
+   bool mThreadSafe;
+   TickTestObject* mNeighbour;
+   Point3F mPos;
+   Point3F mVel;
+
+   void processTick(const Move*)
+   {
+      if (mNeighbour)
+         mVel += (mNeighbour->mPos - mPos) * 0.01f;
+
+      // Enough work per tick to be worth spreading out.
+      for (U32 i = 0; i < 32; i++) {
+         mVel -= mPos * (0.1f * TickSec / 32);
+         mVel *= 0.999f;
+         mPos += mVel * (TickSec / 32);
+      }
+   }
+
+   bool isProcessTickThreadSafe() const { return mThreadSafe; }
+};
+
+ConsoleFunction(checkParallelTick, void, 1, 3, "([objects = 10000[, ticks = 100]]) "
+                "Tick a process list of test objects serially and in parallel, time both and "
+                "check the results are identical.")
+{
+   U32 objectCount = argc > 1 ? getMax(dAtoi(argv[1]), 2) : 10000;
+   U32 tickCount   = argc > 2 ? getMax(dAtoi(argv[2]), 1) : 100;
+
+   ProcessList list(true);
+   Vector<TickTestObject*> objects;
+   for (U32 i = 0; i < objectCount; i++) {
+      TickTestObject* obj = new TickTestObject;
+      obj->mThreadSafe = (i % 4) != 0;
+      obj->mNeighbour = NULL;
+      objects.push_back(obj);
+      list.addObject(obj);
+   }
+   for (U32 i = 0; i < objectCount; i += 4) {
+      objects[i]->mNeighbour = objects[(i + objectCount / 2 + 1) % objectCount];
+      objects[i]->processAfter(objects[i]->mNeighbour);
+   }
+   list.markDirty();
+
+   bool saved = ProcessList::smParallelTick;
+   Vector<Point3F> results[2];
+   U32 times[2];
+   for (U32 pass = 0; pass < 2; pass++) {
+      MRandomLCG rand(1);
+      for (U32 i = 0; i < objectCount; i++) {
+         objects[i]->mPos.set(rand.randF(-10, 10), rand.randF(-10, 10), rand.randF(-10, 10));
+         objects[i]->mVel.set(0, 0, 0);
+      }
+
+      ProcessList::smParallelTick = pass == 1;
+      U32 start = Platform::getRealMilliseconds();
+      for (U32 i = 0; i < tickCount; i++)
+         list.advanceObjects();
+      times[pass] = Platform::getRealMilliseconds() - start;
+
+      for (U32 i = 0; i < objectCount; i++) {
+         results[pass].push_back(objects[i]->mPos);
+         results[pass].push_back(objects[i]->mVel);
+      }
+   }
+   ProcessList::smParallelTick = saved;
+
+   U32 mismatches = 0;
+   for (U32 i = 0; i < objectCount; i++)
+      if (dMemcmp(&results[0][i * 2], &results[1][i * 2], sizeof(Point3F) * 2))
+         mismatches++;
+
+   Con::printf("Parallel tick: %d objects, %d ticks", objectCount, tickCount);
+   Con::printf("   serial %d ms, parallel %d ms (%d worker threads)", times[0], times[1],
+      ThreadPool::GLOBAL().getNumThreads());
+   Con::printf("   %d objects ended up different", mismatches);
+
+   for (U32 i = 0; i < objectCount; i++)
+      objects[i]->clearProcessAfter();
+   for (U32 i = 0; i < objectCount; i++)
+      delete objects[i];
+}
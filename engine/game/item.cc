@@ -31,6 +31,10 @@ const S32 sCollisionTimeout = 15;      // Timout value in ticks
 static F32 sMinWarpTicks = 0.5;        // Fraction of tick at which instant warp occures
 static S32 sMaxWarpTicks = 3;          // Max warp duration in ticks
 
+// Positions go as deltas from what the client last acked, in 1/512ths
+static const U32 PositionField = 0;
+static const F32 PositionPrecision = 1.0f / 512;
+
 F32 Item::mGravity = -20;
 
 const U32 sClientCollisionMask = (TerrainObjectType     | InteriorObjectType |
@@ -862,7 +866,7 @@ U32 Item::packUpdate(NetConnection *connection, U32 mask, BitStream *stream)
    {
       S32 gIndex = connection->getGhostIndex(mCollisionObject);
       if (stream->writeFlag(gIndex != -1))
-         stream->writeInt(gIndex,NetConnection::GhostIdBitSize);
+         connection->writeGhostIndex(stream, gIndex);
    }
    else
       stream->writeFlag(false);
@@ -879,7 +883,7 @@ U32 Item::packUpdate(NetConnection *connection, U32 mask, BitStream *stream)
    {
       Point3F pos;
       mObjToWorld.getColumn(3,&pos);
-      mathWrite(*stream, pos);
+      connection->writeDeltaPoint(stream, PositionField, pos, PositionPrecision);
       if (!stream->writeFlag(mAtRest))
          mathWrite(*stream, mVelocity);
 
@@ -906,7 +910,7 @@ void Item::unpackUpdate(NetConnection *connection, BitStream *stream)
 
    if (stream->readFlag())
    {
-      S32 gIndex = stream->readInt(NetConnection::GhostIdBitSize);
+      S32 gIndex = connection->readGhostIndex(stream);
       setCollisionTimeout(static_cast<ShapeBase*>(connection->resolveGhost(gIndex)));
    }
 
@@ -927,7 +931,7 @@ void Item::unpackUpdate(NetConnection *connection, BitStream *stream)
    if (stream->readFlag())
    {
       Point3F pos;
-      mathRead(*stream, &pos);
+      connection->readDeltaPoint(stream, PositionField, &pos, PositionPrecision);
       F32 speed = mVelocity.len();
       if ((mAtRest = stream->readFlag()) == true)
          mVelocity.set(0,0,0);
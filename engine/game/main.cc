@@ -9,6 +9,8 @@
 #include "platform/platformAudio.h"
 #include "platform/event.h"
 #include "platform/gameInterface.h"
+#include "platform/threadPool.h"
+#include "platform/metrics.h"
 #include "core/tVector.h"
 #include "core/chunkFile.h"
 #include "math/mMath.h"
@@ -62,6 +64,7 @@
 #include "game/badWordFilter.h"
 #include "core/zipSubStream.h"
 #include "game/net/TCPQuery.h"
+#include "sim/netConnection.h"
 #include "game/net/ThreadedDownloading.h"
 
 #ifndef BUILD_TOOLS
@@ -175,6 +178,7 @@ static void shutdownLibraries()
 
    TextureManager::preDestroy();
 
+   ThreadPool::shutdownGlobal();
    Platform::shutdown();
    TelnetDebugger::destroy();
    TelnetConsole::destroy();
@@ -212,6 +216,7 @@ static F32 gTimeScale = 1.0;
 static U32 gTimeAdvance = 0;
 static U32 gFrameSkip = 0;
 static U32 gFrameCount = 0;
+static S32 gIdleMaxFPS = 8;   ///< Main loop rate with nothing going on; 0 never waits. 8 keeps up with the audio update.
 
 // Executes an entry script; can be controlled by command-line options.
 bool runEntryScript (int argc, const char **argv)
@@ -276,6 +281,7 @@ bool initGame(int argc, const char **argv)
    Con::addVariable("timeScale", TypeF32, &gTimeScale);
    Con::addVariable("timeAdvance", TypeS32, &gTimeAdvance);
    Con::addVariable("frameSkip", TypeS32, &gFrameSkip);
+   Con::addVariable("pref::idleMaxFPS", TypeS32, &gIdleMaxFPS);
 
    // Stuff game types into the console
    Con::setIntVariable("$TypeMasks::StaticObjectType",				StaticObjectType);
@@ -407,6 +413,33 @@ void shutdownGame()
 extern bool gDGLRender;
 bool gShuttingDown   = false;
 
+/// How long the main loop can wait for something to happen before going
+/// round again, or 0 if it has work to do.
+///
+/// The loop is idle when nothing is connected and the canvas had nothing
+/// to draw last time round. It then sleeps until input, a packet or
+/// another thread wakes it, or the next scheduled sim event is due, but
+/// never longer than an idle frame.
+static U32 getIdleWait()
+{
+   if(gIdleMaxFPS <= 0 || gTimeAdvance || gTimeScale <= 0 || Game->isJournalReading())
+      return 0;
+
+   // Anything connected needs ticking at full rate.
+   if(NetConnection::getConnectionList())
+      return 0;
+
+   // Something changed on screen, so more is probably on the way.
+   if(Canvas && gDGLRender && Canvas->wasFrameRendered())
+      return 0;
+
+   U32 wait = 1000 / gIdleMaxFPS;
+   U32 nextEvent = Sim::getTimeToNextEvent();
+   if(nextEvent != U32_MAX)
+      wait = getMin(wait, U32(nextEvent / gTimeScale));
+   return wait;
+}
+
 /// Main loop of the game
 int DemoGame::main(int argc, const char **argv)
 {
@@ -482,6 +515,7 @@ int DemoGame::main(int argc, const char **argv)
             PROFILE_START(PlatformProcessMain);
       Platform::process(); // keys, etc.
             PROFILE_END();
+      Con::dispatchQueuedLog(); // output printed by other threads
 			// Don't need telnet console
             //PROFILE_START(TelconsoleProcessMain);
       //TelConsole->process();
@@ -496,6 +530,13 @@ int DemoGame::main(int argc, const char **argv)
             PROFILE_START(GameProcessEvents);
       Game->processEvents(); // process all non-sim posted events.
             PROFILE_END();
+      U32 idleWait = getIdleWait();
+      if(idleWait)
+      {
+            PROFILE_START(IdleWait);
+         Platform::waitForEvents(idleWait);
+            PROFILE_END();
+      }
             PROFILE_END();
    }
    shutdownGame();
@@ -655,6 +696,9 @@ void DemoGame::processConsoleEvent(ConsoleEvent *event)
 void DemoGame::processTimeEvent(TimeEvent *event)
 {
    PROFILE_START(ProcessTimeEvent);
+   // Each pass of the main loop is a frame for the metrics.
+   Metric::endFrame();
+
    U32 elapsedTime = event->elapsedTime;
    // cap the elapsed time to one second
    // if it's more than that we're probably in a bad catch-up situation
@@ -669,6 +713,8 @@ void DemoGame::processTimeEvent(TimeEvent *event)
 
    Platform::advanceTime(elapsedTime);
    bool tickPass;
+   U64 serverStart = Platform::getRealMicroseconds();
+   NetConnection::processTrafficReplay();
    PROFILE_START(ServerProcess);
    tickPass = serverProcess(timeDelta);
    PROFILE_END();
@@ -677,6 +723,7 @@ void DemoGame::processTimeEvent(TimeEvent *event)
    if(tickPass)
       GNet->processServer();
    PROFILE_END();
+   NetConnection::endTrafficReplayFrame(tickPass, U32(Platform::getRealMicroseconds() - serverStart));
 
    PROFILE_START(SimAdvanceTime);
    Sim::advanceTime(timeDelta);
@@ -6,6 +6,7 @@
 #include "console/String.h"
 #include "math/mMath.h"
 #include "dgl/dgl.h"
+#include "platform/metrics.h"
 #include <Windows.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
@@ -784,6 +785,8 @@ DWORD WINAPI TRANSFER_RATE_CALCULATION(LPVOID uData)
 	return 0;
 }
 
+static Metric sDownloadBytes("download.bytesIn", Metric::Counter);
+
 DWORD WINAPI DOWNLOAD_THREAD(LPVOID uData)
 {
 	HANDLE TRC   = NULL;
@@ -872,6 +875,7 @@ DWORD WINAPI DOWNLOAD_THREAD(LPVOID uData)
 		}
 
 		CurrentTransferRate = len;
+		sDownloadBytes.add(len);
 
 		buf[len]   = 0;
 		S32 size   = len;
@@ -1367,6 +1371,13 @@ void ThreadedDownloading::Init()
 	dglDrawText(pProfile->mFont, Point2I(current_x, yOffset), current);\
 	yOffset += pProfile->mFont->getHeight();
 
+bool ThreadedDownloading::IsDrawingDebug()
+{
+	return DThread_DrawDebug;
+}
+
+//---------------------------------------------------------------
+
 void ThreadedDownloading::DrawDebug()
 {
 	if (!DThread_DrawDebug)
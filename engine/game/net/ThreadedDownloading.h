@@ -19,6 +19,9 @@ namespace ThreadedDownloading
 	// Draw debug stuff on-screen.
 	void DrawDebug();
 
+	// Is the debug overlay on? It changes every frame, so the canvas has to keep presenting.
+	bool IsDrawingDebug();
+
 	// Download from a URL. Returns the download ID.
 	DownloadID Download(const char* url, const char* savePath);
 
@@ -3497,7 +3497,7 @@ void Player::writePacketData(GameConnection *connection, BitStream *stream)
    if (mControlObject) {
       S32 gIndex = connection->getGhostIndex(mControlObject);
       if (stream->writeFlag(gIndex != -1)) {
-         stream->writeInt(gIndex,NetConnection::GhostIdBitSize);
+         connection->writeGhostIndex(stream, gIndex);
          mControlObject->writePacketData(connection, stream);
       }
    }
@@ -3542,7 +3542,7 @@ void Player::readPacketData(GameConnection *connection, BitStream *stream)
    delta.rot = rot;
 
    if (stream->readFlag()) {
-      S32 gIndex = stream->readInt(NetConnection::GhostIdBitSize);
+      S32 gIndex = connection->readGhostIndex(stream);
       ShapeBase* obj = static_cast<ShapeBase*>(connection->resolveGhost(gIndex));
       setControlObject(obj);
       obj->readPacketData(connection, stream);
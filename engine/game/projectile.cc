@@ -1000,7 +1000,7 @@ U32 Projectile::packUpdate(NetConnection* con, U32 mask, BitStream* stream)
          S32 ghostIndex = con->getGhostIndex(mSourceObject);
          if (stream->writeFlag(ghostIndex != -1))
          {
-            stream->writeRangedU32(U32(ghostIndex), 0, NetConnection::MaxGhostCount);
+            con->writeGhostIndex(stream, ghostIndex, true);
             stream->writeRangedU32(U32(mSourceObjectSlot),
                                    0, ShapeBase::MaxMountedImages - 1);
          }
@@ -1055,7 +1055,7 @@ void Projectile::unpackUpdate(NetConnection* con, BitStream* stream)
       mCurrTick = stream->readRangedU32(0, MaxLivingTicks);
       if (stream->readFlag())
       {
-         mSourceObjectId   = stream->readRangedU32(0, NetConnection::MaxGhostCount);
+         mSourceObjectId   = con->readGhostIndex(stream, true);
          mSourceObjectSlot = stream->readRangedU32(0, ShapeBase::MaxMountedImages - 1);
 
          NetObject* pObject = con->resolveGhost(mSourceObjectId);
@@ -2989,7 +2989,7 @@ U32 ShapeBase::packUpdate(NetConnection *con, U32 mask, BitStream *stream)
          S32 gIndex = con->getGhostIndex(mMount.object);
          if (stream->writeFlag(gIndex != -1)) {
             stream->writeFlag(true);
-            stream->writeInt(gIndex,NetConnection::GhostIdBitSize);
+            con->writeGhostIndex(stream, gIndex);
             stream->writeInt(mMount.node,ShapeBaseData::NumMountPointBits);
          }
          else
@@ -3208,7 +3208,7 @@ void ShapeBase::unpackUpdate(NetConnection *con, BitStream *stream)
 
    if (stream->readFlag()) {
       if (stream->readFlag()) {
-         S32 gIndex = stream->readInt(NetConnection::GhostIdBitSize);
+         S32 gIndex = con->readGhostIndex(stream);
          ShapeBase* obj = dynamic_cast<ShapeBase*>(con->resolveGhost(gIndex));
          S32 node = stream->readInt(ShapeBaseData::NumMountPointBits);
          if(!obj)
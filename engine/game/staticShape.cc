@@ -228,7 +228,7 @@ U32 StaticShape::packUpdate(NetConnection *connection, U32 mask, BitStream *bstr
 		   bstream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 		   for(U32 i=0; i<maxcount; i++)
 		   {
-			   bstream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+			   connection->writeGhostIndex(bstream, lightIds[i]);
 		   }
 	   }
 	   else
@@ -238,7 +238,7 @@ U32 StaticShape::packUpdate(NetConnection *connection, U32 mask, BitStream *bstr
 		   bstream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 		   for(U32 i=0; i<maxcount; i++)
 		   {
-			   bstream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+			   connection->writeGhostIndex(bstream, lightIds[i]);
 		   }
 	   }
    }
@@ -277,7 +277,7 @@ void StaticShape::unpackUpdate(NetConnection *connection, BitStream *bstream)
 	   lightIds.clear();
 	   for(U32 i=0; i<count; i++)
 	   {
-		   S32 id = bstream->readInt(NetConnection::GhostIdBitSize);
+		   S32 id = connection->readGhostIndex(bstream);
 		   lightIds.push_back(id);
 	   }
    }
@@ -89,6 +89,7 @@ class Trigger : public GameBase
    void unpackUpdate(NetConnection *conn,           BitStream* stream);
 
    bool castRay(const Point3F &start, const Point3F &end, RayInfo* info);
+   bool isCastRayThreadSafe() const { return true; }
 };
 
 inline U32 Trigger::getNumTriggeringObjects() const
@@ -429,7 +429,7 @@ U32 TSStatic::packUpdate(NetConnection *con, U32 mask, BitStream *stream)
 			stream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 			for (U32 i = 0; i < maxcount; i++)
 			{
-				stream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+				con->writeGhostIndex(stream, lightIds[i]);
 			}
 		}
 		else
@@ -439,7 +439,7 @@ U32 TSStatic::packUpdate(NetConnection *con, U32 mask, BitStream *stream)
 			stream->writeInt(maxcount, SG_TSSTATIC_MAX_LIGHT_SHIFT);
 			for (U32 i = 0; i < maxcount; i++)
 			{
-				stream->writeInt(lightIds[i], NetConnection::GhostIdBitSize);
+				con->writeGhostIndex(stream, lightIds[i]);
 			}
 		}
 	}
@@ -528,7 +528,7 @@ void TSStatic::unpackUpdate(NetConnection *con, BitStream *stream)
 		lightIds.clear();
 		for (U32 i = 0; i < count; i++)
 		{
-			S32 id = stream->readInt(NetConnection::GhostIdBitSize);
+			S32 id = con->readGhostIndex(stream);
 			lightIds.push_back(id);
 		}
 	}
@@ -83,6 +83,8 @@ void GuiConsole::onPreRender()
       //if the console was not scrolled, make the last entry visible
       if (scrolled)
          scrollCellVisible(Point2I(0,mSize.y - 1));
+
+      setUpdate();
    }
 }
 
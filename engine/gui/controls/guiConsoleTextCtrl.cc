@@ -92,6 +92,7 @@ void GuiConsoleTextCtrl::onPreRender()
    if (mConsoleExpression)
       mResult = Con::evaluatef("$temp = %s;", mConsoleExpression);
    calcResize();
+   setUpdate();
 }
 
 
@@ -64,7 +64,7 @@ ConsoleMethod(GuiMLTextCtrl,forceReflow,void,2,2,"forces the text control to ref
    if(!object->isAwake())
       Con::errorf("GuiMLTextCtrl::forceReflow can only be called on visible controls.");
    else
-      object->reflow();
+      object->reflowAppended();
 }
 
 //--------------------------------------------------------------------------
@@ -90,9 +90,18 @@ GuiMLTextCtrl::GuiMLTextCtrl()
    mLineList = 0;
    mTagList = 0;
    mHitURL = 0;
+   mURLList = 0;
    mActive = true;
    mAlpha = 1.0;
 
+   VECTOR_SET_ASSOCIATION(mParagraphs);
+   mResumeValid = false;
+   mAppended = false;
+   mLayoutWidth = 0;
+   mLayoutLength = 0;
+   mDroppedChars = 0;
+   mMaxLines = 0;
+
    Sim::findObject("InputDeniedSound", mDeniedSound);
 }
 
@@ -116,6 +125,7 @@ void GuiMLTextCtrl::initPersistFields()
    addField("maxChars",          TypeS32,    Offset(mMaxBufferSize,     GuiMLTextCtrl));
    addField("deniedSound",       TypeAudioProfilePtr, Offset(mDeniedSound, GuiMLTextCtrl));
    addField("text",              TypeCaseString,  Offset( mInitialText, GuiMLTextCtrl ) );
+   addField("maxLines",          TypeS32,    Offset(mMaxLines,          GuiMLTextCtrl));
 }
 
 ConsoleMethod(GuiMLTextCtrl, setAlpha, void, 3, 3, "")
@@ -150,7 +160,15 @@ bool GuiMLTextCtrl::onWake()
 void GuiMLTextCtrl::onPreRender()
 {
    if(mDirty)
+   {
       reflow();
+      setUpdate();
+   }
+   else if(mAppended)
+   {
+      reflowAppended();
+      setUpdate();
+   }
 }
 
 //--------------------------------------------------------------------------
@@ -199,7 +217,7 @@ void GuiMLTextCtrl::drawAtomText(bool sel, U32 start, U32 end, Atom *atom, Line
       if (atom->isClipped)
       {
          Point2I p2 = drawPoint;
-         p2.x += font->getStrNWidthPrecise(tmp, tmpLen);
+         p2.x += (start == atom->textStart && end == atom->textStart + atom->len) ? atom->textWidth : font->getStrNWidthPrecise(tmp, tmpLen);
          dglDrawTextN(font, p2, "...", 3, mAllowColorChars ? mProfile->mFontColors : NULL);
       }
    }
@@ -219,7 +237,7 @@ void GuiMLTextCtrl::drawAtomText(bool sel, U32 start, U32 end, Atom *atom, Line
       if (atom->isClipped)
       {
          Point2I p2 = drawPoint;
-         p2.x += font->getStrNWidthPrecise(tmp, end - atom->textStart);
+         p2.x += (start == atom->textStart && end == atom->textStart + atom->len) ? atom->textWidth : font->getStrNWidthPrecise(tmp, end - atom->textStart);
          dglDrawTextN(font, p2, "...", 3, mAllowColorChars ? mProfile->mFontColors : NULL);
       }
    }
@@ -228,7 +246,7 @@ void GuiMLTextCtrl::drawAtomText(bool sel, U32 start, U32 end, Atom *atom, Line
    {
       drawPoint.y += atom->baseLine + 2;
       Point2I p2 = drawPoint;
-      p2.x += font->getStrNWidthPrecise(tmp, end - atom->textStart);
+      p2.x += (start == atom->textStart && end == atom->textStart + atom->len) ? atom->textWidth : font->getStrNWidthPrecise(tmp, end - atom->textStart);
       dglDrawLine(drawPoint, p2, color);
    }
 }
@@ -249,11 +267,33 @@ void GuiMLTextCtrl::onRender(Point2I offset, const RectI& updateRect)
       //dglDrawRectFill(screenBounds, mProfile->mFillColor);
    }
 
+   // Start from the last paragraph above the update rect rather than the
+   // top of a possibly long buffer.
+   Line *firstLine = mLineList;
+   S32 top = updateRect.point.y - offset.y;
+   S32 lo = 0, hi = S32(mParagraphs.size()) - 1;
+   while(lo <= hi)
+   {
+      S32 mid = (lo + hi) >> 1;
+      if(S32(mParagraphs[mid].y) <= top)
+      {
+         if(*mParagraphs[mid].lineInsert)
+            firstLine = *mParagraphs[mid].lineInsert;
+         lo = mid + 1;
+      }
+      else
+         hi = mid - 1;
+   }
+
    // draw all the text and dividerStyles
-   for(Line *lwalk = mLineList; lwalk; lwalk = lwalk->next)
+   for(Line *lwalk = firstLine; lwalk; lwalk = lwalk->next)
    {
       RectI lineRect(offset.x, offset.y + lwalk->y, mBounds.extent.x, lwalk->height);
 
+      // lines only go down from here
+      if(lineRect.point.y >= updateRect.point.y + updateRect.extent.y)
+         break;
+
       if(!lineRect.overlaps(updateRect))
          continue;
 
@@ -292,6 +332,9 @@ void GuiMLTextCtrl::freeLineBuffers()
    mBitmapRefList = NULL;
    mTagList = NULL;
    mHitURL = 0;
+   mURLList = 0;
+   mParagraphs.clear();
+   mResumeValid = false;
    mDirty = true;
 }
 
@@ -425,7 +468,7 @@ void GuiMLTextCtrl::addText(const char* textBuffer, const U32 numChars, bool ref
    {
       setCursorPosition(0);
       clearSelection();
-      mDirty = true;
+      mAppended = true;
       scrollToTop();
    }
 }
@@ -818,6 +861,8 @@ GuiMLTextCtrl::Atom *GuiMLTextCtrl::findHitAtom(const Point2I localCoords)
    AssertFatal(mAwake, "Can't get the text position of a sleeping control.");
    if(mDirty)
       reflow();
+   else if(mAppended)
+      reflowAppended();
    for(Line *walk = mLineList; walk; walk = walk->next)
    {
       if(localCoords.y < walk->y)
@@ -844,6 +889,8 @@ S32 GuiMLTextCtrl::getTextPosition(const Point2I& localCoords)
    AssertFatal(mAwake, "Can't get the text position of a sleeping control.");
    if(mDirty)
       reflow();
+   else if(mAppended)
+      reflowAppended();
    U32 last = 0;
 
    for(Line *walk = mLineList; walk; walk = walk->next)
@@ -1316,6 +1363,13 @@ GuiMLTextCtrl::Atom *GuiMLTextCtrl::splitAtomListEmit(Atom *list, U32 width)
    }
    while(emitList)
    {
+      // Remember how wide the text itself is; clipped atoms are as wide as
+      // the space they were given.
+      if(emitList->isClipped)
+         emitList->textWidth = emitList->style->font->fontRes->getStrNWidthPrecise(mTextBuffer.getPtr() + emitList->textStart, emitList->len);
+      else
+         emitList->textWidth = emitList->width;
+
       emitList->xStart = mCurX;
       mCurX += emitList->width;
       Atom *temp = emitList->next;
@@ -1377,6 +1431,8 @@ void GuiMLTextCtrl::reflow()
    AssertFatal(mAwake, "Can't reflow a sleeping control.");
    freeLineBuffers();
    mDirty = false;
+   mAppended = false;
+   mDroppedChars = 0;
    mScanPos = 0;
 
    mLineList = NULL;
@@ -1393,6 +1449,7 @@ void GuiMLTextCtrl::reflow()
    mCurStyle->linkColorHL = mProfile->mFontColors[GuiControlProfile::ColorUser1];
 
    U32 width = mBounds.extent.x;
+   mLayoutWidth = width;
 
    mCurLMargin = 0;
    mCurRMargin = width;
@@ -1416,12 +1473,209 @@ void GuiMLTextCtrl::reflow()
 
    mBlockList = &mSentinel;
 
-   Font *nextFont;
-   LineTag *nextTag;
    mTabStops = 0;
    mCurTabStop = 0;
    mTabStopCount = 0;
    mCurURL = 0;
+
+   layoutText();
+}
+
+//--------------------------------------------------------------------------
+void GuiMLTextCtrl::reflowAppended()
+{
+   AssertFatal(mAwake, "Can't reflow a sleeping control.");
+
+   // Only text added on the end can pick up where we left off.
+   if(mDirty || !mResumeValid || mBounds.extent.x != mLayoutWidth || mTextBuffer.length() < mLayoutLength)
+   {
+      reflow();
+      return;
+   }
+   mAppended = false;
+
+   // Drop everything laid out after the last paragraph break...
+   for(URL *walk = mURLList; walk != mResume.urlList; walk = walk->next)
+      if(walk == mHitURL)
+         mHitURL = 0;
+
+   *mResume.lineInsert = NULL;
+   mLineInsert     = mResume.lineInsert;
+   mBitmapRefList  = mResume.bitmapRefList;
+   mTagList        = mResume.tagList;
+   mURLList        = mResume.urlList;
+
+   // ...and carry on from there.
+   mScanPos        = mResume.scanPos;
+   mLineStart      = mResume.lineStart;
+   mCurX           = mResume.curX;
+   mCurY           = mResume.curY;
+   mMaxY           = mResume.maxY;
+   mCurLMargin     = mResume.lMargin;
+   mCurRMargin     = mResume.rMargin;
+   mCurJustify     = mResume.justify;
+   mCurDiv         = mResume.div;
+   mCurClipX       = mResume.clipX;
+   mTabStops       = mResume.tabStops;
+   mTabStopCount   = mResume.tabStopCount;
+   mCurTabStop     = 0;
+   mCurStyle       = mResume.style;
+   mCurURL         = mResume.url;
+
+   mLineAtoms = NULL;
+   mLineAtomPtr = &mLineAtoms;
+   mEmitAtoms = 0;
+   mEmitAtomPtr = &mEmitAtoms;
+   mBlockList = &mSentinel;
+
+   layoutText();
+}
+
+//--------------------------------------------------------------------------
+void GuiMLTextCtrl::markParagraph()
+{
+   // A bitmap hanging over the break would have to be carried across.
+   if(mBlockList != &mSentinel)
+      return;
+
+   mParagraphs.increment();
+   Paragraph &para = mParagraphs.last();
+   para.textStart  = mScanPos;
+   para.y          = mCurY;
+   para.lineInsert = mLineInsert;
+
+   // Styles are changed in place until something uses them, so pin the
+   // ones we'd come back to.
+   for(Style *walk = mCurStyle; walk; walk = walk->next)
+      walk->used = true;
+
+   mResume.scanPos       = mScanPos;
+   mResume.lineStart     = mLineStart;
+   mResume.curX          = mCurX;
+   mResume.curY          = mCurY;
+   mResume.maxY          = mMaxY;
+   mResume.lMargin       = mCurLMargin;
+   mResume.rMargin       = mCurRMargin;
+   mResume.justify       = mCurJustify;
+   mResume.div           = mCurDiv;
+   mResume.clipX         = mCurClipX;
+   mResume.tabStops      = mTabStops;
+   mResume.tabStopCount  = mTabStopCount;
+   mResume.style         = mCurStyle;
+   mResume.url           = mCurURL;
+   mResume.lineInsert    = mLineInsert;
+   mResume.bitmapRefList = mBitmapRefList;
+   mResume.tagList       = mTagList;
+   mResume.urlList       = mURLList;
+   mResumeValid = true;
+}
+
+//--------------------------------------------------------------------------
+static inline void shiftTextRange(U32 &start, U32 &len, U32 cut)
+{
+   U32 end = start + len;
+   start = start > cut ? start - cut : 0;
+   len = (end > cut ? end - cut : 0) - start;
+}
+
+void GuiMLTextCtrl::trimHistory()
+{
+   if(mMaxLines <= 0 || mIsEditCtrl || mParagraphs.size() <= mMaxLines)
+      return;
+
+   // Cut at the break that leaves mMaxLines paragraphs.
+   U32 drop = mParagraphs.size() - mMaxLines;
+   const Paragraph &cutPara = mParagraphs[drop - 1];
+   U32 cut = cutPara.textStart;
+   U32 dy  = cutPara.y;
+   mLineList = *cutPara.lineInsert;
+
+   // Everything left just moves up and back; nothing is measured again.
+   for(Line *walk = mLineList; walk; walk = walk->next)
+   {
+      walk->y -= dy;
+      shiftTextRange(walk->textStart, walk->len, cut);
+      for(Atom *awalk = walk->atomList; awalk; awalk = awalk->next)
+      {
+         awalk->yStart -= dy;
+         shiftTextRange(awalk->textStart, awalk->len, cut);
+      }
+   }
+
+   for(BitmapRef **walk = &mBitmapRefList; *walk; )
+   {
+      BitmapRef *ref = *walk;
+      if(ref->textStart < cut)
+      {
+         *walk = ref->next;
+         continue;
+      }
+      ref->point.y -= dy;
+      ref->textStart -= cut;
+      walk = &ref->next;
+   }
+
+   for(LineTag **walk = &mTagList; *walk; )
+   {
+      LineTag *tag = *walk;
+      if(tag->y < S32(dy))
+      {
+         *walk = tag->next;
+         continue;
+      }
+      tag->y -= dy;
+      walk = &tag->next;
+   }
+
+   // A link left open across the cut keeps working, minus its target.
+   for(URL *walk = mURLList; walk; walk = walk->next)
+      shiftTextRange(walk->textStart, walk->len, cut);
+
+   for(U32 i = drop; i < mParagraphs.size(); i++)
+   {
+      Paragraph &para = mParagraphs[i - drop];
+      para = mParagraphs[i];
+      para.textStart -= cut;
+      para.y -= dy;
+   }
+   mParagraphs.setSize(mParagraphs.size() - drop);
+
+   mResume.scanPos -= cut;
+   mResume.lineStart = mResume.lineStart > cut ? mResume.lineStart - cut : 0;
+   mResume.curY -= dy;
+   mResume.maxY -= dy;
+   mCurY -= dy;
+   mMaxY -= dy;
+
+   mCursorPosition = mCursorPosition > cut ? mCursorPosition - cut : 0;
+   if(mSelectionActive)
+   {
+      if(mSelectionStart < cut)
+         clearSelection();
+      else
+      {
+         mSelectionStart -= cut;
+         mSelectionEnd -= cut;
+      }
+   }
+
+   mTextBuffer.cut(0, cut);
+   mLayoutLength -= cut;
+
+   // What was cut is still sitting in the chunker; once it outweighs what
+   // is left, lay it all out again to get the memory back.
+   mDroppedChars += cut;
+   if(mDroppedChars > mTextBuffer.length())
+      mDirty = true;
+}
+
+//--------------------------------------------------------------------------
+void GuiMLTextCtrl::layoutText()
+{
+   U32 width = mLayoutWidth;
+
+   Font *nextFont;
+   LineTag *nextTag;
    Style *newStyle;
 
    U32 textStart;
@@ -1444,6 +1698,7 @@ void GuiMLTextCtrl::reflow()
          processEmitAtoms();
          emitNewLine(textStart);
          mCurDiv = 0;
+         markParagraph();
          continue;
       }
 
@@ -1484,6 +1739,7 @@ void GuiMLTextCtrl::reflow()
             processEmitAtoms();
             emitNewLine(textStart);
             mCurDiv = 0;
+            markParagraph();
             continue;
          }
 
@@ -1734,6 +1990,8 @@ void GuiMLTextCtrl::reflow()
             mCurURL->textStart = mScanPos + 3;
             mCurURL->len = idx - 3;
             mCurURL->noUnderline = false;
+            mCurURL->next = mURLList;
+            mURLList = mCurURL;
 
             //if the URL is a "gamelink", don't underline...
             if (!dStrnicmp(str + 3, "gamelink", 8))
@@ -1887,6 +2145,9 @@ textemit:
    }
    processEmitAtoms();
    emitNewLine(mScanPos);
+   mLayoutLength = mTextBuffer.length();
+   trimHistory();
+
    resize(mBounds.point, Point2I(mBounds.extent.x, mMaxY));
    Con::executef( this, 3, "onResize", Con::getIntArg( mBounds.extent.x ), Con::getIntArg( mMaxY ) );
 
@@ -50,6 +50,7 @@ class GuiMLTextCtrl : public GuiControl
       U32 textStart;
       U32 len;
       bool noUnderline;
+      URL *next;
    };
 
    struct Style
@@ -71,6 +72,7 @@ class GuiMLTextCtrl : public GuiControl
       U32 xStart;
       U32 yStart;
       U32 width;
+      U32 textWidth;   ///< Measured width of the text itself, for underlines and "...".
       U32 baseLine;
       U32 descent;
       Style *style;
@@ -133,6 +135,11 @@ class GuiMLTextCtrl : public GuiControl
 
    virtual void reflow();
 
+   /// Lay out text added since the last reflow, picking up from the last
+   /// paragraph break instead of starting over. Falls back to reflow() if
+   /// anything else changed.
+   void reflowAppended();
+
    DECLARE_CONOBJECT(GuiMLTextCtrl);
    static void initPersistFields();
 
@@ -182,6 +189,60 @@ class GuiMLTextCtrl : public GuiControl
    URL *mCurURL;
 
    URL *mHitURL;
+   URL *mURLList;
+
+   /// @name Incremental Layout
+   ///
+   /// Each hard line break ('\n' or <br>) with no bitmap floating
+   /// across it is remembered as a paragraph, along with the layout state
+   /// at that point. Appended text is laid out from the last paragraph
+   /// rather than from the top, old paragraphs can be dropped off the
+   /// front for maxLines without laying anything out again, and rendering
+   /// uses them to skip straight to the first visible line.
+   /// @{
+
+   struct Paragraph
+   {
+      U32 textStart;       ///< First character after the break.
+      U32 y;               ///< Top of the first line after the break.
+      Line **lineInsert;   ///< Where the first line after the break hangs.
+   };
+
+   struct LayoutState
+   {
+      U32 scanPos;
+      U32 lineStart;
+      U32 curX;
+      U32 curY;
+      U32 maxY;
+      U32 lMargin;
+      U32 rMargin;
+      U32 justify;
+      U32 div;
+      U32 clipX;
+      U32 *tabStops;
+      U32 tabStopCount;
+      Style *style;
+      URL *url;
+      Line **lineInsert;
+      BitmapRef *bitmapRefList;
+      LineTag *tagList;
+      URL *urlList;
+   };
+
+   Vector<Paragraph> mParagraphs;
+   LayoutState mResume;
+   bool mResumeValid;
+   bool mAppended;         ///< Text was added that still needs laying out.
+   U32  mLayoutWidth;      ///< Width the current layout was done at.
+   U32  mLayoutLength;     ///< Characters covered by the current layout.
+   U32  mDroppedChars;     ///< Characters trimmed since the last full reflow.
+   S32  mMaxLines;         ///< Paragraphs to keep, or 0 to keep everything.
+
+   void markParagraph();
+   void layoutText();
+   void trimHistory();
+   /// @}
 
    void freeLineBuffers();
    void freeResources();
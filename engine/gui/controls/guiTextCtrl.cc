@@ -190,6 +190,10 @@ void GuiTextCtrl::onPreRender()
    const char * var = getVariable();
    if(var && var[0] && dStricmp((char*)mText, var))
       setText(var);
+
+   // The marquee moves every frame
+   if(mScroll && mScrollAmt != SCROLL_INVALID)
+      setUpdate();
 }
 
 //------------------------------------------------------------------------------
@@ -111,6 +111,8 @@ bool GuiTextEditCtrl::onAdd()
 
 void GuiTextEditCtrl::onStaticModified(const char* slotName)
 {
+   Parent::onStaticModified(slotName);
+
    if(!dStricmp(slotName, "text"))
       setText(mText);
 }
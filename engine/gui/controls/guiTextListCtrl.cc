@@ -13,41 +13,65 @@
 
 IMPLEMENT_CONOBJECT(GuiTextListCtrl);
 
-static int sortColumn;
-static bool sIncreasing;
+//------------------------------------------------------------------------------
+// Sorting
+//
+// Keys are pulled out of the rows once up front, the numeric ones parsed
+// once, and merged so rows that compare equal keep their order. Like the
+// old comparators, a text key runs from the start of the column to the end
+// of the row.
 
-static const char *getColumn(const char *text)
+namespace {
+
+struct SortKey
+{
+   const char *text;
+   F32 value;
+   S32 row;
+};
+
+inline S32 compareKeys(const SortKey &a, const SortKey &b, bool numeric, bool increasing)
 {
-   int ct = sortColumn;
-   while(ct--)
+   S32 result;
+   if(numeric)
+      result = a.value < b.value ? -1 : (a.value > b.value ? 1 : 0);
+   else
+      result = dStricmp(a.text, b.text);
+   return increasing ? result : -result;
+}
+
+void mergeSortKeys(SortKey *keys, SortKey *scratch, U32 count, bool numeric, bool increasing)
+{
+   for(U32 width = 1; width < count; width <<= 1)
    {
-      text = dStrchr(text, '\t');
-      if(!text)
-         return "";
-      text++;
+      for(U32 start = 0; start < count; start += width << 1)
+      {
+         U32 mid = getMin(start + width, count);
+         U32 end = getMin(start + (width << 1), count);
+         U32 i = start, j = mid, k = start;
+
+         // Take from the left run on ties so the sort is stable.
+         while(i < mid && j < end)
+            scratch[k++] = compareKeys(keys[j], keys[i], numeric, increasing) < 0 ? keys[j++] : keys[i++];
+         while(i < mid)
+            scratch[k++] = keys[i++];
+         while(j < end)
+            scratch[k++] = keys[j++];
+      }
+      dMemcpy(keys, scratch, count * sizeof(SortKey));
    }
-   return text;
 }
 
-static S32 QSORT_CALLBACK textCompare( const void* a, const void* b )
+inline U32 hashId(U32 id)
 {
-   GuiTextListCtrl::Entry *ea = (GuiTextListCtrl::Entry *) (a);
-   GuiTextListCtrl::Entry *eb = (GuiTextListCtrl::Entry *) (b);
-   S32 result = dStricmp( getColumn( ea->text ), getColumn( eb->text ) );
-   return ( sIncreasing ? result : -result );
+   id ^= id >> 16;
+   id *= 0x45d9f3b;
+   return id ^ (id >> 16);
 }
 
-static S32 QSORT_CALLBACK numCompare(const void *a,const void *b)
-{
-   GuiTextListCtrl::Entry *ea = (GuiTextListCtrl::Entry *) (a);
-   GuiTextListCtrl::Entry *eb = (GuiTextListCtrl::Entry *) (b);
-   const char* aCol = getColumn( ea->text );
-   const char* bCol = getColumn( eb->text );
-   F32 result = dAtof(aCol) - dAtof(bCol);
-   S32 res = result < 0 ? -1 : (result > 0 ? 1 : 0);
+} // namespace
 
-   return ( sIncreasing ? res : -res );
-}
+//------------------------------------------------------------------------------
 
 GuiTextListCtrl::GuiTextListCtrl()
 {
@@ -61,6 +85,8 @@ GuiTextListCtrl::GuiTextListCtrl()
    mColumnOffsets.push_back(0);
    mFitParentWidth = true;
    mClipColumnText = false;
+   mIdTableDirty = true;
+   mMaxRowWidth = -1;
 }
 
 void GuiTextListCtrl::initPersistFields()
@@ -227,10 +253,19 @@ bool GuiTextListCtrl::onWake()
    if(!Parent::onWake())
       return false;
 
+   // The font may have changed.
+   invalidateRowWidths();
    setSize(mSize);
    return true;
 }
 
+void GuiTextListCtrl::onStaticModified(const char *slotName)
+{
+   Parent::onStaticModified(slotName);
+   if(!dStricmp(slotName, "columns"))
+      invalidateRowWidths();
+}
+
 U32 GuiTextListCtrl::getSelectedId()
 {
    if (mSelectedCell.y == -1)
@@ -288,92 +323,119 @@ void GuiTextListCtrl::onRenderCell(Point2I offset, Point2I cell, bool selected,
 	else
 		dglSetBitmapModulation(mProfile->mFontColorNA);
 
-	const char* text = mList[cell.y].text;
-	for (U32 index = 0; index < mColumnOffsets.size(); index++)
+	const Entry &entry = mList[cell.y];
+	RectI cellClip = dglGetClipRect();
+	for (U32 index = 0; index < mColumnOffsets.size() && index < entry.numColumns; index++)
 	{
-		const char* nextCol = dStrchr(text, '\t');
-		if (mColumnOffsets[index] >= 0)
-		{
-			dsize_t slen;
-			if (nextCol)
-				slen = nextCol - text;
-			else
-				slen = dStrlen(text);
+		if (mColumnOffsets[index] < 0)
+			continue;
+
+		Point2I pos(offset.x + 4 + mColumnOffsets[index], offset.y);
 
-			Point2I pos(offset.x + 4 + mColumnOffsets[index], offset.y);
+		// Off the right of the cell, don't bother.
+		if (pos.x >= cellClip.point.x + cellClip.extent.x)
+			continue;
 
-			RectI saveClipRect;
-			bool clipped = false;
+		RectI saveClipRect;
+		bool clipped = false;
 
-			if (mClipColumnText && (index != (mColumnOffsets.size() - 1)))
+		if (mClipColumnText && (index != (mColumnOffsets.size() - 1)))
+		{
+			saveClipRect = dglGetClipRect();
+
+			RectI clipRect(pos, Point2I(mColumnOffsets[index + 1] - mColumnOffsets[index] - 4, mCellSize.y));
+			if (clipRect.intersect(saveClipRect))
 			{
-				saveClipRect = dglGetClipRect();
-
-				RectI clipRect(pos, Point2I(mColumnOffsets[index + 1] - mColumnOffsets[index] - 4, mCellSize.y));
-				if (clipRect.intersect(saveClipRect))
-				{
-					clipped = true;
-					dglSetClipRect(clipRect);
-				}
+				clipped = true;
+				dglSetClipRect(clipRect);
 			}
+		}
 
-			dglDrawTextN(mFont, pos, text, slen, mProfile->mFontColors);
+		dglDrawTextN(mFont, pos, entry.getColumn(index), entry.getColumnLength(index), mProfile->mFontColors);
 
-			if (clipped)
-				dglSetClipRect(saveClipRect);
-		}
-		if (!nextCol)
-			break;
-		text = nextCol + 1;
+		if (clipped)
+			dglSetClipRect(saveClipRect);
 	}
 }
 
 U32 GuiTextListCtrl::getRowWidth(Entry *row)
 {
+   if(row->width)
+      return row->width;
+
    U32 width = 1;
-   const char *text = row->text;
-   for(U32 index = 0; index < mColumnOffsets.size(); index++)
+   for(U32 index = 0; index < mColumnOffsets.size() && index < row->numColumns; index++)
    {
-      const char *nextCol = dStrchr(text, '\t');
-      U32 textWidth;
-      if(nextCol)
-         textWidth = mFont->getStrNWidth((const UTF8*)text, nextCol - text);
-      else
-         textWidth = mFont->getStrWidth((const UTF8*)text);
-      if(mColumnOffsets[index] >= 0)
-         width = getMax(width, mColumnOffsets[index] + textWidth);
-      if(!nextCol)
-         break;
-      text = nextCol+1;
+      if(mColumnOffsets[index] < 0)
+         continue;
+      U32 textWidth = mFont->getStrNWidth((const UTF8*)row->getColumn(index), row->getColumnLength(index));
+      width = getMax(width, mColumnOffsets[index] + textWidth);
    }
+   row->width = width;
    return width;
 }
 
+void GuiTextListCtrl::invalidateRowWidths()
+{
+   for(U32 i = 0; i < mList.size(); i++)
+      mList[i].width = 0;
+   mMaxRowWidth = -1;
+}
+
+//------------------------------------------------------------------------------
+
+void GuiTextListCtrl::setEntryText(Entry &entry, const char *text)
+{
+   entry.text = dStrdup(text);
+   entry.width = 0;
+
+   entry.numColumns = 1;
+   for(const char *walk = dStrchr(text, '\t'); walk; walk = dStrchr(walk + 1, '\t'))
+      entry.numColumns++;
+
+   entry.columns = (U32 *)dMalloc((entry.numColumns + 1) * sizeof(U32));
+   U32 column = 0;
+   entry.columns[column++] = 0;
+   for(const char *walk = dStrchr(text, '\t'); walk; walk = dStrchr(walk + 1, '\t'))
+      entry.columns[column++] = walk - text + 1;
+   entry.columns[column] = dStrlen(text) + 1;
+}
+
+void GuiTextListCtrl::freeEntry(Entry &entry)
+{
+   dFree(entry.text);
+   dFree(entry.columns);
+}
+
 void GuiTextListCtrl::insertEntry(U32 id, const char *text, S32 index)
 {
    Entry e;
-   e.text = dStrdup(text);
+   setEntryText(e, text);
    e.id = id;
    e.active = true;
-   if(!mList.size())
+
+   // Keep the widest row current while we can measure.
+   if(mMaxRowWidth >= 0 && bool(mFont))
+      mMaxRowWidth = getMax(mMaxRowWidth, S32(getRowWidth(&e)));
+   else
+      mMaxRowWidth = -1;
+
+   if(index < 0 || index >= S32(mList.size()))
+   {
       mList.push_back(e);
+      insertIdTable(mList.size() - 1);
+   }
    else
    {
-      if(index > mList.size())
-         index = mList.size();
       mList.insert(&mList[index],e);
+      mIdTableDirty = true;
    }
    setSize(Point2I(1, mList.size()));
 }
 
 void GuiTextListCtrl::addEntry(U32 id, const char *text)
 {
-   Entry e;
-   e.text = dStrdup(text);
-   e.id = id;
-   e.active = true;
-   mList.push_back(e);
-   setSize(Point2I(1, mList.size()));
+   insertEntry(id, text, mList.size());
 }
 
 void GuiTextListCtrl::setEntry(U32 id, const char *text)
@@ -383,8 +445,9 @@ void GuiTextListCtrl::setEntry(U32 id, const char *text)
       addEntry(id, text);
    else
    {
-      dFree(mList[e].text);
-      mList[e].text = dStrdup(text);
+      freeEntry(mList[e]);
+      setEntryText(mList[e], text);
+      mMaxRowWidth = -1;
 
       // Still have to call this to make sure cells are wide enough for new values:
       setSize( Point2I( 1, mList.size() ) );
@@ -411,11 +474,59 @@ void GuiTextListCtrl::setEntryActive(U32 id, bool active)
    }
 }
 
-S32 GuiTextListCtrl::findEntryById(U32 id)
+//------------------------------------------------------------------------------
+
+void GuiTextListCtrl::rebuildIdTable()
 {
+   // Keep it under half full.
+   U32 size = 16;
+   while(size < mList.size() * 2)
+      size <<= 1;
+
+   mIdTable.setSize(size);
+   for(U32 i = 0; i < size; i++)
+      mIdTable[i] = -1;
+
+   mIdTableDirty = false;
    for(U32 i = 0; i < mList.size(); i++)
-      if(mList[i].id == id)
-         return i;
+      insertIdTable(i);
+}
+
+void GuiTextListCtrl::insertIdTable(S32 row)
+{
+   if(mIdTableDirty)
+      return;
+
+   if((mList.size() * 2) > mIdTable.size())
+   {
+      mIdTableDirty = true;
+      return;
+   }
+
+   U32 id = mList[row].id;
+   U32 mask = mIdTable.size() - 1;
+   for(U32 slot = hashId(id) & mask; ; slot = (slot + 1) & mask)
+   {
+      if(mIdTable[slot] == -1)
+      {
+         mIdTable[slot] = row;
+         return;
+      }
+      // Ids needn't be unique; the first row with one wins, as before.
+      if(mList[mIdTable[slot]].id == id)
+         return;
+   }
+}
+
+S32 GuiTextListCtrl::findEntryById(U32 id)
+{
+   if(mIdTableDirty)
+      rebuildIdTable();
+
+   U32 mask = mIdTable.size() - 1;
+   for(U32 slot = hashId(id) & mask; mIdTable[slot] != -1; slot = (slot + 1) & mask)
+      if(mList[mIdTable[slot]].id == id)
+         return mIdTable[slot];
    return -1;
 }
 
@@ -450,16 +561,16 @@ void GuiTextListCtrl::setSize(Point2I newSize)
       }
       else
       {
-         // Find the maximum width cell:
-         S32 maxWidth = 1;
-         for ( U32 i = 0; i < mList.size(); i++ )
+         // Find the maximum width cell. Rows remember their own width, and
+         // the maximum is only looked for again once a row has changed.
+         if ( mMaxRowWidth < 0 )
          {
-            U32 rWidth = getRowWidth( &mList[i] );
-            if ( rWidth > maxWidth )
-               maxWidth = rWidth;
+            mMaxRowWidth = 1;
+            for ( U32 i = 0; i < mList.size(); i++ )
+               mMaxRowWidth = getMax( mMaxRowWidth, S32( getRowWidth( &mList[i] ) ) );
          }
 
-         mCellSize.x = maxWidth + 8;
+         mCellSize.x = mMaxRowWidth + 8;
       }
 
       mCellSize.y = mFont->getHeight() + 2;
@@ -471,30 +582,54 @@ void GuiTextListCtrl::setSize(Point2I newSize)
 
 void GuiTextListCtrl::clear()
 {
-   while (mList.size())
-      removeEntry(mList[0].id);
+   for(U32 i = 0; i < mList.size(); i++)
+      freeEntry(mList[i]);
+   mList.clear();
+   mIdTableDirty = true;
+   mMaxRowWidth = -1;
+   setSize(Point2I(1, 0));
 
    mMouseOverCell.set( -1, -1 );
    setSelectedCell(Point2I(-1, -1));
 }
 
-void GuiTextListCtrl::sort(U32 column, bool increasing)
+void GuiTextListCtrl::sortEntries(U32 column, bool increasing, bool numeric)
 {
-   if (getNumEntries() < 2)
+   U32 count = mList.size();
+   if (count < 2)
       return;
-   sortColumn = column;
-   sIncreasing = increasing;
-   dQsort((void *)&(mList[0]), mList.size(), sizeof(Entry), textCompare);
+
+   Vector<SortKey> keys(count);
+   Vector<SortKey> scratch(count);
+   keys.setSize(count);
+   scratch.setSize(count);
+   for(U32 i = 0; i < count; i++)
+   {
+      keys[i].text = mList[i].getColumn(column);
+      keys[i].value = numeric ? dAtof(keys[i].text) : 0;
+      keys[i].row = i;
+   }
+
+   mergeSortKeys(keys.address(), scratch.address(), count, numeric, increasing);
+
+   Vector<Entry> sorted(count);
+   sorted.setSize(count);
+   for(U32 i = 0; i < count; i++)
+      sorted[i] = mList[keys[i].row];
+   dMemcpy(mList.address(), sorted.address(), count * sizeof(Entry));
+
+   mIdTableDirty = true;
+   setUpdate();
 }
 
-void GuiTextListCtrl::sortNumerical( U32 column, bool increasing )
+void GuiTextListCtrl::sort(U32 column, bool increasing)
 {
-   if ( getNumEntries() < 2 )
-      return;
+   sortEntries(column, increasing, false);
+}
 
-   sortColumn = column;
-   sIncreasing = increasing;
-   dQsort( (void*) &( mList[0] ), mList.size(), sizeof( Entry ), numCompare );
+void GuiTextListCtrl::sortNumerical( U32 column, bool increasing )
+{
+   sortEntries(column, increasing, true);
 }
 
 void GuiTextListCtrl::onRemove()
@@ -512,8 +647,10 @@ void GuiTextListCtrl::removeEntryByIndex(S32 index)
 {
    if(index < 0 || index >= mList.size())
       return;
-   dFree(mList[index].text);
+   freeEntry(mList[index]);
    mList.erase(index);
+   mIdTableDirty = true;
+   mMaxRowWidth = -1;
 
    setSize(Point2I( 1, mList.size()));
    setSelectedCell(Point2I(-1, -1));
@@ -16,13 +16,24 @@ class GuiTextListCtrl : public GuiArrayCtrl
    typedef GuiArrayCtrl Parent;
 
   public:
+   /// A row of the list. The text is kept as given, tabs and all, with the
+   /// start of each column worked out once when the row is set rather than
+   /// every time it is drawn, measured or sorted.
    struct Entry
    {
       char *text;
       U32 id;
       bool active;
+      U32 numColumns;   ///< Tab separated columns in text.
+      U32 *columns;     ///< Start of each column in text, plus one past the end.
+      U32 width;        ///< Measured row width, 0 until measured.
+
+      const char *getColumn(U32 column) const { return column < numColumns ? text + columns[column] : ""; }
+      U32 getColumnLength(U32 column) const   { return column < numColumns ? columns[column + 1] - columns[column] - 1 : 0; }
    };
 
+   /// Rows in display order. Treat as read only outside this class, the
+   /// id lookup table below is only kept up to date by the entry methods.
    Vector<Entry> mList;
 
    bool mEnumerate;
@@ -42,6 +53,26 @@ class GuiTextListCtrl : public GuiArrayCtrl
    bool  mFitParentWidth;
    bool  mClipColumnText;
 
+   /// @name Id Lookup
+   /// Open addressed id -> row table so findEntryById doesn't walk the
+   /// list. Appending rows keeps it current; anything that moves rows
+   /// just marks it dirty and it is rebuilt on the next lookup.
+   /// @{
+   Vector<S32> mIdTable;
+   bool        mIdTableDirty;
+
+   void rebuildIdTable();
+   void insertIdTable(S32 row);
+   /// @}
+
+   /// Widest row, or -1 if a row was changed or removed since it was found.
+   S32   mMaxRowWidth;
+
+   static void setEntryText(Entry &entry, const char *text);
+   static void freeEntry(Entry &entry);
+   void invalidateRowWidths();
+   void sortEntries(U32 column, bool increasing, bool numeric);
+
    U32 getRowWidth(Entry *row);
    void onCellSelected(Point2I cell);
 
@@ -86,8 +117,9 @@ class GuiTextListCtrl : public GuiArrayCtrl
 
    void setSize(Point2I newSize);
    void onRemove();
-   void addColumnOffset(S32 offset) { mColumnOffsets.push_back(offset); }
-   void clearColumnOffsets() { mColumnOffsets.clear(); }
+   void onStaticModified(const char *slotName);
+   void addColumnOffset(S32 offset) { mColumnOffsets.push_back(offset); invalidateRowWidths(); }
+   void clearColumnOffsets() { mColumnOffsets.clear(); invalidateRowWidths(); }
 };
 
 #endif //_GUI_TEXTLIST_CTRL_H
@@ -340,6 +340,7 @@ GuiTreeViewCtrl::GuiTreeViewCtrl()
 
    mItemFreeList  =  NULL;
    mRoot          =  NULL;
+   mLastInserted  =  NULL;
    mInstantGroup = 0;
    mItemCount = 0;
    mSelectedItem = 0;
@@ -563,7 +564,9 @@ void GuiTreeViewCtrl::destroyTree()
 
    //
    mRoot          = NULL;
+   mLastInserted  = NULL;
    mItemFreeList  = NULL;
+   mFlags.clear(IsInspector | RebuildVisible);
    mItemCount = 0;
    mSelectedItem = 0;
    mDraggedToItem = 0;
@@ -657,6 +660,111 @@ void GuiTreeViewCtrl::buildVisibleTree(bool bForceFullUpdate)
 
 //------------------------------------------------------------------------------
 
+void GuiTreeViewCtrl::updateVisibleTree()
+{
+   if(!mFlags.test(RebuildVisible) || mFlags.test(BuildingVisTree))
+      return;
+
+   buildVisibleTree();
+   setUpdate();
+}
+
+S32 GuiTreeViewCtrl::findVisibleRow(Item *item)
+{
+   for(S32 i = 0; i < mVisibleItems.size(); i++)
+      if(mVisibleItems[i] == item)
+         return i;
+   return -1;
+}
+
+S32 GuiTreeViewCtrl::countVisibleDescendants(S32 row)
+{
+   U32 tabLevel = mVisibleItems[row]->mTabLevel;
+   S32 count = 0;
+   while(row + 1 + count < mVisibleItems.size() && mVisibleItems[row + 1 + count]->mTabLevel > tabLevel)
+      count++;
+   return count;
+}
+
+void GuiTreeViewCtrl::expandVisibleItem(Item *item)
+{
+   // A pending rebuild will pick it up anyway.
+   if(mFlags.test(RebuildVisible) || mFlags.test(BuildingVisTree))
+      return;
+
+   // Under a collapsed parent there's nothing to show, and someone may
+   // already have laid the children out.
+   S32 row = findVisibleRow(item);
+   if(row < 0 || countVisibleDescendants(row))
+      return;
+
+   mFlags.set(BuildingVisTree);
+
+   // Give an inspector item the chance to fill itself in first.
+   if(item->mState.test(Item::VirtualParent) && !onVirtualParentBuild(item))
+   {
+      mFlags.clear(BuildingVisTree);
+      mFlags.set(RebuildVisible);
+      return;
+   }
+
+   // Build the children onto the end of the rows above, then put the rows
+   // below back.
+   Vector<Item*> below;
+   below.setSize(mVisibleItems.size() - row - 1);
+   if(below.size())
+      dMemcpy(below.address(), &mVisibleItems[row + 1], below.size() * sizeof(Item*));
+   mVisibleItems.setSize(row + 1);
+
+   Item *child = item->mChild;
+   while(child)
+   {
+      Item *next = child->mNext;
+      buildItem(child, item->mTabLevel + 1);
+      child = next;
+   }
+
+   S32 added = mVisibleItems.size() - row - 1;
+   mVisibleItems.merge(below);
+
+   mFlags.clear(BuildingVisTree);
+
+   syncSelection(row + 1, added);
+   updateVisibleSize();
+}
+
+void GuiTreeViewCtrl::collapseVisibleItem(Item *item)
+{
+   if(mFlags.test(RebuildVisible) || mFlags.test(BuildingVisTree))
+      return;
+
+   S32 row = findVisibleRow(item);
+   if(row < 0)
+      return;
+
+   S32 count = countVisibleDescendants(row);
+   if(!count)
+      return;
+
+   S32 moved = mVisibleItems.size() - row - 1 - count;
+   if(moved)
+      dMemmove(&mVisibleItems[row + 1], &mVisibleItems[row + 1 + count], moved * sizeof(Item*));
+   mVisibleItems.setSize(mVisibleItems.size() - count);
+
+   updateVisibleSize();
+}
+
+void GuiTreeViewCtrl::updateVisibleSize()
+{
+   // mMaxWidth only grows until the next full rebuild, which is fine for
+   // a scroll extent.
+   mCellSize.set(mMaxWidth+1, mItemHeight);
+   setSize(Point2I(1, mVisibleItems.size()));
+   setUpdate();
+}
+
+//------------------------------------------------------------------------------
+
 bool GuiTreeViewCtrl::scrollVisible( S32 itemId )
 {
    Item* item = getItem(itemId);
@@ -675,6 +783,8 @@ bool GuiTreeViewCtrl::scrollVisible( Item *item )
 
    while(parent)
    {
+      if(!parent->isExpanded())
+         mFlags.set(RebuildVisible);
       parent->setExpanded(true);
 
       if( !parent->isInspectorData() && parent->mState.test(Item::VirtualParent) )
@@ -692,17 +802,15 @@ bool GuiTreeViewCtrl::scrollVisible( Item *item )
       return false;
    }
 
-   // And now, build the visible tree so we know where we have to scroll.
-   buildVisibleTree();
+   // And now, make sure the visible tree is current so we know where we have to scroll.
+   updateVisibleTree();
 
    // All done, let's figure out where we have to scroll...
-   for(S32 i=0; i<mVisibleItems.size(); i++)
+   S32 row = findVisibleRow(item);
+   if(row >= 0)
    {
-      if(mVisibleItems[i] == item)
-      {
-         pScrollParent->scrollRectVisible(RectI(0, i * mItemHeight, mMaxWidth, mItemHeight));
-         return true;
-      }
+      pScrollParent->scrollRectVisible(RectI(0, row * mItemHeight, mMaxWidth, mItemHeight));
+      return true;
    }
 
    // If we got here, it's probably bad...
@@ -753,6 +861,8 @@ S32 GuiTreeViewCtrl::insertItem(S32 parentId, const char * text, const char * va
       if( mRoot != NULL )
       {
          Item * pTreeTraverse = mRoot;
+         if( mLastInserted && getItem( mLastInserted->mId ) == mLastInserted && mLastInserted->mParent == NULL )
+            pTreeTraverse = mLastInserted;
          while( pTreeTraverse != NULL && pTreeTraverse->mNext != NULL )
             pTreeTraverse = pTreeTraverse->mNext;
 
@@ -771,7 +881,10 @@ S32 GuiTreeViewCtrl::insertItem(S32 parentId, const char * text, const char * va
       // insert back
       if( pParentItem != NULL && pParentItem->mChild)
       {
+         // Filling in a parent adds to the same end over and over.
          Item * pTreeTraverse = pParentItem->mChild;
+         if( mLastInserted && getItem( mLastInserted->mId ) == mLastInserted && mLastInserted->mParent == pParentItem )
+            pTreeTraverse = mLastInserted;
          while( pTreeTraverse != NULL && pTreeTraverse->mNext != NULL )
             pTreeTraverse = pTreeTraverse->mNext;
 
@@ -787,9 +900,11 @@ S32 GuiTreeViewCtrl::insertItem(S32 parentId, const char * text, const char * va
          mFlags.set(RebuildVisible);
    }
 
-   //
-   if(mFlags.test(RebuildVisible))
-      buildVisibleTree();
+   mLastInserted = pNewItem;
+
+   // The visible list is rebuilt once before it's next used, however many
+   // items go in before then.
+   setUpdate();
 
    return pNewItem->mId;
 }
@@ -812,6 +927,18 @@ bool GuiTreeViewCtrl::removeItem(S32 itemId)
       return false;
    }
 
+   // Take it and its children off the rendered tree while we can still
+   // tell which rows are theirs. While building, it isn't on it yet.
+   S32 row = mFlags.test(BuildingVisTree) ? -1 : findVisibleRow(item);
+   if(row >= 0)
+   {
+      S32 count = countVisibleDescendants(row) + 1;
+      S32 moved = mVisibleItems.size() - row - count;
+      if(moved)
+         dMemmove(&mVisibleItems[row], &mVisibleItems[row + count], moved * sizeof(Item*));
+      mVisibleItems.setSize(mVisibleItems.size() - count);
+   }
+
    // root?
    if(item == mRoot)
       mRoot = item->mNext;
@@ -824,7 +951,10 @@ bool GuiTreeViewCtrl::removeItem(S32 itemId)
    destroyItem(item);
 
    // Update the rendered tree...
-   buildVisibleTree();
+   if(row >= 0)
+      updateVisibleSize();
+   else
+      setUpdate();
 
    return true;
 }
@@ -835,7 +965,9 @@ void GuiTreeViewCtrl::removeAllChildren(S32 itemId)
    Item * item = getItem(itemId);
    if(item)
    {
+      collapseVisibleItem(item);
       destroyChildren(item->mChild, item);
+      setUpdate();
    }
 }
 //------------------------------------------------------------------------------
@@ -1168,6 +1300,8 @@ void GuiTreeViewCtrl::onPreRender()
 {
    Parent::onPreRender();
 
+   updateVisibleTree();
+
    S32 nRootItemId = getFirstRootItem();
    if( nRootItemId == 0 )
       return;
@@ -1178,10 +1312,13 @@ void GuiTreeViewCtrl::onPreRender()
 
    mTicksPassed++;
 
-   if( mTicksPassed > mTreeRefreshInterval ) 
+   // Inspector trees follow SimSets that change under us, so they're still
+   // checked every so often. Script trees tell us when they change.
+   if( mFlags.test( IsInspector ) && mTicksPassed > mTreeRefreshInterval ) 
    {
    // Update every render in case new objects are added
    buildVisibleTree();
+      setUpdate();
 
       mTicksPassed = 0;
    }
@@ -1192,6 +1329,7 @@ void GuiTreeViewCtrl::onPreRender()
 
 bool GuiTreeViewCtrl::hitTest(const Point2I & pnt, Item* & item, BitSet32 & flags)
 {
+   updateVisibleTree();
 
    // Initialize some things.
    const Point2I pos = globalToLocalCoord(pnt);
@@ -1275,9 +1413,18 @@ void GuiTreeViewCtrl::setInstantGroup(SimObject * obj)
 
 void GuiTreeViewCtrl::syncSelection()
 {
+   syncSelection(0, mVisibleItems.size());
+}
+
+void GuiTreeViewCtrl::syncSelection(S32 first, S32 count)
+{
+   // Nothing to find.
+   if (mSelected.empty())
+      return;
+
    // for each visible item check to see if it is on the mSelected list.
    // if it is then make sure that it is on the mSelectedItems list as well.
-   for (S32 i = 0; i < mVisibleItems.size(); i++) 
+   for (S32 i = first; i < first + count; i++) 
    {
       for (S32 j = 0; j < mSelected.size(); j++) 
       {
@@ -1642,22 +1789,35 @@ bool GuiTreeViewCtrl::setItemExpanded(S32 itemId, bool expand)
    // expand parents
    if(expand)
    {
-      while(item)
+      // If it was already on show, just its children need laying out.
+      bool shown = true;
+      for(Item *walk = item; walk; walk = walk->mParent)
       {
-         if(item->mState.test(Item::VirtualParent))
-            onVirtualParentExpand(item);
+         if(walk != item && !walk->isExpanded())
+            shown = false;
 
-         item->setExpanded(true);
-         item = item->mParent;
+         walk->setExpanded(true);
+
+         if(walk->mState.test(Item::VirtualParent))
+            onVirtualParentExpand(walk);
       }
+
+      if(shown)
+         expandVisibleItem(item);
+      else
+         mFlags.set(RebuildVisible);
    }
    else
    {
+      collapseVisibleItem(item);
+
       if(item->mState.test(Item::VirtualParent))
          onVirtualParentCollapse(item);
 
       item->setExpanded(false);
    }
+
+   setUpdate();
    return(true);
 }
 
@@ -1781,6 +1941,8 @@ bool GuiTreeViewCtrl::onKeyDown( const GuiEvent& event )
    if ( !mVisible || !mActive || !mAwake )
       return true;
 
+   updateVisibleTree();
+
    // All the keyboard functionality requires a selected item, so if none exists...
 
    // Deal with enter and delete
@@ -1820,6 +1982,9 @@ bool GuiTreeViewCtrl::onKeyDown( const GuiEvent& event )
    // The Alt key lets you move items around!
    if ( mFlags.test(IsEditable) && event.modifier & SI_ALT )
    {
+      // Anything in here rearranges the tree.
+      mFlags.set(RebuildVisible);
+
       switch ( event.keyCode )
       {
       case KEY_UP:
@@ -2552,6 +2717,7 @@ void GuiTreeViewCtrl::onMouseUp(const GuiEvent &event)
          }
 
          // And update everything.
+         mFlags.set(RebuildVisible);
          scrollVisible(newItem);
       }
    }
@@ -2568,6 +2734,7 @@ void GuiTreeViewCtrl::onMouseDragged(const GuiEvent &event)
 
    if (mSelectedItems.size() == 0)
       return;
+   updateVisibleTree();
    Point2I pt = globalToLocalCoord(event.mousePoint);
    Parent::onMouseMove(event);
    mouseLock();
@@ -2818,9 +2985,7 @@ void GuiTreeViewCtrl::onMouseDown(const GuiEvent & event)
    //
    if ( mFullRowSelect || hitFlags.test( OnImage ) )
    {
-      item->setExpanded(!item->isExpanded());
-      if( !item->isInspectorData() && item->mState.test(Item::VirtualParent) )
-         onVirtualParentExpand(item);
+      setItemExpanded(item->mId, !item->isExpanded());
       scrollVisible(item);
    }
 }
@@ -2829,7 +2994,9 @@ void GuiTreeViewCtrl::onMouseDown(const GuiEvent & event)
 //------------------------------------------------------------------------------
 void GuiTreeViewCtrl::onMouseMove( const GuiEvent &event )
 {
-   if ( mMouseOverCell.y >= 0 )
+   updateVisibleTree();
+
+   if ( mMouseOverCell.y >= 0 && mMouseOverCell.y < mVisibleItems.size() )
       mVisibleItems[mMouseOverCell.y]->mState.clear( Item::MouseOverBmp | Item::MouseOverText );
 
    Parent::onMouseMove( event );
@@ -3290,8 +3457,10 @@ S32 GuiTreeViewCtrl::getIcon(const char * iconString)
    return icon;
 }
 
-void GuiTreeViewCtrl::addInspectorDataItem(Item *parent, SimObject *obj)
+GuiTreeViewCtrl::Item *GuiTreeViewCtrl::addInspectorDataItem(Item *parent, SimObject *obj, Item *lastChild)
 {
+   mFlags.set(IsInspector);
+
    S32 icon = getIcon(obj->getClassName());
    Item *item = createItem(icon);
    item->mState.set(Item::InspectorData);
@@ -3309,7 +3478,7 @@ void GuiTreeViewCtrl::addInspectorDataItem(Item *parent, SimObject *obj)
       // Add as child of parent.
       if(parent->mChild)
       {
-         Item * traverse = parent->mChild;
+         Item * traverse = lastChild ? lastChild : parent->mChild;
          while(traverse->mNext)
             traverse = traverse->mNext;
 
@@ -3329,11 +3498,15 @@ void GuiTreeViewCtrl::addInspectorDataItem(Item *parent, SimObject *obj)
       item->mParent = NULL;
    }
 
-   if(!parent || parent->isExpanded())
+   // Picked up before the tree is next drawn or clicked. While it's being
+   // built, the builder is about to walk over the new item anyway.
+   if((!parent || parent->isExpanded()) && !mFlags.test(BuildingVisTree))
+   {
       mFlags.set(RebuildVisible);
+      setUpdate();
+   }
 
-   buildVisibleTree();
-
+   return item;
 }
 
 void GuiTreeViewCtrl::unlinkItem(Item * item)
@@ -3345,23 +3518,6 @@ void GuiTreeViewCtrl::unlinkItem(Item * item)
       item->mNext->mPrevious = item->mPrevious;
 }
 
-bool GuiTreeViewCtrl::childSearch(Item * item, SimObject *obj, bool yourBaby)
-{
-   Item * temp = item->mChild;
-   while (temp)
-   {
-      //do you have my baby?
-      if (temp->isInspectorData())
-      {
-         if (temp->getObject() == obj)
-            yourBaby = false; //probably a child of an inner script
-      }
-      yourBaby = childSearch(temp,obj, yourBaby);
-      temp = temp->mNext;
-   }
-   return yourBaby;
-}
-
 void GuiTreeViewCtrl::inspectorSearch(Item * item, Item * parent, SimSet * parentSet, SimSet * newParentSet)
 {
    if (!parentSet||!newParentSet)
@@ -3419,6 +3575,39 @@ void GuiTreeViewCtrl::inspectorSearch(Item * item, Item * parent, SimSet * paren
       }
    }
 }
+static S32 QSORT_CALLBACK compareObjectPtrs(const void *a, const void *b)
+{
+   SimObject *objA = *(SimObject **)a;
+   SimObject *objB = *(SimObject **)b;
+   return (objA < objB) ? -1 : ((objA > objB) ? 1 : 0);
+}
+
+static bool findObjectPtr(const Vector<SimObject*> &sorted, SimObject *obj)
+{
+   S32 low = 0, high = sorted.size() - 1;
+   while(low <= high)
+   {
+      S32 mid = (low + high) >> 1;
+      if(sorted[mid] == obj)
+         return true;
+      if(sorted[mid] < obj)
+         low = mid + 1;
+      else
+         high = mid - 1;
+   }
+   return false;
+}
+
+static void gatherInspectorObjects(GuiTreeViewCtrl::Item *item, Vector<SimObject*> &objects)
+{
+   for(; item; item = item->mNext)
+   {
+      if(item->isInspectorData() && item->getObject())
+         objects.push_back(item->getObject());
+      gatherInspectorObjects(item->mChild, objects);
+   }
+}
+
 bool GuiTreeViewCtrl::onVirtualParentBuild(Item *item, bool bForceFullUpdate)
 {
    if(!item->mState.test(Item::InspectorData))
@@ -3442,26 +3631,28 @@ bool GuiTreeViewCtrl::onVirtualParentBuild(Item *item, bool bForceFullUpdate)
    if(!srcObj)
       return true;
 
-   SimSet::iterator i;
+   // Gather what's already under us once, rather than walking every
+   // child for every object in the set.
+   Vector<SimObject*> present;
+   gatherInspectorObjects(item->mChild, present);
+   if(present.size() > 1)
+      dQsort(present.address(), present.size(), sizeof(SimObject*), compareObjectPtrs);
+
+   Item *lastChild = item->mChild;
+   while(lastChild && lastChild->mNext)
+      lastChild = lastChild->mNext;
 
-   // This is slow but probably ok.
+   SimSet::iterator i;
    for(i = srcObj->begin(); i != srcObj->end(); i++)
    {
       SimObject *obj = *i;
 
-      // If we can't find it, add it.
-      // unless it has a parent that is a child that is a script
-      Item *res = item->findChildByValue(obj);
-
-      bool foundChild = true;
-
-      // search the children. if any of them are the parent of the object then don't add it.
-      foundChild = childSearch(item,obj,foundChild);
-
-      if(!res && foundChild)
+      // If we can't find it anywhere under us, add it. It may already be
+      // further down, as a child of an inner script.
+      if(!findObjectPtr(present, obj))
       {
          if (mDebug) Con::printf("adding something");
-         addInspectorDataItem(item, obj);
+         lastChild = addInspectorDataItem(item, obj, lastChild);
       }
    }
 
@@ -3470,7 +3661,18 @@ bool GuiTreeViewCtrl::onVirtualParentBuild(Item *item, bool bForceFullUpdate)
 
 bool GuiTreeViewCtrl::onVirtualParentExpand(Item *item)
 {
-   // Do nothing...
+   // Script items marked as virtual parents are filled in the first time
+   // they're opened, so a huge hierarchy never has to exist all at once.
+   if(item->isInspectorData() || item->mChild)
+      return true;
+
+   Con::executef(this, 2, "onPopulateItem", Con::getIntArg(item->mId));
+
+   // Once it has children it's an ordinary parent, and collapsing it
+   // keeps them.
+   if(item->mChild)
+      item->mState.clear(Item::VirtualParent);
+
    return true;
 }
 
@@ -3633,6 +3835,20 @@ ConsoleMethod(GuiTreeViewCtrl, expandItem, bool, 3, 4, "(TreeItemId item, bool e
    return(object->setItemExpanded(id, expand));
 }
 
+ConsoleMethod(GuiTreeViewCtrl, setItemVirtualParent, bool, 3, 4, "(TreeItemId item, bool virtual=true) - "
+              "A virtual parent shows an expand button while empty, and calls onPopulateItem(%item) "
+              "the first time it's expanded so its children can be added then.")
+{
+   GuiTreeViewCtrl::Item *item = object->getItem(dAtoi(argv[2]));
+   if(!item)
+      return false;
+
+   bool virt = (argc == 4) ? dAtob(argv[3]) : true;
+   item->setVirtualParent(virt);
+   object->setUpdate();
+   return true;
+}
+
 // Make the given item visible.
 ConsoleMethod(GuiTreeViewCtrl, scrollVisible, void, 3, 3, "(TreeItemId item)")
 {
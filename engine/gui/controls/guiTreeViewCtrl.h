@@ -41,7 +41,7 @@ class GuiTreeViewCtrl : public GuiArrayCtrl
 
          BitSet32                mState;
          SimObjectPtr<GuiControlProfile> mProfile;
-         S16                     mId;
+         S32                     mId;
          U16                     mTabLevel;
          Item *                  mParent;
          Item *                  mChild;
@@ -78,7 +78,7 @@ class GuiTreeViewCtrl : public GuiArrayCtrl
          const S8 getExpandedImage() const;
          char *getText();
          char *getValue();
-         inline const S16 getID() const { return mId; };
+         inline const S32 getID() const { return mId; };
          SimObject *getObject();
          const U32 getDisplayTextLength();
          const S32 getDisplayTextWidth(GFont *font);
@@ -243,6 +243,8 @@ public:
                                              ///  item ids and do some other clever
                                              ///  things.
       Item *                  mRoot;
+      Item *                  mLastInserted; ///< Saves walking the siblings when
+                                             ///  adding to the same parent again.
       S32                     mInstantGroup;
       S32                     mMaxWidth;
       S32                     mSelectedItem;
@@ -295,6 +297,28 @@ protected:
 
       void buildItem(Item * item, U32 tabLevel, bool bForceFullUpdate = false);
 
+      /// @name Visible List
+      ///
+      /// Inserting items only flags the visible list for a rebuild, which
+      /// happens once before it is next used rather than once per insert.
+      /// Expanding, collapsing and removing an item splice its rows in or
+      /// out of the list in place.
+      /// @{
+
+      /// Rebuild the visible list if something flagged it.
+      void updateVisibleTree();
+      /// Row of an item in the visible list, or -1.
+      S32 findVisibleRow(Item *item);
+      /// Number of rows below row that belong to its item's children.
+      S32 countVisibleDescendants(S32 row);
+      /// Lay out the children of a visible item under it.
+      void expandVisibleItem(Item *item);
+      /// Take the children of an item out of the visible list.
+      void collapseVisibleItem(Item *item);
+      /// Size the array to the visible list after splicing.
+      void updateVisibleSize();
+      /// @}
+
       bool hitTest(const Point2I & pnt, Item* & item, BitSet32 & flags);
 
       virtual bool onVirtualParentBuild(Item *item, bool bForceFullUpdate = false);
@@ -302,7 +326,9 @@ protected:
       virtual bool onVirtualParentCollapse(Item *item);
       virtual void onItemSelected( Item *item );
 
-      void addInspectorDataItem(Item *parent, SimObject *obj);
+      /// Add an item for obj under parent. lastChild, if known, saves walking
+      /// the parent's children to find the end.
+      Item *addInspectorDataItem(Item *parent, SimObject *obj, Item *lastChild = NULL);
 
    public:
       GuiTreeViewCtrl();
@@ -310,6 +336,8 @@ protected:
 
       /// Used for syncing the mSelected and mSelectedItems lists.
       void syncSelection();
+      /// Sync just count visible rows from first.
+      void syncSelection(S32 first, S32 count);
 
       void lockSelection(bool lock);
       void hideSelection(bool hide);
@@ -382,9 +410,6 @@ protected:
       void onMouseDragged(const GuiEvent &event);
       void onMouseUp(const GuiEvent &event);
 
-      /// Returns false if the object is a child of one of the inner items.
-      bool childSearch(Item * item, SimObject *obj, bool yourBaby);
-
       /// Find immediately available inspector items (eg ones that aren't children of other inspector items)
       /// and then update their sets
       void inspectorSearch(Item * item, Item * parent, SimSet * parentSet, SimSet * newParentSet);
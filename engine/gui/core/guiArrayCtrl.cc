@@ -206,7 +206,12 @@ void GuiArrayCtrl::onRender(Point2I offset, const RectI &updateRect)
    //save the original for clipping the row headers
    RectI origClipRect = clipRect;
 
-   for (j = 0; j < mSize.y; j++)
+   //jump straight to the first visible row, long lists only draw a screenful
+   j = 0;
+   if (mCellSize.y > 0 && updateRect.point.y > offset.y)
+      j = getMin((updateRect.point.y - offset.y) / mCellSize.y, mSize.y);
+
+   for (; j < mSize.y; j++)
    {
       //skip until we get to a visible row
       if ((j + 1) * mCellSize.y + offset.y < updateRect.point.y)
@@ -4,7 +4,9 @@
 //-----------------------------------------------------------------------------
 
 #include "console/console.h"
+#include "console/consoleTypes.h"
 #include "platform/profiler.h"
+#include "platform/metrics.h"
 #include "dgl/dgl.h"
 #include "platform/event.h"
 #include "platform/platform.h"
@@ -255,12 +257,28 @@ GuiCanvas::GuiCanvas()
    hoverPosition = getCursorPos();
    hoverPositionSet = false;
    hoverLeftControlTime = 0;
+
+   mFrameCache = NULL;
+   mFrameCacheSize.set(0, 0);
+   mFrameCacheValid = false;
+   mLastFrameDirtyAll = false;
+   mTooltipWanted = false;
+   mFrameRendered = false;
 }
 
 GuiCanvas::~GuiCanvas()
 {
    if(Canvas == this)
       Canvas = 0;
+
+   delete mFrameCache;
+}
+
+bool GuiCanvas::smUseFrameCache = true;
+
+void GuiCanvas::consoleInit()
+{
+   Con::addVariable("$pref::Video::canvasFrameCache", TypeBool, &smUseFrameCache);
 }
 
 //------------------------------------------------------------------------------
@@ -348,10 +366,22 @@ bool GuiCanvas::tabPrev(void)
 }
 
 
+void GuiCanvas::setInputControlsUpdate()
+{
+   if(mFirstResponder)
+      mFirstResponder->setUpdate();
+   if(bool(mMouseControl))
+      mMouseControl->setUpdate();
+   if(bool(mMouseCapturedControl))
+      mMouseCapturedControl->setUpdate();
+}
+
 void GuiCanvas::processMouseMoveEvent(const MouseMoveEvent *event)
 {
    if( cursorON )
    {
+      setInputControlsUpdate();
+
 		//copy the modifier into the new event
 		mLastEvent.modifier = event->modifier;
 
@@ -381,6 +411,8 @@ void GuiCanvas::processMouseMoveEvent(const MouseMoveEvent *event)
 
 bool GuiCanvas::processInputEvent(const InputEvent *event)
 {
+   setInputControlsUpdate();
+
 	// First call the general input handler (on the extremely off-chance that it will be handled):
 	if ( mFirstResponder )
    {
@@ -677,9 +709,13 @@ void GuiCanvas::findMouseControl(const GuiEvent &event)
    if(controlHit != static_cast<GuiControl*>(mMouseControl))
    {
       if(bool(mMouseControl))
+      {
          mMouseControl->onMouseLeave(event);
+         mMouseControl->setUpdate();
+      }
       mMouseControl = controlHit;
       mMouseControl->onMouseEnter(event);
+      mMouseControl->setUpdate();
    }
 }
 
@@ -716,7 +752,11 @@ void GuiCanvas::checkLockMouseMove(const GuiEvent &event)
          mMouseCapturedControl->onMouseLeave(event);
       else if(controlHit == mMouseCapturedControl)
          mMouseCapturedControl->onMouseEnter(event);
+      if(bool(mMouseControl))
+         mMouseControl->setUpdate();
       mMouseControl = controlHit;
+      if(bool(mMouseControl))
+         mMouseControl->setUpdate();
    }
 }
 
@@ -1076,6 +1116,8 @@ void GuiCanvas::mouseLock(GuiControl *lockingControl)
    if (bool(mMouseCapturedControl))
       return;
    mMouseCapturedControl = lockingControl;
+   if(lockingControl)
+      lockingControl->setUpdate();
    if(mMouseControl && mMouseControl != mMouseCapturedControl)
    {
       GuiEvent evt;
@@ -1090,6 +1132,8 @@ void GuiCanvas::mouseUnlock(GuiControl *lockingControl)
 {
    if (static_cast<GuiControl*>(mMouseCapturedControl) != lockingControl)
       return;
+   if(lockingControl)
+      lockingControl->setUpdate();
 
    GuiEvent evt;
    evt.mousePoint.x = S32(cursorPt.x);
@@ -1144,8 +1188,12 @@ void GuiCanvas::maintainSizing()
 
 }
 
+static Metric sCanvasRender("canvas.render", Metric::Timer);
+
 void GuiCanvas::renderFrame(bool preRenderOnly, bool bufferSwap /* = true */)
 {
+   MetricScope renderScope(sCanvasRender);
+
    PROFILE_START(CanvasPreRender);
    if(mRenderFront)
       glDrawBuffer(GL_FRONT);
@@ -1172,10 +1220,6 @@ void GuiCanvas::renderFrame(bool preRenderOnly, bool bufferSwap /* = true */)
    if(preRenderOnly)
       return;
 
-   // for now, just always reset the update regions - this is a
-   // fix for FSAA on ATI cards
-   resetUpdateRegions();
-
 // Moved this below object integration for performance reasons. -JDD
 //   // finish the gl render so we don't get too far ahead of ourselves
 //#if defined(TORQUE_OS_WIN32)
@@ -1198,35 +1242,95 @@ void GuiCanvas::renderFrame(bool preRenderOnly, bool bufferSwap /* = true */)
    if(!mouseCursor)
       mouseCursor = defaultCursor;
 
-   if(lastCursorON && lastCursor)
-   {
-      Point2I spot = lastCursor->getHotSpot();
-      Point2I cext = lastCursor->getExtent();
-      Point2I pos = lastCursorPt - spot;
-      addUpdateRegion(pos - Point2I(2, 2), Point2I(cext.x + 4, cext.y + 4));
-   }
-   if(cursorVisible && mouseCursor)
-   {
-      Point2I spot = mouseCursor->getHotSpot();
-      Point2I cext = mouseCursor->getExtent();
-      Point2I pos = cursorPos - spot;
-
-      addUpdateRegion(pos - Point2I(2, 2), Point2I(cext.x + 4, cext.y + 4));
-   }
+   bool showCursor = cursorON && mShowCursor;
+   bool cursorChanged = showCursor != lastCursorON || mouseCursor != lastCursor || cursorPos != lastCursorPt;
 
-	lastCursorON = cursorVisible;
+	lastCursorON = showCursor;
 	lastCursor = mouseCursor;
 	lastCursorPt = cursorPos;
 
+   // Tooltip resource
+   bool tooltipWanted = false;
+   if(bool(mMouseControl))
+   {
+      U32 curTime = Platform::getRealMilliseconds();
+      if(hoverControl == mMouseControl)
+      {
+         if(hoverPositionSet || (curTime - hoverControlStart) >= hoverControl->mTipHoverTime || (curTime - hoverLeftControlTime) <= hoverControl->mTipHoverTime)
+         {
+            if(!hoverPositionSet)
+               hoverPosition = cursorPos;
+            tooltipWanted = true;
+         }
+      }
+      else
+      {
+         if(hoverPositionSet)
+         {
+            hoverLeftControlTime = curTime;
+            hoverPositionSet = false;
+         }
+         hoverControl = mMouseControl;
+         hoverControlStart = curTime;
+      }
+   }
+   bool tooltipChanged = tooltipWanted != mTooltipWanted;
+   mTooltipWanted = tooltipWanted;
+
    RectI updateUnion;
    buildUpdateUnion(&updateUnion);
-   if (updateUnion.intersect(screenRect))
+   bool dirty = updateUnion.intersect(screenRect);
+
+   // Nothing under the cursor or tooltip changed, so the last frame is
+   // still on screen and there's no need to draw or present another.
+   if(!dirty && !cursorChanged && !tooltipChanged && !ThreadedDownloading::IsDrawingDebug())
+   {
+      mFrameRendered = false;
+      PROFILE_END();
+      return;
+   }
+   mFrameRendered = true;
+
+   // Since the back buffer can't be trusted after a swap (FSAA on ATI cards
+   // for one), the rest of the screen comes from the frame cache. Without
+   // it, anything changing means drawing everything.
+   bool useCache = smUseFrameCache && !gGLState.isDirect3D;
+   if(useCache)
+   {
+      if(!mFrameCache)
+      {
+         mFrameCache = new DynamicTexture(screenRect);
+         mFrameCacheSize = size;
+         mFrameCacheValid = false;
+      }
+      else if(mFrameCacheSize != size)
+      {
+         mFrameCache->setUpdateRect(screenRect);
+         mFrameCacheSize = size;
+         mFrameCacheValid = false;
+      }
+   }
+   else if(mFrameCache)
    {
-      //fill in with black first
-      //glClearColor(0, 0, 0, 0);
-      //glClear(GL_COLOR_BUFFER_BIT);
+      delete mFrameCache;
+      mFrameCache = NULL;
+      mFrameCacheValid = false;
+   }
+
+   bool dirtyAll = dirty && updateUnion == screenRect;
+   if(!dirtyAll && !(useCache && mFrameCacheValid && mFrameCache->restoreRegion(screenRect)))
+   {
+      updateUnion = screenRect;
+      mFrameCacheValid = false;
+   }
+
+   //fill in with black first
+   //glClearColor(0, 0, 0, 0);
+   //glClear(GL_COLOR_BUFFER_BIT);
 
-      //render the dialogs
+   //render the dialogs
+   if(updateUnion.isValidRect())
+   {
       iterator i;
       for(i = begin(); i != end(); i++)
       {
@@ -1235,59 +1339,48 @@ void GuiCanvas::renderFrame(bool preRenderOnly, bool bufferSwap /* = true */)
          glDisable( GL_CULL_FACE );
          contentCtrl->onRender(contentCtrl->getPosition(), updateUnion);
       }
+   }
 
-	  // Tooltip resource
-	  if(bool(mMouseControl))
-	  {
-         U32 curTime = Platform::getRealMilliseconds();
-         if(hoverControl == mMouseControl)
-		 {
-            if(hoverPositionSet || (curTime - hoverControlStart) >= hoverControl->mTipHoverTime || (curTime - hoverLeftControlTime) <= hoverControl->mTipHoverTime)
-			{
-               if(!hoverPositionSet)
-			   {
-                  hoverPosition = cursorPos;
-			   }
-               hoverPositionSet = mMouseControl->renderTooltip(hoverPosition);
-			}
-
-         } else
-		 {
-            if(hoverPositionSet)
-			{
-               hoverLeftControlTime = curTime;
-			   hoverPositionSet = false;
-			}
-            hoverControl = mMouseControl;
-			hoverControlStart = curTime;
-		 }
-	  }
-	  //end tooltip
-
-      dglSetClipRect(updateUnion);
-
-      //temp draw the mouse
-      if (cursorON && mShowCursor && !mouseCursor)
-      {
-         glColor4ub(255, 0, 0, 255);
-         glRecti((S32)cursorPt.x, (S32)cursorPt.y, (S32)(cursorPt.x + 2), (S32)(cursorPt.y + 2));
-      }
+   // Keep what was just drawn for the next frame, before the cursor and
+   // tooltip go over it. If everything was dirty last frame as well then
+   // something is animating full screen and the copy would only be thrown
+   // away, so skip it until things settle down.
+   if(useCache && updateUnion.isValidRect())
+   {
+      if(dirtyAll && mLastFrameDirtyAll)
+         mFrameCacheValid = false;
+      else
+         mFrameCacheValid = mFrameCache->updateRegion(updateUnion) && (mFrameCacheValid || updateUnion == screenRect);
+   }
+   mLastFrameDirtyAll = dirtyAll;
 
-      //DEBUG
-      //draw the help ctrl
-      //if (helpCtrl)
-      //{
-      //   helpCtrl->render(srf);
-      //}
+   dglSetClipRect(screenRect);
 
-      if (cursorON && mouseCursor && mShowCursor)
-      {
-         Point2I pos((S32)cursorPt.x, (S32)cursorPt.y);
-         Point2I spot = mouseCursor->getHotSpot();
+   if(tooltipWanted)
+      hoverPositionSet = mMouseControl->renderTooltip(hoverPosition);
+   //end tooltip
 
-         pos -= spot;
-         mouseCursor->render(pos);
-      }
+   //temp draw the mouse
+   if (showCursor && !mouseCursor)
+   {
+      glColor4ub(255, 0, 0, 255);
+      glRecti((S32)cursorPt.x, (S32)cursorPt.y, (S32)(cursorPt.x + 2), (S32)(cursorPt.y + 2));
+   }
+
+   //DEBUG
+   //draw the help ctrl
+   //if (helpCtrl)
+   //{
+   //   helpCtrl->render(srf);
+   //}
+
+   if (showCursor && mouseCursor)
+   {
+      Point2I pos((S32)cursorPt.x, (S32)cursorPt.y);
+      Point2I spot = mouseCursor->getHotSpot();
+
+      pos -= spot;
+      mouseCursor->render(pos);
    }
    PROFILE_END();
 
@@ -1327,30 +1420,7 @@ void GuiCanvas::swapBuffers()
 
 void GuiCanvas::buildUpdateUnion(RectI *updateUnion)
 {
-   *updateUnion = mOldUpdateRects[0];
-
-   //the update region should encompass the oldUpdateRects, and the curUpdateRect
-   Point2I upperL;
-   Point2I lowerR;
-
-   upperL.x = getMin(mOldUpdateRects[0].point.x, mOldUpdateRects[1].point.x);
-   upperL.x = getMin(upperL.x, mCurUpdateRect.point.x);
-
-   upperL.y = getMin(mOldUpdateRects[0].point.y, mOldUpdateRects[1].point.y);
-   upperL.y = getMin(upperL.y, mCurUpdateRect.point.y);
-
-   lowerR.x = getMax(mOldUpdateRects[0].point.x + mOldUpdateRects[0].extent.x, mOldUpdateRects[1].point.x + mOldUpdateRects[1].extent.x);
-   lowerR.x = getMax(lowerR.x, mCurUpdateRect.point.x + mCurUpdateRect.extent.x);
-
-   lowerR.y = getMax(mOldUpdateRects[0].point.y + mOldUpdateRects[0].extent.y, mOldUpdateRects[1].point.y + mOldUpdateRects[1].extent.y);
-   lowerR.y = getMax(lowerR.y, mCurUpdateRect.point.y + mCurUpdateRect.extent.y);
-
-   updateUnion->point = upperL;
-   updateUnion->extent = lowerR - upperL;
-
-   //shift the oldUpdateRects
-   mOldUpdateRects[0] = mOldUpdateRects[1];
-   mOldUpdateRects[1] = mCurUpdateRect;
+   *updateUnion = mCurUpdateRect;
 
    mCurUpdateRect.point.set(0,0);
    mCurUpdateRect.extent.set(0,0);
@@ -1379,9 +1449,7 @@ void GuiCanvas::addUpdateRegion(Point2I pos, Point2I ext)
 void GuiCanvas::resetUpdateRegions()
 {
    //DEBUG - get surface width and height
-   mOldUpdateRects[0].set(mBounds.point, mBounds.extent);
-   mOldUpdateRects[1] = mOldUpdateRects[0];
-   mCurUpdateRect = mOldUpdateRects[0];
+   mCurUpdateRect.set(mBounds.point, mBounds.extent);
 }
 
 void GuiCanvas::setFirstResponder( GuiControl* newResponder )
@@ -1390,5 +1458,10 @@ void GuiCanvas::setFirstResponder( GuiControl* newResponder )
 	Parent::setFirstResponder( newResponder );
 
 	if ( oldResponder && ( oldResponder != mFirstResponder ) )
+	{
 		oldResponder->onLoseFirstResponder();
+		oldResponder->setUpdate();
+	}
+	if ( mFirstResponder )
+		mFirstResponder->setUpdate();
 }
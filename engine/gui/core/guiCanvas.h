@@ -18,6 +18,9 @@
 #ifndef _PLATFORMINPUT_H_
 #include "platform/platformInput.h"
 #endif
+
+class DynamicTexture;
+
 /// A canvas on which rendering occurs.
 ///
 ///
@@ -55,6 +58,13 @@
 /// screen will be painted normally. If you are making an animated GuiControl
 /// you need to add your control to the dirty areas of the canvas.
 ///
+/// The rest of the screen comes from a copy of the last frame the canvas keeps
+/// in a DynamicTexture, since the back buffer can't be trusted after a swap.
+/// When nothing is dirty and the cursor and tooltip haven't changed, the frame
+/// isn't drawn or presented at all. Setting $pref::Video::canvasFrameCache to
+/// false does without the copy and repaints everything whenever anything is
+/// dirty.
+///
 class GuiCanvas : public GuiControl
 {
 
@@ -66,9 +76,17 @@ protected:
    /// @{
 
    ///
-   RectI      mOldUpdateRects[2];
-   RectI      mCurUpdateRect;
+   RectI      mCurUpdateRect;      ///< Union of everything dirtied since the last frame was drawn
    F32        rLastFrameTime;
+
+   DynamicTexture *mFrameCache;    ///< The controls as of the last frame drawn, without the cursor or tooltip
+   Point2I    mFrameCacheSize;     ///< Window size the frame cache was grabbed at
+   bool       mFrameCacheValid;    ///< Does the frame cache hold a whole frame?
+   bool       mLastFrameDirtyAll;  ///< Was the whole canvas dirty last frame?
+   bool       mTooltipWanted;      ///< Was a tooltip up last frame?
+   bool       mFrameRendered;      ///< Did the last renderFrame() draw and present anything?
+
+   static bool smUseFrameCache;    ///< $pref::Video::canvasFrameCache
    /// @}
 
    /// @name Cursor Properties
@@ -110,6 +128,10 @@ protected:
 
    virtual void findMouseControl(const GuiEvent &event);
    virtual void refreshMouseControl();
+
+   /// Marks the controls input is about to go to as dirty, since handling
+   /// it is likely to change how they look.
+   void setInputControlsUpdate();
    /// @}
 
    /// @name Keyboard Input
@@ -143,6 +165,8 @@ public:
    GuiCanvas();
    virtual ~GuiCanvas();
 
+   static void consoleInit();
+
    /// @name Rendering methods
    ///
    /// @{
@@ -155,6 +179,10 @@ public:
    /// Repaints the entire canvas by calling resetUpdateRegions() and then renderFrame()
    virtual void paint();
 
+   /// Did the last renderFrame() draw a frame? False if nothing had changed
+   /// and the previous frame was left on screen.
+   bool wasFrameRendered() const { return mFrameRendered; }
+
    /// Adds a dirty area to the canvas so it will be updated on the next frame
    /// @param   pos   Screen-coordinates of the upper-left hand corner of the dirty area
    /// @param   ext   Width/height of the dirty area
@@ -168,7 +196,7 @@ public:
    void maintainSizing();
 
    /// This builds a rectangle which encompasses all of the dirty regions to be
-   /// repainted
+   /// repainted, and clears them for the next frame
    /// @param   updateUnion   (out) Rectangle which surrounds all dirty areas
    virtual void buildUpdateUnion(RectI *updateUnion);
 
@@ -255,7 +255,10 @@ void GuiControl::addObject(SimObject *object)
 
    AssertFatal(!ctrl->isAwake(), "GuiControl::addObject: object is already awake before add");
    if(mAwake)
+   {
       ctrl->awaken();
+      ctrl->setUpdate();
+   }
 
   // If we are a child, notify our parent that we've been removed
   GuiControl *parent = ctrl->getParent();
@@ -269,7 +272,11 @@ void GuiControl::removeObject(SimObject *object)
 {
    AssertFatal(mAwake == static_cast<GuiControl*>(object)->isAwake(), "GuiControl::removeObject: child control wake state is bad");
    if (mAwake)
+   {
+      // mark the area it covered while it can still find the canvas
+      static_cast<GuiControl*>(object)->setUpdate();
       static_cast<GuiControl*>(object)->sleep();
+   }
 	Parent::removeObject(object);
 }
 
@@ -306,6 +313,14 @@ void GuiControl::inspectPreApply()
    }
 }
 
+void GuiControl::onStaticModified(const char* slotName)
+{
+   Parent::onStaticModified(slotName);
+
+   if(mAwake)
+      setUpdate();
+}
+
 void GuiControl::inspectPostApply()
 {
    // Shhhhhhh, you don't want to wake the canvas!
@@ -370,8 +385,11 @@ void GuiControl::resize(const Point2I &newPosition, const Point2I &newExtent)
       parent->childResized(this);
    setUpdate();
    }
-   else {
+   else if (newPosition != mBounds.point) {
+      // moving uncovers the old spot as well
+      setUpdate();
       mBounds.point = newPosition;
+      setUpdate();
    }
 }
 
@@ -778,7 +796,10 @@ void GuiControl::setControlProfile(GuiControlProfile *prof)
       mProfile->decRefCount();
    mProfile = prof;
    if(mAwake)
+   {
       mProfile->incRefCount();
+      setUpdate();
+   }
 
 }
 
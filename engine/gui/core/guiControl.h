@@ -615,6 +615,9 @@ public:
 
     void inspectPostApply();
     void inspectPreApply();
+
+    /// Repaints the control when script changes one of its fields
+    void onStaticModified(const char* slotName);
 };
 
 #endif
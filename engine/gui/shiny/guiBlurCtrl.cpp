@@ -14,6 +14,7 @@ GuiBlurCtrl::GuiBlurCtrl()
 	mBlurBuffer     = NULL;
 	mTextureObject  = NULL;
 	mPassedOnce     = false;
+	mBlurPending    = false;
 }
 
 void GuiBlurCtrl::initPersistFields()
@@ -27,11 +28,10 @@ void GuiBlurCtrl::initPersistFields()
 
 void GuiBlurCtrl::onPreRender()
 {
-	if (!mPassedOnce)
-		return;
-
-	if (mTextureObject.isValid() && Sim::getCurrentTime() - mLastUpdateTime < 2000)
-		return;
+	// The canvas only redraws dirty regions, so ask for the first pass, and
+	// for a blur that was put off because it came too soon after the last.
+	if (!mPassedOnce || (mBlurPending && Sim::getCurrentTime() - mLastUpdateTime >= 64))
+		setUpdate();
 }
 
 void GuiBlurCtrl::onRender(Point2I offset, const RectI& updateRect)
@@ -42,8 +42,21 @@ void GuiBlurCtrl::onRender(Point2I offset, const RectI& updateRect)
 		return;
 	}
 
-	if (mBlurAmount != 0 && mPassedOnce && (!mTextureObject.isValid() || Sim::getCurrentTime() - mLastUpdateTime >= 64))
+	// We're only drawn when the canvas redrew something under us, so that's
+	// when the blur is out of date. The pixels are read back, so all of the
+	// control has to have been redrawn, otherwise ask for that next frame.
+	bool wholeControl = updateRect.point == offset && updateRect.extent == mBounds.extent;
+	bool blurDue = !mTextureObject.isValid() || Sim::getCurrentTime() - mLastUpdateTime >= 64;
+	if (mBlurAmount != 0 && (!wholeControl || !blurDue))
+	{
+		mBlurPending = true;
+		if (!wholeControl)
+			setUpdate();
+	}
+
+	if (mBlurAmount != 0 && wholeControl && blurDue)
 	{
+		mBlurPending = false;
 		mLastUpdateTime = Sim::getCurrentTime();
 		Point2I extent(mBounds.extent);
 		RectI BlurRect(0, 0, extent.x, extent.y);
@@ -17,6 +17,7 @@ private:
 	GBitmap* mBlurBitmap;
 	Point2I mLastPassPos;
 	bool mPassedOnce;
+	bool mBlurPending;	///< Something under us was redrawn since the last blur.
 	S32 mBlurAmount;
 	U32 mLastUpdateTime;
 	U32 mBlurBufferSize;
@@ -80,7 +80,7 @@ GuiEffectCanvas::~GuiEffectCanvas()
 void GuiEffectCanvas::renderFrame( bool preRenderOnly, bool bufferSwap /* = true */ )
 {
    // With this canvas, always re-draw the whole thing if an effect is in progress
-   if( mEffectInProgress )
+   if( mEffectInProgress || mStartEffect || mVisualizeField )
    {
       resetUpdateRegions();
    }
@@ -95,6 +95,10 @@ void GuiEffectCanvas::renderFrame( bool preRenderOnly, bool bufferSwap /* = true
       mLastSize = Platform::getWindowSize();
    }
 
+   // Nothing changed, so the last frame is still up
+   if( !preRenderOnly && !wasFrameRendered() )
+      return;
+
    // Check to see if the effect should be started
    if( mStartEffect )
    {
@@ -90,6 +90,14 @@ void GuiTheoraCtrl::onSleep()
       stop();
 }
 
+//----------------------------------------------------------------------------
+void GuiTheoraCtrl::onPreRender()
+{
+   // Redraw every frame while playing, and once more when playback ends.
+   if(mTheoraTexture.isReady() && (mTheoraTexture.isPlaying() || !mDone))
+      setUpdate();
+}
+
 //----------------------------------------------------------------------------
 void GuiTheoraCtrl::onRender(Point2I offset, const RectI &updateRect)
 {
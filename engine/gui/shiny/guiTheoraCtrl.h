@@ -43,6 +43,7 @@ class GuiTheoraCtrl : public GuiControl
 
    bool onWake();
    void onSleep();
+   void onPreRender();
    void onRender(Point2I offset, const RectI &updateRect);
 
    F32 getCurrentTime()
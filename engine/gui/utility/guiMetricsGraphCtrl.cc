@@ -0,0 +1,172 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "console/console.h"
+#include "console/consoleTypes.h"
+#include "dgl/dgl.h"
+#include "platform/metrics.h"
+
+#include "gui/utility/guiMetricsGraphCtrl.h"
+
+IMPLEMENT_CONOBJECT(GuiMetricsGraphCtrl);
+
+static const ColorI sBreakdownColors[] =
+{
+   ColorI( 80, 160, 255, 160),
+   ColorI(255, 160,  60, 160),
+   ColorI(120, 220, 120, 160),
+   ColorI(220, 100, 220, 160),
+   ColorI( 60, 220, 220, 160),
+   ColorI(220, 220,  80, 160),
+   ColorI(160, 120,  80, 160),
+   ColorI(160, 160, 160, 160),
+};
+
+static const F32    sPercentiles[]      = { 50, 95, 99 };
+static const ColorI sPercentileColors[] =
+{
+   ColorI(  0, 255,   0, 255),
+   ColorI(255, 255,   0, 255),
+   ColorI(255,   0,   0, 255),
+};
+
+GuiMetricsGraphCtrl::GuiMetricsGraphCtrl()
+{
+   mMetricName        = StringTable->insert("frame.ms");
+   mBreakdownNames    = StringTable->insert("");
+   mMaxValue          = 0;
+
+   mResolvedMetric    = NULL;
+   mResolvedBreakdown = NULL;
+   mMetric            = NULL;
+   mBreakdownCount    = 0;
+}
+
+void GuiMetricsGraphCtrl::initPersistFields()
+{
+   Parent::initPersistFields();
+   addGroup("Metrics");
+   addField("metric",    TypeString, Offset(mMetricName,     GuiMetricsGraphCtrl));
+   addField("breakdown", TypeString, Offset(mBreakdownNames, GuiMetricsGraphCtrl));
+   addField("maxValue",  TypeF32,    Offset(mMaxValue,       GuiMetricsGraphCtrl));
+   endGroup("Metrics");
+}
+
+void GuiMetricsGraphCtrl::resolveMetrics()
+{
+   if(mResolvedMetric != mMetricName)
+   {
+      mMetric = Metric::find(mMetricName);
+      mResolvedMetric = mMetricName;
+   }
+
+   if(mResolvedBreakdown != mBreakdownNames)
+   {
+      mBreakdownCount = 0;
+
+      char buffer[256];
+      dStrncpy(buffer, mBreakdownNames, sizeof(buffer) - 1);
+      buffer[sizeof(buffer) - 1] = 0;
+
+      for(char *name = dStrtok(buffer, " \t"); name && mBreakdownCount < MaxBreakdown; name = dStrtok(NULL, " \t"))
+      {
+         Metric *metric = Metric::find(name);
+         if(metric)
+            mBreakdown[mBreakdownCount++] = metric;
+         else
+            Con::warnf("GuiMetricsGraphCtrl - no metric named '%s'.", name);
+      }
+      mResolvedBreakdown = mBreakdownNames;
+   }
+}
+
+void GuiMetricsGraphCtrl::onPreRender()
+{
+   // A new frame of data every frame.
+   setUpdate();
+}
+
+void GuiMetricsGraphCtrl::onRender(Point2I offset, const RectI &updateRect)
+{
+   resolveMetrics();
+
+   RectI ctrlRect(offset, mBounds.extent);
+   if(mProfile->mOpaque)
+      dglDrawRectFill(ctrlRect, mProfile->mFillColor);
+
+   if(mMetric)
+   {
+      F32 pct[3];
+      mMetric->getPercentiles(sPercentiles, pct, 3);
+
+      // Leave some headroom over the 99th so a spike doesn't flatten the rest.
+      F32 top = mMaxValue > 0 ? mMaxValue : getMax(pct[2] * 1.25f, 1.0f);
+      F32 scale = mBounds.extent.y / top;
+      S32 bottom = offset.y + mBounds.extent.y - 1;
+
+      U32 frames = getMin(U32(mBounds.extent.x), mMetric->getHistorySize());
+      S32 lastY = 0;
+      for(U32 i = 0; i < frames; i++)
+      {
+         S32 x = offset.x + mBounds.extent.x - 1 - i;
+
+         // Stack the breakdown up from the bottom.
+         F32 stacked = 0;
+         for(U32 j = 0; j < mBreakdownCount; j++)
+         {
+            F32 value = mBreakdown[j]->getFrameValue(i);
+            if(value <= 0)
+               continue;
+            S32 y0 = bottom - S32(getMin(stacked, top) * scale);
+            stacked += value;
+            S32 y1 = bottom - S32(getMin(stacked, top) * scale);
+            if(y1 < y0)
+               dglDrawLine(x, y0, x, y1, sBreakdownColors[j]);
+         }
+
+         S32 y = bottom - S32(getMin(mMetric->getFrameValue(i), top) * scale);
+         if(i)
+            dglDrawLine(x + 1, lastY, x, y, mProfile->mFontColor);
+         lastY = y;
+      }
+
+      for(U32 i = 0; i < 3; i++)
+      {
+         if(pct[i] > top)
+            continue;
+         S32 y = bottom - S32(pct[i] * scale);
+         dglDrawLine(offset.x, y, offset.x + mBounds.extent.x - 1, y, sPercentileColors[i]);
+      }
+
+      // Numbers along the top, then the breakdown legend.
+      if(bool(mProfile->mFont))
+      {
+         char buffer[256];
+         Point2I pos(offset.x + 2, offset.y + 1);
+         S32 lineHeight = mProfile->mFont->getHeight();
+
+         dSprintf(buffer, sizeof(buffer), "%s %.2f  p50 %.2f  p95 %.2f  p99 %.2f",
+            mMetric->getName(), mMetric->getFrameValue(0), pct[0], pct[1], pct[2]);
+         dglSetBitmapModulation(mProfile->mFontColor);
+         dglDrawText(mProfile->mFont, pos, buffer);
+
+         for(U32 j = 0; j < mBreakdownCount; j++)
+         {
+            pos.y += lineHeight;
+            dSprintf(buffer, sizeof(buffer), "%s %.2f", mBreakdown[j]->getName(), mBreakdown[j]->getFrameValue(0));
+            ColorI color = sBreakdownColors[j];
+            color.alpha = 255;
+            dglSetBitmapModulation(color);
+            dglDrawText(mProfile->mFont, pos, buffer);
+         }
+         dglClearBitmapModulation();
+      }
+   }
+
+   if(mProfile->mBorder)
+      dglDrawRect(ctrlRect, mProfile->mBorderColor);
+
+   renderChildControls(offset, updateRect);
+}
@@ -0,0 +1,64 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _GUIMETRICSGRAPHCTRL_H_
+#define _GUIMETRICSGRAPHCTRL_H_
+
+#ifndef _GUICONTROL_H_
+#include "gui/core/guiControl.h"
+#endif
+
+class Metric;
+
+/// Graphs the recent history of a metric (frame time by default), one
+/// pixel column per frame, with its 50th, 95th and 99th percentiles drawn
+/// across the graph and printed above it.
+///
+/// The breakdown field names further timer metrics, separated by spaces,
+/// which are stacked up under the graph so you can see which subsystem a
+/// spike came from:
+///
+/// @code
+/// new GuiMetricsGraphCtrl(FrameGraph) {
+///    profile = "GuiDefaultProfile";
+///    extent = "300 120";
+///    metric = "frame.ms";
+///    breakdown = "canvas.render script.exec net.process texture.upload";
+/// };
+/// @endcode
+class GuiMetricsGraphCtrl : public GuiControl
+{
+private:
+   typedef GuiControl Parent;
+
+   enum
+   {
+      MaxBreakdown = 8,
+   };
+
+   StringTableEntry mMetricName;
+   StringTableEntry mBreakdownNames;
+   F32              mMaxValue;          ///< Top of the graph, or 0 to scale to fit.
+
+   /// Metrics resolved from the names above.
+   StringTableEntry mResolvedMetric;
+   StringTableEntry mResolvedBreakdown;
+   Metric          *mMetric;
+   Metric          *mBreakdown[MaxBreakdown];
+   U32              mBreakdownCount;
+
+   void resolveMetrics();
+
+public:
+   DECLARE_CONOBJECT(GuiMetricsGraphCtrl);
+   GuiMetricsGraphCtrl();
+
+   static void initPersistFields();
+
+   void onPreRender();
+   void onRender(Point2I offset, const RectI &updateRect);
+};
+
+#endif // _GUIMETRICSGRAPHCTRL_H_
@@ -112,8 +112,9 @@ struct ConnectedAcceptEvent : public Event
 struct PacketReceiveEvent : public Event
 {
    NetAddress sourceAddress;   ///< Originating address.
+   U32 arrivalTime;            ///< Virtual milliseconds when it arrived, or 0 for now.
    U8 data[MaxPacketDataSize]; ///< Payload
-   PacketReceiveEvent() { type = PacketReceiveEventType; }
+   PacketReceiveEvent() { type = PacketReceiveEventType; arrivalTime = 0; }
 };
 
 /// Represents a line of console input.
@@ -168,6 +168,9 @@ void GameInterface::postEvent(Event &event)
    eventQueue->push_back(copy);
    
    Mutex::unlockMutex(gGameEventQueueMutex);   
+
+   if(!Con::isMainThread())
+      Platform::wakeMainLoop();
 }
 
 void GameInterface::processEvents()
@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "platform/metrics.h"
+#include "core/fileStream.h"
+#include "math/mMathFn.h"
+#include "console/console.h"
+
+Metric *Metric::smList = NULL;
+U64     Metric::smLastFrameTime = 0;
+U32     Metric::smFrameCount = 0;
+
+static Metric sFrameTime("frame.ms", Metric::Timer);
+
+//------------------------------------------------------------------------------
+
+Metric::Metric(const char *name, Type type)
+{
+   for(Metric *walk = smList; walk; walk = walk->mNext)
+      AssertISV(dStrcmp(walk->mName, name), avar("Metric::Metric - duplicate metric name '%s'.", name));
+
+   mName       = name;
+   mType       = type;
+   mAccum      = 0;
+   mGaugeValue = 0;
+   mFrames     = 0;
+
+   mNext  = smList;
+   smList = this;
+}
+
+void Metric::recordFrame()
+{
+   F32 value;
+   if(mType == Gauge)
+      value = mGaugeValue;
+   else
+   {
+      // Take what was gathered, leaving anything added since.
+      U32 accum = dAtomicRead(mAccum);
+      if(accum)
+         dFetchAndAdd(mAccum, U32(-S32(accum)));
+      value = (mType == Timer) ? accum / 1000.0f : F32(accum);
+   }
+
+   mHistory[mFrames % HistoryLength] = value;
+   mFrames++;
+}
+
+void Metric::endFrame()
+{
+   U64 now = Platform::getRealMicroseconds();
+   if(smLastFrameTime)
+      sFrameTime.addTime(U32(now - smLastFrameTime));
+   smLastFrameTime = now;
+   smFrameCount++;
+
+   for(Metric *walk = smList; walk; walk = walk->mNext)
+      walk->recordFrame();
+}
+
+void Metric::reset()
+{
+   for(Metric *walk = smList; walk; walk = walk->mNext)
+   {
+      // Throw away the frame in progress too.
+      U32 accum = dAtomicRead(walk->mAccum);
+      if(accum)
+         dFetchAndAdd(walk->mAccum, U32(-S32(accum)));
+      walk->mFrames = 0;
+   }
+   smLastFrameTime = 0;
+}
+
+Metric *Metric::find(const char *name)
+{
+   for(Metric *walk = smList; walk; walk = walk->mNext)
+      if(!dStricmp(walk->mName, name))
+         return walk;
+   return NULL;
+}
+
+//------------------------------------------------------------------------------
+
+F32 Metric::getFrameValue(U32 framesAgo) const
+{
+   if(framesAgo >= getHistorySize())
+      return 0;
+   return mHistory[(mFrames - 1 - framesAgo) % HistoryLength];
+}
+
+U32 Metric::copyHistory(F32 *out) const
+{
+   U32 count = getHistorySize();
+   for(U32 i = 0; i < count; i++)
+      out[i] = getFrameValue(i);
+   return count;
+}
+
+F32 Metric::getMeanValue() const
+{
+   U32 count = getHistorySize();
+   if(!count)
+      return 0;
+
+   F64 total = 0;
+   for(U32 i = 0; i < count; i++)
+      total += mHistory[i];
+   return F32(total / count);
+}
+
+F32 Metric::getMinValue() const
+{
+   U32 count = getHistorySize();
+   if(!count)
+      return 0;
+
+   F32 low = mHistory[0];
+   for(U32 i = 1; i < count; i++)
+      low = getMin(low, mHistory[i]);
+   return low;
+}
+
+F32 Metric::getMaxValue() const
+{
+   U32 count = getHistorySize();
+   if(!count)
+      return 0;
+
+   F32 high = mHistory[0];
+   for(U32 i = 1; i < count; i++)
+      high = getMax(high, mHistory[i]);
+   return high;
+}
+
+static S32 QSORT_CALLBACK compareF32(const void *a, const void *b)
+{
+   F32 fa = *(const F32 *)a;
+   F32 fb = *(const F32 *)b;
+   return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+void Metric::getPercentiles(const F32 *pcts, F32 *out, U32 count) const
+{
+   F32 sorted[HistoryLength];
+   U32 size = copyHistory(sorted);
+   if(!size)
+   {
+      for(U32 i = 0; i < count; i++)
+         out[i] = 0;
+      return;
+   }
+
+   dQsort(sorted, size, sizeof(F32), compareF32);
+
+   // Nearest rank.
+   for(U32 i = 0; i < count; i++)
+   {
+      F32 rank = mClampF(pcts[i], 0, 100) / 100.0f * (size - 1);
+      out[i] = sorted[U32(rank + 0.5f)];
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool Metric::dumpCSV(const char *fileName)
+{
+   FileStream stream;
+   if(!stream.open(fileName, FileStream::Write))
+   {
+      Con::errorf("Metric::dumpCSV - unable to open '%s'.", fileName);
+      return false;
+   }
+
+   static const char *typeNames[] = { "counter", "gauge", "timer" };
+   static const F32 pcts[] = { 50, 95, 99 };
+
+   char buffer[512];
+   dStrcpy(buffer, "name,type,frames,last,mean,min,max,p50,p95,p99\r\n");
+   stream.write(dStrlen(buffer), buffer);
+
+   for(Metric *walk = smList; walk; walk = walk->mNext)
+   {
+      F32 p[3];
+      walk->getPercentiles(pcts, p, 3);
+      dSprintf(buffer, sizeof(buffer), "%s,%s,%d,%g,%g,%g,%g,%g,%g,%g\r\n",
+         walk->mName, typeNames[walk->mType], walk->getHistorySize(),
+         walk->getFrameValue(0), walk->getMeanValue(), walk->getMinValue(), walk->getMaxValue(),
+         p[0], p[1], p[2]);
+      stream.write(dStrlen(buffer), buffer);
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+ConsoleFunction(metricsDump, bool, 2, 2, "(string fileName) - Write the statistics of every metric to a CSV file.")
+{
+   return Metric::dumpCSV(argv[1]);
+}
+
+ConsoleFunction(metricsReset, void, 1, 1, "() - Forget the history of every metric.")
+{
+   Metric::reset();
+}
+
+ConsoleFunction(metricsGet, F32, 3, 3, "(string name, string stat) - Get a statistic of a metric. "
+                "stat is one of last, mean, min, max, or a percentile such as 95.")
+{
+   Metric *metric = Metric::find(argv[1]);
+   if(!metric)
+   {
+      Con::errorf("metricsGet - no metric named '%s'.", argv[1]);
+      return 0;
+   }
+
+   const char *stat = argv[2];
+   if(!dStricmp(stat, "last"))
+      return metric->getFrameValue(0);
+   if(!dStricmp(stat, "mean"))
+      return metric->getMeanValue();
+   if(!dStricmp(stat, "min"))
+      return metric->getMinValue();
+   if(!dStricmp(stat, "max"))
+      return metric->getMaxValue();
+
+   F32 pct = dAtof(stat), value;
+   metric->getPercentiles(&pct, &value, 1);
+   return value;
+}
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _PLATFORMINTRINSICS_H_
+#include "platform/platformIntrinsics.h"
+#endif
+
+/// A named, always-on measurement that subsystems publish into and the
+/// metrics graph and metricsDump() read back.
+///
+/// Metrics are declared as statics next to the code they measure, much like
+/// PROFILE_START blocks, and register themselves on a global list:
+///
+/// @code
+/// static Metric sPacketsIn("net.packetsIn", Metric::Counter);
+/// static Metric sRender("canvas.render", Metric::Timer);
+///
+/// sPacketsIn.add();
+/// {
+///    MetricScope scope(sRender);
+///    // ...
+/// }
+/// @endcode
+///
+/// Once a frame, Metric::endFrame() turns what was gathered into one value
+/// per metric and keeps the last HistoryLength of them, which is what the
+/// statistics and percentiles are computed from:
+///   - Counter: how many times add() counted during the frame.
+///   - Gauge:   the last value given to set().
+///   - Timer:   milliseconds spent in MetricScopes during the frame.
+///
+/// Counters and timers may be fed from any thread; everything else belongs
+/// to the main thread.
+class Metric
+{
+public:
+   enum Type
+   {
+      Counter,
+      Gauge,
+      Timer,
+   };
+
+   enum
+   {
+      HistoryLength = 512,   ///< Frames of history kept per metric.
+   };
+
+private:
+   const char *mName;
+   Type        mType;
+   Metric     *mNext;
+
+   /// Counts or microseconds for the frame in progress.
+   volatile U32 mAccum;
+   F32          mGaugeValue;
+
+   F32 mHistory[HistoryLength];
+   U32 mFrames;              ///< Frames recorded since the last reset.
+
+   static Metric *smList;
+   static U64     smLastFrameTime;
+   static U32     smFrameCount;
+
+   void recordFrame();
+   U32  copyHistory(F32 *out) const;
+
+public:
+   Metric(const char *name, Type type);
+
+   const char *getName() const { return mName; }
+   Type        getType() const { return mType; }
+   Metric     *getNext() const { return mNext; }
+
+   /// @name Publishing
+   /// @{
+
+   void add(U32 count = 1)     { dFetchAndAdd(mAccum, count); }
+   void set(F32 value)         { mGaugeValue = value; }
+   void addTime(U32 micros)    { dFetchAndAdd(mAccum, micros); }
+
+   /// @}
+
+   /// @name Reading
+   /// @{
+
+   /// Frames of history available, at most HistoryLength.
+   U32 getHistorySize() const  { return getMin(mFrames, U32(HistoryLength)); }
+
+   /// Value for a past frame, 0 being the last completed one.
+   F32 getFrameValue(U32 framesAgo) const;
+
+   F32 getMeanValue() const;
+   F32 getMinValue() const;
+   F32 getMaxValue() const;
+
+   /// Fill out[i] with the pcts[i]'th percentile (0-100) of the history.
+   void getPercentiles(const F32 *pcts, F32 *out, U32 count) const;
+
+   /// @}
+
+   static Metric *getList() { return smList; }
+   static U32     getFrameCount() { return smFrameCount; }
+   static Metric *find(const char *name);
+
+   /// Close out the current frame for every metric. Called by the main
+   /// loop once per pass, so dedicated servers get frames too.
+   static void endFrame();
+
+   /// Forget all history.
+   static void reset();
+
+   /// Write one line of statistics per metric to a CSV file.
+   static bool dumpCSV(const char *fileName);
+};
+
+/// Adds the time until it goes out of scope to a Timer metric.
+class MetricScope
+{
+   Metric &mMetric;
+   U64     mStart;
+
+public:
+   MetricScope(Metric &metric) : mMetric(metric)
+   {
+      mStart = Platform::getRealMicroseconds();
+   }
+   ~MetricScope()
+   {
+      mMetric.addTime(U32(Platform::getRealMicroseconds() - mStart));
+   }
+};
+
+#endif // _METRICS_H_
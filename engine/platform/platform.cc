@@ -5,11 +5,15 @@
 
 S32 sgBackgroundSleepTime = 10;
 S32 sgTimeManagerProcessInterval = 0;
+bool gNetBatchIO = true;
+bool gNetIOThread = false;
 
 void Platform::initConsole()
 {
    //Con::addVariable("pref::backgroundSleepTime", TypeS32, &sgBackgroundSleepTime);
    Con::addVariable("pref::timeManagerProcessInterval", TypeS32, &sgTimeManagerProcessInterval);
+   Con::addVariable("pref::Net::BatchIO", TypeBool, &gNetBatchIO);
+   Con::addVariable("pref::Net::IOThread", TypeBool, &gNetIOThread);
 }
 
 S32 Platform::getBackgroundSleepTime()
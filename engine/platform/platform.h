@@ -289,6 +289,14 @@ struct Platform
    static void initConsole();
    static void shutdown();
    static void process();
+
+   /// Block the main loop until there is something for it to do: OS input,
+   /// a packet on the game port or a call to wakeMainLoop(). Returns early
+   /// on any of those, otherwise after timeout milliseconds.
+   static void waitForEvents(U32 timeout);
+
+   /// Wake the main loop out of waitForEvents(). Safe to call from any thread.
+   static void wakeMainLoop();
    static bool doCDCheck();
    static void initWindow(const Point2I &initialSize, const char *name);
    static char* getWindowTitle( char* pBuffer, int iMaxSize );
@@ -344,6 +352,9 @@ public:
    static U32  getTime();
    static U32  getVirtualMilliseconds();
    static U32  getRealMilliseconds();
+   /// Fine grained real time, for measuring things shorter than a frame.
+   /// Only differences between readings are meaningful.
+   static U64  getRealMicroseconds();
    static void advanceTime(U32 delta);
 
    static S32 getBackgroundSleepTime();
@@ -362,6 +373,13 @@ public:
    static bool isDirectory(const char *pDirPath);
    static bool isSubDirectory(const char *pParent, const char *pDir);
 
+   /// Map a file read-only into the address space.  Returns the base address
+   /// and fills in the size and an opaque handle to pass to unmapFile(), or
+   /// NULL if the file could not be mapped (missing, empty, out of address
+   /// space...), in which case the caller should fall back to a FileStream.
+   static const void* mapFile(const char *pFilePath, U32 &size, void *&handle);
+   static void unmapFile(const void *base, U32 size, void *handle);
+
    static void addExcludedDirectory(const char *pDir);
    static void clearExcludedDirectories();
    static bool isExcludedDirectory(const char *pDir);
@@ -389,6 +407,7 @@ public:
          const char *name;
          U32         mhz;
          U32         properties;      // CPU type specific enum
+         U32         numCores;        // logical processors available to the process
       } processor;
    } SystemInfo;
 
@@ -702,6 +721,12 @@ struct Net
    static void closePort();
    static Error sendto(const NetAddress *address, const U8 *buffer, S32 bufferSize);
 
+   // Packets sent between these go out together when the outermost
+   // endSendBatch() is reached, in as few system calls as the platform
+   // allows. Errors from batched sends aren't reported.
+   static void beginSendBatch();
+   static void endSendBatch();
+
    // Reliable net functions (TCP)
    // all incoming messages come in on the Connected* events
    static NetSocket openListenPort(U16 port);
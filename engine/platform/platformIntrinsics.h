@@ -0,0 +1,73 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _PLATFORMINTRINSICS_H_
+#define _PLATFORMINTRINSICS_H_
+
+#ifndef _TORQUE_TYPES_H_
+#include "platform/types.h"
+#endif
+
+/// @file
+/// Atomic operations on 32 bit values, for the few places that need to share
+/// data between threads without taking a Mutex. All of them are full memory
+/// barriers.
+
+#if defined(TORQUE_COMPILER_VISUALC)
+
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange)
+#pragma intrinsic(_InterlockedExchangeAdd)
+#pragma intrinsic(_InterlockedExchange)
+
+/// Atomically replace ref with newVal if it still equals oldVal.
+/// @return true if the swap happened.
+inline bool dCompareAndSwap(volatile U32 &ref, U32 oldVal, U32 newVal)
+{
+   return (U32)_InterlockedCompareExchange((volatile long *)&ref, (long)newVal, (long)oldVal) == oldVal;
+}
+
+/// Atomically add to ref, returning the value it had before.
+inline U32 dFetchAndAdd(volatile U32 &ref, U32 val)
+{
+   return (U32)_InterlockedExchangeAdd((volatile long *)&ref, (long)val);
+}
+
+/// Atomically store val into ref (a full barrier, unlike a plain store).
+inline void dAtomicWrite(volatile U32 &ref, U32 val)
+{
+   _InterlockedExchange((volatile long *)&ref, (long)val);
+}
+
+#elif defined(TORQUE_COMPILER_GCC)
+
+inline bool dCompareAndSwap(volatile U32 &ref, U32 oldVal, U32 newVal)
+{
+   return __sync_bool_compare_and_swap(&ref, oldVal, newVal);
+}
+
+inline U32 dFetchAndAdd(volatile U32 &ref, U32 val)
+{
+   return __sync_fetch_and_add(&ref, val);
+}
+
+inline void dAtomicWrite(volatile U32 &ref, U32 val)
+{
+   __sync_synchronize();
+   ref = val;
+   __sync_synchronize();
+}
+
+#else
+#  error "platformIntrinsics.h: no atomic operations for this compiler."
+#endif
+
+/// Read a value another thread writes with the functions above.
+inline U32 dAtomicRead(volatile U32 &ref)
+{
+   return dFetchAndAdd(ref, 0);
+}
+
+#endif // _PLATFORMINTRINSICS_H_
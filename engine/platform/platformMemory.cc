@@ -8,6 +8,7 @@
 #include "console/console.h"
 #include "platform/profiler.h"
 #include "platform/platformMutex.h"
+#include "platform/metrics.h"
 
 
 #ifdef TORQUE_MULTITHREAD
@@ -23,10 +24,16 @@ enum MemConstants {
    Allocated            = BIT(0),
    Array                = BIT(1),
    FlaggityFlag         = BIT(2),
+   Sampled              = BIT(3),       ///< Counted by the allocation profiler.
+   SiteShift            = 16,           ///< Profiler call site index, in the top of the flags.
+   SiteMask             = 0xFFFF0000,
    AllocatedGuard       = 0xCEDEFEDE,
    FreeGuard            = 0x5555FFFF,
    MaxAllocationAmount  = 0xFFFFFFFF,
    TreeNodeAllocCount   = 2048,
+   MaxAllocSites        = 8192,
+   AllocSiteHashSize    = 16384,
+   MaxAllocSnapshots    = 4,
 };
 
 enum RedBlackTokens {
@@ -932,6 +939,420 @@ static void checkUnusedAlloc(FreeHeader *header, U32 size)
 static bool gReentrantGuard = false;
 #endif
 
+//---------------------------------------------------------------------------
+// Allocation profiler
+//
+// When enabled, every Nth allocation is sampled: its block is flagged as
+// Sampled and the index of its call site (the file and line handed to new
+// and dMalloc) goes in the top bits of the header flags. That costs nothing
+// per block, and free() only has to look at the flags to know whether the
+// block counted. Every figure reported is scaled back up by the sample rate.
+//
+// Building with TORQUE_DEBUG_GUARD lets Vectors pass their owner's file and
+// line (VECTOR_SET_ASSOCIATION); otherwise they all show up as tVector.cc.
+
+struct AllocSite
+{
+   const char *fileName;
+   U32 line;
+
+   U32 liveCount;          ///< Sampled blocks still allocated.
+   U32 liveBytes;
+   U32 totalCount;         ///< Sampled since the last reset.
+   U32 totalBytes;
+   U32 intervalCount;      ///< Sampled since the last top report.
+   U32 intervalBytes;
+};
+
+struct AllocSnapshot
+{
+   bool valid;
+   U32  siteCount;
+   U32  liveCount[MaxAllocSites];
+   U32  liveBytes[MaxAllocSites];
+};
+
+static bool           gProfiling = false;
+static U32            gSampleRate = 1;
+static U32            gSampleCountdown = 0;
+static AllocSite     *gSites = NULL;        ///< Index 0 is unused, it means "not sampled".
+static U32            gSiteCount = 1;
+static U16           *gSiteHash = NULL;
+static AllocSnapshot *gSnapshots = NULL;
+static U32            gNextSnapshot = 0;
+
+static U32 gProfileAllocs = 0;         ///< Every allocation, sampled or not.
+static bool gProfileMoving = false;    ///< realloc() is moving a block, it isn't a new allocation.
+static U32 gProfileFrees = 0;
+static U32 gIntervalAllocs = 0;
+static U32 gIntervalFrees = 0;
+static U32 gIntervalStartFrame = 0;
+static U32 gIntervalStartTime = 0;
+
+static U32 findAllocSite(const char *fileName, U32 line)
+{
+   U32 hash = (U32(dsize_t(fileName)) >> 2) * 31 + line;
+   U32 mask = AllocSiteHashSize - 1;
+   for(U32 i = hash & mask; ; i = (i + 1) & mask)
+   {
+      U32 index = gSiteHash[i];
+      if(!index)
+      {
+         // Out of room, lump the rest together in the last site.
+         if(gSiteCount == MaxAllocSites - 1)
+         {
+            dMemset(&gSites[gSiteCount], 0, sizeof(AllocSite));
+            gSites[gSiteCount].fileName = "(other sites)";
+            gSiteCount = MaxAllocSites;
+         }
+         if(gSiteCount == MaxAllocSites)
+            return MaxAllocSites - 1;
+
+         index = gSiteCount++;
+         dMemset(&gSites[index], 0, sizeof(AllocSite));
+         gSites[index].fileName = fileName;
+         gSites[index].line = line;
+         gSiteHash[i] = index;
+         return index;
+      }
+      if(gSites[index].fileName == fileName && gSites[index].line == line)
+         return index;
+   }
+}
+
+static void profileTrack(AllocatedHeader *hdr, U32 site, bool newAlloc)
+{
+   hdr->flags = (hdr->flags & ~SiteMask) | Sampled | (site << SiteShift);
+
+   AllocSite &s = gSites[site];
+   s.liveCount++;
+   s.liveBytes += hdr->size;
+   if(newAlloc)
+   {
+      s.totalCount++;
+      s.totalBytes += hdr->size;
+      s.intervalCount++;
+      s.intervalBytes += hdr->size;
+   }
+}
+
+static void profileUntrack(AllocatedHeader *hdr)
+{
+   AllocSite &s = gSites[(hdr->flags & SiteMask) >> SiteShift];
+   s.liveCount--;
+   s.liveBytes -= hdr->size;
+   hdr->flags &= ~(Sampled | SiteMask);
+}
+
+static void profileAlloc(AllocatedHeader *hdr, const char *fileName, U32 line)
+{
+   gProfileAllocs++;
+   gIntervalAllocs++;
+
+   if(gProfileMoving)
+      return;
+
+   if(gSampleCountdown)
+   {
+      gSampleCountdown--;
+      return;
+   }
+   gSampleCountdown = gSampleRate - 1;
+
+   if(!fileName)
+      fileName = "(untagged)";
+   profileTrack(hdr, findAllocSite(fileName, line), true);
+}
+
+static void enableProfiler(bool enable, U32 sampleRate)
+{
+   if(enable && !gSites)
+   {
+      gSites = (AllocSite *) dRealMalloc(sizeof(AllocSite) * MaxAllocSites);
+      gSiteHash = (U16 *) dRealMalloc(sizeof(U16) * AllocSiteHashSize);
+      gSnapshots = (AllocSnapshot *) dRealMalloc(sizeof(AllocSnapshot) * MaxAllocSnapshots);
+      dMemset(gSiteHash, 0, sizeof(U16) * AllocSiteHashSize);
+      dMemset(gSites, 0, sizeof(AllocSite));
+      for(U32 i = 0; i < MaxAllocSnapshots; i++)
+         gSnapshots[i].valid = false;
+   }
+
+   gProfiling = enable;
+   gSampleRate = getMax(sampleRate, U32(1));
+   gSampleCountdown = 0;
+   gIntervalStartFrame = Metric::getFrameCount();
+   gIntervalStartTime = Platform::getRealMilliseconds();
+}
+
+/// Copy the sites out, so they can be sorted and printed without holding
+/// the allocator lock.
+static U32 copySites(AllocSite *out)
+{
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::lockMutex(gMemMutex);
+#endif
+   U32 count = gSiteCount;
+   dMemcpy(out, gSites, sizeof(AllocSite) * count);
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::unlockMutex(gMemMutex);
+#endif
+   return count;
+}
+
+static S32 QSORT_CALLBACK compareIntervalBytes(const void *a, const void *b)
+{
+   const AllocSite *sa = (const AllocSite *) a;
+   const AllocSite *sb = (const AllocSite *) b;
+   if(sa->intervalBytes != sb->intervalBytes)
+      return sa->intervalBytes < sb->intervalBytes ? 1 : -1;
+   return S32(sb->intervalCount) - S32(sa->intervalCount);
+}
+
+static S32 QSORT_CALLBACK compareLiveBytes(const void *a, const void *b)
+{
+   const AllocSite *sa = (const AllocSite *) a;
+   const AllocSite *sb = (const AllocSite *) b;
+   return sa->liveBytes < sb->liveBytes ? 1 : (sa->liveBytes > sb->liveBytes ? -1 : 0);
+}
+
+ConsoleFunction(memProfileEnable, void, 2, 3, "(bool enable, int sampleRate=1) - Start or stop sampling one "
+                "in every sampleRate allocations for the memProfile reports.")
+{
+   enableProfiler(dAtob(argv[1]), argc > 2 ? dAtoi(argv[2]) : 1);
+}
+
+ConsoleFunction(memProfileReset, void, 1, 1, "() - Zero the allocation totals. Live bytes are kept.")
+{
+   argc; argv;
+   if(!gSites)
+      return;
+
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::lockMutex(gMemMutex);
+#endif
+   for(U32 i = 1; i < gSiteCount; i++)
+   {
+      gSites[i].totalCount = gSites[i].totalBytes = 0;
+      gSites[i].intervalCount = gSites[i].intervalBytes = 0;
+   }
+   gProfileAllocs = gProfileFrees = 0;
+   gIntervalAllocs = gIntervalFrees = 0;
+   gIntervalStartFrame = Metric::getFrameCount();
+   gIntervalStartTime = Platform::getRealMilliseconds();
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::unlockMutex(gMemMutex);
+#endif
+}
+
+ConsoleFunction(memProfileTop, void, 1, 2, "(int count=10) - Print the call sites that allocated the most since "
+                "the last call, per frame and per second.")
+{
+   if(!gSites)
+   {
+      Con::printf("memProfileTop - the profiler isn't running, see memProfileEnable().");
+      return;
+   }
+
+   AllocSite *sites = (AllocSite *) dRealMalloc(sizeof(AllocSite) * MaxAllocSites);
+   U32 siteCount = copySites(sites);
+
+   U32 frames = Metric::getFrameCount() - gIntervalStartFrame;
+   U32 now = Platform::getRealMilliseconds();
+   F32 seconds = getMax(now - gIntervalStartTime, U32(1)) / 1000.0f;
+   F32 perFrame = frames ? 1.0f / frames : 0;
+
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::lockMutex(gMemMutex);
+#endif
+   U32 allocs = gIntervalAllocs, frees = gIntervalFrees;
+   for(U32 i = 1; i < gSiteCount; i++)
+      gSites[i].intervalCount = gSites[i].intervalBytes = 0;
+   gIntervalAllocs = gIntervalFrees = 0;
+   gIntervalStartFrame = Metric::getFrameCount();
+   gIntervalStartTime = now;
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::unlockMutex(gMemMutex);
+#endif
+
+   Con::printf("%d allocs, %d frees over %d frames, %.1f seconds (sampling 1 in %d):",
+      allocs, frees, frames, seconds, gSampleRate);
+   Con::printf("  %12s %12s %12s %12s  site", "allocs/frame", "bytes/frame", "allocs/sec", "bytes/sec");
+
+   dQsort(sites + 1, siteCount - 1, sizeof(AllocSite), compareIntervalBytes);
+   U32 count = getMin(U32(argc > 1 ? dAtoi(argv[1]) : 10), siteCount - 1);
+   for(U32 i = 1; i <= count && sites[i].intervalCount; i++)
+   {
+      F32 n = F32(sites[i].intervalCount) * gSampleRate, bytes = F32(sites[i].intervalBytes) * gSampleRate;
+      Con::printf("  %12.1f %12.0f %12.1f %12.0f  %s:%d", n * perFrame, bytes * perFrame,
+         n / seconds, bytes / seconds, sites[i].fileName, sites[i].line);
+   }
+
+   dRealFree(sites);
+}
+
+ConsoleFunction(memProfileLive, void, 1, 2, "(int count=20) - Print the call sites holding the most memory.")
+{
+   if(!gSites)
+   {
+      Con::printf("memProfileLive - the profiler isn't running, see memProfileEnable().");
+      return;
+   }
+
+   AllocSite *sites = (AllocSite *) dRealMalloc(sizeof(AllocSite) * MaxAllocSites);
+   U32 siteCount = copySites(sites);
+
+   Con::printf("Live memory by site (sampling 1 in %d):", gSampleRate);
+   Con::printf("  %12s %12s  site", "blocks", "bytes");
+
+   dQsort(sites + 1, siteCount - 1, sizeof(AllocSite), compareLiveBytes);
+   U32 count = getMin(U32(argc > 1 ? dAtoi(argv[1]) : 20), siteCount - 1);
+   for(U32 i = 1; i <= count && sites[i].liveCount; i++)
+      Con::printf("  %12d %12d  %s:%d", sites[i].liveCount * gSampleRate, sites[i].liveBytes * gSampleRate,
+         sites[i].fileName, sites[i].line);
+
+   dRealFree(sites);
+}
+
+ConsoleFunction(memProfileSnapshot, S32, 1, 1, "() - Record live memory by site for memProfileDiff(). "
+                "Returns the snapshot id; only the last few are kept.")
+{
+   argc; argv;
+   if(!gSites)
+   {
+      Con::printf("memProfileSnapshot - the profiler isn't running, see memProfileEnable().");
+      return -1;
+   }
+
+   U32 id = gNextSnapshot;
+   AllocSnapshot &snap = gSnapshots[id % MaxAllocSnapshots];
+
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::lockMutex(gMemMutex);
+#endif
+   snap.siteCount = gSiteCount;
+   for(U32 i = 0; i < gSiteCount; i++)
+   {
+      snap.liveCount[i] = gSites[i].liveCount;
+      snap.liveBytes[i] = gSites[i].liveBytes;
+   }
+   snap.valid = true;
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::unlockMutex(gMemMutex);
+#endif
+
+   gNextSnapshot++;
+   return id;
+}
+
+static S32 QSORT_CALLBACK compareGrowth(const void *a, const void *b)
+{
+   S32 ga = ((const S32 *) a)[1], gb = ((const S32 *) b)[1];
+   return (ga < gb) ? 1 : ((ga > gb) ? -1 : 0);
+}
+
+ConsoleFunction(memProfileDiff, void, 2, 4, "(int from, int to=-1, int count=20) - Print the sites whose live memory "
+                "changed the most between two snapshots, or since a snapshot if to is -1.")
+{
+   S32 from = dAtoi(argv[1]);
+   S32 to = argc > 2 ? dAtoi(argv[2]) : -1;
+
+   if(!gSites || from < 0 || U32(from) >= gNextSnapshot || gNextSnapshot - from > MaxAllocSnapshots ||
+      (to >= 0 && (U32(to) >= gNextSnapshot || gNextSnapshot - to > MaxAllocSnapshots)))
+   {
+      Con::errorf("memProfileDiff - no such snapshot.");
+      return;
+   }
+
+   AllocSite *sites = (AllocSite *) dRealMalloc(sizeof(AllocSite) * MaxAllocSites);
+   U32 siteCount = copySites(sites);
+
+   const AllocSnapshot &a = gSnapshots[from % MaxAllocSnapshots];
+   const AllocSnapshot *b = to >= 0 ? &gSnapshots[to % MaxAllocSnapshots] : NULL;
+   U32 count = b ? b->siteCount : siteCount;
+
+   // Pairs of site index and byte growth.
+   S32 *growth = (S32 *) dRealMalloc(sizeof(S32) * 2 * count);
+   S32 total = 0;
+   for(U32 i = 0; i < count; i++)
+   {
+      S32 before = i < a.siteCount ? a.liveBytes[i] : 0;
+      S32 after = b ? b->liveBytes[i] : sites[i].liveBytes;
+      growth[i * 2] = i;
+      growth[i * 2 + 1] = after - before;
+      total += after - before;
+   }
+   dQsort(growth, count, sizeof(S32) * 2, compareGrowth);
+
+   Con::printf("Live memory change from snapshot %d to %s: %d bytes (sampling 1 in %d):",
+      from, b ? argv[2] : "now", total * S32(gSampleRate), gSampleRate);
+
+   U32 shown = getMin(U32(argc > 3 ? dAtoi(argv[3]) : 20), count);
+   for(U32 i = 0; i < shown && growth[i * 2 + 1] > 0; i++)
+   {
+      U32 site = growth[i * 2];
+      S32 blocks = S32(b ? b->liveCount[site] : sites[site].liveCount) - S32(site < a.siteCount ? a.liveCount[site] : 0);
+      Con::printf("  %+12d bytes %+8d blocks  %s:%d", growth[i * 2 + 1] * S32(gSampleRate), blocks * S32(gSampleRate),
+         sites[site].fileName, sites[site].line);
+   }
+
+   dRealFree(growth);
+   dRealFree(sites);
+}
+
+ConsoleFunction(memHeapStats, void, 1, 1, "() - Print how much of the heap is in use and how fragmented the rest is.")
+{
+   argc; argv;
+
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::lockMutex(gMemMutex);
+#endif
+   U32 pages = 0, pageBytes = 0;
+   U32 usedBlocks = 0, usedBytes = 0;
+   U32 freeBlocks = 0, freeBytes = 0, largestFree = 0;
+   for(PageRecord *walk = gPageList; walk; walk = walk->prevPage)
+   {
+      if(!walk->headerList)
+         continue;
+      pages++;
+      pageBytes += walk->allocSize;
+      for(Header *probe = walk->headerList; probe; probe = probe->next)
+      {
+         if(probe->flags & Allocated)
+         {
+            usedBlocks++;
+            usedBytes += probe->size;
+         }
+         else
+         {
+            freeBlocks++;
+            freeBytes += probe->size;
+            largestFree = getMax(largestFree, U32(probe->size));
+         }
+      }
+   }
+#ifdef TORQUE_MULTITHREAD
+   if(gMemMutex)
+      Mutex::unlockMutex(gMemMutex);
+#endif
+
+   Con::printf("Heap: %d pages, %d bytes", pages, pageBytes);
+   Con::printf("  in use: %d bytes in %d blocks", usedBytes, usedBlocks);
+   Con::printf("  free:   %d bytes in %d blocks, largest %d", freeBytes, freeBlocks, largestFree);
+   Con::printf("  fragmentation: %.1f%%", freeBytes ? 100.0f * (1.0f - F32(largestFree) / freeBytes) : 0.0f);
+   if(gSites)
+      Con::printf("  profiler: %d allocs, %d frees since reset", gProfileAllocs, gProfileFrees);
+}
+
+
 static void* alloc(dsize_t size, bool array, const char* fileName, const U32 line)
 {
    fileName, line;
@@ -1004,6 +1425,9 @@ static void* alloc(dsize_t size, bool array, const char* fileName, const U32 lin
    dMemset(basePtr, 0xCF, size);
 #endif
 
+   if(gProfiling)
+      profileAlloc(retHeader, fileName, line);
+
    if(gCurrAlloc == gBreakAlloc && gBreakAlloc != 0xFFFFFFFF)
       Platform::debugBreak();
 
@@ -1042,6 +1466,14 @@ static void free(void* mem, bool array)
       logFree(hdr);
 #endif
 
+   if(gProfiling)
+   {
+      gProfileFrees++;
+      gIntervalFrees++;
+   }
+   if(hdr->flags & Sampled)
+      profileUntrack(hdr);
+
    hdr->flags = 0;
 
    // fill the block with the fill value
@@ -1123,6 +1555,10 @@ static void* realloc(void* mem, dsize_t size)
 
    FreeHeader *next = (FreeHeader *) hdr->next;
 
+   // A sampled block keeps its call site when it grows or shrinks, so the
+   // profiler's live bytes follow it.
+   U32 site = (hdr->flags & Sampled) ? (hdr->flags & SiteMask) >> SiteShift : 0;
+
 #ifdef TORQUE_DEBUG_GUARD
    hdr->realSize = size;
    if (gEnableLogging)
@@ -1131,6 +1567,8 @@ static void* realloc(void* mem, dsize_t size)
    if (next && !(next->flags & Allocated) && next->size + hdr->size + sizeof(Header) >= size)
    {
       // we can merge with the next dude.
+      if(site)
+         profileUntrack(hdr);
       treeRemove(next);
       hdr->size += sizeof(Header) + next->size;
       hdr->next = next->next;
@@ -1138,6 +1576,8 @@ static void* realloc(void* mem, dsize_t size)
          next->next->prev = (Header *) hdr;
 
       checkUnusedAlloc((FreeHeader *) hdr, size);
+      if(site)
+         profileTrack(hdr, site, false);
       //validate();
       PROFILE_END();
 #ifdef TORQUE_MULTITHREAD
@@ -1147,7 +1587,11 @@ static void* realloc(void* mem, dsize_t size)
    }
    else if(size < oldSize)
    {
+      if(site)
+         profileUntrack(hdr);
       checkUnusedAlloc((FreeHeader *) hdr, size);
+      if(site)
+         profileTrack(hdr, site, false);
       PROFILE_END();
 #ifdef TORQUE_MULTITHREAD
       Mutex::unlockMutex(gMemMutex);
@@ -1155,7 +1599,11 @@ static void* realloc(void* mem, dsize_t size)
       return mem;
    }
 
+   gProfileMoving = true;
    void* ret = alloc(size, false, NULL, 0);
+   gProfileMoving = false;
+   if(site)
+      profileTrack(((AllocatedHeader *)ret) - 1, site, false);
    dMemcpy(ret, mem, oldSize);
    free(mem, false);
    PROFILE_END();
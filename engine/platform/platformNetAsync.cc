@@ -134,6 +134,9 @@ void NetAsync::run()
             lookupRequest->out_h_length = hostent->h_length;
             lookupRequest->complete = true;
          }
+
+         // the main loop picks up the result in Net::process()
+         Platform::wakeMainLoop();
       }
       else
       {
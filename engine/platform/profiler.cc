@@ -125,7 +125,22 @@ U32 endHighResolutionTimer(U32 time[2])
    return 1;
 }
 
+#define TORQUE_PROFILER_NO_HIRES_TIMER
+
+#endif
+
+/// Absolute clock reading for trace events. The units don't matter; they
+/// are calibrated against the millisecond timer over the whole capture.
+static inline U64 readTraceClock()
+{
+#ifdef TORQUE_PROFILER_NO_HIRES_TIMER
+   return U64(Platform::getRealMilliseconds()) * 1000;
+#else
+   U32 time[2];
+   startHighResolutionTimer(time);
+   return (U64(time[1]) << 32) | time[0];
 #endif
+}
 
 //-----------------------------------------------------------------------------
 
@@ -216,6 +231,13 @@ ProfilerInstance::ProfilerInstance()
    dMemset(mDumpFileName, 0, sizeof(mDumpFileName));
 
    mRootCount = ProfilerRoot::smRootCount;
+
+   // Trace ring is allocated on the first event of a capture.
+   mTraceEvents      = NULL;
+   mTraceCapacity    = 0;
+   mTraceCount       = 0;
+   mTraceSession     = 0;
+   mTraceMainThread  = false;
 }
 
 ProfilerInstance::~ProfilerInstance()
@@ -224,6 +246,7 @@ ProfilerInstance::~ProfilerInstance()
    m.lock(mMutex);
 
    free(mRootTable);
+   free(mTraceEvents);
 
    // Walk the profilelist and free things on it.
    ProfilerData *walk = mProfileList, *tmp;
@@ -251,6 +274,9 @@ void ProfilerInstance::hashPush(ProfilerRoot *pr)
    AssertFatal(mStackDepth <= mMaxStackDepth,
       "Stack overflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
 
+   if(gProfiler->mTracing)
+      traceEvent(pr->mID);
+
    if(!mEnabled)
       return;
 
@@ -341,6 +367,9 @@ void ProfilerInstance::hashPop()
    mStackDepth--;
    AssertFatal(mStackDepth >= 0, "Stack underflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
 
+   if(gProfiler->mTracing)
+      traceEvent(TraceEnd);
+
    if(mEnabled)
    {
       // If we're in a subdepth situation, then just dec it.
@@ -396,6 +425,10 @@ void ProfilerInstance::hashPop()
 
       mEnabled = mNextEnable;
 
+      // The main loop is one block, so this is the end of a frame.
+      if(gProfiler->mTracing && Con::isMainThread())
+         gProfiler->traceFrameEnd(this);
+
       gProfilerReentrancyGuard.set((void*)0);
 
       // Finally, kick off the timer if appropriate.
@@ -665,6 +698,118 @@ void ProfilerInstance::dumpToConsole()
    // Implicit unlock.
 }
 
+void ProfilerInstance::traceEvent(U32 root)
+{
+   // First event of a new capture? Reset the ring, reallocating it if the
+   // size changed.
+   if(mTraceSession != gProfiler->mTraceSession)
+   {
+      if(mTraceCapacity != gProfiler->mTraceCapacity)
+      {
+         free(mTraceEvents);
+         mTraceCapacity = gProfiler->mTraceCapacity;
+         mTraceEvents   = (TraceEvent*)malloc(sizeof(TraceEvent) * mTraceCapacity);
+      }
+      mTraceCount      = 0;
+      mTraceMainThread = false;
+      mTraceSession    = gProfiler->mTraceSession;
+   }
+
+   TraceEvent &ev = mTraceEvents[mTraceCount % mTraceCapacity];
+   ev.mTicks = readTraceClock();
+   ev.mRoot  = root;
+   ev.mFrame = gProfiler->mTraceFrame;
+   mTraceCount++;
+}
+
+void ProfilerInstance::exportTrace(Stream &stream, bool &first, S32 firstFrame, S32 lastFrame)
+{
+   if(mTraceSession != gProfiler->mTraceSession || !mTraceCount)
+      return;
+
+   const U64 startTicks = gProfiler->mTraceStartTicks;
+   const U32 elapsedMs  = gProfiler->mTraceStopMs - gProfiler->mTraceStartMs;
+   F64 ticksPerUs = elapsedMs ? F64(gProfiler->mTraceStopTicks - startTicks) / (elapsedMs * 1000.0) : 1.0;
+   if(ticksPerUs <= 0)
+      ticksPerUs = 1.0;
+
+   char buffer[512];
+
+   // Name the thread.
+   if(mTraceMainThread)
+      dSprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Main\"}}",
+         first ? "" : ",\n", mThreadID);
+   else
+      dSprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+         first ? "" : ",\n", mThreadID, mThreadID);
+   stream.write(dStrlen(buffer), buffer);
+   first = false;
+
+   // Replay the ring oldest first, pairing begins with ends. Ends whose
+   // begin was overwritten (or came before the capture) are skipped.
+   const TraceEvent *open[MaxStackDepth];
+   U32 depth = 0;
+
+   U32 count = getMin(mTraceCount, mTraceCapacity);
+   U32 start = mTraceCount - count;
+   for(U32 i = 0; i <= count; i++)
+   {
+      const TraceEvent *ev = (i < count) ? &mTraceEvents[(start + i) % mTraceCapacity] : NULL;
+      const TraceEvent *begin = NULL;
+      U64 endTicks;
+
+      if(!ev)
+      {
+         // Blocks still open when the capture stopped; close them one at a
+         // time at the stop time.
+         if(!depth)
+            break;
+         begin = open[--depth];
+         endTicks = gProfiler->mTraceStopTicks;
+         i--;
+      }
+      else if(ev->mRoot == TraceFrame)
+      {
+         if(S32(ev->mFrame) < firstFrame || (lastFrame >= 0 && S32(ev->mFrame) > lastFrame))
+            continue;
+         dSprintf(buffer, sizeof(buffer), ",\n{\"name\":\"Frame %u\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+            ev->mFrame, mThreadID, F64(ev->mTicks - startTicks) / ticksPerUs);
+         stream.write(dStrlen(buffer), buffer);
+         continue;
+      }
+      else if(ev->mRoot == TraceEnd)
+      {
+         if(!depth)
+            continue;
+         begin = open[--depth];
+         endTicks = ev->mTicks;
+      }
+      else
+      {
+         if(depth < MaxStackDepth)
+            open[depth++] = ev;
+         continue;
+      }
+
+      if(S32(begin->mFrame) < firstFrame || (lastFrame >= 0 && S32(begin->mFrame) > lastFrame))
+         continue;
+
+      // Roots can't go away, so the ID is still good.
+      ProfilerRoot *root = ProfilerRoot::smRootList;
+      if(begin->mRoot < mRootCount)
+         root = mRootTable[begin->mRoot].mRoot;
+      else
+         while(root && root->mID != begin->mRoot)
+            root = root->mNextRoot;
+
+      dSprintf(buffer, sizeof(buffer), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+         root ? root->mName : "unknown", mThreadID,
+         F64(begin->mTicks - startTicks) / ticksPerUs,
+         F64(endTicks - begin->mTicks) / ticksPerUs);
+      stream.write(dStrlen(buffer), buffer);
+   }
+}
+
 void ProfilerInstance::growRoots(U32 newCount)
 {
    // If it's the same size or smaller as we've got now, early out.
@@ -716,6 +861,14 @@ Profiler::Profiler()
    mInstanceListHead = NULL;
    mDumpMutex = Mutex::createMutex();
 
+   mTracing         = false;
+   mTraceSession    = 0;
+   mTraceCapacity   = DefaultTraceEvents;
+   mTraceFrame      = 0;
+   mTraceStopFrame  = 0;
+   mTraceStartTicks = mTraceStopTicks = 0;
+   mTraceStartMs    = mTraceStopMs = 0;
+
    // Singleton magic:
    AssertISV(gProfiler==NULL, "Profiler - a Profiler is already present!");
    gProfiler = this;
@@ -818,6 +971,83 @@ void Profiler::dumpToConsole()
       walk->dumpToConsole();
 }
 
+void Profiler::startTrace(U32 maxFrames, U32 eventsPerThread)
+{
+   stopTrace();
+
+   mTraceCapacity   = getMax(eventsPerThread, U32(ProfilerInstance::MaxStackDepth));
+   mTraceFrame      = 0;
+   mTraceStopFrame  = maxFrames;
+   mTraceStartMs    = Platform::getRealMilliseconds();
+   mTraceStartTicks = readTraceClock();
+   mTraceSession++;
+
+   mTracing = true;
+}
+
+void Profiler::stopTrace()
+{
+   if(!mTracing)
+      return;
+
+   mTracing        = false;
+   mTraceStopTicks = readTraceClock();
+   mTraceStopMs    = Platform::getRealMilliseconds();
+}
+
+void Profiler::traceFrameEnd(ProfilerInstance *pi)
+{
+   pi->mTraceMainThread = true;
+   pi->traceEvent(ProfilerInstance::TraceFrame);
+   mTraceFrame++;
+
+   if(mTraceStopFrame && mTraceFrame >= mTraceStopFrame)
+   {
+      stopTrace();
+      Con::printf("Profiler: trace stopped after %d frames.", mTraceFrame);
+   }
+}
+
+bool Profiler::exportTrace(const char *fileName, S32 firstFrame, S32 lastFrame)
+{
+   stopTrace();
+
+   if(!mTraceSession)
+   {
+      Con::errorf("Profiler::exportTrace - nothing has been captured.");
+      return false;
+   }
+
+   MutexHandle m;
+   m.lock(mDumpMutex);
+
+   FileStream fws;
+   if(!fws.open(fileName, FileStream::Write))
+   {
+      Con::errorf("Profiler::exportTrace - unable to open '%s'.", fileName);
+      return false;
+   }
+
+   // Keep our own blocks out of the capture we're writing.
+   gProfilerReentrancyGuard.set((void*)1);
+
+   const char *header = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+   fws.write(dStrlen(header), header);
+
+   bool first = true;
+   for(ProfilerInstance *walk = mInstanceListHead; walk; walk = walk->mNextInstance)
+      walk->exportTrace(fws, first, firstFrame, lastFrame);
+
+   const char *footer = "\n]}\n";
+   fws.write(dStrlen(footer), footer);
+   fws.close();
+
+   gProfilerReentrancyGuard.set((void*)0);
+
+   Con::printf("Profiler: wrote %d frames of trace to %s.", mTraceFrame, fileName);
+   return true;
+}
+
 //-----------------------------------------------------------------------------
 
 ConsoleFunction(profilerEnable, void, 2, 2, "(bool enable) - Turn the profiler on and off.")
@@ -830,4 +1060,25 @@ ConsoleFunction(profilerDump, void, 1, 1, "() - Dump all profiled threads' infor
    if(gProfiler) gProfiler->dumpToConsole();
 }
 
+ConsoleFunction(profilerTraceStart, void, 1, 3, "(int frames=0, int eventsPerThread) - Start recording a trace of every profiled block. "
+                "If frames is given, recording stops by itself after that many frames.")
+{
+   U32 frames = argc > 1 ? dAtoi(argv[1]) : 0;
+   U32 events = argc > 2 ? dAtoi(argv[2]) : U32(Profiler::DefaultTraceEvents);
+   if(gProfiler) gProfiler->startTrace(frames, events);
+}
+
+ConsoleFunction(profilerTraceStop, void, 1, 1, "() - Stop recording the trace.")
+{
+   if(gProfiler) gProfiler->stopTrace();
+}
+
+ConsoleFunction(profilerTraceExport, bool, 2, 4, "(string filename, int firstFrame=0, int lastFrame=-1) - "
+                "Write the recorded trace in Chrome trace format, for chrome://tracing or Perfetto.")
+{
+   S32 firstFrame = argc > 2 ? dAtoi(argv[2]) : 0;
+   S32 lastFrame  = argc > 3 ? dAtoi(argv[3]) : -1;
+   return gProfiler && gProfiler->exportTrace(argv[1], firstFrame, lastFrame);
+}
+
 #endif
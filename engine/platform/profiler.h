@@ -89,6 +89,25 @@ struct ProfilerInstance;
 /// profilerDumpToFile(string filename);                    //dumps all profiler data to a given file
 /// @endcode
 ///
+/// <b>Tracing</b>
+///
+/// The dumps above only show totals, which hides a single slow frame and
+/// how the threads line up against each other. For that the profiler can
+/// also record every block as a timestamped begin/end event in a ring
+/// buffer per thread, and write them out as a Chrome trace (load it in
+/// chrome://tracing or ui.perfetto.dev):
+///
+/// @code
+/// profilerTraceStart(int frames, int eventsPerThread);   //start recording, optionally stopping after some frames
+/// profilerTraceStop();                                    //stop recording
+/// profilerTraceExport(string filename, int first, int last); //write frames first..last of the capture
+/// @endcode
+///
+/// The rings keep the most recent events, so a capture can be left running
+/// and stopped just after a hitch. Frames are counted from the start of the
+/// capture by the main thread's outermost block. Tracing is independent of
+/// profilerEnable; when no capture is running it costs one test per block.
+///
 /// The C++ code side of the profiler uses pairs of PROFILE_START() and
 /// PROFILE_END().
 ///
@@ -223,6 +242,35 @@ class Profiler
    bool mCurrentDumpIsFile;
    Stream *mCurrentDumpStream;
 
+   /// @name Tracing
+   /// @{
+
+   /// Is a capture running? Tested by every push and pop.
+   volatile bool mTracing;
+
+   /// Bumped by each capture, so instances know to reset their rings.
+   U32 mTraceSession;
+
+   /// Events per thread for the current capture.
+   U32 mTraceCapacity;
+
+   /// Frames completed since the capture started.
+   volatile U32 mTraceFrame;
+
+   /// Stop once mTraceFrame gets here, or 0 to run until stopped.
+   U32 mTraceStopFrame;
+
+   /// Clock readings bracketing the capture, used to convert ticks to time.
+   U64 mTraceStartTicks;
+   U64 mTraceStopTicks;
+   U32 mTraceStartMs;
+   U32 mTraceStopMs;
+
+   /// Called by the main thread when its outermost block closes.
+   void traceFrameEnd(ProfilerInstance *pi);
+
+   /// @}
+
 public:
    Profiler();
    ~Profiler();
@@ -242,6 +290,30 @@ public:
 
    void hashPush(ProfilerRoot *pr);
    void hashPop();
+
+   /// @name Tracing
+   /// @{
+
+   enum
+   {
+      DefaultTraceEvents = 64 * 1024,
+   };
+
+   /// Start recording trace events, throwing away any earlier capture.
+   ///
+   /// @param maxFrames       Stop by itself after this many frames, or 0
+   ///                        to run until stopTrace().
+   /// @param eventsPerThread Size of each thread's ring buffer.
+   void startTrace(U32 maxFrames, U32 eventsPerThread);
+   void stopTrace();
+   bool isTracing() const { return mTracing; }
+
+   /// Write the last capture as Chrome trace JSON. Only blocks starting in
+   /// frames firstFrame through lastFrame are written; a negative lastFrame
+   /// means through the end of the capture.
+   bool exportTrace(const char *fileName, S32 firstFrame, S32 lastFrame);
+
+   /// @}
 };
 
 extern Profiler *gProfiler;
@@ -520,6 +592,40 @@ class ProfilerInstance
    /// Next allocated ProfilerInstance.
    ProfilerInstance *mNextInstance;
 
+   /// @name Tracing
+   ///
+   /// Each thread records into its own ring, so nothing is shared while a
+   /// capture runs. When the ring wraps the oldest events are overwritten.
+   ///
+   /// @{
+
+   struct TraceEvent
+   {
+      U64 mTicks;    ///< Raw high resolution clock reading.
+      U32 mRoot;     ///< ProfilerRoot::mID, or one of the markers below.
+      U32 mFrame;    ///< Frame of the capture this happened in.
+   };
+
+   enum
+   {
+      TraceEnd   = 0xFFFFFFFF,  ///< Closes the innermost open block.
+      TraceFrame = 0xFFFFFFFE,  ///< Main thread frame boundary.
+   };
+
+   TraceEvent *mTraceEvents;
+   U32  mTraceCapacity;
+   U32  mTraceCount;          ///< Events recorded, including overwritten ones.
+   U32  mTraceSession;        ///< Capture the ring belongs to.
+   bool mTraceMainThread;     ///< Did this thread mark frames?
+
+   void traceEvent(U32 root);
+
+   /// Write this thread's events as JSON. 'first' tracks whether a comma is
+   /// needed before the next event.
+   void exportTrace(Stream &stream, bool &first, S32 firstFrame, S32 lastFrame);
+
+   /// @}
+
    /// Do a bunch of extra checking to make sure our data structures
    /// are clean.
    ///
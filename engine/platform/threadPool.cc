@@ -0,0 +1,233 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "platform/threadPool.h"
+#include "platform/platformThread.h"
+#include "platform/platformMutex.h"
+#include "platform/platformSemaphore.h"
+#include "core/stringTable.h"
+#include "core/frameAllocator.h"
+
+ThreadPool *ThreadPool::smGlobal = NULL;
+
+//--------------------------------------------------------------------------
+
+ThreadPool::WorkGroup::WorkGroup()
+{
+   mPending       = 0;
+   mDoneSemaphore = Semaphore::createSemaphore(0);
+}
+
+ThreadPool::WorkGroup::~WorkGroup()
+{
+   AssertFatal(mPending == 0, "ThreadPool::WorkGroup - destroyed with work outstanding!");
+   Semaphore::destroySemaphore(mDoneSemaphore);
+}
+
+//--------------------------------------------------------------------------
+
+class ThreadPool::WorkerThread : public Thread
+{
+   ThreadPool *mPool;
+
+public:
+   WorkerThread(ThreadPool *pool) : Thread(0, 0, false), mPool(pool) {}
+   void run(S32) { mPool->workerLoop(); }
+};
+
+//--------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(const char *name, U32 numThreads)
+{
+   mName          = StringTable->insert(name);
+   mMutex         = Mutex::createMutex();
+   mWorkSemaphore = Semaphore::createSemaphore(0);
+   mQueueHead     = NULL;
+   mQueueTail     = NULL;
+   mShuttingDown  = false;
+
+#ifdef TORQUE_MULTITHREAD
+   if (numThreads == 0)
+   {
+      U32 cores = Platform::SystemInfo.processor.numCores;
+      numThreads = cores > 1 ? cores - 1 : 1;
+   }
+
+   for (U32 i = 0; i < numThreads; i++)
+   {
+      WorkerThread *thread = new WorkerThread(this);
+      mThreads.push_back(thread);
+      thread->start();
+   }
+#else
+   // The memory manager and string table are only safe to share between
+   // threads in multithreaded builds, so everything runs inline here.
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+   Mutex::lockMutex(mMutex);
+   mShuttingDown = true;
+   Mutex::unlockMutex(mMutex);
+
+   for (U32 i = 0; i < mThreads.size(); i++)
+      Semaphore::releaseSemaphore(mWorkSemaphore);
+   for (U32 i = 0; i < mThreads.size(); i++)
+   {
+      mThreads[i]->join();
+      delete mThreads[i];
+   }
+   mThreads.clear();
+
+   // anything still queued runs here rather than leaking its group
+   while (WorkItem *item = popItem())
+      runItem(item);
+
+   Semaphore::destroySemaphore(mWorkSemaphore);
+   Mutex::destroyMutex(mMutex);
+}
+
+//--------------------------------------------------------------------------
+
+ThreadPool::WorkItem* ThreadPool::popItem()
+{
+   Mutex::lockMutex(mMutex);
+   WorkItem *item = mQueueHead;
+   if (item)
+   {
+      mQueueHead = item->mNext;
+      if (!mQueueHead)
+         mQueueTail = NULL;
+      item->mNext = NULL;
+   }
+   Mutex::unlockMutex(mMutex);
+   return item;
+}
+
+void ThreadPool::runItem(WorkItem *item)
+{
+   // grab what we need before execute(), the item may be gone afterwards
+   WorkGroup *group = item->mGroup;
+   bool deleteWhenDone = item->mDeleteWhenDone;
+
+   item->execute();
+
+   if (deleteWhenDone)
+      delete item;
+
+   if (group)
+   {
+      // signal under the lock, so a waiter that sees the group drained can
+      // destroy it without racing this release
+      Mutex::lockMutex(mMutex);
+      if (--group->mPending == 0)
+         Semaphore::releaseSemaphore(group->mDoneSemaphore);
+      Mutex::unlockMutex(mMutex);
+   }
+   else
+   {
+      // nobody is waiting on it, so the main loop may be polling for the result
+      Platform::wakeMainLoop();
+   }
+}
+
+void ThreadPool::workerLoop()
+{
+   for (;;)
+   {
+      Semaphore::acquireSemaphore(mWorkSemaphore);
+
+      Mutex::lockMutex(mMutex);
+      bool shuttingDown = mShuttingDown;
+      Mutex::unlockMutex(mMutex);
+      if (shuttingDown)
+      {
+         FrameAllocator::releaseThreadArena();
+         return;
+      }
+
+      // may come up empty if a waiting thread stole the item
+      if (WorkItem *item = popItem())
+         runItem(item);
+   }
+}
+
+//--------------------------------------------------------------------------
+
+void ThreadPool::queueWorkItem(WorkItem *item, WorkGroup *group)
+{
+   AssertFatal(item, "ThreadPool::queueWorkItem - no item!");
+
+   item->mGroup = group;
+   item->mNext  = NULL;
+
+   // no workers, just do it now
+   if (mThreads.empty())
+   {
+      if (group)
+      {
+         Mutex::lockMutex(mMutex);
+         group->mPending++;
+         Mutex::unlockMutex(mMutex);
+      }
+      runItem(item);
+      return;
+   }
+
+   Mutex::lockMutex(mMutex);
+   if (group)
+      group->mPending++;
+   if (mQueueTail)
+      mQueueTail->mNext = item;
+   else
+      mQueueHead = item;
+   mQueueTail = item;
+   Mutex::unlockMutex(mMutex);
+
+   Semaphore::releaseSemaphore(mWorkSemaphore);
+}
+
+void ThreadPool::waitForGroup(WorkGroup *group)
+{
+   for (;;)
+   {
+      Mutex::lockMutex(mMutex);
+      bool done = group->mPending == 0;
+      Mutex::unlockMutex(mMutex);
+      if (done)
+         break;
+
+      // help out rather than sit idle
+      if (WorkItem *item = popItem())
+      {
+         runItem(item);
+         continue;
+      }
+
+      // everything left is running on a worker; sleep until the group drains
+      Semaphore::acquireSemaphore(group->mDoneSemaphore);
+   }
+
+   // swallow a drain signal we didn't need to block on, so the next wait on
+   // this group doesn't wake early
+   Semaphore::acquireSemaphore(group->mDoneSemaphore, false);
+}
+
+//--------------------------------------------------------------------------
+
+ThreadPool& ThreadPool::GLOBAL()
+{
+   if (!smGlobal)
+      smGlobal = new ThreadPool("GLOBAL");
+   return *smGlobal;
+}
+
+void ThreadPool::shutdownGlobal()
+{
+   delete smGlobal;
+   smGlobal = NULL;
+}
@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#ifndef _PLATFORM_H_
+#include "platform/platform.h"
+#endif
+#ifndef _TVECTOR_H_
+#include "core/tVector.h"
+#endif
+
+/// A fixed set of worker threads that execute queued work items.
+///
+/// Work is described by subclassing ThreadPool::WorkItem. Items that the
+/// caller needs to wait on are queued against a WorkGroup; waitForGroup()
+/// blocks until every item in the group has run, executing queued items on
+/// the calling thread in the meantime so a wait never idles a core (and can
+/// safely be issued from inside a work item).
+///
+/// @code
+/// struct ScanItem : public ThreadPool::WorkItem
+/// {
+///    const char *path;
+///    void execute() { ... }
+/// };
+///
+/// ThreadPool::WorkGroup group;
+/// for(U32 i = 0; i < items.size(); i++)
+///    ThreadPool::GLOBAL().queueWorkItem(&items[i], &group);
+/// ThreadPool::GLOBAL().waitForGroup(&group);
+/// @endcode
+///
+/// Work items must not touch the console, the sim or anything else that is
+/// only safe on the main thread; the StringTable and the memory manager are
+/// safe to use when TORQUE_MULTITHREAD is defined.
+class ThreadPool
+{
+public:
+   class WorkGroup;
+
+   /// A unit of work.  The pool never takes ownership unless the item was
+   /// constructed with deleteWhenDone set.
+   class WorkItem
+   {
+      friend class ThreadPool;
+
+      WorkItem  *mNext;
+      WorkGroup *mGroup;
+      bool       mDeleteWhenDone;
+
+   public:
+      WorkItem(bool deleteWhenDone = false)
+         : mNext(NULL), mGroup(NULL), mDeleteWhenDone(deleteWhenDone) {}
+      virtual ~WorkItem() {}
+
+      /// Do the work.  Called on a worker thread (or the waiting thread).
+      virtual void execute() = 0;
+   };
+
+   /// Completion counter for a set of work items.
+   class WorkGroup
+   {
+      friend class ThreadPool;
+      S32   mPending;
+      void *mDoneSemaphore;   ///< Released each time mPending drops to zero.
+
+   public:
+      WorkGroup();
+      ~WorkGroup();
+   };
+
+private:
+   class WorkerThread;
+   friend class WorkerThread;
+
+   Vector<WorkerThread*> mThreads;
+
+   void *mMutex;
+   void *mWorkSemaphore;      ///< Counts queued items, workers block on it.
+
+   WorkItem *mQueueHead;
+   WorkItem *mQueueTail;
+   bool      mShuttingDown;
+
+   StringTableEntry mName;
+
+   WorkItem* popItem();
+   void      runItem(WorkItem *item);
+
+   void      workerLoop();
+
+   static ThreadPool *smGlobal;
+
+public:
+   /// Create a pool.  A thread count of 0 uses one thread per logical
+   /// processor, minus one for the main thread (but at least one).
+   ThreadPool(const char *name, U32 numThreads = 0);
+   ~ThreadPool();
+
+   U32 getNumThreads() const { return mThreads.size(); }
+   const char *getName() const { return mName; }
+
+   /// Queue an item, optionally as part of a group to wait on.
+   void queueWorkItem(WorkItem *item, WorkGroup *group = NULL);
+
+   /// Block until every item queued against the group has completed.
+   void waitForGroup(WorkGroup *group);
+
+   /// The shared engine pool, created on first use.
+   static ThreadPool& GLOBAL();
+
+   /// True if the shared pool has been created (and not shut down).
+   static bool hasGlobal() { return smGlobal != NULL; }
+
+   /// Shut down the shared pool (called at engine shutdown).
+   static void shutdownGlobal();
+};
+
+#endif // _THREADPOOL_H_
@@ -55,6 +55,8 @@ void Processor::init()
    // These should determine what special code paths we use.
    Platform::SystemInfo.processor.properties = cpuFeatures;
 
+   Platform::SystemInfo.processor.numCores = numCpus > 0 ? numCpus : 1;
+
    // Make pretty strings...
    char freqString[32];
    if(cpuMhz >= 1000)
@@ -19,6 +19,8 @@
 #include <dirent.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 //TODO: file io still needs some work...
 
@@ -642,6 +644,43 @@ S32 Platform::getFileSize(const char* pFilePath)
 }
 
 
+//-----------------------------------------------------------------------------
+const void* Platform::mapFile(const char *pFilePath, U32 &size, void *&handle)
+{
+   size = 0;
+   handle = NULL;
+   if (!pFilePath || !*pFilePath)
+      return NULL;
+
+   int fd = open(pFilePath, O_RDONLY);
+   if (fd == -1)
+      return NULL;
+
+   struct stat statData;
+   if( fstat(fd, &statData) < 0 || (statData.st_mode & S_IFMT) != S_IFREG ||
+       statData.st_size == 0 || statData.st_size != (off_t)(U32)statData.st_size )
+   {
+      close(fd);
+      return NULL;
+   }
+
+   // the mapping stays valid after the descriptor is closed
+   void *base = mmap(NULL, statData.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (base == MAP_FAILED)
+      return NULL;
+
+   size = (U32)statData.st_size;
+   return base;
+}
+
+void Platform::unmapFile(const void *base, U32 size, void *handle)
+{
+   if (base)
+      munmap((void *)base, size);
+}
+
+
 //-----------------------------------------------------------------------------
 bool Platform::isSubDirectory(const char *pathParent, const char *pathSub)
 {
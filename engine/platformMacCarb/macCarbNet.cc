@@ -380,6 +380,15 @@ void Net::closePort()
       close(udpSocket);
 }
 
+// No batched send here, packets go out as they're sent.
+void Net::beginSendBatch()
+{
+}
+
+void Net::endSendBatch()
+{
+}
+
 Net::Error Net::sendto(const NetAddress *address, const U8 *buffer, S32  bufferSize)
 {
    if(Game->isJournalReading())
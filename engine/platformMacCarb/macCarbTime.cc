@@ -58,6 +58,12 @@ U32 Platform::getRealMilliseconds()
    return ret;
 }   
 
+U64 Platform::getRealMicroseconds()
+{
+   Nanoseconds ns = AbsoluteToNanoseconds(UpTime());
+   return UnsignedWideToUInt64(ns) / 1000;
+}
+
 U32 Platform::getVirtualMilliseconds()
 {
    return platState.currentTime;   
@@ -75,6 +81,17 @@ void Platform::sleep(U32 ms)
     usleep( ms * 1000 );
 }
 
+/// Carbon events aren't something we can block on from here, so idle in
+/// short sleeps instead and leave wakeMainLoop() with nothing to do.
+void Platform::waitForEvents(U32 timeout)
+{
+   Platform::sleep( getMin(timeout, U32(10)) );
+}
+
+void Platform::wakeMainLoop()
+{
+}
+
 #pragma mark ---- TimeManager ----
 //--------------------------------------
 static void _MacCarbUpdateSleepTicks()
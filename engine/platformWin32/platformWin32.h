@@ -63,6 +63,8 @@ struct Win32PlatState
    S32 desktopClientHeight;
    U32 currentTime;
 
+   HANDLE wakeEvent;    ///< Signalled by Platform::wakeMainLoop()
+
    Win32PlatState();
 };
 
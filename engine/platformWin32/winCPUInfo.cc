@@ -235,6 +235,12 @@ void Processor::init()
       Con::printf("   3DNow detected");
    if (Platform::SystemInfo.processor.properties & CPU_PROP_SSE)
       Con::printf("   SSE detected");
+
+   SYSTEM_INFO sysInfo;
+   GetSystemInfo(&sysInfo);
+   Platform::SystemInfo.processor.numCores = getMax(U32(sysInfo.dwNumberOfProcessors), U32(1));
+   if (Platform::SystemInfo.processor.numCores > 1)
+      Con::printf("   %d logical processors", Platform::SystemInfo.processor.numCores);
    Con::printf(" ");
 
    PlatformBlitInit();
@@ -929,6 +929,64 @@ bool Platform::isSubDirectory(const char *pParent, const char *pDir)
 
 //------------------------------------------------------------------------------
 
+const void* Platform::mapFile(const char *pFilePath, U32 &size, void *&handle)
+{
+   size = 0;
+   handle = NULL;
+   if (!pFilePath || !*pFilePath)
+      return NULL;
+
+   char filebuf[2048];
+   dStrcpy(filebuf, pFilePath);
+   backslash(filebuf);
+#ifdef UNICODE
+   UTF16 fname[2048];
+   convertUTF8toUTF16((UTF8 *)filebuf, fname, sizeof(fname));
+#else
+   char *fname = filebuf;
+#endif
+
+   HANDLE file = CreateFile(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+   if (file == INVALID_HANDLE_VALUE)
+      return NULL;
+
+   DWORD high = 0;
+   DWORD low = GetFileSize(file, &high);
+   if (low == INVALID_FILE_SIZE || high != 0 || low == 0)
+   {
+      CloseHandle(file);
+      return NULL;
+   }
+
+   // the mapping object keeps its own reference to the file
+   HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   CloseHandle(file);
+   if (mapping == NULL)
+      return NULL;
+
+   const void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+   if (base == NULL)
+   {
+      CloseHandle(mapping);
+      return NULL;
+   }
+
+   size = low;
+   handle = (void *)mapping;
+   return base;
+}
+
+void Platform::unmapFile(const void *base, U32 size, void *handle)
+{
+   if (base)
+      UnmapViewOfFile(base);
+   if (handle)
+      CloseHandle((HANDLE)handle);
+}
+
+//------------------------------------------------------------------------------
+
 bool Platform::fileTimeToString(FileTime * time, char * string, U32 strLen)
 {
    if(!time || !string)
@@ -163,6 +163,10 @@ static LRESULT PASCAL WinsockProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM
             }
          }
          break;
+      case WM_USER + 2:
+         // A packet on the game port. Net::process() reads it, the message
+         // is only here to wake up Platform::waitForEvents().
+         break;
       default:
          return DefWindowProc( hWnd, message, wParam, lParam );
    }
@@ -477,6 +481,9 @@ bool Net::openPort(S32 port)
          error = setBroadcast(udpSocket, true);
       if(error == NoError)
          error = setBlocking(udpSocket, false);
+      // Post a message when a packet comes in, to wake the main loop
+      if(error == NoError && WSAAsyncSelect(udpSocket, winsockWindow, WM_USER + 2, FD_READ))
+         error = getLastError();
       if(error == NoError)
          Con::printf("UDP initialized on port %d", port);
       else
@@ -526,6 +533,15 @@ void Net::closePort()
       closesocket(udpSocket);
 }
 
+// No batched send here, packets go out as they're sent.
+void Net::beginSendBatch()
+{
+}
+
+void Net::endSendBatch()
+{
+}
+
 Net::Error Net::sendto(const NetAddress *address, const U8 *buffer, S32 bufferSize)
 {
    if(Game->isJournalReading())
@@ -81,6 +81,18 @@ U32 Platform::getRealMilliseconds()
    return GetTickCount();
 }
 
+U64 Platform::getRealMicroseconds()
+{
+   static LARGE_INTEGER frequency = { 0 };
+   if(!frequency.QuadPart)
+      QueryPerformanceFrequency(&frequency);
+
+   LARGE_INTEGER count;
+   QueryPerformanceCounter(&count);
+   return U64(count.QuadPart / frequency.QuadPart) * 1000000 +
+          U64(count.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+}
+
 U32 Platform::getVirtualMilliseconds()
 {
    return winState.currentTime;
@@ -69,6 +69,7 @@ Win32PlatState::Win32PlatState()
    appInstance = NULL;
    currentTime = 0;
    processId   = 0;
+   wakeEvent   = CreateEvent(NULL, FALSE, FALSE, NULL);
 }
 
 static bool windowLocked = false;
@@ -959,6 +960,23 @@ void Platform::process()
    Input::process();
 }
 
+#ifndef MWMO_INPUTAVAILABLE
+#define MWMO_INPUTAVAILABLE 0x0004
+#endif
+
+//--------------------------------------
+void Platform::waitForEvents(U32 timeout)
+{
+   // Input and the sockets (through WSAAsyncSelect) all arrive as window
+   // messages, the event is for other threads.
+   MsgWaitForMultipleObjectsEx(1, &winState.wakeEvent, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+void Platform::wakeMainLoop()
+{
+   SetEvent(winState.wakeEvent);
+}
+
 extern U32 calculateCRC(void * buffer, S32 len, U32 crcVal );
 
 #if defined(TORQUE_DEBUG) || defined(INTERNAL_RELEASE)
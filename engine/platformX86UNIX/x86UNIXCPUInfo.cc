@@ -10,6 +10,7 @@
 #include "console/console.h"
 #include "core/stringTable.h"
 #include <math.h>
+#include <unistd.h>
 
 Platform::SystemInfo_struct Platform::SystemInfo;
 
@@ -134,6 +135,11 @@ void Processor::init()
       Con::printf("   3DNow detected");
    if (Platform::SystemInfo.processor.properties & CPU_PROP_SSE)
       Con::printf("   SSE detected");
+
+   long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+   Platform::SystemInfo.processor.numCores = numCores > 0 ? U32(numCores) : 1;
+   if (Platform::SystemInfo.processor.numCores > 1)
+      Con::printf("   %d logical processors", Platform::SystemInfo.processor.numCores);
    Con::printf(" ");
 
    PlatformBlitInit();
@@ -57,6 +57,7 @@
  #include <dirent.h>
  #include <sys/types.h>
  #include <sys/stat.h>
+ #include <sys/mman.h>
  #include <unistd.h>
  #include <fcntl.h>
  #include <errno.h>
@@ -930,6 +931,52 @@ bool dPathCopy(const char *fromName, const char *toName, bool nooverwrite)
    return -1;
  }
  
+ //-----------------------------------------------------------------------------
+ const void* Platform::mapFile(const char *pFilePath, U32 &size, void *&handle)
+ {
+    size = 0;
+    handle = NULL;
+    if (!pFilePath || !*pFilePath)
+       return NULL;
+
+    // same lookup order as File::open for read access
+    char prefPathName[MaxPath];
+    char gamePathName[MaxPath];
+    char cwd[MaxPath];
+    getcwd(cwd, MaxPath);
+    MungePath(prefPathName, MaxPath, pFilePath, GetPrefDir());
+    MungePath(gamePathName, MaxPath, pFilePath, cwd);
+
+    int fd = x86UNIXOpen(prefPathName, O_RDONLY);
+    if (fd == -1)
+       fd = x86UNIXOpen(gamePathName, O_RDONLY);
+    if (fd == -1)
+       return NULL;
+
+    struct stat fStat;
+    if (fstat(fd, &fStat) < 0 || (fStat.st_mode & S_IFMT) != S_IFREG ||
+        fStat.st_size == 0 || fStat.st_size != (off_t)(U32)fStat.st_size)
+    {
+       x86UNIXClose(fd);
+       return NULL;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void *base = mmap(NULL, fStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    x86UNIXClose(fd);
+    if (base == MAP_FAILED)
+       return NULL;
+
+    size = (U32)fStat.st_size;
+    return base;
+ }
+
+ void Platform::unmapFile(const void *base, U32 size, void *handle)
+ {
+    if (base)
+       munmap((void *)base, size);
+ }
+
  //-----------------------------------------------------------------------------
  bool Platform::isDirectory(const char *pDirPath)
  {
@@ -19,6 +19,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <fcntl.h>
 
 /* for PROTO_IPX */
 #if defined(__linux__)
@@ -37,8 +38,19 @@
 #include "platform/gameInterface.h"
 #include "core/fileStream.h"
 #include "core/tVector.h"
+#include "platform/metrics.h"
+#include "platform/platformThread.h"
+#include "math/mMathFn.h"
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+// recvmmsg() and sendmmsg() move a whole batch of datagrams per system call.
+#define TORQUE_NET_MMSG
+#endif
 
 static Net::Error getLastError();
+static void startIOThread();
+static void stopIOThread();
+static void flushIOSends();
 static S32 defaultPort = 28000;
 static S32 netPort = 0;
 static int ipxSocket = InvalidSocket;
@@ -128,30 +140,15 @@ static void netToIPSocketAddress(const NetAddress *address, struct sockaddr_in *
    dMemset(sockAddr, 0, sizeof(struct sockaddr_in));
    sockAddr->sin_family = AF_INET;
    sockAddr->sin_port = htons(address->port);
-   char tAddr[20];
-   dSprintf(tAddr, 20, "%d.%d.%d.%d\n", address->netNum[0], address->netNum[1], address->netNum[2], address->netNum[3]);
-//fprintf(stdout,"netToIPSocketAddress(): %s\n",tAddr);fflush(NULL);
-   sockAddr->sin_addr.s_addr = inet_addr(tAddr);
-//   sockAddr->sin_addr.s_addr = address->netNum[0];  // hopefully this will work.
+   // Both are in network order, first octet first.
+   dMemcpy(&sockAddr->sin_addr.s_addr, address->netNum, 4);
 }
 
 static void IPSocketToNetAddress(const struct sockaddr_in *sockAddr, NetAddress *address)
 {
    address->type = NetAddress::IPAddress;
    address->port = htons(sockAddr->sin_port);
-   char *tAddr;
-   tAddr = inet_ntoa(sockAddr->sin_addr);
-//fprintf(stdout,"IPSocketToNetAddress(): %s\n",tAddr);fflush(NULL);
-   U8 nets[4];
-   nets[0] = atoi(strtok(tAddr, "."));
-   nets[1] = atoi(strtok(NULL, "."));
-   nets[2] = atoi(strtok(NULL, "."));
-   nets[3] = atoi(strtok(NULL, "."));
-//fprintf(stdout,"0 = %d, 1 = %d, 2 = %d, 3 = %d\n", nets[0], nets[1], nets[2], nets[3]);
-   address->netNum[0] = nets[0];
-   address->netNum[1] = nets[1];
-   address->netNum[2] = nets[2];
-   address->netNum[3] = nets[3];
+   dMemcpy(address->netNum, &sockAddr->sin_addr.s_addr, 4);
 }
 
 static void netToIPXSocketAddress(const NetAddress *address, sockaddr_ipx *sockAddr)
@@ -319,6 +316,8 @@ Net::Error Net::sendtoSocket(NetSocket socket, const U8 *buffer, int bufferSize)
 
 bool Net::openPort(S32 port)
 {
+   stopIOThread();
+
    if(udpSocket != InvalidSocket)
       close(udpSocket);
    if(ipxSocket != InvalidSocket)
@@ -372,17 +371,545 @@ bool Net::openPort(S32 port)
       }
    }
    netPort = port;
+   startIOThread();
    return ipxSocket != InvalidSocket || udpSocket != InvalidSocket;
 }
 
 void Net::closePort()
 {
+   stopIOThread();
+
    if(ipxSocket != InvalidSocket)
       close(ipxSocket);
    if(udpSocket != InvalidSocket)
       close(udpSocket);
 }
 
+//------------------------------------------------------------------------------
+// Batched datagrams
+//
+// Incoming packets are read a batch at a time into a pool of events that is
+// reused, and handed straight to the game from there. Packets sent between
+// Net::beginSendBatch() and endSendBatch() are queued and go out together.
+// Where recvmmsg()/sendmmsg() aren't available, or $pref::Net::BatchIO is
+// off, the same code makes one system call per datagram instead.
+
+extern bool gNetBatchIO;
+
+enum
+{
+   DatagramBatchSize = 64,
+};
+
+static Metric sRecvCalls("net.recvCalls", Metric::Counter);
+static Metric sSendCalls("net.sendCalls", Metric::Counter);
+
+/// Datagrams waiting to be sent.
+struct DatagramQueue
+{
+   U32         count;
+   sockaddr_in addrs[DatagramBatchSize];
+   U32         sizes[DatagramBatchSize];
+   U8          data[DatagramBatchSize][MaxPacketDataSize];
+};
+
+static DatagramQueue *      gSendQueue = NULL;
+static U32                  gSendBatchDepth = 0;
+static PacketReceiveEvent * gRecvEvents = NULL;
+static bool                 gRecvEventsInUse = false;
+
+/// Read up to max datagrams from fd. Each one's payload and size go in an
+/// event, and where it came from in addrs.
+/// @return How many were read.
+static U32 receiveDatagrams(int fd, PacketReceiveEvent *events, sockaddr_in *addrs, U32 max, U32 &calls)
+{
+#ifdef TORQUE_NET_MMSG
+   if(gNetBatchIO)
+   {
+      mmsghdr msgs[DatagramBatchSize];
+      iovec iov[DatagramBatchSize];
+      dMemset(msgs, 0, sizeof(mmsghdr) * max);
+      for(U32 i = 0; i < max; i++)
+      {
+         iov[i].iov_base = events[i].data;
+         iov[i].iov_len = MaxPacketDataSize;
+         msgs[i].msg_hdr.msg_iov = &iov[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+         msgs[i].msg_hdr.msg_name = &addrs[i];
+         msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      }
+
+      S32 count = recvmmsg(fd, msgs, max, MSG_DONTWAIT, NULL);
+      calls++;
+      if(count > 0)
+      {
+         for(S32 i = 0; i < count; i++)
+            events[i].size = PacketReceiveEventHeaderSize + msgs[i].msg_len;
+         return count;
+      }
+      if(count == 0 || errno != ENOSYS)
+         return 0;
+
+      // Built against a newer kernel than we're running on.
+      gNetBatchIO = false;
+   }
+#endif
+
+   U32 count = 0;
+   while(count < max)
+   {
+      socklen_t addrLen = sizeof(sockaddr_in);
+      S32 bytesRead = recvfrom(fd, (char *) events[count].data, MaxPacketDataSize, 0,
+                               (sockaddr *) &addrs[count], &addrLen);
+      calls++;
+      if(bytesRead < 0)
+         break;
+      events[count].size = PacketReceiveEventHeaderSize + bytesRead;
+      count++;
+   }
+   return count;
+}
+
+/// Send count datagrams on fd. One the socket won't take is dropped, as it
+/// would be on the wire.
+static void sendDatagrams(int fd, sockaddr_in *addrs, const U32 *sizes, U8 (*data)[MaxPacketDataSize],
+                          U32 count, U32 &calls)
+{
+   U32 sent = 0;
+
+#ifdef TORQUE_NET_MMSG
+   if(gNetBatchIO)
+   {
+      mmsghdr msgs[DatagramBatchSize];
+      iovec iov[DatagramBatchSize];
+      count = getMin(count, U32(DatagramBatchSize));
+      dMemset(msgs, 0, sizeof(mmsghdr) * count);
+      for(U32 i = 0; i < count; i++)
+      {
+         iov[i].iov_base = data[i];
+         iov[i].iov_len = sizes[i];
+         msgs[i].msg_hdr.msg_iov = &iov[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+         msgs[i].msg_hdr.msg_name = &addrs[i];
+         msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      }
+
+      while(sent < count)
+      {
+         S32 result = sendmmsg(fd, msgs + sent, count - sent, 0);
+         calls++;
+         if(result > 0)
+            sent += result;
+         else if(result < 0 && errno == ENOSYS)
+         {
+            gNetBatchIO = false;
+            break;
+         }
+         else
+         {
+            // Skip the one that failed, the next may be for somewhere else.
+            sent++;
+         }
+      }
+   }
+#endif
+
+   for(U32 i = sent; i < count; i++)
+   {
+      ::sendto(fd, (const char *) data[i], sizes[i], 0, (sockaddr *) &addrs[i], sizeof(sockaddr_in));
+      calls++;
+   }
+}
+
+/// Send everything in the queue on fd and empty it.
+static void sendDatagrams(int fd, DatagramQueue &queue, U32 &calls)
+{
+   sendDatagrams(fd, queue.addrs, queue.sizes, queue.data, queue.count, calls);
+   queue.count = 0;
+}
+
+static void flushSendQueue()
+{
+   if(!gSendQueue || !gSendQueue->count)
+      return;
+
+   U32 calls = 0;
+   if(udpSocket != InvalidSocket)
+      sendDatagrams(udpSocket, *gSendQueue, calls);
+   else
+      gSendQueue->count = 0;
+   sSendCalls.add(calls);
+}
+
+void Net::beginSendBatch()
+{
+   gSendBatchDepth++;
+}
+
+void Net::endSendBatch()
+{
+   AssertFatal(gSendBatchDepth, "Net::endSendBatch - not in a batch!");
+   if(--gSendBatchDepth)
+      return;
+
+   flushSendQueue();
+   flushIOSends();
+}
+
+//------------------------------------------------------------------------------
+
+static void dispatchPacket(PacketReceiveEvent &event)
+{
+   NetAddress &na = event.sourceAddress;
+   if(na.type == NetAddress::IPAddress &&
+      na.netNum[0] == 127 &&
+      na.netNum[1] == 0 &&
+      na.netNum[2] == 0 &&
+      na.netNum[3] == 1 &&
+      na.port == netPort)
+      return;
+   if(event.size <= PacketReceiveEventHeaderSize)
+      return;
+
+   // A journal has to see every event go through the queue. Otherwise,
+   // straight to the game out of our buffer.
+   if(Game->isJournalReading() || Game->isJournalWriting())
+      Game->postEvent(event);
+   else
+      Game->processEvent(&event);
+}
+
+//------------------------------------------------------------------------------
+// Network thread
+//
+// With $pref::Net::IOThread set, multithreaded builds hand the game socket
+// to a thread of its own from openPort() on. It reads packets as they
+// arrive, stamps them with the time, throws out any whose connection header
+// is malformed, and queues the rest for Net::process() to give the game.
+// Packets to send are queued the other way. Each queue is a ring with one
+// writer and one reader, so neither thread ever waits on the other.
+
+extern bool gNetIOThread;
+
+#ifdef TORQUE_MULTITHREAD
+
+enum
+{
+   IORingSize = 1024,      ///< Packets each way, a power of two.
+};
+
+static Metric sIORejected("net.ioRejected", Metric::Counter);
+static Metric sIODropped("net.ioDropped", Metric::Counter);
+
+struct NetIORings
+{
+   // Received packets, written by the network thread.
+   PacketReceiveEvent recv[IORingSize];
+   sockaddr_in        recvAddrs[IORingSize];
+   U32                recvTime[IORingSize];    ///< Real milliseconds.
+   volatile U32       recvHead;
+   volatile U32       recvTail;
+
+   // Packets to send, written by the main thread.
+   sockaddr_in        sendAddrs[IORingSize];
+   U32                sendSizes[IORingSize];
+   U8                 sendData[IORingSize][MaxPacketDataSize];
+   volatile U32       sendHead;
+   volatile U32       sendTail;
+};
+
+class NetIOThread : public Thread
+{
+   int          mSocket;
+   int          mWakePipe[2];
+   volatile U32 mStop;
+
+   void sendQueued();
+   void receive();
+
+public:
+   NetIORings  *mRings;
+
+   NetIOThread(int socket);
+   ~NetIOThread();
+
+   void run(S32 arg = 0);
+
+   /// Get the thread out of poll() to look at the send queue.
+   void wake();
+   /// Send what's queued and wait for the thread to finish.
+   void stop();
+};
+
+static NetIOThread *gIOThread = NULL;
+static U32          gIOThreadGeneration = 0;   ///< Bumped each time gIOThread goes away.
+static bool         gIOSendPending = false;
+
+NetIOThread::NetIOThread(int socket) : Thread(0, 0, false)
+{
+   mSocket = socket;
+   mStop = 0;
+
+   mRings = new NetIORings;
+   mRings->recvHead = mRings->recvTail = 0;
+   mRings->sendHead = mRings->sendTail = 0;
+
+   if(pipe(mWakePipe) == 0)
+   {
+      fcntl(mWakePipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(mWakePipe[1], F_SETFL, O_NONBLOCK);
+   }
+   else
+      mWakePipe[0] = mWakePipe[1] = -1;
+}
+
+NetIOThread::~NetIOThread()
+{
+   if(mWakePipe[0] != -1)
+   {
+      close(mWakePipe[0]);
+      close(mWakePipe[1]);
+   }
+   delete mRings;
+}
+
+void NetIOThread::wake()
+{
+   // A full pipe (EAGAIN) already has a wake-up in it.
+   char c = 0;
+   if(mWakePipe[1] != -1)
+      while(::write(mWakePipe[1], &c, 1) == -1 && errno == EINTR)
+         ;
+}
+
+void NetIOThread::stop()
+{
+   dAtomicWrite(mStop, 1);
+   wake();
+   join();
+}
+
+/// Check the fixed part of a connection packet's header, the same checks
+/// ConnectionProtocol::processRawPacket() starts with.
+static bool validatePacket(const PacketReceiveEvent &event)
+{
+   if(event.size <= PacketReceiveEventHeaderSize)
+      return false;
+   U32 size = event.size - PacketReceiveEventHeaderSize;
+
+   // Info and handshake packets are checked by whoever reads them.
+   if(!(event.data[0] & 0x01))
+      return true;
+
+   // 1 bit game flag, 1 connect sequence, 9 sequence, 9 ack, 2 type, 3 ack bytes.
+   if(size < 4)
+      return false;
+   U32 header = event.data[0] | (event.data[1] << 8) | (event.data[2] << 16) | (event.data[3] << 24);
+   U32 packetType = (header >> 20) & 0x3;
+   U32 ackBytes = (header >> 22) & 0x7;
+   return packetType < 3 && ackBytes <= 4 && size * 8 >= 25 + ackBytes * 8;
+}
+
+void NetIOThread::receive()
+{
+   U32 calls = 0;
+   bool received = false;
+   for(;;)
+   {
+      U32 head = mRings->recvHead;
+      U32 room = IORingSize - (head - dAtomicRead(mRings->recvTail));
+      if(!room)
+      {
+         // The game has fallen behind. Drop packets rather than spin on a
+         // socket that stays readable.
+         U8 discard[MaxPacketDataSize];
+         while(recv(mSocket, discard, sizeof(discard), MSG_DONTWAIT) >= 0)
+         {
+            calls++;
+            sIODropped.add();
+         }
+         break;
+      }
+
+      U32 index = head & (IORingSize - 1);
+      U32 span = getMin(getMin(room, IORingSize - index), U32(DatagramBatchSize));
+      U32 count = receiveDatagrams(mSocket, &mRings->recv[index], &mRings->recvAddrs[index], span, calls);
+      if(!count)
+         break;
+
+      U32 now = Platform::getRealMilliseconds();
+      for(U32 i = index; i < index + count; i++)
+      {
+         PacketReceiveEvent &event = mRings->recv[i];
+         IPSocketToNetAddress(&mRings->recvAddrs[i], &event.sourceAddress);
+         mRings->recvTime[i] = now;
+         if(!validatePacket(event))
+         {
+            // Left in place, Net::process() skips it.
+            event.size = PacketReceiveEventHeaderSize;
+            sIORejected.add();
+         }
+      }
+
+      dAtomicWrite(mRings->recvHead, head + count);
+      received = true;
+
+      if(count < span)
+         break;
+   }
+
+   sRecvCalls.add(calls);
+   if(received)
+      Platform::wakeMainLoop();
+}
+
+void NetIOThread::sendQueued()
+{
+   U32 calls = 0;
+   U32 tail = mRings->sendTail;
+   U32 head = dAtomicRead(mRings->sendHead);
+   while(tail != head)
+   {
+      U32 index = tail & (IORingSize - 1);
+      U32 span = getMin(getMin(head - tail, IORingSize - index), U32(DatagramBatchSize));
+      sendDatagrams(mSocket, &mRings->sendAddrs[index], &mRings->sendSizes[index], &mRings->sendData[index], span, calls);
+      tail += span;
+      dAtomicWrite(mRings->sendTail, tail);
+   }
+   sSendCalls.add(calls);
+}
+
+void NetIOThread::run(S32)
+{
+   pollfd fds[2];
+   fds[0].fd = mSocket;
+   fds[0].events = POLLIN;
+   fds[1].fd = mWakePipe[0];
+   fds[1].events = POLLIN;
+
+   while(!dAtomicRead(mStop))
+   {
+      fds[0].revents = fds[1].revents = 0;
+      poll(fds, mWakePipe[0] != -1 ? 2 : 1, 100);
+
+      if(fds[1].revents & POLLIN)
+      {
+         char buffer[64];
+         while(read(mWakePipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+      }
+
+      sendQueued();
+      receive();
+   }
+
+   sendQueued();
+}
+
+/// Queue a packet for the network thread to send.
+/// @return false if the queue is full.
+static bool queueIOSend(const NetAddress *address, const U8 *buffer, S32 bufferSize)
+{
+   NetIORings *rings = gIOThread->mRings;
+   U32 head = rings->sendHead;
+   if(head - dAtomicRead(rings->sendTail) == IORingSize)
+      return false;
+
+   U32 index = head & (IORingSize - 1);
+   netToIPSocketAddress(address, &rings->sendAddrs[index]);
+   rings->sendSizes[index] = getMin(U32(bufferSize), U32(MaxPacketDataSize));
+   dMemcpy(rings->sendData[index], buffer, rings->sendSizes[index]);
+   dAtomicWrite(rings->sendHead, head + 1);
+
+   // A batch wakes the thread once, at the end.
+   if(gSendBatchDepth)
+      gIOSendPending = true;
+   else
+      gIOThread->wake();
+   return true;
+}
+
+/// Hand what the network thread has received to the game.
+static void processIOQueue()
+{
+   NetIORings *rings = gIOThread->mRings;
+   U32 generation = gIOThreadGeneration;
+   U32 head = dAtomicRead(rings->recvHead);
+   if(rings->recvTail == head)
+      return;
+
+   // Turn the thread's real time stamps into virtual time.
+   U32 nowReal = Platform::getRealMilliseconds();
+   U32 nowVirtual = Platform::getVirtualMilliseconds();
+
+   // Handlers can run Net::process() again, or close the port and take the
+   // rings with them, so each packet comes off the ring before it goes out.
+   while(S32(head - rings->recvTail) > 0)
+   {
+      U32 tail = rings->recvTail;
+      U32 index = tail & (IORingSize - 1);
+      PacketReceiveEvent event = rings->recv[index];
+      event.arrivalTime = getMax(nowVirtual - (nowReal - rings->recvTime[index]), U32(1));
+      dAtomicWrite(rings->recvTail, tail + 1);
+
+      dispatchPacket(event);
+      if(gIOThreadGeneration != generation)
+         return;
+   }
+}
+
+static void startIOThread()
+{
+   if(!gNetIOThread || gIOThread || udpSocket == InvalidSocket)
+      return;
+
+   gIOThread = new NetIOThread(udpSocket);
+   gIOThread->start();
+   Con::printf("Network thread started.");
+}
+
+static void stopIOThread()
+{
+   if(!gIOThread)
+      return;
+
+   gIOThread->stop();
+   delete gIOThread;
+   gIOThread = NULL;
+   gIOThreadGeneration++;
+   gIOSendPending = false;
+}
+
+/// Wake the network thread for what a batch queued.
+static void flushIOSends()
+{
+   if(gIOSendPending)
+   {
+      gIOThread->wake();
+      gIOSendPending = false;
+   }
+}
+
+#else
+
+static void startIOThread()
+{
+   if(gNetIOThread)
+      Con::warnf("$pref::Net::IOThread needs a multithreaded build, ignored.");
+}
+
+static void stopIOThread()
+{
+}
+
+static void flushIOSends()
+{
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
 Net::Error Net::sendto(const NetAddress *address, const U8 *buffer, S32 bufferSize)
 {
    if(Game->isJournalReading())
@@ -398,10 +925,33 @@ Net::Error Net::sendto(const NetAddress *address, const U8 *buffer, S32 bufferSi
       else
          return NoError;
    }
+#ifdef TORQUE_MULTITHREAD
+   else if(gIOThread && queueIOSend(address, buffer, bufferSize))
+      return NoError;
+#endif
+   else if(gSendBatchDepth && udpSocket != InvalidSocket)
+   {
+      if(!gSendQueue)
+      {
+         gSendQueue = new DatagramQueue;
+         gSendQueue->count = 0;
+      }
+
+      // The caller's buffer is reused for the next packet, so take a copy.
+      U32 index = gSendQueue->count++;
+      netToIPSocketAddress(address, &gSendQueue->addrs[index]);
+      gSendQueue->sizes[index] = getMin(U32(bufferSize), U32(MaxPacketDataSize));
+      dMemcpy(gSendQueue->data[index], buffer, gSendQueue->sizes[index]);
+
+      if(gSendQueue->count == DatagramBatchSize)
+         flushSendQueue();
+      return NoError;
+   }
    else
    {
       sockaddr_in ipAddr;
       netToIPSocketAddress(address, &ipAddr);
+      sSendCalls.add();
       if(::sendto(udpSocket, (const char*)buffer, bufferSize, 0,
                   (sockaddr *) &ipAddr, sizeof(sockaddr_in)) == -1)
          return getLastError();
@@ -412,43 +962,59 @@ Net::Error Net::sendto(const NetAddress *address, const U8 *buffer, S32 bufferSi
 
 void Net::process()
 {
-   sockaddr sa;
+#ifdef TORQUE_MULTITHREAD
+   if(gIOThread)
+      processIOQueue();
+   else
+#endif
+   if(udpSocket != InvalidSocket)
+   {
+      // Handlers can run Net::process() again before the batch is done, so
+      // a nested call reads into a batch of its own.
+      PacketReceiveEvent *events;
+      if(gRecvEventsInUse)
+         events = new PacketReceiveEvent[DatagramBatchSize];
+      else
+      {
+         if(!gRecvEvents)
+            gRecvEvents = new PacketReceiveEvent[DatagramBatchSize];
+         events = gRecvEvents;
+         gRecvEventsInUse = true;
+      }
 
+      sockaddr_in addrs[DatagramBatchSize];
+      U32 count, calls = 0;
+      do
+      {
+         count = receiveDatagrams(udpSocket, events, addrs, DatagramBatchSize, calls);
+         for(U32 i = 0; i < count; i++)
+         {
+            IPSocketToNetAddress(&addrs[i], &events[i].sourceAddress);
+            dispatchPacket(events[i]);
+         }
+      } while(count == DatagramBatchSize && udpSocket != InvalidSocket);
+      sRecvCalls.add(calls);
+
+      if(events == gRecvEvents)
+         gRecvEventsInUse = false;
+      else
+         delete [] events;
+   }
+
+   sockaddr sa;
    PacketReceiveEvent receiveEvent;
-   for(;;)
+   while(ipxSocket != InvalidSocket)
    {
       U32 addrLen = sizeof(sa);
-      S32 bytesRead = -1;
-      if(udpSocket != InvalidSocket)
-         bytesRead = recvfrom(udpSocket, (char *) receiveEvent.data, MaxPacketDataSize, 0, &sa, &addrLen);
-      if(bytesRead == -1 && ipxSocket != InvalidSocket)
-      {
-         addrLen = sizeof(sa);
-         bytesRead = recvfrom(ipxSocket, (char *) receiveEvent.data, MaxPacketDataSize, 0, &sa, &addrLen);
-      }
-      
+      S32 bytesRead = recvfrom(ipxSocket, (char *) receiveEvent.data, MaxPacketDataSize, 0, &sa, &addrLen);
       if(bytesRead == -1)
          break;
-      
-      if(sa.sa_family == AF_INET)
-         IPSocketToNetAddress((sockaddr_in *) &sa, &receiveEvent.sourceAddress);
-      else if(sa.sa_family == AF_IPX)
-         IPXSocketToNetAddress((sockaddr_ipx *) &sa, &receiveEvent.sourceAddress);
-      else
-         continue;
-         
-      NetAddress &na = receiveEvent.sourceAddress;
-      if(na.type == NetAddress::IPAddress &&
-         na.netNum[0] == 127 &&
-         na.netNum[1] == 0 &&
-         na.netNum[2] == 0 &&
-         na.netNum[3] == 1 &&
-         na.port == netPort)
-         continue;
-      if(bytesRead <= 0)
+      if(sa.sa_family != AF_IPX)
          continue;
+
+      IPXSocketToNetAddress((sockaddr_ipx *) &sa, &receiveEvent.sourceAddress);
       receiveEvent.size = PacketReceiveEventHeaderSize + bytesRead;
-      Game->postEvent(receiveEvent);
+      dispatchPacket(receiveEvent);
    }
 
    // process the polled sockets.  This blob of code performs functions
@@ -621,6 +1187,77 @@ void Net::process()
    }
 }
                  
+//-----------------------------------------------------------------------------
+// Idle waiting lives here since the sockets are most of what there is to
+// wait on.
+
+static int sgWakePipe[2] = { -1, -1 };
+
+void Platform::waitForEvents(U32 timeout)
+{
+   if (sgWakePipe[0] == -1 && pipe(sgWakePipe) == 0)
+   {
+      fcntl(sgWakePipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(sgWakePipe[1], F_SETFL, O_NONBLOCK);
+   }
+
+#ifndef DEDICATED
+   // SDL input can't be waited on, so keep polling it often enough that
+   // nobody notices
+   timeout = getMin(timeout, U32(10));
+#endif
+
+   static Vector<pollfd> fds;
+   fds.clear();
+
+   pollfd pfd;
+   pfd.revents = 0;
+   if (sgWakePipe[0] != -1)
+   {
+      pfd.fd = sgWakePipe[0];
+      pfd.events = POLLIN;
+      fds.push_back(pfd);
+   }
+   if (udpSocket != InvalidSocket)
+   {
+      pfd.fd = udpSocket;
+      pfd.events = POLLIN;
+      fds.push_back(pfd);
+   }
+   for (S32 i = 0; i < gPolledSockets.size(); i++)
+   {
+      Socket *sock = gPolledSockets[i];
+      if (sock->state == NameLookupRequired)
+         continue;
+      pfd.fd = sock->fd;
+      pfd.events = sock->state == ConnectionPending ? POLLOUT : POLLIN;
+      fds.push_back(pfd);
+   }
+
+   poll(fds.address(), fds.size(), timeout);
+
+   if (sgWakePipe[0] != -1)
+   {
+      char buffer[64];
+      while (read(sgWakePipe[0], buffer, sizeof(buffer)) > 0)
+         ;
+   }
+}
+
+void Platform::wakeMainLoop()
+{
+   if (sgWakePipe[1] != -1)
+   {
+      // Anything but an interrupted write is fine: EAGAIN means the pipe is
+      // full, so the main loop already has a wake-up pending.
+      char c = 0;
+      while (write(sgWakePipe[1], &c, 1) == -1 && errno == EINTR)
+         ;
+   }
+}
+
+//-----------------------------------------------------------------------------
+
 NetSocket Net::openSocket()
 {
    int retSocket;
@@ -906,3 +1543,97 @@ Net::Error getLastError()
    return Net::UnknownError;
 }
 
+
+//------------------------------------------------------------------------------
+
+static void runLoopbackSoak(int sendFd, int recvFd, const sockaddr_in &recvAddr, S32 ticks, S32 perTick, S32 size)
+{
+   DatagramQueue *queue = new DatagramQueue;
+   PacketReceiveEvent *events = new PacketReceiveEvent[DatagramBatchSize];
+   sockaddr_in addrs[DatagramBatchSize];
+   queue->count = 0;
+
+   U32 sendCalls = 0, recvCalls = 0, received = 0;
+   U64 start = Platform::getRealMicroseconds();
+
+   for(S32 t = 0; t < ticks; t++)
+   {
+      for(S32 p = 0; p < perTick; p++)
+      {
+         U32 index = queue->count++;
+         queue->addrs[index] = recvAddr;
+         queue->sizes[index] = size;
+         dMemset(queue->data[index], p, size);
+         if(queue->count == DatagramBatchSize)
+            sendDatagrams(sendFd, *queue, sendCalls);
+      }
+      sendDatagrams(sendFd, *queue, sendCalls);
+
+      // Drain it the way Net::process() does.
+      U32 count;
+      do
+      {
+         count = receiveDatagrams(recvFd, events, addrs, DatagramBatchSize, recvCalls);
+         received += count;
+      } while(count);
+   }
+
+   F64 seconds = (Platform::getRealMicroseconds() - start) / 1000000.0;
+   Con::printf("  %-9s %d of %d packets arrived, %.0f packets/s, %.2f send and %.2f receive calls per tick",
+      gNetBatchIO ? "batched:" : "single:", received, ticks * perTick, seconds > 0 ? received / seconds : 0.0,
+      F32(sendCalls) / ticks, F32(recvCalls) / ticks);
+
+   delete [] events;
+   delete queue;
+}
+
+ConsoleFunction(netLoopbackSoak, void, 1, 4, "(int ticks=500, int packetsPerTick=256, int packetSize=200) - "
+                "Push packets through the datagram layer over loopback, with and without batching, and "
+                "report the packet rate and system calls per tick.")
+{
+   S32 ticks = argc > 1 ? getMax(dAtoi(argv[1]), 1) : 500;
+   S32 perTick = argc > 2 ? getMax(dAtoi(argv[2]), 1) : 256;
+   S32 size = argc > 3 ? mClamp(dAtoi(argv[3]), 1, S32(MaxPacketDataSize)) : 200;
+
+   int sendFd = socket(AF_INET, SOCK_DGRAM, 0);
+   int recvFd = socket(AF_INET, SOCK_DGRAM, 0);
+
+   sockaddr_in recvAddr;
+   dMemset(&recvAddr, 0, sizeof(recvAddr));
+   recvAddr.sin_family = AF_INET;
+   recvAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   socklen_t addrLen = sizeof(recvAddr);
+
+   if(sendFd == InvalidSocket || recvFd == InvalidSocket ||
+      ::bind(recvFd, (sockaddr *) &recvAddr, sizeof(recvAddr)) ||
+      getsockname(recvFd, (sockaddr *) &recvAddr, &addrLen))
+   {
+      Con::errorf("netLoopbackSoak - unable to open the loopback sockets.");
+      if(sendFd != InvalidSocket)
+         close(sendFd);
+      if(recvFd != InvalidSocket)
+         close(recvFd);
+      return;
+   }
+
+   // Room for a whole tick, so the test measures the calls and not drops.
+   S32 bufferSize = 8 << 20;
+   setsockopt(recvFd, SOL_SOCKET, SO_RCVBUF, (char *) &bufferSize, sizeof(bufferSize));
+   setsockopt(sendFd, SOL_SOCKET, SO_SNDBUF, (char *) &bufferSize, sizeof(bufferSize));
+   Net::setBlocking(sendFd, false);
+   Net::setBlocking(recvFd, false);
+
+   Con::printf("Loopback soak, %d ticks of %d packets of %d bytes:", ticks, perTick, size);
+
+   bool batchIO = gNetBatchIO;
+#ifdef TORQUE_NET_MMSG
+   gNetBatchIO = true;
+   runLoopbackSoak(sendFd, recvFd, recvAddr, ticks, perTick, size);
+#endif
+   gNetBatchIO = false;
+   runLoopbackSoak(sendFd, recvFd, recvAddr, ticks, perTick, size);
+   gNetBatchIO = batchIO;
+
+   close(sendFd);
+   close(recvFd);
+}
@@ -50,6 +50,13 @@ U32 Platform::getRealMilliseconds()
    return x86UNIXGetTickCount();
 }
 
+U64 Platform::getRealMicroseconds()
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return U64(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
 U32 Platform::getVirtualMilliseconds()
 {
    return x86UNIXState->currentTime;
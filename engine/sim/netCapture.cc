@@ -0,0 +1,484 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "platform/event.h"
+#include "sim/netConnection.h"
+#include "core/bitStream.h"
+#include "core/fileStream.h"
+#include "core/resManager.h"
+#include "console/console.h"
+
+// Capture file layout, all little endian:
+//
+//   U32 magic, U32 version, string connection class
+//   U32 connect request bit count, connect request bytes
+//   then until the end of the file, one per data packet:
+//      U32 milliseconds since the connection was accepted
+//      U32 payload bit count, payload bytes
+
+enum
+{
+   CaptureMagic   = 0x5041434E,   // "NCAP"
+   CaptureVersion = 1,
+};
+
+static bool sCapturing = false;
+static char sCapturePath[1024];
+static U32  sCaptureCount = 0;
+
+//-----------------------------------------------------------------------------
+
+/// Write the bits left in a stream, leaving its position alone.
+static void writeCaptureBits(Stream *out, BitStream *stream)
+{
+   U8 buffer[MaxPacketDataSize];
+   dMemset(buffer, 0, sizeof(buffer));
+
+   U32 start = stream->getCurPos();
+   U32 bitCount = getMin((stream->getStreamSize() << 3) - start, U32(MaxPacketDataSize << 3));
+   stream->readBits(bitCount, buffer);
+   stream->setCurPos(start);
+
+   out->write(bitCount);
+   out->write((bitCount + 7) >> 3, buffer);
+}
+
+void NetConnection::startTrafficCapture(const char *path)
+{
+   dStrncpy(sCapturePath, path, sizeof(sCapturePath) - 1);
+   sCapturePath[sizeof(sCapturePath) - 1] = 0;
+   sCapturing = true;
+}
+
+void NetConnection::stopTrafficCapture()
+{
+   sCapturing = false;
+   for(NetConnection *walk = getConnectionList(); walk; walk = walk->getNext())
+      walk->endCapture();
+}
+
+bool NetConnection::isCapturingTraffic()
+{
+   return sCapturing;
+}
+
+void NetConnection::beginCapture(BitStream *connectRequest)
+{
+   if(mReplayClient)
+      return;
+
+   char fileName[1024];
+   dSprintf(fileName, sizeof(fileName), "%s/client%d.ncap", sCapturePath, sCaptureCount++);
+
+   FileStream *fs = new FileStream;
+   if(!ResourceManager->openFileForWrite(*fs, fileName))
+   {
+      Con::errorf("NetConnection::beginCapture - could not open %s.", fileName);
+      delete fs;
+      return;
+   }
+
+   fs->write(U32(CaptureMagic));
+   fs->write(U32(CaptureVersion));
+   fs->writeString(getClassName());
+   writeCaptureBits(fs, connectRequest);
+
+   mCaptureStream = fs;
+   mCaptureStartTime = Platform::getVirtualMilliseconds();
+   Con::printf("Capturing connection %d to %s", getId(), fileName);
+}
+
+void NetConnection::endCapture()
+{
+   if(mCaptureStream)
+   {
+      delete mCaptureStream;
+      mCaptureStream = NULL;
+   }
+}
+
+void NetConnection::capturePacket(BitStream *stream)
+{
+   mCaptureStream->write(U32(Platform::getVirtualMilliseconds() - mCaptureStartTime));
+   writeCaptureBits(mCaptureStream, stream);
+}
+
+//-----------------------------------------------------------------------------
+
+struct CapturedPacket
+{
+   U32 time;
+   U32 bitCount;
+   const U8 *data;
+};
+
+struct CaptureRecording
+{
+   char className[256];
+   U8 *buffer;
+   U32 requestBits;
+   const U8 *request;
+   Vector<CapturedPacket> packets;
+};
+
+struct ReplayClient
+{
+   SimObjectId connectionId;
+   CaptureRecording *recording;
+   U32 nextPacket;
+};
+
+static bool sReplaying = false;
+static bool sReplayQuitWhenDone = false;
+static U32  sReplayStartTime;
+static U64  sReplayRealStart;
+static Vector<CaptureRecording *> sRecordings;
+static Vector<ReplayClient> sReplayClients;
+
+static Vector<U32> sReplayTickTimes;
+static U64 sReplayServerMicros;
+static U32 sReplayPacketsSent;
+static U64 sReplayBytesSent;
+static U64 sReplayGhostTotal;
+static U32 sReplayGhostMax;
+
+static bool readCaptureU32(const U8 *&ptr, const U8 *end, U32 *value)
+{
+   if(end - ptr < 4)
+      return false;
+   U32 raw;
+   dMemcpy(&raw, ptr, 4);
+   *value = convertLEndianToHost(raw);
+   ptr += 4;
+   return true;
+}
+
+static const U8 *readCaptureBits(const U8 *&ptr, const U8 *end, U32 *bitCount)
+{
+   if(!readCaptureU32(ptr, end, bitCount) || *bitCount > (MaxPacketDataSize << 3))
+      return NULL;
+   U32 bytes = (*bitCount + 7) >> 3;
+   if(U32(end - ptr) < bytes)
+      return NULL;
+   const U8 *data = ptr;
+   ptr += bytes;
+   return data;
+}
+
+static CaptureRecording *loadCaptureRecording(const char *fileName)
+{
+   Stream *stream = ResourceManager->openStream(fileName);
+   if(!stream)
+      return NULL;
+
+   U32 magic, version;
+   stream->read(&magic);
+   stream->read(&version);
+   if(magic != CaptureMagic || version != CaptureVersion)
+   {
+      ResourceManager->closeStream(stream);
+      return NULL;
+   }
+
+   CaptureRecording *recording = new CaptureRecording;
+   stream->readString(recording->className);
+
+   U32 size = stream->getStreamSize() - stream->getPosition();
+   recording->buffer = (U8 *) dMalloc(size);
+   stream->read(size, recording->buffer);
+   bool ok = stream->getStatus() != Stream::IOError;
+   ResourceManager->closeStream(stream);
+
+   const U8 *ptr = recording->buffer;
+   const U8 *end = ptr + size;
+   recording->request = readCaptureBits(ptr, end, &recording->requestBits);
+   if(!ok || !recording->request)
+   {
+      dFree(recording->buffer);
+      delete recording;
+      return NULL;
+   }
+
+   // A capture cut off mid packet just ends early.
+   CapturedPacket packet;
+   while(readCaptureU32(ptr, end, &packet.time) && (packet.data = readCaptureBits(ptr, end, &packet.bitCount)) != NULL)
+      recording->packets.push_back(packet);
+   return recording;
+}
+
+static void freeCaptureRecordings()
+{
+   for(U32 i = 0; i < sRecordings.size(); i++)
+   {
+      dFree(sRecordings[i]->buffer);
+      delete sRecordings[i];
+   }
+   sRecordings.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+static bool startTrafficReplay(const char *pattern, U32 clientCount)
+{
+   const char *fn;
+   ResourceObject *match = NULL;
+   while((match = ResourceManager->findMatch(pattern, &fn, match)) != NULL)
+   {
+      CaptureRecording *recording = loadCaptureRecording(fn);
+      if(recording)
+         sRecordings.push_back(recording);
+      else
+         Con::errorf("Traffic replay: %s is not a traffic capture.", fn);
+   }
+   if(!sRecordings.size())
+   {
+      Con::errorf("Traffic replay: no captures match %s.", pattern);
+      return false;
+   }
+
+   sReplayTickTimes.clear();
+   sReplayServerMicros = 0;
+   sReplayPacketsSent = 0;
+   sReplayBytesSent = 0;
+   sReplayGhostTotal = 0;
+   sReplayGhostMax = 0;
+
+   // Clients take the captures in turn.
+   for(U32 i = 0; i < clientCount; i++)
+   {
+      CaptureRecording *recording = sRecordings[i % sRecordings.size()];
+      ConsoleObject *co = ConsoleObject::create(recording->className);
+      NetConnection *conn = dynamic_cast<NetConnection *>(co);
+      if(!conn || !conn->canRemoteCreate())
+      {
+         Con::errorf("Traffic replay: can't create a %s.", recording->className);
+         delete co;
+         continue;
+      }
+
+      if(!conn->connectReplayClient(recording->request, recording->requestBits, i))
+         continue;
+
+      sReplayClients.increment();
+      sReplayClients.last().connectionId = conn->getId();
+      sReplayClients.last().recording = recording;
+      sReplayClients.last().nextPacket = 0;
+   }
+   if(!sReplayClients.size())
+   {
+      freeCaptureRecordings();
+      return false;
+   }
+
+   Con::printf("Traffic replay: %d clients from %d captures", sReplayClients.size(), sRecordings.size());
+   sReplaying = true;
+   sReplayStartTime = Platform::getVirtualMilliseconds();
+   sReplayRealStart = Platform::getRealMicroseconds();
+   return true;
+}
+
+static S32 QSORT_CALLBACK cmpTickTimes(const void *a, const void *b)
+{
+   U32 ta = *(const U32 *) a;
+   U32 tb = *(const U32 *) b;
+   return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static F32 getTickPercentile(F32 pct)
+{
+   U32 index = U32(pct * (sReplayTickTimes.size() - 1) / 100.0f + 0.5f);
+   return sReplayTickTimes[index] / 1000.0f;
+}
+
+static void stopTrafficReplay()
+{
+   if(!sReplaying)
+      return;
+   sReplaying = false;
+
+   U32 clients = sReplayClients.size();
+   U32 ticks = sReplayTickTimes.size();
+   F32 seconds = (Platform::getRealMicroseconds() - sReplayRealStart) / 1000000.0f;
+
+   Con::printf("Traffic replay finished: %d clients, %.1f seconds", clients, seconds);
+   if(ticks)
+   {
+      dQsort(sReplayTickTimes.address(), ticks, sizeof(U32), cmpTickTimes);
+
+      U64 tickTotal = 0;
+      for(U32 i = 0; i < ticks; i++)
+         tickTotal += sReplayTickTimes[i];
+      F32 meanTick = tickTotal / 1000.0f / ticks;
+
+      Con::printf("   %d server ticks: mean %.2f ms, median %.2f ms, 95th %.2f ms, max %.2f ms", ticks,
+         meanTick, getTickPercentile(50), getTickPercentile(95), getTickPercentile(100));
+      Con::printf("   per client: %.3f ms a tick, %.0f bytes a tick", meanTick / clients,
+         F32(sReplayBytesSent) / ticks / clients);
+      Con::printf("   server busy %.1f%% of the time", sReplayServerMicros / 10000.0f / getMax(seconds, 0.001f));
+      Con::printf("   sent %d packets, %d bytes", sReplayPacketsSent, U32(sReplayBytesSent));
+      Con::printf("   ghosts per client: mean %.1f, max %d", F32(sReplayGhostTotal) / ticks / clients, sReplayGhostMax);
+
+      Con::setFloatVariable("NetReplay::meanTickMs", meanTick);
+      Con::setFloatVariable("NetReplay::maxTickMs", getTickPercentile(100));
+      Con::setFloatVariable("NetReplay::bytesPerClientTick", F32(sReplayBytesSent) / ticks / clients);
+   }
+
+   for(U32 i = 0; i < clients; i++)
+   {
+      NetConnection *conn;
+      if(Sim::findObject(sReplayClients[i].connectionId, conn))
+         conn->deleteObject();
+   }
+   sReplayClients.clear();
+   freeCaptureRecordings();
+
+   if(sReplayQuitWhenDone)
+      Platform::postQuitMessage(0);
+}
+
+//-----------------------------------------------------------------------------
+
+bool NetConnection::connectReplayClient(const U8 *request, U32 bitCount, U32 index)
+{
+   // Nothing real comes from 0.0.0.0, so these never clash with a client.
+   NetAddress address;
+   dMemset(&address, 0, sizeof(address));
+   address.type = NetAddress::IPAddress;
+   address.port = index + 1;
+
+   mReplayClient = true;
+   registerObject();
+   setNetAddress(&address);
+   setNetworkConnection(true);
+   setSequence(index + 1);
+
+   BitStream stream((void *) request, (bitCount + 7) >> 3);
+   const char *errorString = NULL;
+   if(!readConnectRequest(&stream, &errorString))
+   {
+      Con::errorf("Traffic replay: client %d rejected (%s).", index, errorString ? errorString : "");
+      deleteObject();
+      return false;
+   }
+   onConnectionEstablished(false);
+   setEstablished();
+   setConnectSequence(index + 1);
+   return true;
+}
+
+void NetConnection::replayPacket(const U8 *payload, U32 bitCount)
+{
+   // A header acking everything we've sent, as in buildSendPacketHeader().
+   U8 buffer[MaxPacketDataSize + 16];
+   BitStream stream(buffer, sizeof(buffer));
+   stream.writeFlag(true);
+   stream.writeInt(mConnectSequence & 1, 1);
+   stream.writeInt(mLastSeqRecvd + 1, 9);
+   stream.writeInt(mLastSendSeq, 9);
+   stream.writeInt(0, 2);                 // data packet
+   stream.writeInt(4, 3);
+   stream.writeInt(0xFFFFFFFF, 32);
+   stream.writeBits(bitCount, payload);
+
+   U32 size = stream.getPosition();
+   stream.setBuffer(buffer, size);
+   processRawPacket(&stream);
+}
+
+void NetConnection::replayPacketSent(U32 bytes)
+{
+   sReplayPacketsSent++;
+   sReplayBytesSent += bytes;
+}
+
+void NetConnection::processTrafficReplay()
+{
+   if(!sReplaying)
+      return;
+
+   U32 elapsed = Platform::getVirtualMilliseconds() - sReplayStartTime;
+   bool done = true;
+   for(U32 i = 0; i < sReplayClients.size(); i++)
+   {
+      // The server may drop the connection while handling a packet.
+      ReplayClient &client = sReplayClients[i];
+      Vector<CapturedPacket> &packets = client.recording->packets;
+      NetConnection *conn;
+      while(client.nextPacket < packets.size() && packets[client.nextPacket].time <= elapsed &&
+            Sim::findObject(client.connectionId, conn))
+      {
+         CapturedPacket &packet = packets[client.nextPacket++];
+         conn->replayPacket(packet.data, packet.bitCount);
+      }
+
+      // Dropped by the server, or out of packets.
+      if(client.nextPacket < packets.size() && Sim::findObject(client.connectionId, conn))
+         done = false;
+   }
+
+   if(done)
+      stopTrafficReplay();
+}
+
+void NetConnection::endTrafficReplayFrame(bool ticked, U32 micros)
+{
+   if(!sReplaying)
+      return;
+
+   sReplayServerMicros += micros;
+   if(!ticked)
+      return;
+
+   sReplayTickTimes.push_back(micros);
+   for(U32 i = 0; i < sReplayClients.size(); i++)
+   {
+      NetConnection *conn;
+      if(Sim::findObject(sReplayClients[i].connectionId, conn) && conn->isGhostingFrom())
+      {
+         sReplayGhostTotal += conn->mGhostFreeIndex;
+         sReplayGhostMax = getMax(sReplayGhostMax, conn->mGhostFreeIndex);
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+
+ConsoleFunction(startNetCapture, void, 2, 2, "(string path) Capture the traffic from every client that "
+                "connects from now on, one file per client in path.")
+{
+   argc;
+   NetConnection::startTrafficCapture(argv[1]);
+}
+
+ConsoleFunction(stopNetCapture, void, 1, 1, "() Stop capturing client traffic and close the captures.")
+{
+   argc; argv;
+   NetConnection::stopTrafficCapture();
+}
+
+ConsoleFunction(replayNetCapture, bool, 3, 4, "(string pattern, int clients, [bool quitWhenDone]) "
+                "Drive this server with synthetic clients replaying the captures matching pattern, "
+                "and report the server's tick times and traffic when they run out.")
+{
+   if(sReplaying)
+   {
+      Con::errorf("replayNetCapture - a replay is already running.");
+      return false;
+   }
+
+   char pattern[1024];
+   if(!Con::expandScriptFilename(pattern, sizeof(pattern), argv[1]))
+      return false;
+
+   sReplayQuitWhenDone = argc > 3 && dAtob(argv[3]);
+   return startTrafficReplay(pattern, getMax(dAtoi(argv[2]), 1));
+}
+
+ConsoleFunction(stopNetReplay, void, 1, 1, "() End a capture replay early and report on it.")
+{
+   argc; argv;
+   stopTrafficReplay();
+}
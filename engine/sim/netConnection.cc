@@ -14,6 +14,7 @@
 #include "sim/pathManager.h"
 #include "console/consoleTypes.h"
 #include "sim/netInterface.h"
+#include "platform/metrics.h"
 #include <stdarg.h>
 
 S32 gNetBitsSent = 0;
@@ -42,23 +43,23 @@ class ConnectionMessageEvent : public NetEvent
 public:
    ConnectionMessageEvent(U32 msg=0, U32 seq=0, U32 gc=0)
       { message = msg; sequence = seq; ghostCount = gc;}
-   void pack(NetConnection *, BitStream *bstream)
+   void pack(NetConnection *ps, BitStream *bstream)
    {
       bstream->write(sequence);
       bstream->writeInt(message, 3);
-      bstream->writeInt(ghostCount, NetConnection::GhostIdBitSize + 1);
+      bstream->writeInt(ghostCount, ps->getGhostIdBitSize() + 1);
    }
-   void write(NetConnection *, BitStream *bstream)
+   void write(NetConnection *ps, BitStream *bstream)
    {
       bstream->write(sequence);
       bstream->writeInt(message, 3);
-      bstream->writeInt(ghostCount, NetConnection::GhostIdBitSize + 1);
+      bstream->writeInt(ghostCount, ps->getGhostIdBitSize() + 1);
    }
-   void unpack(NetConnection *, BitStream *bstream)
+   void unpack(NetConnection *ps, BitStream *bstream)
    {
       bstream->read(&sequence);
       message = bstream->readInt(3);
-      ghostCount = bstream->readInt(NetConnection::GhostIdBitSize + 1);
+      ghostCount = bstream->readInt(ps->getGhostIdBitSize() + 1);
    }
    void process(NetConnection *ps)
    {
@@ -78,6 +79,11 @@ void NetConnection::sendConnectionMessage(U32 message, U32 sequence, U32 ghostCo
 IMPLEMENT_CONOBJECT(NetConnection);
 
 NetConnection* NetConnection::mConnectionList = NULL;
+U32 NetConnection::smPacketArrivalTime = 0;
+bool NetConnection::smParallelGhosting = true;
+U32 NetConnection::smMaxGhosts = 1 << NetConnection::DefaultGhostIdBitSize;
+S32 NetConnection::smFileWindowSize = 16384;
+bool NetConnection::smCompressFiles = true;
 NetConnection* NetConnection::mHashTable[NetConnection::HashTableSize] = { NULL, };
 
 bool NetConnection::mFilesWereDownloaded = false;
@@ -149,6 +155,10 @@ void NetConnection::consoleInit()
    Con::addVariable("pref::Net::PacketRateToServer",  TypeS32, &gPacketRateToServer);
    Con::addVariable("pref::Net::PacketRateToClient",  TypeS32, &gPacketRateToClient);
    Con::addVariable("pref::Net::PacketSize",          TypeS32, &gPacketSize);
+   Con::addVariable("pref::Net::ParallelGhosting",    TypeBool, &smParallelGhosting);
+   Con::addVariable("pref::Net::MaxGhosts",           TypeS32, &smMaxGhosts);
+   Con::addVariable("pref::Net::FileWindowSize",      TypeS32, &smFileWindowSize);
+   Con::addVariable("pref::Net::CompressFiles",       TypeBool, &smCompressFiles);
    Con::addVariable("Stats::netBitsSent",       TypeS32, &gNetBitsSent);
    Con::addVariable("Stats::netBitsReceived",   TypeS32, &gNetBitsReceived);
    Con::addVariable("Stats::netGhostUpdates",   TypeS32, &gGhostUpdates);
@@ -229,7 +239,6 @@ NetConnection::NetConnection()
    mSendDelayCredit = 0;
    mConnectionState = NotConnected;
 
-   mCurrentDownloadingFile = NULL;
    mCurrentFileBuffer = NULL;
 
    mNextConnection = NULL;
@@ -262,13 +271,24 @@ NetConnection::NetConnection()
    // ghost management data:
 
    mScopeObject = NULL;
+   mGhostsPrepared = false;
+   mGhostMaxIndex = 0;
+   mGhostSelectCount = MinGhostSelectCount;
    mGhostingSequence = 0;
    mGhosting = false;
    mScoping = false;
    mGhostArray = NULL;
    mGhostRefs = NULL;
    mGhostLookupTable = NULL;
+   mGhostLookupTableSize = 0;
+   mGhostCapacity = 0;
    mLocalGhosts = NULL;
+   mLocalGhostCount = 0;
+   mGhostIdBitSize = DefaultGhostIdBitSize;
+   mProtocolVersion = 0;
+   mPackingRef = NULL;
+   mUnpackingIndex = -1;
+   mLocalDeltaHistory = NULL;
 
    mGhostsActive = 0;
 
@@ -276,14 +296,29 @@ NetConnection::NetConnection()
    mDemoWriteStream = NULL;
    mDemoReadStream = NULL;
 
+   mCaptureStream = NULL;
+   mCaptureStartTime = 0;
+   mReplayClient = false;
+
    mPingSendCount = 0;
    mPingRetryCount = DefaultPingRetryCount;
    mLastPingSendTime = Platform::getVirtualMilliseconds();
 
-   mCurrentDownloadingFile = NULL;
+   mFileSendBuffer = NULL;
+   mFileSendSize = 0;
+   mFileSendOffset = 0;
+   mFileBytesInFlight = 0;
    mCurrentFileBuffer = NULL;
    mCurrentFileBufferSize = 0;
    mCurrentFileBufferOffset = 0;
+   mFileStartOffset = 0;
+   mFileStreamSize = 0;
+   mFileStreamReceived = 0;
+   mFileCRC = 0;
+   mFileInflate = NULL;
+   mFileTransferStart = 0;
+   mFileTransferBytes = 0;
+   mFileTransferRate = 0;
    mNumDownloadedFiles = 0;
 }
 
@@ -292,19 +327,26 @@ NetConnection::~NetConnection()
    AssertFatal(mNotifyQueueHead == NULL, "Uncleared notifies remain.");
    netAddressTableRemove();
 
-   dFree(mCurrentFileBuffer);
-   if(mCurrentDownloadingFile)
-      ResourceManager->closeStream(mCurrentDownloadingFile);
+   savePartialFile();
+   freeFileTransfer();
 
-   delete[] mLocalGhosts;
+   for(U32 i = 0; i < mLocalGhostCount; i++)
+      delete mLocalDeltaHistory[i];
+   dFree(mLocalDeltaHistory);
+   dFree(mLocalGhosts);
    delete[] mGhostLookupTable;
-   delete[] mGhostRefs;
-   delete[] mGhostArray;
+   for(U32 i = 0; i < mGhostCapacity; i++)
+      delete[] mGhostRefs[i]->deltaFields;
+   for(S32 i = 0; i < mGhostBlocks.size(); i++)
+      delete[] mGhostBlocks[i];
+   dFree(mGhostRefs);
+   dFree(mGhostArray);
    delete mStringTable;
    if(mDemoWriteStream)
       delete mDemoWriteStream;
    if(mDemoReadStream)
       ResourceManager->closeStream(mDemoReadStream);
+   endCapture();
 }
 
 NetConnection::PacketNotify::PacketNotify()
@@ -475,8 +517,9 @@ void NetConnection::handleNotify(bool recvd)
 
    if(recvd) 
    {
-      // Running average of roundTrip time
-      U32 curTime = Platform::getVirtualMilliseconds();
+      // Running average of roundTrip time, up to when the ack arrived rather
+      // than when we got round to it.
+      U32 curTime = smPacketArrivalTime ? smPacketArrivalTime : Platform::getVirtualMilliseconds();
       mRoundTripTime = (mRoundTripTime + (curTime - note->sendTime)) * 0.5;
       packetReceived(note);
    }
@@ -501,6 +544,9 @@ void NetConnection::handlePacket(BitStream *bstream)
 
    mErrorBuffer[0] = 0;
 
+   if(mCaptureStream)
+      capturePacket(bstream);
+
    if(bstream->readFlag())
    {
       mCurRate.updateDelay = bstream->readInt(10);
@@ -561,6 +607,12 @@ public:
    }
 };
 
+bool NetConnection::isPacketDue()
+{
+   U32 delay = isConnectionToServer() ? gPacketUpdateDelayToServer : mCurRate.updateDelay;
+   return Platform::getVirtualMilliseconds() >= mLastUpdateTime + delay - mSendDelayCredit && !windowFull();
+}
+
 void NetConnection::checkPacketSend(bool force)
 {
    U32 curTime = Platform::getVirtualMilliseconds();
@@ -569,7 +621,10 @@ void NetConnection::checkPacketSend(bool force)
    if(!force)
    {
       if(curTime < mLastUpdateTime + delay - mSendDelayCredit)
+      {
+         mGhostsPrepared = false;
          return;
+      }
 
       mSendDelayCredit = curTime - (mLastUpdateTime + delay - mSendDelayCredit);
       if(mSendDelayCredit > 1000)
@@ -579,7 +634,10 @@ void NetConnection::checkPacketSend(bool force)
          recordBlock(BlockTypeSendPacket, 0, 0);
    }
    if(windowFull())
+   {
+      mGhostsPrepared = false;
       return;
+   }
 
    BitStream *stream = BitStream::getPacketStream(mCurRate.packetSize);
    buildSendPacketHeader(stream);
@@ -627,6 +685,9 @@ void NetConnection::checkPacketSend(bool force)
    sendPacket(stream);
 }
 
+static Metric sPacketsOut("net.packetsOut", Metric::Counter);
+static Metric sBytesOut("net.bytesOut", Metric::Counter);
+
 Net::Error NetConnection::sendPacket(BitStream *stream)
 {
    //Con::printf("NET  %d: SEND - %d", getId(), mLastSendSeq);
@@ -635,6 +696,15 @@ Net::Error NetConnection::sendPacket(BitStream *stream)
       return Net::NoError;
 
    gNetBitsSent = stream->getStreamSize();
+   sPacketsOut.add();
+   sBytesOut.add(stream->getPosition());
+
+   // Nobody to send to, just count it.
+   if(mReplayClient)
+   {
+      replayPacketSent(stream->getPosition());
+      return Net::NoError;
+   }
 
    if(isLocalConnection())
    {
@@ -690,6 +760,8 @@ void NetConnection::writeDemoStartBlock(ResizeBitStream* stream)
 
    stream->write(mRoundTripTime);
    stream->write(mPacketLoss);
+   if(mProtocolVersion >= GhostIdBitSizeVersion)
+      stream->write(mGhostIdBitSize);
 
    // Write all the current paths to the stream...
    gClientPathManager->dumpState(stream);
@@ -715,6 +787,14 @@ bool NetConnection::readDemoStartBlock(BitStream* stream)
 
    stream->read(&mRoundTripTime);
    stream->read(&mPacketLoss);
+   if(mProtocolVersion >= GhostIdBitSizeVersion)
+   {
+      stream->read(&mGhostIdBitSize);
+      if(mGhostIdBitSize < MinGhostIdBitSize || mGhostIdBitSize > MaxGhostIdBitSize)
+         return false;
+   }
+   else
+      mGhostIdBitSize = DefaultGhostIdBitSize;
 
    // Read
    gClientPathManager->readState(stream);
@@ -1056,6 +1136,13 @@ void NetConnection::handleStartupError(const char *errorString)
 
 }
 
+/// The ghost index size that fits $pref::Net::MaxGhosts.
+static U32 getPreferredGhostIdBitSize(U32 maxGhosts)
+{
+   U32 bits = getBinLog2(getNextPow2(getMax(maxGhosts, U32(2))));
+   return mClamp(bits, NetConnection::MinGhostIdBitSize, NetConnection::MaxGhostIdBitSize);
+}
+
 void NetConnection::writeConnectRequest(BitStream *stream)
 {
    stream->write(mNetClassGroup);
@@ -1087,12 +1174,48 @@ bool NetConnection::readConnectAccept(BitStream *stream, const char **errorStrin
    return true;
 }
 
+void NetConnection::writeGhostIdBitSizeRequest(BitStream *stream)
+{
+   // The most ghosts we'd like, the server may want fewer.
+   stream->writeInt(getPreferredGhostIdBitSize(smMaxGhosts), 5);
+}
+
+bool NetConnection::readGhostIdBitSizeRequest(BitStream *stream, const char **errorString)
+{
+   U32 ghostIdBitSize = stream->readInt(5);
+   if(ghostIdBitSize < MinGhostIdBitSize || ghostIdBitSize > MaxGhostIdBitSize)
+   {
+      *errorString = "CHR_INVALID";
+      return false;
+   }
+
+   mGhostIdBitSize = getMin(ghostIdBitSize, getPreferredGhostIdBitSize(smMaxGhosts));
+   return true;
+}
+
+void NetConnection::writeGhostIdBitSizeAccept(BitStream *stream)
+{
+   stream->writeInt(mGhostIdBitSize, 5);
+}
+
+bool NetConnection::readGhostIdBitSizeAccept(BitStream *stream, const char **errorString)
+{
+   U32 ghostIdBitSize = stream->readInt(5);
+   if(ghostIdBitSize < MinGhostIdBitSize || ghostIdBitSize > getPreferredGhostIdBitSize(smMaxGhosts))
+   {
+      *errorString = "CHR_INVALID";
+      return false;
+   }
+   mGhostIdBitSize = ghostIdBitSize;
+   return true;
+}
+
 ConsoleMethod(NetConnection, resolveGhostID, S32, 3, 3, "( S32 ghostID ) Convert a ghost id from this connection to a real id.")
 {
    S32 gID = dAtoi(argv[2]);
 
    // Safety check
-   if(gID < 0 || gID > NetConnection::MaxGhostCount) return 0;
+   if(gID < 0) return 0;
 
    NetObject *foo = object->resolveGhost(gID);
 
@@ -1107,7 +1230,7 @@ ConsoleMethod(NetConnection, resolveObjectFromGhostIndex, S32, 3, 3, "( S32 ghos
    S32 gID = dAtoi(argv[2]);
 
    // Safety check
-   if(gID < 0 || gID > NetConnection::MaxGhostCount) return 0;
+   if(gID < 0) return 0;
 
    NetObject *foo = object->resolveObjectFromGhostIndex(gID);
 
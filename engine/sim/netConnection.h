@@ -32,8 +32,11 @@ class BitStream;
 class ResizeBitStream;
 class Stream;
 class Point3F;
+class QuatF;
+class PooledArena;
 
 struct GhostInfo;
+struct z_stream_s;
 struct SubPacketRef; // defined in NetConnection subclass
 
 //#define TORQUE_DEBUG_NET
@@ -382,6 +385,8 @@ public:
    /// dropped, we can easily manipulate the stored states and figure out what if any data
    /// we need to resend.
    ///
+   struct DeltaRecord;
+
    struct GhostRef
    {
       U32 mask;                  ///< States we transmitted.
@@ -389,8 +394,94 @@ public:
       GhostInfo *ghost;          ///< Reference to the GhostInfo we're from.
       GhostRef *nextRef;         ///< Next GhostRef in this packet.
       GhostRef *nextUpdateChain; ///< Next update we sent for this ghost.
+      DeltaRecord *deltas;       ///< Delta compressed fields in this update.
+   };
+
+   /// @name Delta compression
+   ///
+   /// Object updates can send fields that change a little at a time, like
+   /// positions, as the difference from the last value the other side has
+   /// acknowledged getting, instead of in full. The values sent in each
+   /// packet are kept with it; once the packet is acked they become the
+   /// field's baseline. The receiver keeps the last few values it got for
+   /// each field, and the sender names the packet its baseline came in.
+   ///
+   /// Each object has MaxDeltaFields fields, numbered by its class (and its
+   /// subclasses, which must pick different numbers). A field may be sent
+   /// at most once per update. Outside ghost updates, in events or demo
+   /// start blocks, fields are always sent in full.
+   ///
+   /// Peers from before DeltaFieldsVersion get every field in full, points
+   /// and rotations as the floats they used to be sent as.
+   /// @{
+
+   enum DeltaConstants
+   {
+      MaxDeltaFields = 4,     ///< Delta compressed fields per object.
+      MaxDeltaValues = 4,     ///< Values per field, enough for a quaternion.
+      DeltaHistorySize = 8,   ///< Values of each field the receiver keeps.
+      DeltaDistanceBits = 10, ///< Farthest back, in packets, a baseline can be.
+   };
+
+   /// A field as sent in a packet.
+   struct DeltaRecord
+   {
+      U32 field;
+      U32 seq;                ///< Packet it went in.
+      U32 sendCount;          ///< Which time the field was sent.
+      S32 values[MaxDeltaValues];
+      DeltaRecord *next;
    };
 
+   /// The sender's baseline for one field of one ghost.
+   struct DeltaField
+   {
+      U32 sendCount;          ///< Times the field has been sent.
+      U32 ackedSendCount;     ///< sendCount when the baseline was sent.
+      U32 ackedSeq;           ///< Packet the baseline went in, 0 if none yet.
+      S32 acked[MaxDeltaValues];
+   };
+
+   /// What the receiver has had of the fields of one ghost.
+   struct DeltaHistory
+   {
+      U32 head[MaxDeltaFields];
+      U32 seq[MaxDeltaFields][DeltaHistorySize];
+      S32 values[MaxDeltaFields][DeltaHistorySize][MaxDeltaValues];
+   };
+
+   /// Write count values of up to bitCount bits (at most 30) for a field.
+   void writeDeltaInts(BitStream *stream, U32 field, const S32 *values, U32 count, U32 bitCount);
+   void readDeltaInts(BitStream *stream, U32 field, S32 *values, U32 count, U32 bitCount);
+
+   /// A position, to the nearest precision units.
+   void writeDeltaPoint(BitStream *stream, U32 field, const Point3F &point, F32 precision);
+   void readDeltaPoint(BitStream *stream, U32 field, Point3F *point, F32 precision);
+
+   /// A rotation, to about 1/16000 in each component.
+   void writeDeltaQuat(BitStream *stream, U32 field, const QuatF &quat);
+   void readDeltaQuat(BitStream *stream, U32 field, QuatF *quat);
+
+protected:
+   GhostRef *mPackingRef;              ///< Update being written, NULL outside ghostWritePacket().
+   S32 mUnpackingIndex;                ///< Ghost being read, -1 outside ghostReadPacket().
+   DeltaHistory **mLocalDeltaHistory;  ///< By ghost index, like mLocalGhosts; NULL until needed.
+
+   /// GhostRefs and DeltaRecords for every connection. Packets are built
+   /// and acked on the main thread, so it isn't locked.
+   static PooledArena smPacketArena;
+
+   /// Make the fields sent in an update the baselines, now it's arrived.
+   void deltaPacketReceived(GhostRef *ref);
+   void freeDeltaRecords(GhostRef *ref);
+   void clearDeltaHistory(U32 index);
+
+   void writeDeltaHistory(BitStream *stream);
+   void readDeltaHistory(BitStream *stream);
+
+public:
+   /// @}
+
    enum Constants
    {
       HashTableSize = 127,
@@ -413,6 +504,22 @@ public:
    virtual void writeConnectAccept(BitStream *stream);
    virtual bool  readConnectAccept(BitStream *stream, const char **errorString);
 
+   /// @name Ghost index size
+   ///
+   /// From GhostIdBitSizeVersion on, the ghost index size is agreed while
+   /// connecting. These go at the end of the connect request and accept,
+   /// after the protocol version, where older peers never look. They're
+   /// only read when both sides are new enough; everyone else stays at
+   /// DefaultGhostIdBitSize.
+   /// @{
+
+   void writeGhostIdBitSizeRequest(BitStream *stream);
+   bool readGhostIdBitSizeRequest(BitStream *stream, const char **errorString);
+   void writeGhostIdBitSizeAccept(BitStream *stream);
+   bool readGhostIdBitSizeAccept(BitStream *stream, const char **errorString);
+
+   /// @}
+
    void connect(const NetAddress *address);
 
    //----------------------------------------------------------------
@@ -424,6 +531,10 @@ private:
    NetConnection *mNextConnection;        ///< Next item in list.
    NetConnection *mPrevConnection;        ///< Previous item in list.
    static NetConnection *mConnectionList; ///< Head of list.
+
+   /// When the packet being processed arrived, which may be a while before
+   /// it's processed if the network thread queued it. 0 outside a packet.
+   static U32 smPacketArrivalTime;
 public:
    static NetConnection *getConnectionList() { return mConnectionList; }
    NetConnection *getNext() { return mNextConnection; }
@@ -581,6 +692,9 @@ public:
 
    void checkPacketSend(bool force);
 
+   /// Would checkPacketSend(false) send a packet right now?
+   bool isPacketDue();
+
    bool missionPathsSent() const          { return mMissionPathsSent; }
    void setMissionPathsSent(const bool s) { mMissionPathsSent = s; }
 
@@ -726,7 +840,7 @@ protected:
       EndGhosting,
       GhostAlwaysStarting,
       SendNextDownloadRequest,
-      FileDownloadSizeMessage,
+      FileDownloadSizeMessage,   ///< Before StreamedFilesVersion, the file's size.
       NumConnectionMessages,
    };
    GhostInfo **mGhostArray;    ///< Linked list of ghostInfos ghosted by this side of the connection
@@ -743,9 +857,24 @@ protected:
    NetObject **mLocalGhosts;  ///< Local ghost for remote object.
                               ///
                               /// mLocalGhosts pointer is NULL if mGhostTo is false
+   U32 mLocalGhostCount;      ///< Size of mLocalGhosts, grown as higher indices arrive.
 
-   GhostInfo *mGhostRefs;           ///< Allocated array of ghostInfos. Null if ghostFrom is false.
+   GhostInfo **mGhostRefs;          ///< GhostInfos by ghost index. Null if ghostFrom is false.
    GhostInfo **mGhostLookupTable;   ///< Table indexed by object id to GhostInfo. Null if ghostFrom is false.
+   U32 mGhostLookupTableSize;       ///< Power of two, kept at mGhostCapacity.
+   U32 mGhostCapacity;              ///< GhostInfos allocated so far, a power of two.
+   Vector<GhostInfo *> mGhostBlocks;   ///< The GhostInfos, allocated a block per growth so they never move.
+
+   U32 mGhostIdBitSize;       ///< Bits in a ghost index, agreed at connect time.
+   static U32 smMaxGhosts;    ///< $pref::Net::MaxGhosts, what we ask for when connecting.
+
+   /// Make sure there are GhostInfos for at least count ghosts.
+   /// @return false if that's more than the connection allows.
+   bool reserveGhosts(U32 count);
+
+   /// Make sure mLocalGhosts has room for count ghosts.
+   /// @return false if that's more than the connection allows.
+   bool reserveLocalGhosts(U32 count);
 
    /// The object around which we are scoping this connection.
    ///
@@ -753,6 +882,34 @@ protected:
    /// that the player is driving.
    SimObjectPtr<NetObject> mScopeObject;
 
+   /// @name Update selection
+   ///
+   /// Picking which ghosts go in a packet is split in two so the server can
+   /// spread the second half over the thread pool, see prepareGhostPackets().
+   /// @{
+
+   CameraScopeQuery mCamInfo;  ///< From the last scope query.
+   bool mGhostsPrepared;       ///< Scoped and prioritized for the next packet.
+   S32  mGhostMaxIndex;        ///< Highest ghost index with updates, from the scope query.
+   U32  mGhostSelectCount;     ///< Ghosts to sort at a time, from the size of the last packet.
+
+   static bool smParallelGhosting;
+
+   /// Scope query, and drop ghosts that went out of scope. Main thread only.
+   void ghostScopeUpdates();
+
+   /// Work out every ghost's update priority and pick the most urgent.
+   /// Only reads object state, so this can run on a worker.
+   void ghostPrioritizeUpdates();
+
+   /// Move the highest priority mGhostSelectCount of the first size ghosts
+   /// to the end of that range, sorted.
+   void ghostSelectUpdates(S32 size);
+
+   friend class GhostPrioritizeItem;
+
+   /// @}
+
    void clearGhostInfo();
    bool validateGhostArray();
 
@@ -770,12 +927,51 @@ public:
    /// Some configuration values.
    enum GhostConstants
    {
-      GhostIdBitSize = 12,
-      MaxGhostCount = 1 << GhostIdBitSize, //4096,
-      GhostLookupTableSize = 1 << GhostIdBitSize, //4096
-      GhostIndexBitSize = 4 // number of bits GhostIdBitSize-3 fits into
+      MinGhostIdBitSize = 8,
+      DefaultGhostIdBitSize = 12,
+      MaxGhostIdBitSize = 18, ///< 256k ghosts
+      InitialGhostCount = 1 << MinGhostIdBitSize,
+      GhostIndexBitSize = 4, // number of bits MaxGhostIdBitSize-3 fits into
+      MinGhostSelectCount = 32
    };
 
+   /// Protocol versions (see GameConnection::CurrentProtocolVersion) that
+   /// changed what NetConnection itself sends.
+   enum ProtocolVersions
+   {
+      GhostIdBitSizeVersion = 22,   ///< Agreed ghost index size, variable length indices.
+      DeltaFieldsVersion    = 23,   ///< Delta compressed fields, delta history in demos.
+      StreamedFilesVersion  = 24,   ///< Windowed, compressed and resumable file downloads.
+   };
+
+   /// Bits in a ghost index on this connection.
+   U32 getGhostIdBitSize() const { return mGhostIdBitSize; }
+
+   /// The most ghosts this connection can have at once.
+   U32 getMaxGhostCount() const { return 1 << mGhostIdBitSize; }
+
+   /// @name Ghost indices
+   ///
+   /// For objects that send ghost indices of other objects in their updates.
+   /// Small indices cost fewer bits, see BitStream::writeVariableU32().
+   ///
+   /// Peers from before GhostIdBitSizeVersion get the old fixed size
+   /// instead. Some objects sent theirs with writeRangedU32() back then;
+   /// they pass legacyRanged to keep doing so.
+   /// @{
+
+   void writeGhostIndex(BitStream *stream, S32 index, bool legacyRanged = false);
+   S32  readGhostIndex(BitStream *stream, bool legacyRanged = false);
+
+   /// @}
+
+   /// Get the ghost updates for the next packet of every connection in the
+   /// list ready in one go, working out priorities in parallel.
+   ///
+   /// The list should only hold connections that are about to send, see
+   /// isPacketDue(); it is compacted to the ones that are ghosting.
+   static void prepareGhostPackets(NetConnection **list, U32 count);
+
    U32 getGhostsActive() { return mGhostsActive;};
 
    /// Are we ghosting to someone?
@@ -888,8 +1084,12 @@ protected:
    /// The currently downloading file is always first in the list (ie, [0]).
    Vector<char *> mMissingFileList;
 
-   /// Stream for currently uploading file (if any).
-   Stream *mCurrentDownloadingFile;
+   /// What we're uploading, from the offset the other side asked for,
+   /// compressed if that made it smaller. NULL if nothing is.
+   U8 *mFileSendBuffer;
+   U32 mFileSendSize;         ///< Bytes in mFileSendBuffer.
+   U32 mFileSendOffset;       ///< Bytes of it posted so far.
+   U32 mFileBytesInFlight;    ///< Bytes posted but not yet delivered.
 
    /// Storage for currently downloading file.
    void *mCurrentFileBuffer;
@@ -900,6 +1100,20 @@ protected:
    /// Our position in the currently downloading file in bytes.
    U32 mCurrentFileBufferOffset;
 
+   U32 mFileStartOffset;      ///< Where the download resumed from.
+   U32 mFileStreamSize;       ///< Bytes the sender is sending for this file.
+   U32 mFileStreamReceived;   ///< Bytes of them we have.
+   U32 mFileCRC;              ///< Of the whole file, to check it against when done.
+   z_stream_s *mFileInflate;  ///< If the file is coming compressed.
+
+   /// For the transfer rate, both ways.
+   U32 mFileTransferStart;
+   U32 mFileTransferBytes;
+   U32 mFileTransferRate;     ///< Bytes/sec, as of the last chunk.
+
+   static S32 smFileWindowSize;     ///< $pref::Net::FileWindowSize, bytes in flight per upload.
+   static bool smCompressFiles;     ///< $pref::Net::CompressFiles
+
    /// Number of files we have downloaded.
    U32 mNumDownloadedFiles;
 
@@ -915,9 +1129,19 @@ protected:
    /// List of objects to ghost-always.
    Vector<GhostSave> mGhostAlwaysSaveList;
 
+   /// Keep what we have of the current download, if the connection goes.
+   void savePartialFile();
+   void freeFileTransfer();
+
+   /// Check and save the file once all of it is here.
+   void fileDownloadFinished();
+
 public:
-   /// Start sending the specified file over the link.
-   bool startSendingFile(const char *fileName);
+   /// Start sending the specified file over the link, from offset bytes in.
+   bool startSendingFile(const char *fileName, U32 offset);
+
+   /// Called when the sender tells us about the file it's about to send.
+   void fileStartReceived(bool found, U32 fileSize, U32 offset, U32 streamSize, bool compressed, U32 crc);
 
    /// Called when we receive a FileChunkEvent.
    void chunkReceived(U8 *chunkData, U32 chunkLen);
@@ -925,8 +1149,20 @@ public:
    /// Get the next file...
    void sendNextFileDownloadRequest();
 
-   /// Post the next FileChunkEvent.
-   void sendFileChunk();
+   /// Post FileChunkEvents until the window is full.
+   void sendFileChunks();
+
+   /// A chunk got there, so there's room for more.
+   void fileChunkDelivered(U32 chunkLen);
+
+   /// Bytes/sec of the current (or last) file transfer on this connection.
+   U32 getFileTransferRate();
+
+   /// How many bytes in flight an upload will allow.
+   static U32 getFileWindowSize();
+
+   /// Where partly downloaded files are kept, to pick up where they left off.
+   static void getPartialFileName(const char *fileName, char *buffer, U32 bufferSize);
 
    /// Called when we finish downloading file data.
    virtual void fileDownloadSegmentComplete();
@@ -986,6 +1222,55 @@ public:
    virtual bool readDemoStartBlock(BitStream *stream);
    virtual void demoPlaybackComplete();
 /// @}
+
+//----------------------------------------------------------------
+/// @name Traffic Capture
+///
+/// A server can capture what its clients send it, one file per client:
+/// the connect request, then the payload of every data packet with its
+/// time. A replay drives a server with synthetic clients from those files.
+/// Each one connects with the recorded request and then sends the recorded
+/// packets at their recorded times. Its packets ack everything the server
+/// sent, as if the network never dropped anything, and nothing is actually
+/// sent to it. The replay times every server tick and counts what the
+/// server sent, so a server can be measured per client without real
+/// clients. Replays have to run with the same mission and server scripts
+/// as the capture, or the clients' part of the mission load handshake
+/// won't match.
+/// @{
+
+private:
+   Stream *mCaptureStream;
+   U32 mCaptureStartTime;
+   bool mReplayClient;     ///< A synthetic client driven by a capture.
+
+   void capturePacket(BitStream *stream);
+   void replayPacketSent(U32 bytes);
+
+public:
+   /// Capture every client that connects from now on into path.
+   static void startTrafficCapture(const char *path);
+   static void stopTrafficCapture();
+   static bool isCapturingTraffic();
+
+   /// Set this up as a synthetic client, connected with a recorded request.
+   bool connectReplayClient(const U8 *request, U32 bitCount, U32 index);
+
+   /// Start capturing this connection, with the stream at its connect request.
+   void beginCapture(BitStream *connectRequest);
+   void endCapture();
+
+   /// Handle a recorded packet payload as if the client had just sent it.
+   void replayPacket(const U8 *payload, U32 bitCount);
+
+   /// Feed the synthetic clients their packets. Called every frame before
+   /// the server ticks.
+   static void processTrafficReplay();
+
+   /// Account for a frame of server time, the replay packets, tick and
+   /// packet sends, in microseconds.
+   static void endTrafficReplayFrame(bool ticked, U32 micros);
+/// @}
 };
 
 
@@ -1013,6 +1298,7 @@ public:  // required for MSVC
    /// @{
 
    NetConnection::GhostRef *updateChain;  ///< List of references in NetConnections to us.
+   NetConnection::DeltaField *deltaFields;   ///< Baselines of delta compressed fields, or NULL.
 
    GhostInfo *nextObjectRef;              ///< Next ghosted object.
    GhostInfo *prevObjectRef;              ///< Previous ghosted object.
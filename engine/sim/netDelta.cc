@@ -0,0 +1,310 @@
+//-----------------------------------------------------------------------------
+// Torque Game Engine
+// Copyright (C) GarageGames.com, Inc.
+//-----------------------------------------------------------------------------
+
+#include "platform/platform.h"
+#include "core/dnet.h"
+#include "console/simBase.h"
+#include "sim/netConnection.h"
+#include "core/bitStream.h"
+#include "math/mQuat.h"
+#include "math/mMathFn.h"
+#include "math/mathIO.h"
+#include "platform/metrics.h"
+#include "core/pooledArena.h"
+
+static Metric sDeltaFields("net.deltaFields", Metric::Counter);
+static Metric sFullFields("net.fullFields", Metric::Counter);
+
+enum
+{
+   QuatBitCount = 16,
+   QuatScale    = 1 << (QuatBitCount - 2),
+};
+
+//-----------------------------------------------------------------------------
+
+static void writeFullInts(BitStream *stream, const S32 *values, U32 count, U32 bitCount)
+{
+   for(U32 i = 0; i < count; i++)
+      stream->writeSignedInt(values[i], bitCount);
+}
+
+static void readFullInts(BitStream *stream, S32 *values, U32 count, U32 bitCount)
+{
+   for(U32 i = 0; i < count; i++)
+      values[i] = stream->readSignedInt(bitCount);
+}
+
+void NetConnection::writeDeltaInts(BitStream *stream, U32 field, const S32 *values, U32 count, U32 bitCount)
+{
+   AssertFatal(field < MaxDeltaFields && count <= MaxDeltaValues && bitCount <= 30,
+      "NetConnection::writeDeltaInts - out of range.");
+
+   // Older peers get the values as they are, and no flag.
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      writeFullInts(stream, values, count, bitCount);
+      return;
+   }
+
+   // Only ghost updates go in a packet we hear back about.
+   GhostRef *ref = mPackingRef;
+   if(!ref)
+   {
+      stream->writeFlag(false);
+      writeFullInts(stream, values, count, bitCount);
+      sFullFields.add();
+      return;
+   }
+
+   GhostInfo *ghost = ref->ghost;
+   if(!ghost->deltaFields)
+   {
+      ghost->deltaFields = new DeltaField[MaxDeltaFields];
+      dMemset(ghost->deltaFields, 0, sizeof(DeltaField) * MaxDeltaFields);
+   }
+   DeltaField &state = ghost->deltaFields[field];
+
+   // The other side still has the baseline if it hasn't had enough newer
+   // values to push it out of its history, even if they all arrived.
+   U32 distance = mLastSendSeq - state.ackedSeq;
+   if(stream->writeFlag(state.ackedSeq && state.sendCount - state.ackedSendCount < DeltaHistorySize &&
+                        distance < (1 << DeltaDistanceBits)))
+   {
+      stream->writeVariableU32(distance, DeltaDistanceBits);
+      stream->writeDeltaInts(values, state.acked, count, bitCount);
+      sDeltaFields.add();
+   }
+   else
+   {
+      writeFullInts(stream, values, count, bitCount);
+      sFullFields.add();
+   }
+
+   // Keep what went in this packet, it's the baseline if it arrives.
+   DeltaRecord *record = smPacketArena.alloc<DeltaRecord>(1);
+   record->field = field;
+   record->seq = mLastSendSeq;
+   record->sendCount = ++state.sendCount;
+   for(U32 i = 0; i < MaxDeltaValues; i++)
+      record->values[i] = i < count ? values[i] : 0;
+   record->next = ref->deltas;
+   ref->deltas = record;
+}
+
+void NetConnection::readDeltaInts(BitStream *stream, U32 field, S32 *values, U32 count, U32 bitCount)
+{
+   AssertFatal(field < MaxDeltaFields && count <= MaxDeltaValues && bitCount <= 30,
+      "NetConnection::readDeltaInts - out of range.");
+
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      readFullInts(stream, values, count, bitCount);
+      return;
+   }
+
+   DeltaHistory *history = mUnpackingIndex >= 0 ? mLocalDeltaHistory[mUnpackingIndex] : NULL;
+
+   if(stream->readFlag())
+   {
+      U32 seq = mLastSeqRecvd - stream->readVariableU32(DeltaDistanceBits);
+
+      const S32 *baseline = NULL;
+      for(U32 i = 0; history && i < DeltaHistorySize; i++)
+      {
+         if(history->seq[field][i] == seq)
+         {
+            baseline = history->values[field][i];
+            break;
+         }
+      }
+
+      if(!baseline)
+      {
+         static const S32 zero[MaxDeltaValues] = { 0, 0, 0, 0 };
+         stream->readDeltaInts(values, zero, count, bitCount);
+         setLastError("Invalid packet.");
+         return;
+      }
+      stream->readDeltaInts(values, baseline, count, bitCount);
+   }
+   else
+      readFullInts(stream, values, count, bitCount);
+
+   if(mUnpackingIndex < 0)
+      return;
+
+   // The sender may use this as a baseline once we've acked the packet.
+   if(!history)
+   {
+      history = new DeltaHistory;
+      dMemset(history, 0, sizeof(DeltaHistory));
+      mLocalDeltaHistory[mUnpackingIndex] = history;
+   }
+
+   U32 slot = history->head[field]++ % DeltaHistorySize;
+   history->seq[field][slot] = mLastSeqRecvd;
+   for(U32 i = 0; i < MaxDeltaValues; i++)
+      history->values[field][slot][i] = i < count ? values[i] : 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void NetConnection::writeDeltaPoint(BitStream *stream, U32 field, const Point3F &point, F32 precision)
+{
+   // Older peers had these in full.
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      mathWrite(*stream, point);
+      return;
+   }
+
+   F32 scale = 1.0f / precision;
+   S32 values[3];
+   values[0] = S32(mFloor(point.x * scale + 0.5f));
+   values[1] = S32(mFloor(point.y * scale + 0.5f));
+   values[2] = S32(mFloor(point.z * scale + 0.5f));
+   writeDeltaInts(stream, field, values, 3, 30);
+}
+
+void NetConnection::readDeltaPoint(BitStream *stream, U32 field, Point3F *point, F32 precision)
+{
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      mathRead(*stream, point);
+      return;
+   }
+
+   S32 values[3];
+   readDeltaInts(stream, field, values, 3, 30);
+   point->set(values[0] * precision, values[1] * precision, values[2] * precision);
+}
+
+void NetConnection::writeDeltaQuat(BitStream *stream, U32 field, const QuatF &quat)
+{
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      mathWrite(*stream, quat);
+      return;
+   }
+
+   S32 values[4];
+   values[0] = S32(mFloor(quat.x * QuatScale + 0.5f));
+   values[1] = S32(mFloor(quat.y * QuatScale + 0.5f));
+   values[2] = S32(mFloor(quat.z * QuatScale + 0.5f));
+   values[3] = S32(mFloor(quat.w * QuatScale + 0.5f));
+   writeDeltaInts(stream, field, values, 4, QuatBitCount);
+}
+
+void NetConnection::readDeltaQuat(BitStream *stream, U32 field, QuatF *quat)
+{
+   if(mProtocolVersion < DeltaFieldsVersion)
+   {
+      mathRead(*stream, quat);
+      return;
+   }
+
+   S32 values[4];
+   readDeltaInts(stream, field, values, 4, QuatBitCount);
+   quat->set(F32(values[0]) / QuatScale, F32(values[1]) / QuatScale,
+             F32(values[2]) / QuatScale, F32(values[3]) / QuatScale);
+   quat->normalize();
+}
+
+//-----------------------------------------------------------------------------
+
+void NetConnection::deltaPacketReceived(GhostRef *ref)
+{
+   DeltaField *fields = ref->ghost->deltaFields;
+   for(DeltaRecord *walk = ref->deltas; walk; walk = walk->next)
+   {
+      // Acks come in order, but be sure.
+      DeltaField &state = fields[walk->field];
+      if(walk->sendCount <= state.ackedSendCount)
+         continue;
+
+      state.ackedSendCount = walk->sendCount;
+      state.ackedSeq = walk->seq;
+      dMemcpy(state.acked, walk->values, sizeof(state.acked));
+   }
+   freeDeltaRecords(ref);
+}
+
+void NetConnection::freeDeltaRecords(GhostRef *ref)
+{
+   while(ref->deltas)
+   {
+      DeltaRecord *next = ref->deltas->next;
+      smPacketArena.free(ref->deltas, sizeof(DeltaRecord));
+      ref->deltas = next;
+   }
+}
+
+void NetConnection::clearDeltaHistory(U32 index)
+{
+   if(index < mLocalGhostCount && mLocalDeltaHistory[index])
+   {
+      delete mLocalDeltaHistory[index];
+      mLocalDeltaHistory[index] = NULL;
+   }
+}
+
+void NetConnection::writeDeltaHistory(BitStream *stream)
+{
+   if(mProtocolVersion < DeltaFieldsVersion)
+      return;
+
+   // Packets recorded after this may be deltas against what came before.
+   for(U32 i = 0; i < mLocalGhostCount; i++)
+   {
+      DeltaHistory *history = mLocalDeltaHistory[i];
+      if(!history || !mLocalGhosts[i])
+         continue;
+
+      stream->writeFlag(true);
+      writeGhostIndex(stream, i);
+      for(U32 field = 0; field < MaxDeltaFields; field++)
+      {
+         stream->write(history->head[field]);
+         for(U32 j = 0; j < DeltaHistorySize; j++)
+         {
+            stream->write(history->seq[field][j]);
+            for(U32 k = 0; k < MaxDeltaValues; k++)
+               stream->write(history->values[field][j][k]);
+         }
+      }
+   }
+   stream->writeFlag(false);
+}
+
+void NetConnection::readDeltaHistory(BitStream *stream)
+{
+   if(mProtocolVersion < DeltaFieldsVersion)
+      return;
+
+   while(stream->readFlag())
+   {
+      U32 index = readGhostIndex(stream);
+      if(!reserveLocalGhosts(index + 1))
+      {
+         setLastError("Invalid packet.");
+         return;
+      }
+
+      clearDeltaHistory(index);
+      DeltaHistory *history = new DeltaHistory;
+      mLocalDeltaHistory[index] = history;
+      for(U32 field = 0; field < MaxDeltaFields; field++)
+      {
+         stream->read(&history->head[field]);
+         for(U32 j = 0; j < DeltaHistorySize; j++)
+         {
+            stream->read(&history->seq[field][j]);
+            for(U32 k = 0; k < MaxDeltaValues; k++)
+               stream->read(&history->values[field][j][k]);
+         }
+      }
+   }
+}
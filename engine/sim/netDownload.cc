@@ -10,6 +10,10 @@
 #include "core/bitStream.h"
 #include "sim/netObject.h"
 #include "core/resManager.h"
+#include "core/fileStream.h"
+#include "core/crc.h"
+#include "console/console.h"
+#include "zlib.h"
 
 class FileDownloadRequestEvent : public NetEvent
 {
@@ -21,6 +25,7 @@ public:
    
    U32 nameCount;
    char mFileNames[MaxFileNames][256];
+   U32 mOffsets[MaxFileNames];   ///< Bytes we already have of each.
 
    FileDownloadRequestEvent(Vector<char *> *nameList = NULL)
    {
@@ -35,40 +40,59 @@ public:
          for(U32 i = 0; i < nameCount; i++)
          {
             dStrcpy(mFileNames[i], (*nameList)[i]);
-            Con::printf("Sending request for file %s", mFileNames[i]);
+
+            // Pick up where an earlier download left off.
+            char partName[1024];
+            NetConnection::getPartialFileName(mFileNames[i], partName, sizeof(partName));
+            FileStream part;
+            mOffsets[i] = part.open(partName, FileStream::Read) ? part.getStreamSize() : 0;
+
+            if(mOffsets[i])
+               Con::printf("Sending request for file %s, from byte %d", mFileNames[i], mOffsets[i]);
+            else
+               Con::printf("Sending request for file %s", mFileNames[i]);
          }
       }
    }
 
-   virtual void pack(NetConnection *, BitStream *bstream)
+   virtual void pack(NetConnection *ps, BitStream *bstream)
    {
+      bool resume = ps->getProtocolVersion() >= NetConnection::StreamedFilesVersion;
       bstream->writeRangedU32(nameCount, 0, MaxFileNames);
       for(U32 i = 0; i < nameCount; i++)
+      {
          bstream->writeString(mFileNames[i]);
+         if(resume)
+            bstream->write(mOffsets[i]);
+      }
    }
 
-   virtual void write(NetConnection *, BitStream *bstream)
+   virtual void write(NetConnection *ps, BitStream *bstream)
    {
-      bstream->writeRangedU32(nameCount, 0, MaxFileNames);
-      for(U32 i = 0; i < nameCount; i++)
-         bstream->writeString(mFileNames[i]);
+      pack(ps, bstream);
    }
 
-   virtual void unpack(NetConnection *, BitStream *bstream)
+   virtual void unpack(NetConnection *ps, BitStream *bstream)
    {
+      bool resume = ps->getProtocolVersion() >= NetConnection::StreamedFilesVersion;
       nameCount = bstream->readRangedU32(0, MaxFileNames);
       for(U32 i = 0; i < nameCount; i++)
+      {
          bstream->readString(mFileNames[i]);
+         mOffsets[i] = 0;
+         if(resume)
+            bstream->read(&mOffsets[i]);
+      }
    }
 
    virtual void process(NetConnection *connection)
    {
       U32 i;
       for(i = 0; i < nameCount; i++)
-         if(connection->startSendingFile(mFileNames[i]))
+         if(connection->startSendingFile(mFileNames[i], mOffsets[i]))
             break;
       if(i == nameCount)
-         connection->startSendingFile(NULL);  // none of the files were sent
+         connection->startSendingFile(NULL, 0);  // none of the files were sent
    }
 
    DECLARE_CONOBJECT(FileDownloadRequestEvent);
@@ -77,39 +101,118 @@ public:
 
 IMPLEMENT_CO_NETEVENT_V1(FileDownloadRequestEvent);
 
+/// Tells the other side about the file that's coming, or that there isn't one.
+class FileDownloadStartEvent : public NetEvent
+{
+public:
+   bool found;
+   U32 fileSize;
+   U32 offset;
+   U32 streamSize;
+   bool compressed;
+   U32 crc;
+
+   FileDownloadStartEvent(bool in_found = false, U32 in_fileSize = 0, U32 in_offset = 0, U32 in_streamSize = 0,
+                  bool in_compressed = false, U32 in_crc = 0)
+   {
+      found = in_found;
+      fileSize = in_fileSize;
+      offset = in_offset;
+      streamSize = in_streamSize;
+      compressed = in_compressed;
+      crc = in_crc;
+   }
+
+   virtual void pack(NetConnection *, BitStream *bstream)
+   {
+      if(bstream->writeFlag(found))
+      {
+         bstream->write(fileSize);
+         bstream->write(offset);
+         bstream->write(streamSize);
+         bstream->writeFlag(compressed);
+         bstream->write(crc);
+      }
+   }
+
+   virtual void write(NetConnection *ps, BitStream *bstream)
+   {
+      pack(ps, bstream);
+   }
+
+   virtual void unpack(NetConnection *, BitStream *bstream)
+   {
+      found = bstream->readFlag();
+      if(found)
+      {
+         bstream->read(&fileSize);
+         bstream->read(&offset);
+         bstream->read(&streamSize);
+         compressed = bstream->readFlag();
+         bstream->read(&crc);
+      }
+   }
+
+   virtual void process(NetConnection *connection)
+   {
+      connection->fileStartReceived(found, fileSize, offset, streamSize, compressed, crc);
+   }
+
+   DECLARE_CONOBJECT(FileDownloadStartEvent);
+};
+
+IMPLEMENT_CO_NETEVENT_V1(FileDownloadStartEvent);
+
 class FileChunkEvent : public NetEvent
 {
 public:
    enum
    {
-      ChunkSize = 63,
+      MinChunkSize = 32,
+      MaxChunkSize = 1023,
+      LegacyChunkSize = 63,      ///< Before StreamedFilesVersion.
+      LegacyChunkCount = 32,     ///< Kept in flight, back then.
    };
 
-   U8 chunkData[ChunkSize];
+   static U32 getMaxChunkSize(NetConnection *ps)
+   {
+      return ps->getProtocolVersion() >= NetConnection::StreamedFilesVersion ? MaxChunkSize : LegacyChunkSize;
+   }
+
+   U8 *chunkData;
    U32 chunkLen;
    
    FileChunkEvent(U8 *data = NULL, U32 len = 0)
    {
+      chunkData = NULL;
+      chunkLen = len;
       if(data)
+      {
+         chunkData = new U8[len];
          dMemcpy(chunkData, data, len);
-      chunkLen = len;
+      }
+   }
+
+   ~FileChunkEvent()
+   {
+      delete[] chunkData;
    }
    
-   virtual void pack(NetConnection *, BitStream *bstream)
+   virtual void pack(NetConnection *ps, BitStream *bstream)
    {
-      bstream->writeRangedU32(chunkLen, 0, ChunkSize);
+      bstream->writeRangedU32(chunkLen, 0, getMaxChunkSize(ps));
       bstream->write(chunkLen, chunkData);
    }
    
-   virtual void write(NetConnection *, BitStream *bstream)
+   virtual void write(NetConnection *ps, BitStream *bstream)
    {
-      bstream->writeRangedU32(chunkLen, 0, ChunkSize);
-      bstream->write(chunkLen, chunkData);
+      pack(ps, bstream);
    }
    
-   virtual void unpack(NetConnection *, BitStream *bstream)
+   virtual void unpack(NetConnection *ps, BitStream *bstream)
    {
-      chunkLen = bstream->readRangedU32(0, ChunkSize);
+      chunkLen = bstream->readRangedU32(0, getMaxChunkSize(ps));
+      chunkData = new U8[chunkLen];
       bstream->read(chunkLen, chunkData);
    }
    
@@ -121,7 +224,7 @@ public:
    virtual void notifyDelivered(NetConnection *nc, bool madeIt)
    {
       if(!nc->isRemoved())
-        nc->sendFileChunk();
+        nc->fileChunkDelivered(chunkLen);
    }
    
    DECLARE_CONOBJECT(FileChunkEvent);
@@ -129,26 +232,113 @@ public:
 
 IMPLEMENT_CO_NETEVENT_V1(FileChunkEvent);
 
-void NetConnection::sendFileChunk()
+//-----------------------------------------------------------------------------
+
+void NetConnection::getPartialFileName(const char *fileName, char *buffer, U32 bufferSize)
+{
+   dSprintf(buffer, bufferSize, "%s.part", fileName);
+}
+
+U32 NetConnection::getFileWindowSize()
 {
-   U8 buffer[FileChunkEvent::ChunkSize];
-   U32 len = FileChunkEvent::ChunkSize;
-   if(len + mCurrentFileBufferOffset > mCurrentFileBufferSize)
-      len = mCurrentFileBufferSize - mCurrentFileBufferOffset;
+   return mClamp(smFileWindowSize, FileChunkEvent::MaxChunkSize, 1 << 20);
+}
+
+void NetConnection::freeFileTransfer()
+{
+   dFree(mFileSendBuffer);
+   mFileSendBuffer = NULL;
+   mFileSendSize = 0;
+   mFileSendOffset = 0;
 
-   if(!len)
+   dFree(mCurrentFileBuffer);
+   mCurrentFileBuffer = NULL;
+   if(mFileInflate)
    {
-      ResourceManager->closeStream(mCurrentDownloadingFile);
-      mCurrentDownloadingFile = NULL;
+      inflateEnd(mFileInflate);
+      delete mFileInflate;
+      mFileInflate = NULL;
+   }
+}
+
+void NetConnection::savePartialFile()
+{
+   // Only worth it if there's more than we started with.
+   if(!mCurrentFileBuffer || !mMissingFileList.size() || mCurrentFileBufferOffset <= mFileStartOffset)
+      return;
+
+   char partName[1024];
+   getPartialFileName(mMissingFileList[0], partName, sizeof(partName));
+
+   FileStream stream;
+   if(!ResourceManager->openFileForWrite(stream, partName))
+      return;
+   stream.write(mCurrentFileBufferOffset, mCurrentFileBuffer);
+   stream.close();
+   Con::printf("Saved %d bytes of %s to resume later.", mCurrentFileBufferOffset, mMissingFileList[0]);
+}
+
+U32 NetConnection::getFileTransferRate()
+{
+   return mFileTransferRate;
+}
+
+static void updateTransferRate(U32 start, U32 bytes, U32 *rate)
+{
+   U32 elapsed = getMax(Platform::getRealMilliseconds() - start, U32(1));
+   *rate = U32(U64(bytes) * 1000 / elapsed);
+}
+
+ConsoleMethod(NetConnection, getFileTransferRate, S32, 2, 2, "conn.getFileTransferRate()"
+              "Returns the bytes/sec of the file being sent or received on this connection, "
+              "or the last one.")
+{
+   argc; argv;
+   return object->getFileTransferRate();
+}
+
+//-----------------------------------------------------------------------------
+
+void NetConnection::sendFileChunks()
+{
+   if(!mFileSendBuffer)
       return;
+
+   // Fill about half a packet, leaving room for whatever else is going.
+   U32 chunkSize = mClamp(mCurRate.packetSize / 2, FileChunkEvent::MinChunkSize, FileChunkEvent::MaxChunkSize);
+   U32 window = getFileWindowSize();
+   if(mProtocolVersion < StreamedFilesVersion)
+   {
+      chunkSize = FileChunkEvent::LegacyChunkSize;
+      window = FileChunkEvent::LegacyChunkSize * FileChunkEvent::LegacyChunkCount;
+   }
+
+   while(mFileSendOffset < mFileSendSize && mFileBytesInFlight < window)
+   {
+      U32 len = getMin(chunkSize, mFileSendSize - mFileSendOffset);
+      postNetEvent(new FileChunkEvent(mFileSendBuffer + mFileSendOffset, len));
+      mFileSendOffset += len;
+      mFileBytesInFlight += len;
    }
+}
 
-   mCurrentFileBufferOffset += len;
-   mCurrentDownloadingFile->read(len, buffer);
-   postNetEvent(new FileChunkEvent(buffer, len));
+void NetConnection::fileChunkDelivered(U32 chunkLen)
+{
+   // Chunks of the last file may still be arriving after the next one started.
+   mFileBytesInFlight -= getMin(chunkLen, mFileBytesInFlight);
+   mFileTransferBytes += chunkLen;
+   updateTransferRate(mFileTransferStart, mFileTransferBytes, &mFileTransferRate);
+
+   if(mFileSendBuffer && mFileSendOffset == mFileSendSize)
+   {
+      dFree(mFileSendBuffer);
+      mFileSendBuffer = NULL;
+   }
+   else
+      sendFileChunks();
 }
 
-bool NetConnection::startSendingFile(const char *fileName)
+bool NetConnection::startSendingFile(const char *fileName, U32 offset)
 {
    if(!fileName || Con::getBoolVariable("$NetConnection::neverUploadFiles"))
    {
@@ -156,24 +346,71 @@ bool NetConnection::startSendingFile(const char *fileName)
       return false;
    }
 
-   mCurrentDownloadingFile = ResourceManager->openStream(fileName);
+   Stream *stream = ResourceManager->openStream(fileName);
 
-   if(!mCurrentDownloadingFile)
+   // Older clients can't resume, inflate or check a CRC.
+   bool streamed = mProtocolVersion >= StreamedFilesVersion;
+
+   if(!stream)
    {
-      // the server didn't have the file, so send a 0 byte chunk:
+      // the server didn't have the file, so say so (with a 0 byte chunk to older clients):
       Con::printf("No such file '%s'.", fileName);
-      postNetEvent(new FileChunkEvent(NULL, 0));
+      if(streamed)
+         postNetEvent(new FileDownloadStartEvent);
+      else
+         postNetEvent(new FileChunkEvent(NULL, 0));
       return false;
    }
 
-   Con::printf("Sending file '%s'.", fileName);
-   mCurrentFileBufferSize = mCurrentDownloadingFile->getStreamSize();
-   mCurrentFileBufferOffset = 0;
+   freeFileTransfer();
+
+   U32 fileSize = stream->getStreamSize();
+   U8 *data = (U8 *) dMalloc(getMax(fileSize, U32(1)));
+   stream->read(fileSize, data);
+   ResourceManager->closeStream(stream);
+
+   // The CRC is of the whole file, so a resumed download can be checked too.
+   U32 crc = streamed ? calculateCRC(data, fileSize) : 0;
+   if(offset > fileSize || !streamed)
+      offset = 0;
+
+   mFileSendBuffer = data;
+   mFileSendOffset = offset;
+   mFileSendSize = fileSize;
+
+   // Only keep the compressed version if it's smaller.
+   bool compressed = false;
+   U32 size = fileSize - offset;
+   if(streamed && smCompressFiles && size)
+   {
+      uLongf packedSize = size;
+      U8 *packed = (U8 *) dMalloc(size);
+      if(compress2(packed, &packedSize, data + offset, size, Z_DEFAULT_COMPRESSION) == Z_OK && packedSize < size)
+      {
+         dFree(data);
+         mFileSendBuffer = packed;
+         mFileSendOffset = 0;
+         mFileSendSize = packedSize;
+         compressed = true;
+      }
+      else
+         dFree(packed);
+   }
 
-   // always have 32 file chunks (64 bytes each) in transit
-   sendConnectionMessage(FileDownloadSizeMessage, mCurrentFileBufferSize);
-   for(U32 i = 0; i < 32; i++)
-      sendFileChunk();
+   Con::printf("Sending file '%s' (%d bytes%s%s).", fileName, mFileSendSize - mFileSendOffset,
+      compressed ? ", compressed" : "", offset ? avar(", from byte %d", offset) : "");
+
+   mFileTransferStart = Platform::getRealMilliseconds();
+   mFileTransferBytes = 0;
+   mFileTransferRate = 0;
+
+   if(streamed)
+      postNetEvent(new FileDownloadStartEvent(true, fileSize, offset, mFileSendSize - mFileSendOffset, compressed, crc));
+   else
+      sendConnectionMessage(FileDownloadSizeMessage, fileSize);
+   sendFileChunks();
+   if(mFileSendOffset == mFileSendSize && !mFileBytesInFlight)
+      freeFileTransfer();
    return true;
 }
 
@@ -196,49 +433,167 @@ void NetConnection::sendNextFileDownloadRequest()
    }
 }
 
+//-----------------------------------------------------------------------------
 
-void NetConnection::chunkReceived(U8 *chunkData, U32 chunkLen)
+void NetConnection::fileStartReceived(bool found, U32 fileSize, U32 offset, U32 streamSize, bool compressed, U32 crc)
 {
-   if(chunkLen == 0)
+   if(!mMissingFileList.size())
+   {
+      setLastError("Invalid file from server.");
+      return;
+   }
+
+   freeFileTransfer();
+
+   if(!found)
    {
       // the server didn't have the file... apparently it's one we don't need...
-      dFree(mCurrentFileBuffer);
-      mCurrentFileBuffer = NULL;
       dFree(mMissingFileList[0]);
       mMissingFileList.pop_front();
       return;
    }
-   if(chunkLen + mCurrentFileBufferOffset > mCurrentFileBufferSize)
+
+   if(offset > fileSize)
+   {
+      setLastError("Invalid file from server.");
+      return;
+   }
+
+   mCurrentFileBuffer = dMalloc(getMax(fileSize, U32(1)));
+   mCurrentFileBufferSize = fileSize;
+   mCurrentFileBufferOffset = 0;
+
+   // The start is whatever we had last time, which is why it asked from there.
+   if(offset)
+   {
+      char partName[1024];
+      getPartialFileName(mMissingFileList[0], partName, sizeof(partName));
+      FileStream part;
+      if(!part.open(partName, FileStream::Read) || part.getStreamSize() < offset ||
+         !part.read(offset, mCurrentFileBuffer))
+      {
+         setLastError("Couldn't read partly downloaded file.");
+         return;
+      }
+      mCurrentFileBufferOffset = offset;
+   }
+
+   mFileStartOffset = offset;
+   mFileStreamSize = streamSize;
+   mFileStreamReceived = 0;
+   mFileCRC = crc;
+
+   if(compressed)
+   {
+      mFileInflate = new z_stream;
+      dMemset(mFileInflate, 0, sizeof(z_stream));
+      inflateInit(mFileInflate);
+   }
+
+   mFileTransferStart = Platform::getRealMilliseconds();
+   mFileTransferBytes = 0;
+   mFileTransferRate = 0;
+
+   if(!streamSize)
+      fileDownloadFinished();
+}
+
+void NetConnection::chunkReceived(U8 *chunkData, U32 chunkLen)
+{
+   // Older servers say they don't have a file with an empty chunk.
+   if(!chunkLen && mProtocolVersion < StreamedFilesVersion)
+   {
+      fileStartReceived(false, 0, 0, 0, false, 0);
+      return;
+   }
+
+   if(!mCurrentFileBuffer || chunkLen + mFileStreamReceived > mFileStreamSize)
    {
       setLastError("Invalid file chunk from server.");
       return;
    }
-   dMemcpy(((U8 *) mCurrentFileBuffer) + mCurrentFileBufferOffset, chunkData, chunkLen);
-   mCurrentFileBufferOffset += chunkLen;
-   if(mCurrentFileBufferOffset == mCurrentFileBufferSize)
+   mFileStreamReceived += chunkLen;
+   mFileTransferBytes += chunkLen;
+   updateTransferRate(mFileTransferStart, mFileTransferBytes, &mFileTransferRate);
+
+   if(mFileInflate)
    {
-      // this file's done...
-      // save it to disk:
-      FileStream stream;
+      // Inflate as it comes, so what we have is always usable to resume from.
+      mFileInflate->next_in = chunkData;
+      mFileInflate->avail_in = chunkLen;
+      mFileInflate->next_out = ((U8 *) mCurrentFileBuffer) + mCurrentFileBufferOffset;
+      mFileInflate->avail_out = mCurrentFileBufferSize - mCurrentFileBufferOffset;
 
-      Con::printf("Saving file %s.", mMissingFileList[0]);
-      if(!ResourceManager->openFileForWrite(stream, mMissingFileList[0]))
+      S32 ret = inflate(mFileInflate, Z_SYNC_FLUSH);
+      mCurrentFileBufferOffset = mCurrentFileBufferSize - mFileInflate->avail_out;
+      if((ret != Z_OK && ret != Z_STREAM_END) || mFileInflate->avail_in)
       {
-         setLastError("Couldn't open file downloaded by server.");
+         setLastError("Invalid file chunk from server.");
          return;
       }
-      dFree(mMissingFileList[0]);
-      mMissingFileList.pop_front();
-      stream.write(mCurrentFileBufferSize, mCurrentFileBuffer);
-      stream.close();
-      mNumDownloadedFiles++;
-      dFree(mCurrentFileBuffer);
-      mCurrentFileBuffer = NULL;
-      sendNextFileDownloadRequest();
    }
    else
    {
-      Con::executef(4, "onFileChunkReceived", mMissingFileList[0], Con::getIntArg(mCurrentFileBufferOffset), Con::getIntArg(mCurrentFileBufferSize));
+      if(chunkLen + mCurrentFileBufferOffset > mCurrentFileBufferSize)
+      {
+         setLastError("Invalid file chunk from server.");
+         return;
+      }
+      dMemcpy(((U8 *) mCurrentFileBuffer) + mCurrentFileBufferOffset, chunkData, chunkLen);
+      mCurrentFileBufferOffset += chunkLen;
+   }
+
+   if(mFileStreamReceived == mFileStreamSize)
+      fileDownloadFinished();
+   else
+   {
+      Con::executef(5, "onFileChunkReceived", mMissingFileList[0], Con::getIntArg(mCurrentFileBufferOffset),
+         Con::getIntArg(mCurrentFileBufferSize), Con::getIntArg(mFileTransferRate));
    }
 }
 
+void NetConnection::fileDownloadFinished()
+{
+   char partName[1024];
+   getPartialFileName(mMissingFileList[0], partName, sizeof(partName));
+
+   // Older servers don't send a CRC.
+   bool valid = mCurrentFileBufferOffset == mCurrentFileBufferSize &&
+                (mProtocolVersion < StreamedFilesVersion ||
+                 calculateCRC(mCurrentFileBuffer, mCurrentFileBufferSize) == mFileCRC);
+
+   // Either we have all of it now, or what we had was no good.
+   dFileDelete(partName);
+
+   if(!valid)
+   {
+      freeFileTransfer();
+      if(mFileStartOffset)
+      {
+         // The file changed since we got the start of it, get all of it.
+         Con::warnf("Resumed download of %s didn't match, downloading all of it.", mMissingFileList[0]);
+         sendNextFileDownloadRequest();
+      }
+      else
+         setLastError("Corrupt file downloaded from server.");
+      return;
+   }
+
+   // this file's done...
+   // save it to disk:
+   FileStream stream;
+
+   Con::printf("Saving file %s (%d bytes/sec).", mMissingFileList[0], mFileTransferRate);
+   if(!ResourceManager->openFileForWrite(stream, mMissingFileList[0]))
+   {
+      setLastError("Couldn't open file downloaded by server.");
+      return;
+   }
+   dFree(mMissingFileList[0]);
+   mMissingFileList.pop_front();
+   stream.write(mCurrentFileBufferSize, mCurrentFileBuffer);
+   stream.close();
+   mNumDownloadedFiles++;
+   freeFileTransfer();
+   sendNextFileDownloadRequest();
+}
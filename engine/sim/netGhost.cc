@@ -12,11 +12,126 @@
 #include "core/resManager.h"
 #include "console/console.h"
 #include "console/consoleTypes.h"
+#include "platform/threadPool.h"
+#include "platform/metrics.h"
+#include "core/pooledArena.h"
 
 #define DebugChecksum 0xF00DBAAD
 
 extern U32 gGhostUpdates;
 
+PooledArena NetConnection::smPacketArena("net.ghostUpdates", 16 << 10, false);
+
+//-----------------------------------------------------------------------------
+
+/// What ghost updates of one class have cost, to find the ones worth
+/// sending more cheaply. Bits of an update are counted against every mask
+/// bit it sent, since there's no telling which bits went with which.
+struct GhostClassStats
+{
+   const char *className;
+   U32 updates;
+   U32 initialUpdates;
+   U64 bits;
+   U32 maskUpdates[32];
+   U64 maskBits[32];
+};
+
+static Vector<GhostClassStats> sGhostStats[NetClassGroupsCount];
+static U32 sGhostStatsStart = 0;
+
+static void recordGhostStats(U32 group, NetObject *obj, U32 mask, bool initial, U32 bits)
+{
+   S32 classId = obj->getClassId(group);
+   Vector<GhostClassStats> &list = sGhostStats[group];
+   if(classId >= list.size())
+   {
+      S32 oldSize = list.size();
+      list.setSize(classId + 1);
+      dMemset(list.address() + oldSize, 0, sizeof(GhostClassStats) * (classId + 1 - oldSize));
+   }
+   if(!sGhostStatsStart)
+      sGhostStatsStart = Platform::getRealMilliseconds();
+
+   GhostClassStats &stats = list[classId];
+   stats.className = obj->getClassName();
+   stats.updates++;
+   if(initial)
+      stats.initialUpdates++;
+   stats.bits += bits;
+   for(U32 i = 0; i < 32; i++)
+   {
+      if(mask & (1 << i))
+      {
+         stats.maskUpdates[i]++;
+         stats.maskBits[i] += bits;
+      }
+   }
+}
+
+static S32 QSORT_CALLBACK compareGhostStats(const void *a, const void *b)
+{
+   U64 bitsA = (*(GhostClassStats **) a)->bits;
+   U64 bitsB = (*(GhostClassStats **) b)->bits;
+   return bitsA < bitsB ? 1 : (bitsA > bitsB ? -1 : 0);
+}
+
+ConsoleFunction(netGhostStats, void, 1, 1, "() - Print what ghost updates of each class have cost since "
+                "the stats were last reset, most expensive first.")
+{
+   argc; argv;
+   if(!sGhostStatsStart)
+   {
+      Con::printf("No ghost updates sent.");
+      return;
+   }
+
+   U32 clients = 0;
+   for(NetConnection *walk = NetConnection::getConnectionList(); walk; walk = walk->getNext())
+      if(walk->isGhostingFrom())
+         clients++;
+   F32 seconds = getMax(Platform::getRealMilliseconds() - sGhostStatsStart, U32(1)) / 1000.0f;
+
+   Vector<GhostClassStats *> sorted;
+   U64 totalBits = 0;
+   for(U32 group = 0; group < NetClassGroupsCount; group++)
+   {
+      for(S32 i = 0; i < sGhostStats[group].size(); i++)
+      {
+         if(sGhostStats[group][i].updates)
+         {
+            sorted.push_back(&sGhostStats[group][i]);
+            totalBits += sGhostStats[group][i].bits;
+         }
+      }
+   }
+   dQsort(sorted.address(), sorted.size(), sizeof(GhostClassStats *), compareGhostStats);
+
+   Con::printf("Ghost updates over %.1f seconds, %.0f bytes/sec (%.0f per ghosting client):", seconds,
+      totalBits / 8 / seconds, totalBits / 8 / seconds / getMax(clients, U32(1)));
+   for(S32 i = 0; i < sorted.size(); i++)
+   {
+      GhostClassStats *stats = sorted[i];
+      Con::printf("  %-24s %8d updates (%d initial), %6.1f bits avg, %.0f bytes/sec, %4.1f%%", stats->className,
+         stats->updates, stats->initialUpdates, F64(stats->bits) / stats->updates, stats->bits / 8 / seconds,
+         100.0 * stats->bits / totalBits);
+      for(U32 j = 0; j < 32; j++)
+      {
+         if(stats->maskUpdates[j])
+            Con::printf("     mask bit %2d: %8d updates, %6.1f bits avg", j, stats->maskUpdates[j],
+               F64(stats->maskBits[j]) / stats->maskUpdates[j]);
+      }
+   }
+}
+
+ConsoleFunction(netGhostStatsReset, void, 1, 1, "() - Clear the ghost update stats.")
+{
+   argc; argv;
+   for(U32 group = 0; group < NetClassGroupsCount; group++)
+      sGhostStats[group].clear();
+   sGhostStatsStart = 0;
+}
+
 class GhostAlwaysObjectEvent : public NetEvent
 {
    SimObjectId objectId;
@@ -38,7 +153,7 @@ public:
 
    void pack(NetConnection *ps, BitStream *bstream)
    {
-      bstream->writeInt(ghostIndex, NetConnection::GhostIdBitSize);
+      ps->writeGhostIndex(bstream, ghostIndex);
 
       NetObject *obj = (NetObject *) Sim::findObject(objectId);
       if(bstream->writeFlag(obj != NULL))
@@ -50,7 +165,7 @@ public:
    }
    void write(NetConnection *ps, BitStream *bstream)
    {
-      bstream->writeInt(ghostIndex, NetConnection::GhostIdBitSize);
+      ps->writeGhostIndex(bstream, ghostIndex);
       if(bstream->writeFlag(validObject))
       {
          S32 classId = object->getClassId(ps->getNetClassGroup());
@@ -60,7 +175,7 @@ public:
    }
    void unpack(NetConnection *ps, BitStream *bstream)
    {
-      ghostIndex = bstream->readInt(NetConnection::GhostIdBitSize);
+      ghostIndex = ps->readGhostIndex(bstream);
 
       if(bstream->readFlag())
       {
@@ -111,11 +226,7 @@ void NetConnection::setGhostTo(bool ghostTo)
       return;
 
    if(ghostTo)
-   {
-      mLocalGhosts = new NetObject *[MaxGhostCount];
-      for(S32 i = 0; i < MaxGhostCount; i++)
-         mLocalGhosts[i] = NULL;
-   }
+      reserveLocalGhosts(InitialGhostCount);
 }
 
 void NetConnection::setGhostFrom(bool ghostFrom)
@@ -126,19 +237,107 @@ void NetConnection::setGhostFrom(bool ghostFrom)
    if(ghostFrom)
    {
       mGhostFreeIndex = mGhostZeroUpdateIndex = 0;
-      mGhostArray = new GhostInfo *[MaxGhostCount];
-      mGhostRefs = new GhostInfo[MaxGhostCount];
-      S32 i;
-      for(i = 0; i < MaxGhostCount; i++)
+      reserveGhosts(InitialGhostCount);
+   }
+}
+
+bool NetConnection::reserveLocalGhosts(U32 count)
+{
+   if(count <= mLocalGhostCount)
+      return true;
+   if(count > getMaxGhostCount())
+      return false;
+
+   U32 newCount = getMax(mLocalGhostCount, U32(InitialGhostCount));
+   while(newCount < count)
+      newCount <<= 1;
+
+   mLocalGhosts = (NetObject **) dRealloc(mLocalGhosts, newCount * sizeof(NetObject *));
+   mLocalDeltaHistory = (DeltaHistory **) dRealloc(mLocalDeltaHistory, newCount * sizeof(DeltaHistory *));
+   for(U32 i = mLocalGhostCount; i < newCount; i++)
+   {
+      mLocalGhosts[i] = NULL;
+      mLocalDeltaHistory[i] = NULL;
+   }
+   mLocalGhostCount = newCount;
+   return true;
+}
+
+bool NetConnection::reserveGhosts(U32 count)
+{
+   if(count <= mGhostCapacity)
+      return true;
+   if(count > getMaxGhostCount())
+      return false;
+
+   U32 newCapacity = getMax(mGhostCapacity, U32(InitialGhostCount));
+   while(newCapacity < count)
+      newCapacity <<= 1;
+
+   // GhostInfos are pointed at from all over, so the new ones get a block
+   // of their own rather than moving the old ones.
+   U32 added = newCapacity - mGhostCapacity;
+   GhostInfo *block = new GhostInfo[added];
+   mGhostBlocks.push_back(block);
+
+   // They all start out free, at the end of the array.
+   mGhostArray = (GhostInfo **) dRealloc(mGhostArray, newCapacity * sizeof(GhostInfo *));
+   mGhostRefs = (GhostInfo **) dRealloc(mGhostRefs, newCapacity * sizeof(GhostInfo *));
+   for(U32 i = 0; i < added; i++)
+   {
+      GhostInfo *info = block + i;
+      info->obj = NULL;
+      info->index = mGhostCapacity + i;
+      info->arrayIndex = mGhostCapacity + i;
+      info->updateMask = 0;
+      info->updateChain = NULL;
+      info->deltaFields = NULL;
+      mGhostRefs[info->index] = info;
+      mGhostArray[info->arrayIndex] = info;
+   }
+
+   // Keep the lookup table as big as the array, rehashing what's in it.
+   GhostInfo **table = new GhostInfo *[newCapacity];
+   for(U32 i = 0; i < newCapacity; i++)
+      table[i] = NULL;
+   for(U32 i = 0; i < mGhostLookupTableSize; i++)
+   {
+      GhostInfo *walk = mGhostLookupTable[i];
+      while(walk)
       {
-         mGhostRefs[i].obj = NULL;
-         mGhostRefs[i].index = i;
-         mGhostRefs[i].updateMask = 0;
+         GhostInfo *next = walk->nextLookupInfo;
+         U32 index = walk->obj->getId() & (newCapacity - 1);
+         walk->nextLookupInfo = table[index];
+         table[index] = walk;
+         walk = next;
       }
-      mGhostLookupTable = new GhostInfo *[GhostLookupTableSize];
-      for(i = 0; i < GhostLookupTableSize; i++)
-         mGhostLookupTable[i] = 0;
    }
+   delete[] mGhostLookupTable;
+   mGhostLookupTable = table;
+   mGhostLookupTableSize = newCapacity;
+
+   mGhostCapacity = newCapacity;
+   return true;
+}
+
+void NetConnection::writeGhostIndex(BitStream *stream, S32 index, bool legacyRanged)
+{
+   if(mProtocolVersion >= GhostIdBitSizeVersion)
+      stream->writeVariableU32(U32(index), mGhostIdBitSize);
+   else if(legacyRanged)
+      stream->writeRangedU32(U32(index), 0, getMaxGhostCount());
+   else
+      stream->writeInt(index, mGhostIdBitSize);
+}
+
+S32 NetConnection::readGhostIndex(BitStream *stream, bool legacyRanged)
+{
+   if(mProtocolVersion >= GhostIdBitSizeVersion)
+      return S32(stream->readVariableU32(mGhostIdBitSize));
+   else if(legacyRanged)
+      return S32(stream->readRangedU32(0, getMaxGhostCount()));
+   else
+      return stream->readInt(mGhostIdBitSize);
 }
 
 void NetConnection::ghostOnRemove()
@@ -204,7 +403,8 @@ void NetConnection::ghostPacketDropped(PacketNotify *notify)
          packRef->ghost->flags &= ~GhostInfo::KillingGhost;
       }
 
-      delete packRef;
+      freeDeltaRecords(packRef);
+      smPacketArena.free(packRef, sizeof(GhostRef));
       packRef = temp;
    }
 }
@@ -240,7 +440,8 @@ void NetConnection::ghostPacketReceived(PacketNotify *notify)
       else if(packRef->ghostInfoFlags & GhostInfo::KillingGhost)
          freeGhostInfo(packRef->ghost);
 
-      delete packRef;
+      deltaPacketReceived(packRef);
+      smPacketArena.free(packRef, sizeof(GhostRef));
       packRef = temp;
    }
 }
@@ -263,45 +464,88 @@ static S32 QSORT_CALLBACK UQECompare(const void *a,const void *b)
    return (ret < 0) ? -1 : ((ret > 0) ? 1 : 0);
 }
 
-void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
-{
-#ifdef    TORQUE_DEBUG_NET
-   bstream->writeInt(DebugChecksum, 32);
-#endif
-
-   notify->ghostList = NULL;
-
-   if(!isGhostingFrom())
-      return;
+//-----------------------------------------------------------------------------
 
-   if(!bstream->writeFlag(mGhosting))
-      return;
+static inline void swapGhosts(GhostInfo *&a, GhostInfo *&b)
+{
+   GhostInfo *temp = a;
+   a = b;
+   b = temp;
+}
 
-   // fill a packet (or two) with ghosting data
+/// Partition the array so its count highest priority ghosts are at the end,
+/// in ascending order, leaving the rest unsorted in front of them.
+static void selectTopGhosts(GhostInfo **array, S32 size, S32 count)
+{
+   if(count < size)
+   {
+      S32 lo = 0;
+      S32 hi = size - 1;
+      S32 nth = size - count;
+      while(lo < hi)
+      {
+         // Median of three for the pivot.
+         S32 mid = (lo + hi) >> 1;
+         if(array[mid]->priority < array[lo]->priority)
+            swapGhosts(array[mid], array[lo]);
+         if(array[hi]->priority < array[lo]->priority)
+            swapGhosts(array[hi], array[lo]);
+         if(array[hi]->priority < array[mid]->priority)
+            swapGhosts(array[hi], array[mid]);
+         F32 pivot = array[mid]->priority;
+
+         S32 i = lo;
+         S32 j = hi;
+         while(i <= j)
+         {
+            while(array[i]->priority < pivot)
+               i++;
+            while(array[j]->priority > pivot)
+               j--;
+            if(i <= j)
+            {
+               swapGhosts(array[i], array[j]);
+               i++;
+               j--;
+            }
+         }
 
-   // first step is to check all our polled ghosts:
+         if(nth <= j)
+            hi = j;
+         else if(nth >= i)
+            lo = i;
+         else
+            break;
+      }
+      array += size - count;
+      size = count;
+   }
+   dQsort(array, size, sizeof(GhostInfo *), UQECompare);
+}
 
+void NetConnection::ghostScopeUpdates()
+{
    // 1. Scope query - find if any new objects have come into
    //    scope and if any have gone out.
    // 2. call scoped objects' priority functions if the flag set is nonzero
    //    A removed ghost is assumed to have a high priority
    // 3. call updates based on sorted priority until the packet is
    //    full.  set flags to zero for all updated objects
+   //
+   // This is step 1, and has to run on the main thread: scoping goes
+   // through the scene graph, the container and script.
 
-   CameraScopeQuery camInfo;
-
-   camInfo.camera = NULL;
-   camInfo.pos.set(0,0,0);
-   camInfo.orientation.set(0,1,0);
-   camInfo.visibleDistance = 1;
-   camInfo.fov = (F32)(3.1415f / 4.0f);
-   camInfo.sinFov = 0.7071f;
-   camInfo.cosFov = 0.7071f;
+   mCamInfo.camera = NULL;
+   mCamInfo.pos.set(0,0,0);
+   mCamInfo.orientation.set(0,1,0);
+   mCamInfo.visibleDistance = 1;
+   mCamInfo.fov = (F32)(3.1415f / 4.0f);
+   mCamInfo.sinFov = 0.7071f;
+   mCamInfo.cosFov = 0.7071f;
 
    GhostInfo *walk;
 
    // only need to worry about the ghosts that have update masks set...
-   S32 maxIndex = 0;
    S32 i;
    for(i = 0; i < mGhostZeroUpdateIndex; i++)
    {
@@ -313,7 +557,7 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
    }
 
    if(mScopeObject)
-      mScopeObject->onCameraScopeQuery(this, &camInfo);
+      mScopeObject->onCameraScopeQuery(this, &mCamInfo);
 
    for(i = mGhostZeroUpdateIndex - 1; i >= 0; i--)
    {
@@ -321,37 +565,125 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
          detachObject(mGhostArray[i]);
    }
 
+   mGhostMaxIndex = 0;
    for(i = mGhostZeroUpdateIndex - 1; i >= 0; i--)
    {
       walk = mGhostArray[i];
-      if(walk->index > maxIndex)
-         maxIndex = walk->index;
+      if(walk->index > mGhostMaxIndex)
+         mGhostMaxIndex = walk->index;
 
       // clear out any kill objects that haven't been ghosted yet
       if((walk->flags & GhostInfo::KillGhost) && (walk->flags & GhostInfo::NotYetGhosted))
-      {
          freeGhostInfo(walk);
-         continue;
-      }
+   }
+}
+
+void NetConnection::ghostPrioritizeUpdates()
+{
+   // Step 2. Only reads object state, so this is safe on a worker thread
+   // while the main thread waits.
+   for(S32 i = mGhostZeroUpdateIndex - 1; i >= 0; i--)
+   {
+      GhostInfo *walk = mGhostArray[i];
+
       // don't do any ghost processing on objects that are being killed
       // or in the process of ghosting
-      else if(!(walk->flags & (GhostInfo::KillingGhost | GhostInfo::Ghosting)))
+      if(!(walk->flags & (GhostInfo::KillingGhost | GhostInfo::Ghosting)))
       {
          if(walk->flags & GhostInfo::KillGhost)
             walk->priority = 10000;
          else
-            walk->priority = walk->obj->getUpdatePriority(&camInfo, walk->updateMask, walk->updateSkipCount);
+            walk->priority = walk->obj->getUpdatePriority(&mCamInfo, walk->updateMask, walk->updateSkipCount);
       }
       else
          walk->priority = 0;
    }
-   GhostRef *updateList = NULL;
-   dQsort(mGhostArray, mGhostZeroUpdateIndex, sizeof(GhostInfo *), UQECompare);
+
+   // A packet only has room for so many updates, so rather than sort the
+   // lot, pull out the ones that might make it.
+   ghostSelectUpdates(mGhostZeroUpdateIndex);
+}
+
+void NetConnection::ghostSelectUpdates(S32 size)
+{
+   selectTopGhosts(mGhostArray, size, getMin(size, S32(mGhostSelectCount)));
 
    // reset the array indices...
-   for(i = mGhostZeroUpdateIndex - 1; i >= 0; i--)
+   for(S32 i = size - 1; i >= 0; i--)
       mGhostArray[i]->arrayIndex = i;
+}
+
+static Metric sGhostPrepare("net.ghostPrepare", Metric::Timer);
+
+/// Works out one connection's ghost priorities on the thread pool.
+class GhostPrioritizeItem : public ThreadPool::WorkItem
+{
+   NetConnection *mConnection;
+public:
+   GhostPrioritizeItem(NetConnection *connection) : WorkItem(true), mConnection(connection) {}
+   void execute() { mConnection->ghostPrioritizeUpdates(); }
+};
+
+void NetConnection::prepareGhostPackets(NetConnection **list, U32 count)
+{
+   MetricScope prepareScope(sGhostPrepare);
+
+   U32 prepared = 0;
+   for(U32 i = 0; i < count; i++)
+   {
+      NetConnection *conn = list[i];
+      if(!conn->isGhostingFrom() || !conn->mGhosting)
+         continue;
+
+      conn->ghostScopeUpdates();
+      conn->mGhostsPrepared = true;
+      list[prepared++] = conn;
+   }
+
+#ifdef TORQUE_MULTITHREAD
+   if(smParallelGhosting && prepared > 1)
+   {
+      ThreadPool::WorkGroup group;
+      for(U32 i = 0; i < prepared; i++)
+         ThreadPool::GLOBAL().queueWorkItem(new GhostPrioritizeItem(list[i]), &group);
+      ThreadPool::GLOBAL().waitForGroup(&group);
+      return;
+   }
+#endif
+
+   for(U32 i = 0; i < prepared; i++)
+      list[i]->ghostPrioritizeUpdates();
+}
+
+void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
+{
+#ifdef    TORQUE_DEBUG_NET
+   bstream->writeInt(DebugChecksum, 32);
+#endif
+
+   notify->ghostList = NULL;
 
+   bool prepared = mGhostsPrepared;
+   mGhostsPrepared = false;
+
+   if(!isGhostingFrom())
+      return;
+
+   if(!bstream->writeFlag(mGhosting))
+      return;
+
+   // fill a packet (or two) with ghosting data, unless
+   // prepareGhostPackets() has already scoped and sorted for us.
+   if(!prepared)
+   {
+      ghostScopeUpdates();
+      ghostPrioritizeUpdates();
+   }
+
+   GhostRef *updateList = NULL;
+   S32 i;
+
+   S32 maxIndex = mGhostMaxIndex;
    S32 sendSize = 1;
    while(maxIndex >>= 1)
       sendSize++;
@@ -361,10 +693,20 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
 
    bstream->writeInt(sendSize - 3, GhostIndexBitSize);
 
+   // Everything below the selected ghosts is still in no particular order.
+   S32 selectEnd = mGhostZeroUpdateIndex - getMin(S32(mGhostZeroUpdateIndex), S32(mGhostSelectCount));
+
    U32 count = 0;
    //
    for(i = mGhostZeroUpdateIndex - 1; i >= 0 && !bstream->isFull(); i--)
    {
+      // Ran out of selected ghosts with room to spare, select some more.
+      if(i < selectEnd)
+      {
+         ghostSelectUpdates(i + 1);
+         selectEnd = i + 1 - getMin(i + 1, S32(mGhostSelectCount));
+      }
+
       GhostInfo *walk = mGhostArray[i];
 		if(walk->flags & (GhostInfo::KillingGhost | GhostInfo::Ghosting))
 		   continue;
@@ -374,7 +716,7 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
       bstream->writeInt(walk->index, sendSize);
       U32 updateMask = walk->updateMask;
 
-      GhostRef *upd = new GhostRef;
+      GhostRef *upd = smPacketArena.alloc<GhostRef>(1);
 
       upd->nextRef = updateList;
       updateList = upd;
@@ -383,6 +725,7 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
 
       upd->ghost = walk;
       upd->ghostInfoFlags = 0;
+      upd->deltas = NULL;
 
       if(walk->flags & GhostInfo::KillGhost)
       {
@@ -418,7 +761,12 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
          }
 #endif
          // update the object
+         U32 packStart = bstream->getCurPos();
+         mPackingRef = upd;
          U32 retMask = walk->obj->packUpdate(this, updateMask, bstream);
+         mPackingRef = NULL;
+         recordGhostStats(getNetClassGroup(), walk->obj, updateMask & ~retMask, upd->ghostInfoFlags == GhostInfo::Ghosting,
+            bstream->getCurPos() - packStart);
          DEBUG_LOG(("PKLOG %d GHOST %d: %s", getId(), bstream->getCurPos() - 16 - startPos, walk->obj->getClassName()));
 
          AssertFatal((retMask & (~updateMask)) == 0, "Cannot set new bits in packUpdate return");
@@ -438,6 +786,10 @@ void NetConnection::ghostWritePacket(BitStream *bstream, PacketNotify *notify)
       count++;
    }
    //Con::printf("Ghosts updated: %d (%d remain)", count, mGhostZeroUpdateIndex);
+
+   // Select enough for a packet like this one next time, with some room.
+   mGhostSelectCount = getMax(count * 2, U32(MinGhostSelectCount));
+
    // no more objects...
    bstream->writeFlag(false);
    notify->ghostList = updateList;
@@ -469,12 +821,18 @@ void NetConnection::ghostReadPacket(BitStream *bstream)
       U32 index;
       //S32 startPos = bstream->getCurPos();
       index = (U32) bstream->readInt(idSize);
+      if(!reserveLocalGhosts(index + 1))
+      {
+         setLastError("Invalid packet.");
+         return;
+      }
       if(bstream->readFlag()) // is this ghost being deleted?
       {
 		 mGhostsActive--;
          AssertFatal(mLocalGhosts[index] != NULL, "Error, NULL ghost encountered.");
          mLocalGhosts[index]->deleteObject();
          mLocalGhosts[index] = NULL;
+         clearDeltaHistory(index);
       }
       else
       {
@@ -508,7 +866,10 @@ void NetConnection::ghostReadPacket(BitStream *bstream)
                avar("class id mismatch for dest class %s.",
                   mLocalGhosts[index]->getClassName()) );
 #endif
+            clearDeltaHistory(index);
+            mUnpackingIndex = index;
             mLocalGhosts[index]->unpackUpdate(this, bstream);
+            mUnpackingIndex = -1;
 
             if(!obj->registerObject())
             {
@@ -532,7 +893,9 @@ void NetConnection::ghostReadPacket(BitStream *bstream)
                avar("class id mismatch for dest class %s.",
                   mLocalGhosts[index]->getClassName()) );
 #endif
+            mUnpackingIndex = index;
             mLocalGhosts[index]->unpackUpdate(this, bstream);
+            mUnpackingIndex = -1;
          }
          //PacketStream::getStats()->addBits(PacketStats::Receive, bstream->getCurPos() - startPos, ghostRefs[index].localGhost->getPersistTag());
 #ifdef TORQUE_DEBUG_NET
@@ -582,7 +945,7 @@ void NetConnection::detachObject(GhostInfo *info)
 
       // remove it from the lookup table
       U32 id = info->obj->getId();
-      for(GhostInfo **walk = &mGhostLookupTable[id & (GhostLookupTableSize - 1)]; *walk; walk = &((*walk)->nextLookupInfo))
+      for(GhostInfo **walk = &mGhostLookupTable[id & (mGhostLookupTableSize - 1)]; *walk; walk = &((*walk)->nextLookupInfo))
       {
          GhostInfo *temp = *walk;
          if(temp == info)
@@ -616,7 +979,7 @@ void NetConnection::objectLocalScopeAlways(NetObject *obj)
    if(!isGhostingFrom())
       return;
    objectInScope(obj);
-   for(GhostInfo *walk = mGhostLookupTable[obj->getId() & (GhostLookupTableSize - 1)]; walk; walk = walk->nextLookupInfo)
+   for(GhostInfo *walk = mGhostLookupTable[obj->getId() & (mGhostLookupTableSize - 1)]; walk; walk = walk->nextLookupInfo)
    {
       if(walk->obj != obj)
          continue;
@@ -629,7 +992,7 @@ void NetConnection::objectLocalClearAlways(NetObject *obj)
 {
    if(!isGhostingFrom())
       return;
-   for(GhostInfo *walk = mGhostLookupTable[obj->getId() & (GhostLookupTableSize - 1)]; walk; walk = walk->nextLookupInfo)
+   for(GhostInfo *walk = mGhostLookupTable[obj->getId() & (mGhostLookupTableSize - 1)]; walk; walk = walk->nextLookupInfo)
    {
       if(walk->obj != obj)
          continue;
@@ -641,7 +1004,7 @@ void NetConnection::objectLocalClearAlways(NetObject *obj)
 bool NetConnection::validateGhostArray()
 {
    AssertFatal(mGhostZeroUpdateIndex >= 0 && mGhostZeroUpdateIndex <= mGhostFreeIndex, "Invalid update index range.");
-   AssertFatal(mGhostFreeIndex <= MaxGhostCount, "Invalid free index range.");
+   AssertFatal(mGhostFreeIndex <= mGhostCapacity, "Invalid free index range.");
    U32 i;
    for(i = 0; i < mGhostZeroUpdateIndex; i ++)
    {
@@ -653,7 +1016,7 @@ bool NetConnection::validateGhostArray()
       AssertFatal(mGhostArray[i]->arrayIndex == i, "Invalid array index.");
       AssertFatal(mGhostArray[i]->updateMask == 0, "Invalid ghost mask.");
    }
-   for(; i < MaxGhostCount; i++)
+   for(; i < mGhostCapacity; i++)
    {
       AssertFatal(mGhostArray[i]->arrayIndex == i, "Invalid array index.");
    }
@@ -667,13 +1030,11 @@ void NetConnection::objectInScope(NetObject *obj)
 	if (obj->isScopeLocal() && !isLocalConnection())
 		return;
 
-   S32 index = obj->getId() & (GhostLookupTableSize - 1);
-
    // check if it's already in scope
    // the object may have been cleared out without the lookupTable being cleared
    // so validate that the object pointers are the same.
 
-   for(GhostInfo *walk = mGhostLookupTable[index ]; walk; walk = walk->nextLookupInfo)
+   for(GhostInfo *walk = mGhostLookupTable[obj->getId() & (mGhostLookupTableSize - 1)]; walk; walk = walk->nextLookupInfo)
    {
       if(walk->obj != obj)
          continue;
@@ -681,11 +1042,12 @@ void NetConnection::objectInScope(NetObject *obj)
       return;
    }
 
-   if (mGhostFreeIndex == MaxGhostCount)
+   if (mGhostFreeIndex == mGhostCapacity && !reserveGhosts(mGhostCapacity + 1))
    {
       AssertWarn(0,"NetConnection::objectInScope: too many ghosts");
       return;
    }
+   S32 index = obj->getId() & (mGhostLookupTableSize - 1);
 
    GhostInfo *giptr = mGhostArray[mGhostFreeIndex];
    ghostPushFreeToZero(giptr);
@@ -701,6 +1063,10 @@ void NetConnection::objectInScope(NetObject *obj)
    giptr->updateChain = NULL;
    giptr->updateSkipCount = 0;
 
+   // Nothing the last object in this slot had acked is any use now.
+   delete[] giptr->deltaFields;
+   giptr->deltaFields = NULL;
+
    giptr->connection = this;
 
    giptr->nextObjectRef = obj->mFirstObjectRef;
@@ -758,13 +1124,14 @@ void NetConnection::handleConnectionMessage(U32 message, U32 sequence, U32 ghost
       case EndGhosting:
          // just delete all the local ghosts,
          // and delete all the ghosts in the current save list
-         for(i = 0; i < MaxGhostCount; i++)
+         for(i = 0; i < mLocalGhostCount; i++)
          {
             if(mLocalGhosts[i])
             {
                mLocalGhosts[i]->deleteObject();
                mLocalGhosts[i] = NULL;
             }
+            clearDeltaHistory(i);
          }
          while(mGhostAlwaysSaveList.size())
          {
@@ -779,9 +1146,8 @@ void NetConnection::handleConnectionMessage(U32 message, U32 sequence, U32 ghost
          sendNextFileDownloadRequest();
          break;
       case FileDownloadSizeMessage:
-         mCurrentFileBufferSize = sequence;
-         mCurrentFileBuffer = dRealloc(mCurrentFileBuffer, mCurrentFileBufferSize);
-         mCurrentFileBufferOffset = 0;
+         // What older servers send instead of a FileDownloadStartEvent.
+         fileStartReceived(true, sequence, 0, sequence, false, 0);
          break;
    }
 }
@@ -805,16 +1171,22 @@ void NetConnection::activateGhosting()
    U32 sz = ghostAlwaysSet->size();
    S32 j;
 
+   if(!reserveGhosts(sz))
+      Con::warnf("NetConnection::activateGhosting - %d ghost always objects, only room for %d.", sz, getMaxGhostCount());
+
+   // Ghost always objects take the indices at the top, so the ghosts that
+   // update the most get the small ones.
+   sz = getMin(sz, mGhostCapacity);
    for(j = 0; j < sz; j++)
    {
-      U32 idx = MaxGhostCount - sz + j;
-      mGhostArray[j] = mGhostRefs + idx;
+      U32 idx = mGhostCapacity - sz + j;
+      mGhostArray[j] = mGhostRefs[idx];
       mGhostArray[j]->arrayIndex = j;
    }
-   for(j = sz; j < MaxGhostCount; j++)
+   for(j = sz; j < mGhostCapacity; j++)
    {
       U32 idx = j - sz;
-      mGhostArray[j] = mGhostRefs + idx;
+      mGhostArray[j] = mGhostRefs[idx];
       mGhostArray[j]->arrayIndex = j;
    }
    mScoping = true; // so that objectInScope will work
@@ -851,12 +1223,12 @@ void NetConnection::clearGhostInfo()
       ghostPacketReceived(walk);
       walk->ghostList = NULL;
    }
-   for(S32 i = 0; i < MaxGhostCount; i++)
+   for(S32 i = 0; i < mGhostCapacity; i++)
    {
-      if(mGhostRefs[i].arrayIndex < mGhostFreeIndex)
+      if(mGhostRefs[i]->arrayIndex < mGhostFreeIndex)
       {
-         detachObject(&mGhostRefs[i]);
-         freeGhostInfo(&mGhostRefs[i]);
+         detachObject(mGhostRefs[i]);
+         freeGhostInfo(mGhostRefs[i]);
       }
    }
    AssertFatal((mGhostFreeIndex == 0) && (mGhostZeroUpdateIndex == 0), "Invalid indices.");
@@ -879,7 +1251,7 @@ void NetConnection::resetGhosting()
 
 void NetConnection::setGhostAlwaysObject(NetObject *object, U32 index)
 {
-   if(!isGhostingTo())
+   if(!isGhostingTo() || !reserveLocalGhosts(index + 1))
    {
       object->deleteObject();
       setLastError("Invalid packet.");
@@ -887,6 +1259,7 @@ void NetConnection::setGhostAlwaysObject(NetObject *object, U32 index)
    }
    object->mNetFlags = NetObject::IsGhost;
    object->mNetIndex = index;
+   clearDeltaHistory(index);
 
    // while there's an object waiting...
    if (isLocalConnection()) {
@@ -989,19 +1362,23 @@ void NetConnection::loadNextGhostAlwaysObject(bool hadNewFiles)
 
 NetObject *NetConnection::resolveGhost(S32 id)
 {
+   if(U32(id) >= mLocalGhostCount)
+      return NULL;
    return mLocalGhosts[id];
 }
 
 NetObject *NetConnection::resolveObjectFromGhostIndex(S32 id)
 {
-   return mGhostRefs[id].obj;
+   if(U32(id) >= mGhostCapacity)
+      return NULL;
+   return mGhostRefs[id]->obj;
 }
 
 S32 NetConnection::getGhostIndex(NetObject *obj)
 {
    if(!isGhostingFrom())
       return obj->mNetIndex;
-   S32 index = obj->getId() & (GhostLookupTableSize - 1);
+   S32 index = obj->getId() & (mGhostLookupTableSize - 1);
 
    for(GhostInfo *gptr = mGhostLookupTable[index]; gptr; gptr = gptr->nextLookupInfo)
    {
@@ -1029,12 +1406,12 @@ void NetConnection::ghostWriteStartBlock(ResizeBitStream *stream)
    stream->write(mGhostingSequence);
 
    // first write out the indices and ids:
-   for(U32 i = 0; i < MaxGhostCount; i++)
+   for(U32 i = 0; i < mLocalGhostCount; i++)
    {
       if(mLocalGhosts[i])
       {
          stream->writeFlag(true);
-         stream->writeInt(i, GhostIdBitSize);
+         writeGhostIndex(stream, i);
          stream->writeClassId(mLocalGhosts[i]->getClassId(getNetClassGroup()), NetClassTypeObject, getNetClassGroup());
          stream->validate();
       }
@@ -1048,7 +1425,7 @@ void NetConnection::ghostWriteStartBlock(ResizeBitStream *stream)
    // then, for each ghost written into the start block, write the full pack update
    // into the start block.  For demos to work properly, packUpdate must
    // be callable from client objects.
-   for(U32 i = 0; i < MaxGhostCount; i++)
+   for(U32 i = 0; i < mLocalGhostCount; i++)
    {
       if(mLocalGhosts[i])
       {
@@ -1056,6 +1433,10 @@ void NetConnection::ghostWriteStartBlock(ResizeBitStream *stream)
          stream->validate();
       }
    }
+
+   // Updates recorded after this may be deltas against earlier ones.
+   writeDeltaHistory(stream);
+   stream->validate();
 }
 
 void NetConnection::ghostReadStartBlock(BitStream *stream)
@@ -1067,7 +1448,12 @@ void NetConnection::ghostReadStartBlock(BitStream *stream)
 
    while(stream->readFlag())
    {
-      U32 index = stream->readInt(GhostIdBitSize);
+      U32 index = readGhostIndex(stream);
+      if(!reserveLocalGhosts(index + 1))
+      {
+         setLastError("Invalid packet.");
+         return;
+      }
       S32 tag = stream->readClassId(NetClassTypeObject, getNetClassGroup());
       NetObject *obj = (NetObject *) ConsoleObject::create(getNetClassGroup(), NetClassTypeObject, tag);
       if(!obj)
@@ -1084,7 +1470,7 @@ void NetConnection::ghostReadStartBlock(BitStream *stream)
    // through all non-null mLocalGhosts, unpacking the objects
    // as we go:
 
-   for(U32 i = 0; i < MaxGhostCount; i++)
+   for(U32 i = 0; i < mLocalGhostCount; i++)
    {
       if(mLocalGhosts[i])
       {
@@ -1098,6 +1484,7 @@ void NetConnection::ghostReadStartBlock(BitStream *stream)
          addObject(mLocalGhosts[i]);
       }
    }
+   readDeltaHistory(stream);
    // MARKF - TODO - looks like we could have memory leaks here
    // if there are errors.
 }
@@ -10,6 +10,7 @@
 #include "core/bitStream.h"
 #include "math/mRandom.h"
 #include "platform/gameInterface.h"
+#include "platform/metrics.h"
 
 NetInterface *GNet = NULL;
 StringTableEntry gMatchMakerToken = NULL;
@@ -63,10 +64,17 @@ NetConnection *NetInterface::findPendingConnection(const NetAddress *address, U3
    return NULL;
 }
 
+static Metric sPacketsIn("net.packetsIn", Metric::Counter);
+static Metric sBytesIn("net.bytesIn", Metric::Counter);
+static Metric sPacketProcess("net.process", Metric::Timer);
+
 void NetInterface::processPacketReceiveEvent(PacketReceiveEvent *prEvent)
 {
+   MetricScope processScope(sPacketProcess);
 
    U32 dataSize = prEvent->size - PacketReceiveEventHeaderSize;
+   sPacketsIn.add();
+   sBytesIn.add(dataSize);
    BitStream pStream(prEvent->data, dataSize);
 
    if(prEvent->data[0] & 0x01) // it's a protocol packet...
@@ -77,7 +85,11 @@ void NetInterface::processPacketReceiveEvent(PacketReceiveEvent *prEvent)
       // lookup the connection in the addressTable
       NetConnection *conn = NetConnection::lookup(&prEvent->sourceAddress);
       if(conn)
+      {
+         NetConnection::smPacketArrivalTime = prEvent->arrivalTime;
          conn->processRawPacket(&pStream);
+         NetConnection::smPacketArrivalTime = 0;
+      }
    }
    else
    {
@@ -301,12 +313,18 @@ void NetInterface::handleConnectRequest(const NetAddress *address, BitStream *st
    conn->setSequence(connectSequence);
 
    const char *errorString = NULL;
+   U32 requestStart = stream->getCurPos();
    if(!conn->readConnectRequest(stream, &errorString))
    {
       sendConnectReject(conn, errorString);
       conn->deleteObject();
       return;
    }
+   if(NetConnection::isCapturingTraffic())
+   {
+      stream->setCurPos(requestStart);
+      conn->beginCapture(stream);
+   }
    conn->setNetworkConnection(true);
    conn->onConnectionEstablished(false);
    conn->setEstablished();
@@ -423,23 +441,42 @@ void NetInterface::handleInfoPacket(const NetAddress *address, U8 packetType, Bi
 void NetInterface::processClient()
 {
    NetObject::collapseDirtyList(); // collapse all the mask bits...
+   Net::beginSendBatch();
    for(NetConnection *walk = NetConnection::getConnectionList();
       walk; walk = walk->getNext())
    {
       if(walk->isConnectionToServer() && (walk->isLocalConnection() || walk->isNetworkConnection()))
          walk->checkPacketSend(false);
    }
+   Net::endSendBatch();
 }
 
 void NetInterface::processServer()
 {
    NetObject::collapseDirtyList(); // collapse all the mask bits...
+
+   // Choose the ghost updates for every client that's due a packet first,
+   // so the work can be shared out.
+   static Vector<NetConnection *> due;
+   due.clear();
+   for(NetConnection *walk = NetConnection::getConnectionList();
+      walk; walk = walk->getNext())
+   {
+      if(!walk->isConnectionToServer() && (walk->isLocalConnection() || walk->isNetworkConnection()) && walk->isPacketDue())
+         due.push_back(walk);
+   }
+   if(due.size())
+      NetConnection::prepareGhostPackets(due.address(), due.size());
+
+   // Every client's packet for this tick goes out in one go.
+   Net::beginSendBatch();
    for(NetConnection *walk = NetConnection::getConnectionList();
       walk; walk = walk->getNext())
    {
       if(!walk->isConnectionToServer() && (walk->isLocalConnection() || walk->isNetworkConnection()))
          walk->checkPacketSend(false);
    }
+   Net::endSendBatch();
 }
 
 void NetInterface::startConnection(NetConnection *conn)
@@ -18,14 +18,16 @@
 #include "dgl/dgl.h"
 #include "sim/netConnection.h"
 #include "lightingSystem/sgLightObject.h"
+#include "math/mRandom.h"
+#include "platform/threadPool.h"
+#include "platform/platformThread.h"
+#include "core/pooledArena.h"
 
 IMPLEMENT_CONOBJECT(SceneObject);
 
-const U32 Container::csmNumBins = 16;
-const F32 Container::csmBinSize = 64;
-const F32 Container::csmTotalBinSize = Container::csmBinSize * Container::csmNumBins;
-U32       Container::smCurrSeqKey = 1;
+const F32 Container::csmMinBinSize = 8;
 const U32 Container::csmRefPoolBlockSize = 4096;
+bool Container::smParallelRayCasts = true;
 
 // Statics used by buildPolyList methods
 AbstractPolyList* sPolyList;
@@ -246,72 +248,179 @@ ConsoleFunction( containerRayCast, const char*, 4, 5, "( Point3F start, Point3F
    return(returnBuffer);
 }
 
-ConsoleFunctionGroupEnd( Containers );
+ConsoleFunction(dumpContainerBins, void, 1, 2, "([bool client]) - Print how the server (or client) "
+                "container's objects are spread over its bins.")
+{
+   if (argc > 1 && dAtob(argv[1]))
+      gClientContainer.dumpBinStats();
+   else
+      gServerContainer.dumpBinStats();
+}
 
-// Utility method for bin insertion
-void getBinRange(const F32 min,
-                 const F32 max,
-                 U32&      minBin,
-                 U32&      maxBin)
+/// A box that rays hit, for benchmarking the container without a mission.
+class BenchmarkBoxObject : public SceneObject
 {
-   AssertFatal(max >= min, "Error, bad range! in getBinRange");
+   bool mThreadSafe;
 
-   if ((max - min) >= Container::csmTotalBinSize) {
-      F32 minCoord = mFmod(min, Container::csmTotalBinSize);
-      if (minCoord < 0.0f) {
-         minCoord += Container::csmTotalBinSize;
+public:
+   BenchmarkBoxObject(const Point3F &pos, const Point3F &size, bool threadSafe)
+   {
+      mThreadSafe = threadSafe;
+      mTypeMask = StaticObjectType;
+      mObjBox.min = size * -0.5f;
+      mObjBox.max = size * 0.5f;
+      MatrixF mat(true);
+      mat.setColumn(3, pos);
+      setTransform(mat);
+   }
 
-         // This is truly lame, but it can happen.  There must be a better way to
-         //  deal with this.
-         if (minCoord == Container::csmTotalBinSize)
-            minCoord = Container::csmTotalBinSize - 0.01;
-      }
-      AssertFatal(minCoord >= 0.0 && minCoord < Container::csmTotalBinSize, "Bad minCoord");
+   bool castRay(const Point3F &start, const Point3F &end, RayInfo *info)
+   {
+      if (!mObjBox.collideLine(start, end, &info->t, &info->normal))
+         return false;
+      info->object = this;
+      return true;
+   }
 
-      minBin = U32(minCoord / Container::csmBinSize);
-      AssertFatal(minBin < Container::csmNumBins, avar("Error, bad clipping! (%g, %d)", minCoord, minBin));
+   bool isCastRayThreadSafe() const { return mThreadSafe; }
+};
 
-      maxBin = minBin + (Container::csmNumBins - 1);
-      return;
-   } else {
+static void countFound(SceneObject *, void *key)
+{
+   (*(U32 *) key)++;
+}
+
+ConsoleFunction(benchmarkContainer, void, 1, 4, "([objects = 100000[, queries = 10000[, worldSize = 8192]]]) "
+                "Time ray casts and box queries on a container full of boxes, and check them by brute force.")
+{
+   U32 objectCount = argc > 1 ? getMax(dAtoi(argv[1]), 1) : 100000;
+   U32 queryCount  = argc > 2 ? getMax(dAtoi(argv[2]), 1) : 10000;
+   F32 worldSize   = argc > 3 ? getMax(F32(dAtof(argv[3])), 64.0f) : 8192;
 
-      F32 minCoord = mFmod(min, Container::csmTotalBinSize);
-      if (minCoord < 0.0f) {
-         minCoord += Container::csmTotalBinSize;
+   MRandomLCG rand(1);
+   Container *container = new Container;
+   Vector<SceneObject *> objects;
 
-         // This is truly lame, but it can happen.  There must be a better way to
-         //  deal with this.
-         if (minCoord == Container::csmTotalBinSize)
-            minCoord = Container::csmTotalBinSize - 0.01;
+   // Mostly small things, a few buildings, half of it all packed in towns.
+   // Half the objects make batched casts go back to the main thread.
+   U32 start = Platform::getRealMilliseconds();
+   for (U32 i = 0; i < objectCount; i++)
+   {
+      F32 extent = (i % 100) == 0 ? rand.randF(20, 200) : rand.randF(0.5f, 4);
+      Point3F pos(rand.randF(0, worldSize), rand.randF(0, worldSize), rand.randF(0, 100));
+      if (i & 1)
+      {
+         F32 town = F32(rand.randI(0, 7)) * worldSize / 8;
+         pos.x = town + rand.randF(0, 256);
+         pos.y = town + rand.randF(0, 256);
       }
-      AssertFatal(minCoord >= 0.0 && minCoord < Container::csmTotalBinSize, "Bad minCoord");
+      objects.push_back(new BenchmarkBoxObject(pos, Point3F(extent, extent, extent), (i & 2) != 0));
+      container->addObject(objects.last());
+   }
+   Con::printf("Container benchmark: %d objects added in %d ms", objectCount, Platform::getRealMilliseconds() - start);
+   container->dumpBinStats();
+
+   Vector<Point3F> rayStarts, rayEnds;
+   Vector<Box3F> boxes;
+   for (U32 i = 0; i < queryCount; i++)
+   {
+      Point3F from(rand.randF(0, worldSize), rand.randF(0, worldSize), rand.randF(0, 100));
+      if (i & 1)
+         from.x = from.y = F32(rand.randI(0, 7)) * worldSize / 8 + rand.randF(0, 256);
+      Point3F dir(rand.randF(-1, 1), rand.randF(-1, 1), rand.randF(-0.2f, 0.2f));
+      dir.normalizeSafe();
+      rayStarts.push_back(from);
+      rayEnds.push_back(from + dir * rand.randF(10, 500));
+
+      F32 half = rand.randF(5, 50);
+      boxes.push_back(Box3F(from - Point3F(half, half, half), from + Point3F(half, half, half)));
+   }
 
-      F32 maxCoord = mFmod(max, Container::csmTotalBinSize);
-      if (maxCoord < 0.0f) {
-         maxCoord += Container::csmTotalBinSize;
+   U32 hits = 0;
+   start = Platform::getRealMilliseconds();
+   for (U32 i = 0; i < queryCount; i++)
+   {
+      RayInfo info;
+      if (container->castRay(rayStarts[i], rayEnds[i], StaticObjectType, &info))
+         hits++;
+   }
+   U32 rayTime = Platform::getRealMilliseconds() - start;
 
-         // This is truly lame, but it can happen.  There must be a better way to
-         //  deal with this.
-         if (maxCoord == Container::csmTotalBinSize)
-            maxCoord = Container::csmTotalBinSize - 0.01;
-      }
-      AssertFatal(maxCoord >= 0.0 && maxCoord < Container::csmTotalBinSize, "Bad maxCoord");
+   U32 found = 0;
+   start = Platform::getRealMilliseconds();
+   for (U32 i = 0; i < queryCount; i++)
+      container->findObjects(boxes[i], StaticObjectType, countFound, &found);
+   U32 boxTime = Platform::getRealMilliseconds() - start;
 
-      minBin = U32(minCoord / Container::csmBinSize);
-      maxBin = U32(maxCoord / Container::csmBinSize);
-      AssertFatal(minBin < Container::csmNumBins, avar("Error, bad clipping(min)! (%g, %d)", maxCoord, minBin));
-      AssertFatal(minBin < Container::csmNumBins, avar("Error, bad clipping(max)! (%g, %d)", maxCoord, maxBin));
+   Vector<Container::RayQuery> batch;
+   batch.setSize(queryCount);
+   for (U32 i = 0; i < queryCount; i++)
+   {
+      batch[i].start = rayStarts[i];
+      batch[i].end   = rayEnds[i];
+      batch[i].mask  = StaticObjectType;
+   }
+   start = Platform::getRealMilliseconds();
+   container->castRays(batch.address(), queryCount);
+   U32 batchTime = Platform::getRealMilliseconds() - start;
 
-      // MSVC6 seems to be generating some bad floating point code around
-      // here when full optimizations are on.  The min != max test should
-      // not be needed, but it clears up the VC issue.
-      if (min != max && minCoord >= maxCoord)
-         maxBin += Container::csmNumBins;
+   U32 batchMismatches = 0;
+   for (U32 i = 0; i < queryCount; i++)
+   {
+      RayInfo info;
+      bool hit = container->castRay(rayStarts[i], rayEnds[i], StaticObjectType, &info);
+      if (hit != batch[i].hit || (hit && info.t != batch[i].info.t))
+         batchMismatches++;
+   }
 
-      AssertFatal(maxBin >= minBin, "Error, min should always be less than max!");
+   Con::printf("   %d ray casts in %d ms (%.2f us each), %d hits", queryCount, rayTime,
+      rayTime * 1000.0f / queryCount, hits);
+   Con::printf("   %d batched ray casts in %d ms (%.2f us each), %d disagreed with castRay()", queryCount,
+      batchTime, batchTime * 1000.0f / queryCount, batchMismatches);
+   Con::printf("   %d box queries in %d ms (%.2f us each), %d objects found", queryCount, boxTime,
+      boxTime * 1000.0f / queryCount, found);
+
+   // Everything the bins say has to match looking at every object.
+   U32 checks = getMin(queryCount, U32(200));
+   U32 mismatches = 0;
+   for (U32 i = 0; i < checks; i++)
+   {
+      F32 bestT = 2;
+      for (U32 j = 0; j < objectCount; j++)
+      {
+         RayInfo ri;
+         Point3F xformedStart, xformedEnd;
+         objects[j]->getWorldTransform().mulP(rayStarts[i], &xformedStart);
+         objects[j]->getWorldTransform().mulP(rayEnds[i], &xformedEnd);
+         if (objects[j]->castRay(xformedStart, xformedEnd, &ri) && ri.t < bestT)
+            bestT = ri.t;
+      }
+      RayInfo info;
+      F32 t = container->castRay(rayStarts[i], rayEnds[i], StaticObjectType, &info) ? info.t : 2;
+      // Allow for rounding in the transforms.
+      if (mFabs(t - bestT) > 0.0001f)
+         mismatches++;
+
+      U32 expected = 0;
+      for (U32 j = 0; j < objectCount; j++)
+         if (objects[j]->getWorldBox().isOverlapped(boxes[i]))
+            expected++;
+      U32 count = 0;
+      container->findObjects(boxes[i], StaticObjectType, countFound, &count);
+      if (count != expected)
+         mismatches++;
    }
+   Con::printf("   %d of %d queries checked by brute force disagreed", mismatches, checks * 2);
+
+   for (U32 i = 0; i < objectCount; i++)
+   {
+      container->removeObject(objects[i]);
+      delete objects[i];
+   }
+   delete container;
 }
 
+ConsoleFunctionGroupEnd( Containers );
 
 //--------------------------------------------------------------------------
 //-------------------------------------- SceneObject implementation
@@ -349,8 +458,6 @@ SceneObject::SceneObject()
    mRenderWorldBox = Box3F(Point3F(0, 0, 0), Point3F(0, 0, 0));
    mRenderWorldSphere = SphereF(Point3F(0, 0, 0), 0);
 
-   mContainerSeqKey = 0;
-
    mBinRefHead  = NULL;
 
    mSceneManager     = NULL;
@@ -362,10 +469,9 @@ SceneObject::SceneObject()
    mLastState    = NULL;
    mLastStateKey = 0;
 
-   mBinMinX = 0xFFFFFFFF;
-   mBinMaxX = 0xFFFFFFFF;
-   mBinMinY = 0xFFFFFFFF;
-   mBinMaxY = 0xFFFFFFFF;
+   mBinLevel = 0xFFFFFFFF;
+   mBinX = 0;
+   mBinY = 0;
 }
 
 SceneObject::~SceneObject()
@@ -667,6 +773,11 @@ void SceneObject::initPersistFields()
    endGroup("Transform"); // MM: Added group footer.
 }
 
+void SceneObject::consoleInit()
+{
+   Con::addVariable("pref::Container::ParallelRayCasts", TypeBool, &Container::smParallelRayCasts);
+}
+
 bool SceneObject::onSceneAdd(SceneGraph* pGraph)
 {
    mSceneManager = pGraph;
@@ -804,17 +915,15 @@ Container::Container()
       sBoxPolyhedron.buildBox(imat,box);
    }
 
-   mBinArray = new SceneObjectRef[csmNumBins * csmNumBins];
-   for (U32 i = 0; i < csmNumBins; i++) 
+   mBinHashSize = InitialBinHashSize;
+   mBinHash = new BinCell*[mBinHashSize];
+   dMemset(mBinHash, 0, mBinHashSize * sizeof(BinCell*));
+   mBinCellCount = 0;
+   mFreeBinCells = NULL;
+   for (U32 i = 0; i < NumBinLevels; i++)
    {
-      U32 base = i * csmNumBins;
-      for (U32 j = 0; j < csmNumBins; j++) 
-      {
-         mBinArray[base + j].object    = NULL;
-         mBinArray[base + j].nextInBin = NULL;
-         mBinArray[base + j].prevInBin = NULL;
-         mBinArray[base + j].nextInObj = NULL;
-      }
+      mLevelCells[i] = NULL;
+      mLevelCellCounts[i] = 0;
    }
    mOverflowBin.object    = NULL;
    mOverflowBin.nextInBin = NULL;
@@ -853,6 +962,23 @@ Container::~Container()
    }
    mFreeRefPool = NULL;
 
+   for (U32 i = 0; i < NumBinLevels; i++)
+   {
+      while (mLevelCells[i])
+      {
+         BinCell* next = mLevelCells[i]->nextInLevel;
+         delete mLevelCells[i];
+         mLevelCells[i] = next;
+      }
+   }
+   while (mFreeBinCells)
+   {
+      BinCell* next = mFreeBinCells->nextInHash;
+      delete mFreeBinCells;
+      mFreeBinCells = next;
+   }
+   delete [] mBinHash;
+
    cleanupSearchVectors();
 }
 
@@ -894,150 +1020,215 @@ void Container::addRefPoolBlock()
    mFreeRefPool = &(mRefPoolBlocks.last()[0]);
 }
 
+//----------------------------------------------------------------------------
 
-void Container::insertIntoBins(SceneObject* obj)
+S32 Container::getBinCoord(F32 coord, F32 binSize)
 {
-   AssertFatal(obj != NULL, "No object?");
-   AssertFatal(obj->mBinRefHead == NULL, "Error, already have a bin chain!");
+   // Keep far flung objects from overflowing the cell coordinates.
+   F32 cell = mFloor(coord / binSize);
+   return S32(mClampF(cell, -F32(1 << 30), F32(1 << 30)));
+}
 
-   // The first thing we do is find which bins are covered in x and y...
-   const Box3F* pWBox = &obj->getWorldBox();
+U32 Container::getBinLevel(const SceneObject *obj)
+{
+   if (obj->isGlobalBounds())
+      return OverflowBinLevel;
 
-   U32 minX, maxX, minY, maxY;
-   getBinRange(pWBox->min.x, pWBox->max.x, minX, maxX);
-   getBinRange(pWBox->min.y, pWBox->max.y, minY, maxY);
+   const Box3F &box = obj->getWorldBox();
+   F32 size = getMax(box.len_x(), box.len_y());
 
-   // Store the current regions for later queries
-   obj->mBinMinX = minX;
-   obj->mBinMaxX = maxX;
-   obj->mBinMinY = minY;
-   obj->mBinMaxY = maxY;
+   U32 level = 0;
+   while (level < NumBinLevels && getBinSize(level) < size)
+      level++;
+   return level;
+}
 
-   // For huge objects, dump them into the overflow bin.  Otherwise, everything
-   //  goes into the grid...
-   if ((maxX - minX + 1) < csmNumBins || (maxY - minY + 1) < csmNumBins && !obj->isGlobalBounds())
-   {
-      SceneObjectRef** pCurrInsert = &obj->mBinRefHead;
+U32 Container::hashBin(U32 level, S32 x, S32 y)
+{
+   return (U32(x) * 73856093) ^ (U32(y) * 19349663) ^ (level * 83492791);
+}
 
-      for (U32 i = minY; i <= maxY; i++)
-      {
-         U32 insertY = i % csmNumBins;
-         U32 base    = insertY * csmNumBins;
-         for (U32 j = minX; j <= maxX; j++)
-         {
-            U32 insertX = j % csmNumBins;
+Container::BinCell *Container::findBinCell(U32 level, S32 x, S32 y) const
+{
+   for (BinCell *walk = mBinHash[hashBin(level, x, y) & (mBinHashSize - 1)]; walk; walk = walk->nextInHash)
+      if (walk->x == x && walk->y == y && walk->level == level)
+         return walk;
+   return NULL;
+}
+
+Container::BinCell *Container::allocateBinCell(U32 level, S32 x, S32 y)
+{
+   if (mBinCellCount >= mBinHashSize)
+      growBinHash();
 
-            SceneObjectRef* ref = allocateObjectRef();
+   BinCell *cell = mFreeBinCells;
+   if (cell)
+      mFreeBinCells = cell->nextInHash;
+   else
+      cell = new BinCell;
 
-            ref->object    = obj;
-            ref->nextInBin = mBinArray[base + insertX].nextInBin;
-            ref->prevInBin = &mBinArray[base + insertX];
-            ref->nextInObj = NULL;
+   cell->x = x;
+   cell->y = y;
+   cell->level = level;
+   cell->list.object    = NULL;
+   cell->list.nextInBin = NULL;
+   cell->list.prevInBin = NULL;
+   cell->list.nextInObj = NULL;
 
-            if (mBinArray[base + insertX].nextInBin)
-               mBinArray[base + insertX].nextInBin->prevInBin = ref;
-            mBinArray[base + insertX].nextInBin = ref;
+   U32 index = hashBin(level, x, y) & (mBinHashSize - 1);
+   cell->nextInHash = mBinHash[index];
+   mBinHash[index] = cell;
 
-            *pCurrInsert = ref;
-            pCurrInsert  = &ref->nextInObj;
-         }
-      }
-   }
+   cell->prevInLevel = NULL;
+   cell->nextInLevel = mLevelCells[level];
+   if (mLevelCells[level])
+      mLevelCells[level]->prevInLevel = cell;
+   mLevelCells[level] = cell;
+
+   mLevelCellCounts[level]++;
+   mBinCellCount++;
+   return cell;
+}
+
+void Container::freeBinCell(BinCell *cell)
+{
+   AssertFatal(cell->list.nextInBin == NULL, "Container::freeBinCell - cell isn't empty!");
+
+   BinCell **walk = &mBinHash[hashBin(cell->level, cell->x, cell->y) & (mBinHashSize - 1)];
+   while (*walk != cell)
+      walk = &(*walk)->nextInHash;
+   *walk = cell->nextInHash;
+
+   if (cell->prevInLevel)
+      cell->prevInLevel->nextInLevel = cell->nextInLevel;
    else
-   {
-      SceneObjectRef* ref = allocateObjectRef();
+      mLevelCells[cell->level] = cell->nextInLevel;
+   if (cell->nextInLevel)
+      cell->nextInLevel->prevInLevel = cell->prevInLevel;
 
-      ref->object    = obj;
-      ref->nextInBin = mOverflowBin.nextInBin;
-      ref->prevInBin = &mOverflowBin;
-      ref->nextInObj = NULL;
+   mLevelCellCounts[cell->level]--;
+   mBinCellCount--;
+
+   cell->nextInHash = mFreeBinCells;
+   mFreeBinCells = cell;
+}
 
-      if (mOverflowBin.nextInBin)
-         mOverflowBin.nextInBin->prevInBin = ref;
-      mOverflowBin.nextInBin = ref;
+void Container::growBinHash()
+{
+   U32 newSize = mBinHashSize << 1;
+   BinCell **table = new BinCell*[newSize];
+   dMemset(table, 0, newSize * sizeof(BinCell*));
 
-      obj->mBinRefHead = ref;
+   for (U32 level = 0; level < NumBinLevels; level++)
+   {
+      for (BinCell *walk = mLevelCells[level]; walk; walk = walk->nextInLevel)
+      {
+         U32 index = hashBin(walk->level, walk->x, walk->y) & (newSize - 1);
+         walk->nextInHash = table[index];
+         table[index] = walk;
+      }
    }
+
+   delete [] mBinHash;
+   mBinHash     = table;
+   mBinHashSize = newSize;
 }
 
-void Container::insertIntoBins(SceneObject* obj,
-                               U32 minX, U32 maxX,
-                               U32 minY, U32 maxY)
+void Container::dumpBinStats()
 {
-   AssertFatal(obj != NULL, "No object?");
+   U32 overflow = 0;
+   for (SceneObjectRef* walk = mOverflowBin.nextInBin; walk; walk = walk->nextInBin)
+      overflow++;
 
-   AssertFatal(obj->mBinRefHead == NULL, "Error, already have a bin chain!");
-   // Store the current regions for later queries
-   obj->mBinMinX = minX;
-   obj->mBinMaxX = maxX;
-   obj->mBinMinY = minY;
-   obj->mBinMaxY = maxY;
-
-   // For huge objects, dump them into the overflow bin.  Otherwise, everything
-   //  goes into the grid...
-   //
-   if ((maxX - minX + 1) < csmNumBins || (maxY - minY + 1) < csmNumBins && !obj->isGlobalBounds())
+   Con::printf("Container bins: %d cells, %d hash buckets, %d objects in the overflow bin",
+      mBinCellCount, mBinHashSize, overflow);
+   for (U32 level = 0; level < NumBinLevels; level++)
    {
-      SceneObjectRef** pCurrInsert = &obj->mBinRefHead;
+      if (!mLevelCellCounts[level])
+         continue;
+
+      U32 objects = 0;
+      for (BinCell *cell = mLevelCells[level]; cell; cell = cell->nextInLevel)
+         for (SceneObjectRef* walk = cell->list.nextInBin; walk; walk = walk->nextInBin)
+            objects++;
+      Con::printf("   %6g units: %6d cells, %7d objects", getBinSize(level), mLevelCellCounts[level], objects);
+   }
+}
 
-      for (U32 i = minY; i <= maxY; i++)
-      {
-         U32 insertY = i % csmNumBins;
-         U32 base    = insertY * csmNumBins;
-         for (U32 j = minX; j <= maxX; j++)
-         {
-            U32 insertX = j % csmNumBins;
+//----------------------------------------------------------------------------
+
+void Container::insertIntoBins(SceneObject* obj)
+{
+   AssertFatal(obj != NULL, "No object?");
 
-            SceneObjectRef* ref = allocateObjectRef();
+   U32 level = getBinLevel(obj);
+   S32 x = 0, y = 0;
+   if (level != OverflowBinLevel)
+   {
+      F32 size = getBinSize(level);
+      x = getBinCoord(obj->getWorldBox().min.x, size);
+      y = getBinCoord(obj->getWorldBox().min.y, size);
+   }
+   insertIntoBins(obj, level, x, y);
+}
 
-            ref->object    = obj;
-            ref->nextInBin = mBinArray[base + insertX].nextInBin;
-            ref->prevInBin = &mBinArray[base + insertX];
-            ref->nextInObj = NULL;
+void Container::insertIntoBins(SceneObject* obj, U32 level, S32 x, S32 y)
+{
+   AssertFatal(obj != NULL, "No object?");
+   AssertFatal(obj->mBinRefHead == NULL, "Error, already have a bin chain!");
 
-            if (mBinArray[base + insertX].nextInBin)
-               mBinArray[base + insertX].nextInBin->prevInBin = ref;
-            mBinArray[base + insertX].nextInBin = ref;
+   // Store the current cell for later queries
+   obj->mBinLevel = level;
+   obj->mBinX     = x;
+   obj->mBinY     = y;
 
-            *pCurrInsert = ref;
-            pCurrInsert  = &ref->nextInObj;
-         }
-      }
-   }
+   SceneObjectRef* bin;
+   if (level == OverflowBinLevel)
+      bin = &mOverflowBin;
    else
    {
-      SceneObjectRef* ref = allocateObjectRef();
+      BinCell* cell = findBinCell(level, x, y);
+      if (!cell)
+         cell = allocateBinCell(level, x, y);
+      bin = &cell->list;
+   }
 
-      ref->object    = obj;
-      ref->nextInBin = mOverflowBin.nextInBin;
-      ref->prevInBin = &mOverflowBin;
-      ref->nextInObj = NULL;
+   SceneObjectRef* ref = allocateObjectRef();
 
-      if (mOverflowBin.nextInBin)
-         mOverflowBin.nextInBin->prevInBin = ref;
-      mOverflowBin.nextInBin = ref;
-      obj->mBinRefHead = ref;
-   }
+   ref->object    = obj;
+   ref->nextInBin = bin->nextInBin;
+   ref->prevInBin = bin;
+   ref->nextInObj = NULL;
+
+   if (bin->nextInBin)
+      bin->nextInBin->prevInBin = ref;
+   bin->nextInBin = ref;
+
+   obj->mBinRefHead = ref;
 }
 
 void Container::removeFromBins(SceneObject* obj)
 {
    AssertFatal(obj != NULL, "No object?");
 
-   SceneObjectRef* chain = obj->mBinRefHead;
+   SceneObjectRef* trash = obj->mBinRefHead;
+   if (!trash)
+      return;
    obj->mBinRefHead = NULL;
 
-   while (chain)
-   {
-      SceneObjectRef* trash = chain;
-      chain = chain->nextInObj;
+   AssertFatal(trash->prevInBin != NULL, "Error, must have a previous entry in the bin!");
+   if (trash->nextInBin)
+      trash->nextInBin->prevInBin = trash->prevInBin;
+   trash->prevInBin->nextInBin = trash->nextInBin;
+   freeObjectRef(trash);
 
-      AssertFatal(trash->prevInBin != NULL, "Error, must have a previous entry in the bin!");
-      if (trash->nextInBin)
-         trash->nextInBin->prevInBin = trash->prevInBin;
-      trash->prevInBin->nextInBin = trash->nextInBin;
-
-      freeObjectRef(trash);
+   // Empty cells go, so queries only ever see ones with something in them.
+   if (obj->mBinLevel != OverflowBinLevel)
+   {
+      BinCell* cell = findBinCell(obj->mBinLevel, obj->mBinX, obj->mBinY);
+      AssertFatal(cell != NULL, "Container::removeFromBins - object's cell is missing!");
+      if (!cell->list.nextInBin)
+         freeBinCell(cell);
    }
 }
 
@@ -1053,75 +1244,86 @@ void Container::checkBins(SceneObject* obj)
    }
 
    // Otherwise, the object is already in the bins.  Let's see if it has strayed out of
-   //  the bins that it's currently in...
-   const Box3F* pWBox = &obj->getWorldBox();
-
-   U32 minX, maxX, minY, maxY;
-   getBinRange(pWBox->min.x, pWBox->max.x, minX, maxX);
-   getBinRange(pWBox->min.y, pWBox->max.y, minY, maxY);
+   //  the cell that it's currently in...
+   U32 level = getBinLevel(obj);
+   S32 x = 0, y = 0;
+   if (level != OverflowBinLevel)
+   {
+      F32 size = getBinSize(level);
+      x = getBinCoord(obj->getWorldBox().min.x, size);
+      y = getBinCoord(obj->getWorldBox().min.y, size);
+   }
 
-   if (obj->mBinMinX != minX || obj->mBinMaxX != maxX ||
-       obj->mBinMinY != minY || obj->mBinMaxY != maxY)
+   if (obj->mBinLevel != level || obj->mBinX != x || obj->mBinY != y)
    {
       // We have to rebin the object
       removeFromBins(obj);
-      insertIntoBins(obj, minX, maxX, minY, maxY);
+      insertIntoBins(obj, level, x, y);
    }
 }
 
 
-void Container::findObjects(const Box3F& box, U32 mask, FindCallback callback, void *key)
+//----------------------------------------------------------------------------
+
+void Container::findInList(SceneObjectRef* list, const Box3F& box, U32 mask, FindCallback callback, void *key)
 {
-   U32 minX, maxX, minY, maxY;
-   getBinRange(box.min.x, box.max.x, minX, maxX);
-   getBinRange(box.min.y, box.max.y, minY, maxY);
-   smCurrSeqKey++;
-   for (U32 i = minY; i <= maxY; i++)
+   SceneObjectRef* chain = list->nextInBin;
+   while (chain)
    {
-      U32 insertY = i % csmNumBins;
-      U32 base    = insertY * csmNumBins;
-      for (U32 j = minX; j <= maxX; j++)
+      // The callback may take the object out of the bin.
+      SceneObjectRef* next = chain->nextInBin;
+      SceneObject* ptr = chain->object;
+
+      if ((ptr->getType() & mask) != 0 && ptr->isCollisionEnabled())
       {
-         U32 insertX = j % csmNumBins;
+         if (ptr->getWorldBox().isOverlapped(box) || ptr->isGlobalBounds())
+            (*callback)(ptr, key);
+      }
+      chain = next;
+   }
+}
 
-         SceneObjectRef* chain = mBinArray[base + insertX].nextInBin;
-         while (chain)
-         {
-            if (chain->object->getContainerSeqKey() != smCurrSeqKey)
-            {
-               chain->object->setContainerSeqKey(smCurrSeqKey);
+void Container::findObjects(const Box3F& box, U32 mask, FindCallback callback, void *key)
+{
+   for (U32 level = 0; level < NumBinLevels; level++)
+   {
+      if (!mLevelCellCounts[level])
+         continue;
 
-               if ((chain->object->getType() & mask) != 0 &&
-                   chain->object->isCollisionEnabled())
-               {
-                  if (chain->object->getWorldBox().isOverlapped(box) || chain->object->isGlobalBounds())
-                  {
-                     (*callback)(chain->object,key);
-                  }
-               }
-            }
-            chain = chain->nextInBin;
+      // Objects reach up to a cell past their own in x and y.
+      F32 size = getBinSize(level);
+      S32 minX = getBinCoord(box.min.x, size) - 1;
+      S32 maxX = getBinCoord(box.max.x, size);
+      S32 minY = getBinCoord(box.min.y, size) - 1;
+      S32 maxY = getBinCoord(box.max.y, size);
+
+      if (F64(maxX - minX + 1) * F64(maxY - minY + 1) > mLevelCellCounts[level])
+      {
+         // Fewer cells on the level than in the box, check them all.
+         BinCell* cell = mLevelCells[level];
+         while (cell)
+         {
+            BinCell* next = cell->nextInLevel;
+            if (cell->x >= minX && cell->x <= maxX && cell->y >= minY && cell->y <= maxY)
+               findInList(&cell->list, box, mask, callback, key);
+            cell = next;
          }
       }
-   }
-   SceneObjectRef* chain = mOverflowBin.nextInBin;
-   while (chain)
-   {
-      if (chain->object->getContainerSeqKey() != smCurrSeqKey)
+      else
       {
-         chain->object->setContainerSeqKey(smCurrSeqKey);
-
-         if ((chain->object->getType() & mask) != 0 &&
-             chain->object->isCollisionEnabled())
+         for (S32 y = minY; y <= maxY; y++)
          {
-            if (chain->object->getWorldBox().isOverlapped(box) || chain->object->isGlobalBounds())
+            for (S32 x = minX; x <= maxX; x++)
             {
-               (*callback)(chain->object,key);
+               BinCell* cell = findBinCell(level, x, y);
+               if (cell)
+                  findInList(&cell->list, box, mask, callback, key);
             }
          }
       }
-      chain = chain->nextInBin;
    }
+
+   findInList(&mOverflowBin, box, mask, callback, key);
 }
 
 
@@ -1137,323 +1339,313 @@ void Container::polyhedronFindObjects(const Polyhedron& polyhedron, U32 mask, Fi
       box.max.setMax(polyhedron.pointList[i]);
    }
 
-   U32 minX, maxX, minY, maxY;
-   getBinRange(box.min.x, box.max.x, minX, maxX);
-   getBinRange(box.min.y, box.max.y, minY, maxY);
-   smCurrSeqKey++;
-   for (i = minY; i <= maxY; i++)
-   {
-      U32 insertY = i % csmNumBins;
-      U32 base    = insertY * csmNumBins;
-      for (U32 j = minX; j <= maxX; j++)
-      {
-         U32 insertX = j % csmNumBins;
+   findObjects(box, mask, callback, key);
+}
 
-         SceneObjectRef* chain = mBinArray[base + insertX].nextInBin;
-         while (chain)
-         {
-            if (chain->object->getContainerSeqKey() != smCurrSeqKey)
-            {
-               chain->object->setContainerSeqKey(smCurrSeqKey);
 
-               if ((chain->object->getType() & mask) != 0 &&
-                   chain->object->isCollisionEnabled())
-               {
-                  if (chain->object->getWorldBox().isOverlapped(box) || chain->object->isGlobalBounds())
-                  {
-                     (*callback)(chain->object,key);
-                  }
-               }
-            }
-            chain = chain->nextInBin;
-         }
+//----------------------------------------------------------------------------
+
+void Container::castRayObject(SceneObject* ptr, const Point3F &start, const Point3F &end,
+                              RayInfo* info, F32* currentT)
+{
+   Point3F xformedStart, xformedEnd;
+   ptr->mWorldToObj.mulP(start, &xformedStart);
+   ptr->mWorldToObj.mulP(end,   &xformedEnd);
+   xformedStart.convolveInverse(ptr->mObjScale);
+   xformedEnd.convolveInverse(ptr->mObjScale);
+
+   RayInfo ri;
+   if (ptr->castRay(xformedStart, xformedEnd, &ri))
+   {
+      if (ri.t < *currentT)
+      {
+         *info = ri;
+         info->point.interpolate(start, end, info->t);
+         *currentT = ri.t;
       }
    }
-   SceneObjectRef* chain = mOverflowBin.nextInBin;
-   while (chain)
+}
+
+void Container::castRayInList(SceneObjectRef* list, const Point3F &start, const Point3F &end, U32 mask,
+                              RayInfo* info, F32* currentT, DeferredRayList* deferred, U32 ray)
+{
+   for (SceneObjectRef* chain = list->nextInBin; chain; chain = chain->nextInBin)
    {
-      if (chain->object->getContainerSeqKey() != smCurrSeqKey)
+      SceneObject* ptr = chain->object;
+      if ((ptr->getType() & mask) == 0 || !ptr->isCollisionEnabled())
+         continue;
+
+      F32 entryT = 0;
+      if (!ptr->isGlobalBounds())
       {
-         chain->object->setContainerSeqKey(smCurrSeqKey);
+         Point3F normal;
+         if (!ptr->getWorldBox().collideLine(start, end, &entryT, &normal))
+            continue;
+      }
 
-         if ((chain->object->getType() & mask) != 0 &&
-             chain->object->isCollisionEnabled())
-         {
-            if (chain->object->getWorldBox().isOverlapped(box) || chain->object->isGlobalBounds())
-            {
-               (*callback)(chain->object,key);
-            }
-         }
+      if (deferred && !ptr->isCastRayThreadSafe())
+      {
+         deferred->push(ptr, entryT, ray);
+         continue;
       }
-      chain = chain->nextInBin;
+
+      castRayObject(ptr, start, end, info, currentT);
    }
 }
 
+/// True if cell (x, y) is one of those checked when the ray went through (cx, cy).
+static inline bool isBinNeighbour(S32 x, S32 y, S32 cx, S32 cy)
+{
+   return (x == cx || x == cx - 1) && (y == cy || y == cy - 1);
+}
 
-//----------------------------------------------------------------------------
-// DMMNOTE: There are still some optimizations to be done here.  In particular:
-//           - After checking the overflow bin, we can potentially shorten the line
-//             that we rasterize against the grid if there is a collision with say,
-//             the terrain.
-//           - The optimal grid size isn't necessarily what we have set here. possibly
-//             a resolution of 16 meters would give better results
-//           - The line rasterizer is pretty lame.  Unfortunately we can't use a
-//             simple bres. here, since we need to check every grid element that the line
-//             passes through, which bres does _not_ do for us.  Possibly there's a
-//             rasterizer for anti-aliased lines that will serve better than what
-//             we have below.
-//
 bool Container::castRay(const Point3F &start, const Point3F &end, U32 mask, RayInfo* info)
 {
    PROFILE_START(ContainerCastRay);
    F32 currentT = 2.0;
-   smCurrSeqKey++;
-
-   SceneObjectRef* chain = mOverflowBin.nextInBin;
-   static RayInfo ri;
-   ri.material = 0;
-   
-   while (chain)
-   {
-      SceneObject* ptr = chain->object;
-      if (ptr->getContainerSeqKey() != smCurrSeqKey)
-      {
-         ptr->setContainerSeqKey(smCurrSeqKey);
-
-         // In the overflow bin, the world box is always going to intersect the line,
-         //  so we can omit that test...
-         if ((ptr->getType() & mask) != 0 &&
-             ptr->isCollisionEnabled() == true)
-         {
-            Point3F xformedStart, xformedEnd;
-            ptr->mWorldToObj.mulP(start, &xformedStart);
-            ptr->mWorldToObj.mulP(end,   &xformedEnd);
-            xformedStart.convolveInverse(ptr->mObjScale);
-            xformedEnd.convolveInverse(ptr->mObjScale);
+   castRayBins(start, end, mask, info, &currentT);
+   bool hit = finishRayCast(info, currentT);
+   PROFILE_END();
+   return hit;
+}
 
-            if (ptr->castRay(xformedStart, xformedEnd, &ri))
-            {
-               if(ri.t < currentT)
-               {
-                  *info = ri;
-                  info->point.interpolate(start, end, info->t);
-                  currentT = ri.t;
-               }
-            }
-         }
-      }
-      chain = chain->nextInBin;
-   }
+void Container::castRayBins(const Point3F &start, const Point3F &end, U32 mask, RayInfo* info, F32* currentT,
+                            DeferredRayList* deferred, U32 ray)
+{
+   castRayInList(&mOverflowBin, start, end, mask, info, currentT, deferred, ray);
 
-   // These are just for rasterizing the line against the grid.  We want the x coord
-   //  of the start to be <= the x coord of the end
-   Point3F normalStart, normalEnd;
-   if (start.x <= end.x)
+   // Big cells first; anything they hit means the smaller levels only need
+   // checking up to that point.
+   for (S32 level = NumBinLevels - 1; level >= 0; level--)
    {
-      normalStart = start;
-      normalEnd   = end;
-   }
-   else
-   {
-      normalStart = end;
-      normalEnd   = start;
-   }
+      if (!mLevelCellCounts[level])
+         continue;
 
-   // Ok, let's scan the grids.  The simplest way to do this will be to scan across in
-   //  x, finding the y range for each affected bin...
-   U32 minX, maxX;
-   U32 minY, maxY;
-//if (normalStart.x == normalEnd.x)
-//   Con::printf("X start = %g, end = %g", normalStart.x, normalEnd.x);
+      Point3F rayEnd = end;
+      if (*currentT < 1)
+         rayEnd.interpolate(start, end, *currentT);
 
-   getBinRange(normalStart.x, normalEnd.x, minX, maxX);
-   getBinRange(getMin(normalStart.y, normalEnd.y),
-               getMax(normalStart.y, normalEnd.y), minY, maxY);
+      F32 size = getBinSize(level);
+      S32 x    = getBinCoord(start.x, size);
+      S32 y    = getBinCoord(start.y, size);
+      S32 endX = getBinCoord(rayEnd.x, size);
+      S32 endY = getBinCoord(rayEnd.y, size);
+      U32 steps = mAbs(endX - x) + mAbs(endY - y);
 
-//if (normalStart.x == normalEnd.x && minX != maxX)
-//   Con::printf("X min = %d, max = %d", minX, maxX);
-//if (normalStart.y == normalEnd.y && minY != maxY)
-//   Con::printf("Y min = %d, max = %d", minY, maxY);
-
-   // We'll optimize the case that the line is contained in one bin row or column, which
-   //  will be quite a few lines.  No sense doing more work than we have to...
-   //
-   if ((mFabs(normalStart.x - normalEnd.x) < csmTotalBinSize && minX == maxX) ||
-       (mFabs(normalStart.y - normalEnd.y) < csmTotalBinSize && minY == maxY))
-   {
-      U32 count;
-      U32 incX, incY;
-      if (minX == maxX)
-      {
-         count = maxY - minY + 1;
-         incX  = 0;
-         incY  = 1;
-      }
-      else
+      if (steps >= mLevelCellCounts[level])
       {
-         count = maxX - minX + 1;
-         incX  = 1;
-         incY  = 0;
+         // Fewer cells on the level than along the ray, check them all.
+         for (BinCell* cell = mLevelCells[level]; cell; cell = cell->nextInLevel)
+         {
+            Box3F cellBox(Point3F(cell->x * size, cell->y * size, -1e30f),
+                          Point3F((cell->x + 2) * size, (cell->y + 2) * size, 1e30f));
+            if (cellBox.collideLine(start, rayEnd))
+               castRayInList(&cell->list, start, end, mask, info, currentT, deferred, ray);
+         }
+         continue;
       }
 
-      U32 x = minX;
-      U32 y = minY;
-      for (U32 i = 0; i < count; i++)
+      // Walk the cells along the ray, checking the ones whose objects can
+      // reach into each.  A cell is only ever one of those for up to three
+      // cells in a row, so skipping the ones the last two checked is enough
+      // to check each just once.
+      F32 dx = rayEnd.x - start.x;
+      F32 dy = rayEnd.y - start.y;
+      S32 stepX = endX >= x ? 1 : -1;
+      S32 stepY = endY >= y ? 1 : -1;
+      F32 tDeltaX = dx != 0 ? size / mFabs(dx) : 1e30f;
+      F32 tDeltaY = dy != 0 ? size / mFabs(dy) : 1e30f;
+      F32 tMaxX = dx != 0 ? ((stepX > 0 ? x + 1 : x) * size - start.x) / dx : 1e30f;
+      F32 tMaxY = dy != 0 ? ((stepY > 0 ? y + 1 : y) * size - start.y) / dy : 1e30f;
+
+      S32 prevX[2], prevY[2];
+      for (U32 i = 0; ; i++)
       {
-         U32 checkX = x % csmNumBins;
-         U32 checkY = y % csmNumBins;
-
-         SceneObjectRef* chain = mBinArray[(checkY * csmNumBins) + checkX].nextInBin;
-         while (chain)
+         for (S32 cy = y - 1; cy <= y; cy++)
          {
-            SceneObject* ptr = chain->object;
-            if (ptr->getContainerSeqKey() != smCurrSeqKey)
+            for (S32 cx = x - 1; cx <= x; cx++)
             {
-               ptr->setContainerSeqKey(smCurrSeqKey);
+               if ((i > 0 && isBinNeighbour(cx, cy, prevX[0], prevY[0])) ||
+                   (i > 1 && isBinNeighbour(cx, cy, prevX[1], prevY[1])))
+                  continue;
 
-               if ((ptr->getType() & mask) != 0      &&
-                   ptr->isCollisionEnabled() == true)
-               {
-                  if (ptr->getWorldBox().collideLine(start, end) || chain->object->isGlobalBounds())
-                  {
-                     Point3F xformedStart, xformedEnd;
-                     ptr->mWorldToObj.mulP(start, &xformedStart);
-                     ptr->mWorldToObj.mulP(end,   &xformedEnd);
-                     xformedStart.convolveInverse(ptr->mObjScale);
-                     xformedEnd.convolveInverse(ptr->mObjScale);
-
-                     RayInfo ri;
-                     if (ptr->castRay(xformedStart, xformedEnd, &ri))
-                     {
-                        if(ri.t < currentT)
-                        {
-                           *info = ri;
-                           info->point.interpolate(start, end, info->t);
-                           currentT = ri.t;
-                        }
-                     }
-                  }
-               }
+               BinCell* cell = findBinCell(level, cx, cy);
+               if (cell)
+                  castRayInList(&cell->list, start, end, mask, info, currentT, deferred, ray);
             }
-            chain = chain->nextInBin;
          }
 
-         x += incX;
-         y += incY;
+         if (i == steps)
+            break;
+
+         prevX[1] = prevX[0];
+         prevY[1] = prevY[0];
+         prevX[0] = x;
+         prevY[0] = y;
+
+         if (x != endX && (y == endY || tMaxX < tMaxY))
+         {
+            x += stepX;
+            tMaxX += tDeltaX;
+         }
+         else
+         {
+            y += stepY;
+            tMaxY += tDeltaY;
+         }
       }
    }
-   else
+
+}
+
+bool Container::finishRayCast(RayInfo* info, F32 currentT)
+{
+   // Bump the normal into worldspace if appropriate.
+   if(currentT != 2)
    {
-      // Oh well, let's earn our keep.  We know that after the above conditional, we're
-      //  going to cross at least one boundary, so that simplifies our job...
+      PlaneF fakePlane;
+      fakePlane.x = info->normal.x;
+      fakePlane.y = info->normal.y;
+      fakePlane.z = info->normal.z;
+      fakePlane.d = 0;
 
-      F32 currStartX = normalStart.x;
+      PlaneF result;
+      mTransformPlane(info->object->getTransform(), info->object->getScale(), fakePlane, &result);
+      info->normal = result;
+      return true;
+   }
+   return false;
+}
 
-      AssertFatal(currStartX != normalEnd.x, "This is going to cause problems in Container::castRay");
-      while (currStartX != normalEnd.x)
-      {
-         F32 currEndX   = getMin(currStartX + csmTotalBinSize, normalEnd.x);
+//----------------------------------------------------------------------------
 
-         F32 currStartT = (currStartX - normalStart.x) / (normalEnd.x - normalStart.x);
-         F32 currEndT   = (currEndX   - normalStart.x) / (normalEnd.x - normalStart.x);
+#ifdef TORQUE_MULTITHREAD
+/// Everything a batch of rays needs comes out of one arena, so a steady
+/// stream of batches doesn't allocate.
+static PooledArena sRayCastArena("container.rayCasts");
+static bool        sRayCastArenaInUse = false;
+#endif
 
-         F32 y1 = normalStart.y + (normalEnd.y - normalStart.y) * currStartT;
-         F32 y2 = normalStart.y + (normalEnd.y - normalStart.y) * currEndT;
+/// Casts a run of a batch's rays on the thread pool.
+class RayCastBatchItem : public ThreadPool::WorkItem
+{
+public:
+   Container *mContainer;
+   Container::RayQuery *mRays;
+   U32 mCount;
+   Container::DeferredRayList mDeferred;
 
-         U32 subMinX, subMaxX;
-         getBinRange(currStartX, currEndX, subMinX, subMaxX);
+   void execute() { mContainer->castRayRange(mRays, mCount, &mDeferred); }
+};
 
-         F32 subStartX = currStartX;
-         F32 subEndX   = currStartX;
+static S32 QSORT_CALLBACK cmpDeferredRayObjects(const void *a, const void *b)
+{
+   const Container::DeferredRayObject *da = (const Container::DeferredRayObject *) a;
+   const Container::DeferredRayObject *db = (const Container::DeferredRayObject *) b;
+   if (da->ray != db->ray)
+      return S32(da->ray) - S32(db->ray);
+   return da->t < db->t ? -1 : (da->t > db->t ? 1 : 0);
+}
 
-         if (currStartX < 0.0f)
-            subEndX -= mFmod(subEndX, csmBinSize);
-         else
-            subEndX += (csmBinSize - mFmod(subEndX, csmBinSize));
+void Container::DeferredRayList::push(SceneObject *object, F32 t, U32 ray)
+{
+   if (count == capacity)
+   {
+      // The old array stays in the arena until the batch is done with.
+      capacity = capacity ? capacity * 2 : 32;
+      DeferredRayObject *grown = arena->alloc<DeferredRayObject>(capacity);
+      if (count)
+         dMemcpy(grown, objects, sizeof(DeferredRayObject) * count);
+      objects = grown;
+   }
 
-         for (U32 currXBin = subMinX; currXBin <= subMaxX; currXBin++)
-         {
-            U32 checkX = currXBin % csmNumBins;
+   DeferredRayObject &entry = objects[count++];
+   entry.object = object;
+   entry.t      = t;
+   entry.ray    = ray;
+}
 
-            F32 subStartT = (subStartX - currStartX) / (currEndX - currStartX);
-            F32 subEndT   = getMin(F32((subEndX   - currStartX) / (currEndX - currStartX)), 1.f);
+void Container::castRayRange(RayQuery* rays, U32 count, DeferredRayList* deferred)
+{
+   for (U32 i = 0; i < count; i++)
+   {
+      F32 currentT = 2.0;
+      castRayBins(rays[i].start, rays[i].end, rays[i].mask, &rays[i].info, &currentT, deferred, i);
+      rays[i].hit = currentT != 2;
+   }
+}
 
-            F32 subY1 = y1 + (y2 - y1) * subStartT;
-            F32 subY2 = y1 + (y2 - y1) * subEndT;
+void Container::castRays(RayQuery* rays, U32 count)
+{
+   PROFILE_START(ContainerCastRays);
 
-            U32 newMinY, newMaxY;
-            getBinRange(getMin(subY1, subY2), getMax(subY1, subY2), newMinY, newMaxY);
+#ifdef TORQUE_MULTITHREAD
+   // The batch arena and its in-use flag are shared.
+   AssertFatal(Thread::isMainThread(), "Container::castRays - only on the main thread.");
 
-            for (U32 i = newMinY; i <= newMaxY; i++)
-            {
-               U32 checkY = i % csmNumBins;
+   enum { RaysPerItem = 64 };
+   U32 itemCount = (count + RaysPerItem - 1) / RaysPerItem;
 
-               SceneObjectRef* chain = mBinArray[(checkY * csmNumBins) + checkX].nextInBin;
-               while (chain)
-               {
-                  SceneObject* ptr = chain->object;
-                  if (ptr->getContainerSeqKey() != smCurrSeqKey)
-                  {
-                     ptr->setContainerSeqKey(smCurrSeqKey);
+   // A castRay() run from the deferred list could cast a batch of its own,
+   // which goes the serial way rather than reset the arena under us.
+   if (smParallelRayCasts && itemCount > 1 && !sRayCastArenaInUse)
+   {
+      sRayCastArenaInUse = true;
+      RayCastBatchItem *items = sRayCastArena.alloc<RayCastBatchItem>(itemCount);
+      ThreadPool::WorkGroup group;
+      for (U32 i = 0; i < itemCount; i++)
+      {
+         constructInPlace(&items[i]);
+         items[i].mDeferred.objects  = NULL;
+         items[i].mDeferred.count    = 0;
+         items[i].mDeferred.capacity = 0;
+         items[i].mDeferred.arena    = &sRayCastArena;
+         items[i].mContainer = this;
+         items[i].mRays      = rays + i * RaysPerItem;
+         items[i].mCount     = getMin(U32(RaysPerItem), count - i * RaysPerItem);
+         ThreadPool::GLOBAL().queueWorkItem(&items[i], &group);
+      }
+      ThreadPool::GLOBAL().waitForGroup(&group);
 
-                     if ((ptr->getType() & mask) != 0      &&
-                         ptr->isCollisionEnabled() == true)
-                     {
-                        if (ptr->getWorldBox().collideLine(start, end))
-                        {
-                           Point3F xformedStart, xformedEnd;
-                           ptr->mWorldToObj.mulP(start, &xformedStart);
-                           ptr->mWorldToObj.mulP(end,   &xformedEnd);
-                           xformedStart.convolveInverse(ptr->mObjScale);
-                           xformedEnd.convolveInverse(ptr->mObjScale);
-
-                           if (ptr->castRay(xformedStart, xformedEnd, &ri))
-                           {
-                              if(ri.t < currentT)
-                              {
-                                 *info = ri;
-                                 info->point.interpolate(start, end, info->t);
-                                 currentT = ri.t;
-                              }
-                           }
-                        }
-                     }
-                  }
-                  chain = chain->nextInBin;
-               }
-            }
+      // Now the objects that have to be done here, nearest first for each
+      // ray, stopping at the first one that starts beyond the best hit.
+      for (U32 i = 0; i < itemCount; i++)
+      {
+         DeferredRayList &deferred = items[i].mDeferred;
+         if (deferred.count > 1)
+            dQsort(deferred.objects, deferred.count, sizeof(DeferredRayObject), cmpDeferredRayObjects);
 
-            subStartX = subEndX;
-            subEndX   = getMin(subEndX + csmBinSize, currEndX);
-         }
+         for (U32 j = 0; j < deferred.count; j++)
+         {
+            RayQuery &ray = items[i].mRays[deferred.objects[j].ray];
+            F32 currentT = ray.hit ? ray.info.t : 2.0f;
+            if (deferred.objects[j].t > currentT)
+               continue;
 
-         currStartX = currEndX;
+            castRayObject(deferred.objects[j].object, ray.start, ray.end, &ray.info, &currentT);
+            ray.hit = currentT != 2;
+         }
+         items[i].~RayCastBatchItem();
       }
-   }
+      sRayCastArena.reset();
+      sRayCastArenaInUse = false;
 
-   // Bump the normal into worldspace if appropriate.
-   if(currentT != 2)
-   {
-      PlaneF fakePlane;
-      fakePlane.x = info->normal.x;
-      fakePlane.y = info->normal.y;
-      fakePlane.z = info->normal.z;
-      fakePlane.d = 0;
-
-      PlaneF result;
-      mTransformPlane(info->object->getTransform(), info->object->getScale(), fakePlane, &result);
-      info->normal = result;
+      for (U32 i = 0; i < count; i++)
+         rays[i].hit = finishRayCast(&rays[i].info, rays[i].hit ? rays[i].info.t : 2.0f);
 
       PROFILE_END();
-      return true;
+      return;
    }
-   else
+#endif
+
+   for (U32 i = 0; i < count; i++)
    {
-      // Do nothing and exit...
-      PROFILE_END();
-      return false;
+      F32 currentT = 2.0;
+      castRayBins(rays[i].start, rays[i].end, rays[i].mask, &rays[i].info, &currentT);
+      rays[i].hit = finishRayCast(&rays[i].info, currentT);
    }
 
+   PROFILE_END();
 }
 
 // collide with the objects projected object box
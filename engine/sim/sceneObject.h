@@ -39,6 +39,7 @@ class Box3F;
 class Point3F;
 class LightManager;
 class Convex;
+class PooledArena;
 
 //----------------------------------------------------------------------------
 /// Extension of the collision structore to allow use with raycasting.
@@ -109,21 +110,120 @@ public:
       void *key;
    };
 
-   static const U32 csmNumBins;
-   static const F32 csmBinSize;
-   static const F32 csmTotalBinSize;
+   /// Called for each object a search finds. The callback may move or
+   /// remove the object it is given. An object it moves into a cell the
+   /// search hasn't reached yet will be found a second time, so callbacks
+   /// that move objects have to cope with that.
+   typedef void (*FindCallback)(SceneObject*,void *key);
+
+   /// @name Bins
+   ///
+   /// Objects are kept in a hashed grid with several levels, each with cells
+   /// twice the size of the level below. An object goes in exactly one cell:
+   /// the one holding its minimum x/y corner, on the smallest level whose
+   /// cells are at least as big as the object. So it lies within that cell
+   /// and its neighbours above in x and y, and a query on a level looks one
+   /// cell further back than the area it covers. Only cells with objects in
+   /// them exist, so the grid covers any size of world without wrapping.
+   /// Objects too big for any level, and ones with global bounds, go in the
+   /// overflow bin, which every query checks.
+   ///
+   /// A query never visits more cells on a level than the level has, so a
+   /// long ray or big box over a sparse level just checks the level's cells.
+   /// @{
+
+   enum BinConstants
+   {
+      NumBinLevels = 14,               ///< csmMinBinSize up to 64K units.
+      OverflowBinLevel = NumBinLevels, ///< Level of objects in the overflow bin.
+      InitialBinHashSize = 1024,
+   };
+
+   struct BinCell
+   {
+      S32 x, y;
+      U32 level;
+      SceneObjectRef list;             ///< Its objects start at list.nextInBin.
+      BinCell *nextInHash;
+      BinCell *nextInLevel;
+      BinCell *prevInLevel;
+   };
+
+   static const F32 csmMinBinSize;
+   /// @}
+
    static const U32 csmRefPoolBlockSize;
-   static U32    smCurrSeqKey;
+
+   /// One ray of a batch for castRays().
+   struct RayQuery
+   {
+      Point3F start;
+      Point3F end;
+      U32     mask;
+      bool    hit;      ///< Set by castRays(); info is only filled in if true.
+      RayInfo info;
+   };
+
+   /// Cast batches of rays across the thread pool.
+   static bool smParallelRayCasts;
+
+   /// An object a worker found on a ray whose castRay() must run on the main
+   /// thread, and where the ray enters its bounds.
+   struct DeferredRayObject
+   {
+      SceneObject *object;
+      F32          t;
+      U32          ray;
+   };
 
 private:
+   friend class RayCastBatchItem;
+
+   /// A worker's DeferredRayObjects. The array comes out of the batch's
+   /// arena and is thrown away with it.
+   struct DeferredRayList
+   {
+      DeferredRayObject *objects;
+      U32                count;
+      U32                capacity;
+      PooledArena       *arena;
+
+      void push(SceneObject *object, F32 t, U32 ray);
+   };
+
    Link mStart,mEnd;
 
    SceneObjectRef*         mFreeRefPool;
    Vector<SceneObjectRef*> mRefPoolBlocks;
 
-   SceneObjectRef* mBinArray;
+   BinCell **mBinHash;
+   U32       mBinHashSize;                  ///< Always a power of two.
+   U32       mBinCellCount;
+   BinCell  *mFreeBinCells;
+   BinCell  *mLevelCells[NumBinLevels];     ///< Cells in use on each level.
+   U32       mLevelCellCounts[NumBinLevels];
    SceneObjectRef  mOverflowBin;
 
+   static F32 getBinSize(U32 level) { return csmMinBinSize * F32(1 << level); }
+   static S32 getBinCoord(F32 coord, F32 binSize);
+   static U32 getBinLevel(const SceneObject *obj);
+   static U32 hashBin(U32 level, S32 x, S32 y);
+
+   BinCell *findBinCell(U32 level, S32 x, S32 y) const;
+   BinCell *allocateBinCell(U32 level, S32 x, S32 y);
+   void     freeBinCell(BinCell *cell);
+   void     growBinHash();
+
+   static void findInList(SceneObjectRef *list, const Box3F &box, U32 mask, FindCallback callback, void *key);
+   static void castRayObject(SceneObject *ptr, const Point3F &start, const Point3F &end,
+                             RayInfo *info, F32 *currentT);
+   static void castRayInList(SceneObjectRef *list, const Point3F &start, const Point3F &end, U32 mask,
+                             RayInfo *info, F32 *currentT, DeferredRayList *deferred, U32 ray);
+   void castRayBins(const Point3F &start, const Point3F &end, U32 mask, RayInfo *info, F32 *currentT,
+                    DeferredRayList *deferred = NULL, U32 ray = 0);
+   static bool finishRayCast(RayInfo *info, F32 currentT);
+   void castRayRange(RayQuery *rays, U32 count, DeferredRayList *deferred);
+
 public:
    Container();
    ~Container();
@@ -132,7 +232,6 @@ public:
    /// @{
 
    ///
-   typedef void (*FindCallback)(SceneObject*,void *key);
    void findObjects(U32 mask, FindCallback, void *key = NULL);
    void findObjects(const Box3F& box, U32 mask, FindCallback, void *key = NULL);
    void polyhedronFindObjects(const Polyhedron& polyhedron, U32 mask,
@@ -144,6 +243,17 @@ public:
 
    ///
    bool castRay(const Point3F &start, const Point3F &end, U32 mask, RayInfo* info);
+
+   /// Cast a batch of rays, as if by castRay() on each one.
+   ///
+   /// The rays are split across the thread pool. Workers walk the bins and
+   /// cast against objects whose castRay() is thread safe. Everything else
+   /// they find is cast afterwards on this thread, nearest first, and only
+   /// if it could still beat the hit the workers found. The call blocks
+   /// until the whole batch is done, so the container and its objects can't
+   /// change under the workers. Main thread only.
+   void castRays(RayQuery *rays, U32 count);
+
    bool collideBox(const Point3F &start, const Point3F &end, U32 mask, RayInfo* info);
    /// @}
 
@@ -173,9 +283,12 @@ public:
 
    /// Checkbins makes sure that we're not just sticking the object right back
    /// where it came from.  The overloaded insertInto is so we don't calculate
-   /// the ranges twice.
+   /// the cell twice.
    void checkBins(SceneObject*);
-   void insertIntoBins(SceneObject*, U32, U32, U32, U32);
+   void insertIntoBins(SceneObject*, U32 level, S32 x, S32 y);
+
+   /// Print how many cells each level of the bins has.
+   void dumpBinStats();
 
 
 private:
@@ -416,6 +529,11 @@ public:
    /// @param   info   Collision information obtained (out)
    virtual bool castRay(const Point3F &start, const Point3F &end, RayInfo* info);
 
+   /// True if castRay() may be called from several threads at once, which
+   /// means it must not touch anything but the object's own unchanging
+   /// data. @see Container::castRays
+   virtual bool isCastRayThreadSafe() const { return false; }
+
    virtual bool collideBox(const Point3F &start, const Point3F &end, RayInfo* info);
 
    /// Returns the position of the object.
@@ -715,31 +833,10 @@ protected:
    SceneObjectRef* mZoneRefHead;
    SceneObjectRef* mBinRefHead;
 
-   U32 mBinMinX;
-   U32 mBinMaxX;
-   U32 mBinMinY;
-   U32 mBinMaxY;
-
-   /// @}
-
-   /// @name Container Interface
-   ///
-   /// When objects are searched, we go through all the zones and ask them for
-   /// all of their objects. Because an object can exist in multiple zones, the
-   /// container sequence key is set to the id of the current search. Then, while
-   /// searching, we check to see if an object's sequence key is the same as the
-   /// current search key. If it is, it will NOT be added to the list of returns
-   /// since it has already been processed.
-   ///
-   /// @{
-
-   U32  mContainerSeqKey;  ///< Container sequence key
-
-   /// Returns the container sequence key
-   U32  getContainerSeqKey() const        { return mContainerSeqKey; }
+   U32 mBinLevel;    ///< Container::OverflowBinLevel if in the overflow bin.
+   S32 mBinX;
+   S32 mBinY;
 
-   /// Sets the container sequence key
-   void setContainerSeqKey(const U32 key) { mContainerSeqKey = key;  }
    /// @}
 
 public:
@@ -799,6 +896,7 @@ private:
    /// @{
 public:
    static void initPersistFields();
+   static void consoleInit();
    void inspectPostApply();
    DECLARE_CONOBJECT(SceneObject);
 
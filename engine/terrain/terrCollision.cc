@@ -782,44 +782,6 @@ BSPNode *TerrainBlock::buildSquareTree(S32 y, S32 x)
 
 //----------------------------------------------------------------------------
 
-static bool calcInterceptX;
-static bool calcInterceptY;
-
-static U32 lineCount;
-static Point3F lineStart, lineEnd;
-
-static void drawLineTest(F32 startT, F32 endT, bool collide)
-{
-   glEnable(GL_DEPTH_TEST);
-   if(lineCount & 1)
-   {
-      if(collide)
-         glColor3f(1.0f, 0.0f, 0.0f);
-      else
-         glColor3f(1.0f, 1.0f, 1.0f);
-   }
-   else
-   {
-      if(collide)
-         glColor3f(0.0f, 1.0f, 0.0f);
-      else
-         glColor3f(0.0f, 0.0f, 0.0f);
-   }
-   lineCount++;
-   glBegin(GL_LINES);
-   Point3F pt;
-   pt.interpolate(lineStart, lineEnd, startT);
-   glVertex3fv(pt);
-   pt.interpolate(lineStart, lineEnd, endT);
-   glVertex3fv(pt);
-   Point3F ptUp = pt;
-   ptUp.z += 4.0f;
-   glVertex3fv(pt);
-   glVertex3fv(ptUp);
-
-   glEnd();
-}
-
 bool TerrainBlock::castRay(const Point3F &start, const Point3F &end, RayInfo *info)
 {
    return castRayI(start, end, info, false);
@@ -827,10 +789,6 @@ bool TerrainBlock::castRay(const Point3F &start, const Point3F &end, RayInfo *in
 
 bool TerrainBlock::castRayI(const Point3F &start, const Point3F &end, RayInfo *info, bool collideEmpty)
 {
-   lineCount = 0;
-   lineStart = start;
-   lineEnd = end;
-
    info->object = this;
 
    if(start.x == end.x && start.y == end.y)
@@ -860,7 +818,9 @@ bool TerrainBlock::castRayI(const Point3F &start, const Point3F &end, RayInfo *i
 
    int dx, dy;
 
-   
+   // No statics in here or in castRayBlock(), the container may cast rays
+   // against terrain from several threads at once.
+   bool calcInterceptX, calcInterceptY;
    F32 invDeltaX;
    if(pEnd.x == pStart.x)
    {
@@ -939,9 +899,11 @@ struct TerrLOSStackNode
 
 bool TerrainBlock::castRayBlock(const Point3F &pStart, const Point3F &pEnd, const Point2I &aBlockPos, U32 aLevel, F32 invDeltaX, F32 invDeltaY, F32 aStartT, F32 aEndT, RayInfo *info, bool collideEmpty)
 {
-   static const F32 invBlockSize = 1.0f / F32(BlockSquareWidth);
+   const F32 invBlockSize = 1.0f / F32(BlockSquareWidth);
+   const bool calcInterceptX = invDeltaX != 0.0f;
+   const bool calcInterceptY = invDeltaY != 0.0f;
 
-   static TerrLOSStackNode stack[BlockShift * 3 + 1];
+   TerrLOSStackNode stack[BlockShift * 3 + 1];
    U32 stackSize = 1;
 
    stack[0].startT   = aStartT;
@@ -968,19 +930,16 @@ bool TerrainBlock::castRayBlock(const Point3F &pStart, const Point3F &pEnd, cons
       F32 minHeight = fixedToFloat(sq->minHeight);
       if(startZ <= minHeight && endZ <= minHeight)
       {
-         //drawLineTest(startT, sn->endT, false);
          continue;
       }
       F32 maxHeight = fixedToFloat(sq->maxHeight);
       if(startZ >= maxHeight && endZ >= maxHeight)
       {
-         //drawLineTest(startT, endT, false);
          continue;
       }
       if (!collideEmpty && (sq->flags & GridSquare::Empty) &&
       	  blockPos.x == (blockPos.x & BlockMask) && blockPos.y == (blockPos.y & BlockMask))
       {
-         //drawLineTest(startT, endT, false);
          continue;
       }
       if(level == 0)
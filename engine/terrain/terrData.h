@@ -297,6 +297,7 @@ class TerrainBlock : public SceneObject
    bool buildPolyList(AbstractPolyList* polyList, const Box3F &box, const SphereF &sphere);
    BSPNode *buildCollisionBSP(BSPTree *tree, const Box3F &box, const SphereF &sphere);
    bool castRay(const Point3F &start, const Point3F &end, RayInfo* info);
+   bool isCastRayThreadSafe() const { return true; }
    bool castRayI(const Point3F &start, const Point3F &end, RayInfo* info, bool emptyCollide);
    bool castRayBlock(const Point3F &pStart, const Point3F &pEnd, const Point2I &blockPos, U32 level, F32 invDeltaX, F32 invDeltaY, F32 startT, F32 endT, RayInfo *info, bool);
   private: